@@ -53,6 +53,7 @@
  */
 
 #include <string.h>
+#include <math.h>
 
 #include "constants.h"
 #include "dep/constants_dep.h"
@@ -182,8 +183,7 @@ void initData(RunTimeOpts *rtOpts, PtpClock *ptpClock)
 	      ether_addr_octet(&macaddr)[PTP_UUID_LENGTH - 2]);
 
 	/*Init other stuff*/
-	ptpClock->number_foreign_records = 0;
-  	ptpClock->max_foreign_records = rtOpts->max_foreign_records;
+	clearForeignMasters(ptpClock);
 }
 
 /* memcmp behaviour: -1: a<b, 1: a>b, 0: a=b */
@@ -764,6 +764,7 @@ UInteger8
 bmc(ForeignMasterRecord *foreignMaster,
     const RunTimeOpts *rtOpts, PtpClock *ptpClock)
 {
+	ForeignMasterIndex *index = &ptpClock->foreignIndex;
 	Integer16 i,best;
 
 	DBGV("number_foreign_records : %d \n", ptpClock->number_foreign_records);
@@ -773,10 +774,26 @@ bmc(ForeignMasterRecord *foreignMaster,
 			return ptpClock->portDS.portState;
 		}
 
-	for (i=1,best = 0; i<ptpClock->number_foreign_records;i++)
-		if ((bmcDataSetComparison(&foreignMaster[i], &foreignMaster[best],
-					  ptpClock, rtOpts)) < 0)
-			best = i;
+	/*
+	 * the best record is kept up to date as records are added or improve (see foreignMasterChanged()),
+	 * so they only all need comparing when one got worse or left, or what they are compared against changed
+	 */
+	if (index->best >= 0 && index->best < ptpClock->number_foreign_records &&
+	    !memcmp(&index->bestParent, &ptpClock->parentDS.parentPortIdentity, sizeof(PortIdentity)) &&
+	    index->bestDomain == ptpClock->defaultDS.domainNumber) {
+		best = index->best;
+	} else {
+		for (i=1,best = 0; i<ptpClock->number_foreign_records;i++)
+			if ((bmcDataSetComparison(&foreignMaster[i], &foreignMaster[best],
+						  ptpClock, rtOpts)) < 0)
+				best = i;
+
+		if (ptpClock->number_foreign_records) {
+			index->best = best;
+			index->bestParent = ptpClock->parentDS.parentPortIdentity;
+			index->bestDomain = ptpClock->defaultDS.domainNumber;
+		}
+	}
 
 	DBGV("Best record : %d \n",best);
 	ptpClock->foreign_record_best = best;
@@ -784,3 +801,341 @@ bmc(ForeignMasterRecord *foreignMaster,
 	return (bmcStateDecision(ptpClock->bestMaster,
 				 rtOpts,ptpClock));
 }
+
+/*
+ * Foreign master record table: records are kept packed in ptpClock->foreign[0..number_foreign_records-1]
+ * so bmc() can walk them, looked up through a hash index of port identities, and linked in a list
+ * ordered by the time their last Announce was received, so that records can be aged out and the
+ * least recently heard from one can be reused when the table is full.
+ */
+
+static int
+foreignSlot(ForeignMasterIndex *index, const PortIdentity *portIdentity)
+{
+	return fnvHash((void*)portIdentity, sizeof(PortIdentity), index->size);
+}
+
+static void
+lruUnlink(PtpClock *ptpClock, int i)
+{
+	ForeignMasterRecord *record = &ptpClock->foreign[i];
+	ForeignMasterIndex *index = &ptpClock->foreignIndex;
+
+	if(record->lruNewer >= 0) {
+		ptpClock->foreign[record->lruNewer].lruOlder = record->lruOlder;
+	} else {
+		index->newest = record->lruOlder;
+	}
+
+	if(record->lruOlder >= 0) {
+		ptpClock->foreign[record->lruOlder].lruNewer = record->lruNewer;
+	} else {
+		index->oldest = record->lruNewer;
+	}
+
+	record->lruNewer = record->lruOlder = -1;
+}
+
+static void
+lruPushNewest(PtpClock *ptpClock, int i)
+{
+	ForeignMasterRecord *record = &ptpClock->foreign[i];
+	ForeignMasterIndex *index = &ptpClock->foreignIndex;
+
+	record->lruNewer = -1;
+	record->lruOlder = index->newest;
+	if(index->newest >= 0) {
+		ptpClock->foreign[index->newest].lruNewer = i;
+	} else {
+		index->oldest = i;
+	}
+	index->newest = i;
+}
+
+/* slot holding foreign record number i */
+static int
+findForeignSlot(PtpClock *ptpClock, int i)
+{
+	ForeignMasterIndex *index = &ptpClock->foreignIndex;
+	int mask = index->size - 1;
+	int slot;
+
+	for(slot = foreignSlot(index, &ptpClock->foreign[i].foreignMasterPortIdentity);
+	    index->slots[slot] != i + 1; slot = (slot + 1) & mask);
+
+	return slot;
+}
+
+/* remove foreign record number i, moving the last record into its place */
+static void
+removeForeignMaster(PtpClock *ptpClock, int i)
+{
+	ForeignMasterIndex *index = &ptpClock->foreignIndex;
+	ForeignMasterRecord *record;
+	int mask = index->size - 1;
+	int last = ptpClock->number_foreign_records - 1;
+	int slot, next, home;
+#ifdef PTPD_DBG
+	char idStr[50];
+
+	snprint_PortIdentity(idStr, sizeof(idStr), &ptpClock->foreign[i].foreignMasterPortIdentity);
+	DBG("Foreign master %s removed\n", idStr);
+#endif /* PTPD_DBG */
+
+	/* empty the slot, moving back records further along the probe run so they stay reachable */
+	slot = findForeignSlot(ptpClock, i);
+	index->slots[slot] = 0;
+	for(next = (slot + 1) & mask; index->slots[next]; next = (next + 1) & mask) {
+		home = foreignSlot(index, &ptpClock->foreign[index->slots[next] - 1].foreignMasterPortIdentity);
+		if(((next - home) & mask) >= ((next - slot) & mask)) {
+			index->slots[slot] = index->slots[next];
+			index->slots[next] = 0;
+			slot = next;
+		}
+	}
+
+	lruUnlink(ptpClock, i);
+
+	if(index->best == i) {
+		index->best = -1;
+	} else if(index->best == last) {
+		index->best = i;
+	}
+
+	if(i != last) {
+		index->slots[findForeignSlot(ptpClock, last)] = i + 1;
+		ptpClock->foreign[i] = ptpClock->foreign[last];
+		record = &ptpClock->foreign[i];
+		if(record->lruNewer >= 0) {
+			ptpClock->foreign[record->lruNewer].lruOlder = i;
+		} else {
+			index->newest = i;
+		}
+		if(record->lruOlder >= 0) {
+			ptpClock->foreign[record->lruOlder].lruNewer = i;
+		} else {
+			index->oldest = i;
+		}
+		if(ptpClock->bestMaster == &ptpClock->foreign[last]) {
+			ptpClock->bestMaster = record;
+			ptpClock->foreign_record_best = i;
+		}
+	}
+
+	memset(&ptpClock->foreign[last], 0, sizeof(ForeignMasterRecord));
+	ptpClock->number_foreign_records--;
+	ptpClock->counters.foreignRemoved++;
+	ptpClock->counters.foreignCount = ptpClock->number_foreign_records;
+}
+
+/* allocate (or resize) the foreign master record table, emptying it */
+Boolean
+allocForeignMasterTable(PtpClock *ptpClock, int capacity)
+{
+	int size = 8;
+	ForeignMasterRecord *foreign;
+	int *slots;
+
+	/* keep the index at most half full with the whole table in use */
+	while(size < 2 * capacity) {
+		size <<= 1;
+	}
+
+	foreign = (ForeignMasterRecord*)calloc(capacity, sizeof(ForeignMasterRecord));
+	slots = (int*)calloc(size, sizeof(int));
+
+	if(foreign == NULL || slots == NULL) {
+		PERROR("failed to allocate memory for %d foreign master records", capacity);
+		free(foreign);
+		free(slots);
+		return FALSE;
+	}
+
+	freeForeignMasterTable(ptpClock);
+
+	ptpClock->foreign = foreign;
+	ptpClock->foreignIndex.slots = slots;
+	ptpClock->foreignIndex.size = size;
+	ptpClock->max_foreign_records = capacity;
+	clearForeignMasters(ptpClock);
+
+	DBG("allocated %d bytes for foreign master data\n",
+	    (int)(capacity * sizeof(ForeignMasterRecord) + size * sizeof(int)));
+
+	return TRUE;
+}
+
+void
+freeForeignMasterTable(PtpClock *ptpClock)
+{
+	SAFE_FREE(ptpClock->foreign);
+	SAFE_FREE(ptpClock->foreignIndex.slots);
+	ptpClock->foreignIndex.size = 0;
+	ptpClock->max_foreign_records = 0;
+	ptpClock->number_foreign_records = 0;
+	ptpClock->bestMaster = NULL;
+}
+
+/* forget all foreign masters */
+void
+clearForeignMasters(PtpClock *ptpClock)
+{
+	if(ptpClock->foreign != NULL) {
+		memset(ptpClock->foreign, 0, ptpClock->max_foreign_records * sizeof(ForeignMasterRecord));
+	}
+	if(ptpClock->foreignIndex.slots != NULL) {
+		memset(ptpClock->foreignIndex.slots, 0, ptpClock->foreignIndex.size * sizeof(int));
+	}
+	ptpClock->foreignIndex.newest = -1;
+	ptpClock->foreignIndex.oldest = -1;
+	ptpClock->foreignIndex.best = -1;
+	ptpClock->number_foreign_records = 0;
+	ptpClock->foreign_record_best = 0;
+	ptpClock->bestMaster = NULL;
+	ptpClock->counters.foreignCount = 0;
+}
+
+ForeignMasterRecord*
+findForeignMaster(PtpClock *ptpClock, const PortIdentity *portIdentity)
+{
+	ForeignMasterIndex *index = &ptpClock->foreignIndex;
+	ForeignMasterRecord *record;
+	int mask = index->size - 1;
+	int slot;
+
+	for(slot = foreignSlot(index, portIdentity); index->slots[slot]; slot = (slot + 1) & mask) {
+		record = &ptpClock->foreign[index->slots[slot] - 1];
+		if(!cmpPortIdentity(&record->foreignMasterPortIdentity, portIdentity)) {
+			return record;
+		}
+	}
+
+	return NULL;
+}
+
+/*
+ * add an empty record for a new foreign master: if the table is full, the least recently
+ * heard from record other than the best master is reused. Returns NULL if there is none.
+ */
+ForeignMasterRecord*
+addForeignMaster(PtpClock *ptpClock, const PortIdentity *portIdentity)
+{
+	ForeignMasterIndex *index = &ptpClock->foreignIndex;
+	ForeignMasterRecord *record;
+	int mask = index->size - 1;
+	int slot, i;
+
+	if(ptpClock->number_foreign_records >= ptpClock->max_foreign_records) {
+		ptpClock->counters.foreignOverflows++;
+		for(i = index->oldest; i >= 0 && &ptpClock->foreign[i] == ptpClock->bestMaster;
+		    i = ptpClock->foreign[i].lruNewer);
+		if(i < 0) {
+			return NULL;
+		}
+		DBG("Foreign master table full (%d records), reusing the least recently seen record\n",
+		    ptpClock->max_foreign_records);
+		removeForeignMaster(ptpClock, i);
+	}
+
+	for(slot = foreignSlot(index, portIdentity); index->slots[slot]; slot = (slot + 1) & mask);
+
+	i = ptpClock->number_foreign_records++;
+	record = &ptpClock->foreign[i];
+	memset(record, 0, sizeof(ForeignMasterRecord));
+	record->foreignMasterPortIdentity = *portIdentity;
+	index->slots[slot] = i + 1;
+	lruPushNewest(ptpClock, i);
+	getTimeMonotonic(&record->lastSeen);
+
+	ptpClock->counters.foreignAdded++;
+	ptpClock->counters.foreignCount = ptpClock->number_foreign_records;
+
+	return record;
+}
+
+/* an Announce was received from this foreign master */
+void
+touchForeignMaster(PtpClock *ptpClock, ForeignMasterRecord *record)
+{
+	int i = record - ptpClock->foreign;
+
+	/* bmc() can point bestMaster at an empty table */
+	if(i < 0 || i >= ptpClock->number_foreign_records) {
+		return;
+	}
+
+	getTimeMonotonic(&record->lastSeen);
+	if(ptpClock->foreignIndex.newest != i) {
+		lruUnlink(ptpClock, i);
+		lruPushNewest(ptpClock, i);
+	}
+}
+
+/*
+ * remove records not heard from within the foreign master time window (in their Announce intervals),
+ * oldest first. The best master is left alone, the Announce receipt timeout takes care of it.
+ */
+void
+ageForeignMasters(PtpClock *ptpClock, const RunTimeOpts *rtOpts)
+{
+	ForeignMasterRecord *record;
+	TimeInternal now, age;
+	Integer8 logInterval;
+	int i, next;
+
+	if(!rtOpts->foreignRecordTimeWindow) {
+		return;
+	}
+
+	getTimeMonotonic(&now);
+
+	for(i = ptpClock->foreignIndex.oldest; i >= 0; i = next) {
+		record = &ptpClock->foreign[i];
+		next = record->lruNewer;
+		if(record == ptpClock->bestMaster) {
+			continue;
+		}
+		/* unicast Announce does not carry the interval, use ours */
+		logInterval = record->header.logMessageInterval;
+		if(logInterval == UNICAST_MESSAGEINTERVAL) {
+			logInterval = ptpClock->portDS.logAnnounceInterval;
+		}
+		subTime(&age, &now, &record->lastSeen);
+		if(timeInternalToDouble(&age) <= rtOpts->foreignRecordTimeWindow * pow(2, logInterval)) {
+			break;
+		}
+		/* the last record is moved into the place of the removed one */
+		if(next == ptpClock->number_foreign_records - 1) {
+			next = i;
+		}
+		removeForeignMaster(ptpClock, i);
+	}
+}
+
+/*
+ * a record was added or its Announce changed: a better one becomes the best record,
+ * while a change to the best record itself may have made it worse, so compare them all again
+ */
+void
+foreignMasterChanged(PtpClock *ptpClock, ForeignMasterRecord *record, const RunTimeOpts *rtOpts)
+{
+	ForeignMasterIndex *index = &ptpClock->foreignIndex;
+	int i = record - ptpClock->foreign;
+
+	if(index->best < 0 || i < 0 || i >= ptpClock->number_foreign_records) {
+		return;
+	}
+
+	if(i == index->best) {
+		index->best = -1;
+	} else if(bmcDataSetComparison(record, &ptpClock->foreign[index->best], ptpClock, rtOpts) < 0) {
+		index->best = i;
+	}
+}
+
+/* the records were changed behind the cache's back: compare them all in the next bmc() */
+void
+invalidateForeignBest(PtpClock *ptpClock)
+{
+	ptpClock->foreignIndex.best = -1;
+}
@@ -25,4 +25,14 @@ void s1(MsgHeader*, MsgAnnounce*, PtpClock*, const RunTimeOpts*);
 
 UInteger8 bmc(ForeignMasterRecord*, const RunTimeOpts*, PtpClock*);
 
+Boolean allocForeignMasterTable(PtpClock*, int capacity);
+void freeForeignMasterTable(PtpClock*);
+void clearForeignMasters(PtpClock*);
+ForeignMasterRecord* findForeignMaster(PtpClock*, const PortIdentity*);
+ForeignMasterRecord* addForeignMaster(PtpClock*, const PortIdentity*);
+void touchForeignMaster(PtpClock*, ForeignMasterRecord*);
+void ageForeignMasters(PtpClock*, const RunTimeOpts*);
+void foreignMasterChanged(PtpClock*, ForeignMasterRecord*, const RunTimeOpts*);
+void invalidateForeignBest(PtpClock*);
+
 #endif /* include guard */
@@ -449,6 +449,9 @@ enum {
 
 #define MISSED_MESSAGES_MAX 20 /* how long we wait to trigger a [sync/delay] receipt alarm */
 
+/* PdelayReqs answered and waiting for their PdelayResp's TX timestamp to send the follow-up */
+#define PDELAY_REQ_PENDING 16
+
 /* constants used for unicast grant processing */
 #define UNICAST_GRANT_REFRESH_INTERVAL 1
 #define GRANT_NOT_FOUND -1
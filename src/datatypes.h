@@ -11,7 +11,7 @@
 #include <stdint.h>
 
 #include "constants.h" // For USER_DESCRIPTION_MAX
-#include "dep/constants_dep.h" // For UNICAST_MAX_DESTINATIONS, PACKET_SIZE
+#include "dep/constants_dep.h" // For PACKET_SIZE, UNICAST_PACING_MAX_SLOTS
 #include "ptp_primitives.h"
 #include "datatypes_port.h"
 #include "timingdomain.h"
@@ -28,6 +28,7 @@
 #  include "dep/outlierfilter.h"
 #endif /* PTPD_STATISTICS */
 #include "dep/alarm_datatypes.h"
+#include "dep/clocksim.h"
 #include "dep/net.h"
 #include "dep/servo.h"
 
@@ -65,13 +66,11 @@ typedef struct
 	uint32_t managementMessagesSent;
 	uint32_t managementMessagesReceived;
 
-/* not implemented yet */
-
 	/* FMR counters */
-	uint32_t foreignAdded; // implement me! /* number of insertions to FMR */
-	uint32_t foreignCount; // implement me! /* number of foreign masters seen */
-	uint32_t foreignRemoved; // implement me! /* number of FMR records deleted */
-	uint32_t foreignOverflows; // implement me! /* how many times the FMR was full */
+	uint32_t foreignAdded; /* number of insertions to FMR */
+	uint32_t foreignCount; /* number of foreign masters currently in the FMR */
+	uint32_t foreignRemoved; /* number of FMR records deleted: aged out or evicted */
+	uint32_t foreignOverflows; /* how many times the FMR was full */
 
 	/* protocol engine counters */
 
@@ -111,6 +110,7 @@ typedef struct
 	uint32_t delaySMOutliersFound;	  /* Number of outliers found by the delaySM filter */
 #endif /* PTPD_STATISTICS */
 	uint32_t maxDelayDrops; /* number of samples dropped due to maxDelay threshold */
+	uint32_t syncDestinationMisses; /* looped back unicast Syncs with no known destination - no FollowUp sent */
 
 	uint32_t messageSendRate;	/* RX message rate per sec */
 	uint32_t messageReceiveRate;	/* TX message rate per sec */
@@ -140,10 +140,54 @@ typedef struct {
 	long clockOffset;
 } ClockStatusInfo;
 
+/* unicast Sync sent: where its FollowUp goes when the Sync is looped back to us */
 typedef struct {
-	Integer32 transportAddress;
+	TimeInternal originTimestamp;
+	Integer32 transportAddress;	/* 0: FollowUp destination already looked up */
+	UInteger32 generation;		/* entry only valid in the round of Syncs it was written in */
+	UInteger16 sequenceId;
 } SyncDestEntry;
 
+/* open addressing table of Syncs sent this round, looked up by sequence ID and origin timestamp */
+typedef struct {
+	SyncDestEntry *entry;
+	int size;			/* power of 2, at least twice the unicast destination capacity */
+	int filled;			/* slots written this round */
+	UInteger32 generation;		/* current round of Syncs */
+} SyncDestTable;
+
+/* message templates in MsgTemplates.valid */
+#define MSG_TEMPLATE_SYNC	(1 << 0)
+#define MSG_TEMPLATE_FOLLOWUP	(1 << 1)
+#define MSG_TEMPLATE_DELAYRESP	(1 << 2)
+#define MSG_TEMPLATE_ANNOUNCE	(1 << 3)
+#define MSG_TEMPLATE_ALL	0xFF
+
+/* pre-packed messages: everything but sequenceId, timestamps and per-message fields */
+typedef struct {
+	Octet sync[SYNC_LENGTH];
+	Octet followUp[FOLLOW_UP_LENGTH];
+	Octet delayResp[DELAY_RESP_LENGTH];
+	Octet announce[ANNOUNCE_LENGTH];
+	UInteger8 valid;		/* MSG_TEMPLATE_* packed since the last invalidation */
+} MsgTemplates;
+
+/* one round of unicast Sync or Announce transmissions, spread over the message interval */
+typedef struct {
+	int *order;			/* grant table entries due this round, grouped by slot */
+	int *due;			/* scratch: entries due, in table order */
+	int start[UNICAST_PACING_MAX_SLOTS + 1];	/* slot n sends order[start[n]] to order[start[n+1]-1] */
+	int slots;			/* slots in the current round */
+	int next;			/* next slot to send, == slots when the round is complete */
+	int roundBurst;			/* largest slot sent so far this round */
+	int roundSent;			/* messages sent so far this round */
+	/* burst size metrics */
+	int lastSlots;			/* slots used by the last completed round */
+	int lastRound;			/* messages sent in the last completed round */
+	int lastBurst;			/* largest slot sent in the last completed round */
+	int maxBurst;			/* largest slot sent since the protocol was started */
+} UnicastPacer;
+
 
 /**
  * \struct RunTimeOpts
@@ -204,6 +248,7 @@ typedef struct RunTimeOpts {
 	Integer16 s;
 	TimeInternal inboundLatency, outboundLatency, ofmShift;
 	Integer16 max_foreign_records;
+	int foreignRecordTimeWindow; /* foreign records not heard from in this many Announce intervals are aged out */
 	Enumeration8 delayMechanism;
 
 	Boolean portDisabled;
@@ -213,6 +258,7 @@ typedef struct RunTimeOpts {
 	Boolean requireUtcValid;
 	Boolean checkConfigOnly;
 	Boolean printLockFile;
+	char replayFile[PATH_MAX+1]; /* servo trace to replay offline instead of running the protocol */
 
 	int leapSecondPausePeriod;
 	Enumeration8 leapSecondHandling;
@@ -263,6 +309,8 @@ typedef struct RunTimeOpts {
 	 * transmit signaling using one port ID, and rest of messages with another
 	 */
 	UInteger16  unicastPortMask; /* port mask to apply to portNumber when using negotiation */
+	int unicastTableCapacity; /* maximum number of unicast destinations / negotiated slaves */
+	int unicastPacingSlots; /* number of slots unicast Sync / Announce transmissions are spread over */
 
 	Boolean pidAsClockId;
 
@@ -279,6 +327,9 @@ typedef struct RunTimeOpts {
 	Enumeration8 selectedPreset;
 
 	int servoMaxPpb;
+	/* clock driven by the servo: system or simulated */
+	Enumeration8 clockBackend;
+	ClockSimConfig clockSimConfig;
 	double servoKP;
 	double servoKI;
 	Enumeration8 servoDtMethod;
@@ -351,6 +402,30 @@ typedef struct RunTimeOpts {
 
 } RunTimeOpts;
 
+/*
+ * Foreign master index: open addressing (linear probing) hash map of port identities
+ * over the foreign master records, sized to at least twice their capacity, the records
+ * ordered by the time their last Announce was received, and the best record so far
+ */
+typedef struct ForeignMasterIndex {
+	int	size;		/* number of slots, power of 2 */
+	int	*slots;		/* foreign record number + 1, 0: empty slot */
+	int	newest;		/* most recently heard from record, -1 if none */
+	int	oldest;		/* least recently heard from record, -1 if none */
+	int	best;		/* best record as of the last comparison, -1: compare them all again */
+	PortIdentity	bestParent;	/* parent port the best record was chosen against */
+	UInteger8	bestDomain;	/* domain the best record was chosen against */
+} ForeignMasterIndex;
+
+/*
+ * PdelayReq answered with a PdelayResp: the follow-up is built from it once the
+ * response's TX timestamp comes back, which may be after other requests were handled
+ */
+typedef struct {
+	MsgHeader	header;
+	Boolean		pending;
+} PdelayReqRecord;
+
 
 /**
  * \struct PtpClock
@@ -374,32 +449,38 @@ typedef struct PtpClock {
 
 	/* Foreign master data set */
 	ForeignMasterRecord *foreign;
+	/* hash index and LRU list over the foreign master records */
+	ForeignMasterIndex foreignIndex;
 	/* Current best master (unless it's us) */
 	ForeignMasterRecord *bestMaster;
 
 	/* Other things we need for the protocol */
 	UInteger16 number_foreign_records;
 	Integer16  max_foreign_records;
-	Integer16  foreign_record_i;
 	Integer16  foreign_record_best;
 	UInteger32 random_seed;
 	Boolean  record_update;    /* should we run bmc() after receiving an announce message? */
 
 	Boolean disabled;	/* port is permanently disabled */
 
+	/* number of entries allocated for the unicast grant table, destinations and Sync index */
+	int unicastCapacity;
 	/* unicast grant table - our own grants or our slaves' grants or grants to peers */
-	UnicastGrantTable unicastGrants[UNICAST_MAX_DESTINATIONS];
-	/* our trivial index table to speed up lookups */
+	UnicastGrantTable *unicastGrants;
+	/* hash index over the grant table, by port identity and transport address */
 	UnicastGrantIndex grantIndex;
 	/* current parent from the above table */
 	UnicastGrantTable *parentGrants;
 	/* previous parent's grants when changing parents: if not null, this is what should be canceled */
 	UnicastGrantTable *previousGrants;
 	/* another index to match unicast Sync with FollowUp when we can't capture the destination address of Sync */
-	SyncDestEntry syncDestIndex[UNICAST_MAX_DESTINATIONS];
+	SyncDestTable syncDestTable;
+	/* unicast Sync and Announce transmissions paced across the interval */
+	UnicastPacer syncPacer;
+	UnicastPacer announcePacer;
 
 	/* unicast destinations parsed from config */
-	UnicastDestination unicastDestinations[UNICAST_MAX_DESTINATIONS];
+	UnicastDestination *unicastDestinations;
 	int unicastDestinationCount;
 
 	/* number of slaves we have granted Announce to */
@@ -431,6 +512,8 @@ typedef struct PtpClock {
 
 	Octet msgObuf[PACKET_SIZE];
 	Octet msgIbuf[PACKET_SIZE];
+	/* pre-packed outgoing messages, see msgInvalidateTemplates() */
+	MsgTemplates msgTemplates;
 
 	int followUpGap;
 
@@ -448,7 +531,8 @@ typedef struct PtpClock {
 	TimeInternal	sync_receive_time;
 	TimeInternal	delay_req_send_time;
 	TimeInternal	delay_req_receive_time;
-	MsgHeader	PdelayReqHeader;
+	PdelayReqRecord	pdelayReqPending[PDELAY_REQ_PENDING];
+	int		pdelayReqPendingNext;	/* slot the next request goes into */
 	MsgHeader	delayReqHeader;
 	TimeInternal	pdelayMS;
 	TimeInternal	pdelaySM;
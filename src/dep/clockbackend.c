@@ -0,0 +1,123 @@
+/*-
+ * Copyright (c) 2015 Wojciech Owczarek,
+ *
+ * All Rights Reserved
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHORS ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE AUTHORS OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+ * OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
+ * IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/**
+ * @file   clockbackend.c
+ * @date   Sun Oct 18 14:05:31 2026
+ *
+ * @brief  Pluggable clock backend behind getTime / setTime / adjFreq
+ *
+ * The clock functions in sys.c ask the installed backend first and only
+ * touch the operating system clock when there is none, or when the
+ * backend declines the operation.
+ */
+
+#include <stddef.h>
+
+#include "ptp_primitives.h"
+#include "ptp_datatypes.h"
+#include "ptpd_logging.h"
+#include "dep/clockbackend.h"
+
+static ClockBackend *backend = NULL;
+
+void
+clockBackendInstall(ClockBackend *newBackend)
+{
+	/* only report leaving or returning to the system clock - the simulator switches a lot */
+	if(newBackend != NULL && backend == NULL) {
+		DBG("Clock backend: using %s\n", newBackend->id);
+	} else if(newBackend == NULL && backend != NULL) {
+		DBG("Clock backend: %s removed, using the system clock\n", backend->id);
+	}
+
+	backend = newBackend;
+}
+
+void
+clockBackendShutdown(void)
+{
+	ClockBackend *old = backend;
+
+	if(old == NULL) {
+		return;
+	}
+
+	backend = NULL;
+
+	if(old->shutdown != NULL) {
+		old->shutdown(old);
+	}
+}
+
+Boolean
+clockBackendIsSystem(void)
+{
+	return backend == NULL;
+}
+
+Boolean
+clockBackendGetTime(TimeInternal *time)
+{
+	return backend != NULL && backend->getTime != NULL &&
+	    backend->getTime(backend, time);
+}
+
+Boolean
+clockBackendGetTimeMonotonic(TimeInternal *time)
+{
+	return backend != NULL && backend->getTimeMonotonic != NULL &&
+	    backend->getTimeMonotonic(backend, time);
+}
+
+Boolean
+clockBackendSetTime(const TimeInternal *time)
+{
+	return backend != NULL && backend->setTime != NULL &&
+	    backend->setTime(backend, time);
+}
+
+Boolean
+clockBackendAdjFreq(double adj)
+{
+	return backend != NULL && backend->adjFreq != NULL &&
+	    backend->adjFreq(backend, adj);
+}
+
+Boolean
+clockBackendGetAdjFreq(double *adj)
+{
+	return backend != NULL && backend->getAdjFreq != NULL &&
+	    backend->getAdjFreq(backend, adj);
+}
+
+Boolean
+clockBackendFromSystemTime(TimeInternal *time)
+{
+	return backend != NULL && backend->fromSystemTime != NULL &&
+	    backend->fromSystemTime(backend, time);
+}
@@ -0,0 +1,82 @@
+/*-
+ * Copyright (c) 2015 Wojciech Owczarek,
+ *
+ * All Rights Reserved
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHORS ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE AUTHORS OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+ * OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
+ * IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef CLOCKBACKEND_H_
+#define CLOCKBACKEND_H_
+
+/**
+ * @file   clockbackend.h
+ * @date   Sun Oct 18 14:05:31 2026
+ *
+ * @brief  Pluggable clock backend behind getTime / setTime / adjFreq
+ *
+ */
+
+#include "ptp_primitives.h"
+#include "ptp_datatypes.h"
+
+#define CLOCKBACKEND_MAX_DESC	20
+
+typedef struct ClockBackend ClockBackend;
+
+struct ClockBackend {
+
+	/* data */
+	char id[CLOCKBACKEND_MAX_DESC + 1];
+	void *data;
+
+	/*
+	 * "methods" - each returns FALSE if the operation is left to the
+	 * system clock, so a backend only implements what it overrides
+	 */
+	Boolean (*getTime) (ClockBackend *backend, TimeInternal *time);
+	Boolean (*getTimeMonotonic) (ClockBackend *backend, TimeInternal *time);
+	Boolean (*setTime) (ClockBackend *backend, const TimeInternal *time);
+	Boolean (*adjFreq) (ClockBackend *backend, double adj);
+	Boolean (*getAdjFreq) (ClockBackend *backend, double *adj);
+	/* move a kernel (CLOCK_REALTIME) packet timestamp onto this clock */
+	Boolean (*fromSystemTime) (ClockBackend *backend, TimeInternal *time);
+	void (*shutdown) (ClockBackend *backend);
+
+};
+
+/* make backend the clock, NULL restores the system clock */
+void clockBackendInstall(ClockBackend *backend);
+/* shut down and remove the installed backend */
+void clockBackendShutdown(void);
+/* TRUE when the operating system clock is in use */
+Boolean clockBackendIsSystem(void);
+
+/* used by the clock functions in sys.c: TRUE if the backend handled the call */
+Boolean clockBackendGetTime(TimeInternal *time);
+Boolean clockBackendGetTimeMonotonic(TimeInternal *time);
+Boolean clockBackendSetTime(const TimeInternal *time);
+Boolean clockBackendAdjFreq(double adj);
+Boolean clockBackendGetAdjFreq(double *adj);
+Boolean clockBackendFromSystemTime(TimeInternal *time);
+
+#endif /* CLOCKBACKEND_H_ */
@@ -0,0 +1,411 @@
+/*-
+ * Copyright (c) 2015 Wojciech Owczarek,
+ *
+ * All Rights Reserved
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHORS ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE AUTHORS OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+ * OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
+ * IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/**
+ * @file   clocksim.c
+ * @date   Sun Oct 18 14:05:31 2026
+ *
+ * @brief  Software oscillator clock backend
+ *
+ * The simulated clock is integrated against a reference timebase - the
+ * untouched system clock - at a rate of (frequency offset + random walk
+ * wander + servo adjustment). Step events are applied at fixed reference
+ * times after startup. The random walk is driven by a seeded generator
+ * and advanced once per reference second, so the same configuration
+ * always produces the same oscillator. Kernel packet timestamps are
+ * mapped onto the simulated clock by evaluating it at the reference
+ * time they carry. Any number of clocks can be created against another
+ * reference, such as the virtual timebase of the network simulator.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include <math.h>
+#include <time.h>
+
+#include "ptp_primitives.h"
+#include "ptp_datatypes.h"
+#include "ptpd_logging.h"
+#include "dep/clockbackend.h"
+#include "dep/clocksim.h"
+
+#define CLOCKSIM_WANDER_INTERVAL 1000000000LL
+
+typedef struct {
+	ClockSimConfig config;
+	int64_t (*reference) (void);
+	ClockSimStep steps[CLOCKSIM_MAX_STEPS];
+	int stepCount;
+	int nextStep;
+	int64_t start;		/* reference time at setup */
+	int64_t anchor;		/* reference time the state below is valid at */
+	int64_t time;		/* simulated clock at anchor */
+	double fraction;	/* sub-nanosecond remainder of the simulated clock */
+	double wanderFreq;	/* current random walk frequency, ppb */
+	int64_t nextWander;
+	double adj;
+	double maxAdj;
+	uint64_t rng;
+} ClockSim;
+
+/* a backend with its clock, allocated together by clockSimCreate() */
+typedef struct {
+	ClockBackend backend;
+	ClockSim sim;
+} ClockSimInstance;
+
+static ClockSim clockSim;
+static ClockBackend clockSimBackend;
+
+static int64_t
+systemReference(void)
+{
+	struct timespec tp;
+
+	clock_gettime(CLOCK_REALTIME, &tp);
+	return (int64_t)tp.tv_sec * 1000000000LL + tp.tv_nsec;
+}
+
+static int64_t
+referenceTime(const ClockSim *sim)
+{
+	return sim->reference();
+}
+
+static int64_t
+internalToNs(const TimeInternal *time)
+{
+	return (int64_t)time->seconds * 1000000000LL + time->nanoseconds;
+}
+
+static void
+nsToInternal(int64_t ns, TimeInternal *time)
+{
+	time->seconds = ns / 1000000000LL;
+	time->nanoseconds = ns % 1000000000LL;
+}
+
+/* xorshift64*, good enough for a random walk and fully reproducible */
+static uint64_t
+nextRandom(ClockSim *sim)
+{
+	sim->rng ^= sim->rng >> 12;
+	sim->rng ^= sim->rng << 25;
+	sim->rng ^= sim->rng >> 27;
+	return sim->rng * 0x2545F4914F6CDD1DULL;
+}
+
+static double
+nextGaussian(ClockSim *sim)
+{
+	double u1, u2;
+
+	do {
+		u1 = (nextRandom(sim) >> 11) * (1.0 / 9007199254740992.0);
+	} while (u1 <= 0.0);
+	u2 = (nextRandom(sim) >> 11) * (1.0 / 9007199254740992.0);
+
+	return sqrt(-2.0 * log(u1)) * cos(2.0 * M_PI * u2);
+}
+
+static double
+clockSimRate(const ClockSim *sim)
+{
+	return sim->config.frequencyOffset + sim->wanderFreq + sim->adj;
+}
+
+static void
+integrate(ClockSim *sim, int64_t to)
+{
+	int64_t dt = to - sim->anchor;
+	int64_t whole;
+
+	sim->fraction += dt * clockSimRate(sim) / 1E9;
+	whole = (int64_t)sim->fraction;
+	sim->fraction -= whole;
+	sim->time += dt + whole;
+	sim->anchor = to;
+}
+
+/* apply everything due at or before the anchor */
+static void
+processEvents(ClockSim *sim)
+{
+	while(sim->nextWander <= sim->anchor) {
+		sim->wanderFreq += nextGaussian(sim) * sim->config.wander;
+		sim->nextWander += CLOCKSIM_WANDER_INTERVAL;
+	}
+
+	while(sim->nextStep < sim->stepCount &&
+	    sim->start + sim->steps[sim->nextStep].when <= sim->anchor) {
+		sim->time += sim->steps[sim->nextStep].offset;
+		NOTICE("Simulated clock: step event of %.09f s\n",
+			sim->steps[sim->nextStep].offset / 1E9);
+		sim->nextStep++;
+	}
+}
+
+static void
+advance(ClockSim *sim, int64_t to)
+{
+	int64_t next;
+
+	while(sim->anchor < to) {
+		next = to;
+		if(sim->nextWander < next) {
+			next = sim->nextWander;
+		}
+		if(sim->nextStep < sim->stepCount &&
+		    sim->start + sim->steps[sim->nextStep].when < next) {
+			next = sim->start + sim->steps[sim->nextStep].when;
+		}
+		integrate(sim, next);
+		processEvents(sim);
+	}
+}
+
+/* simulated clock at reference time t - times already passed are extrapolated back */
+static int64_t
+evaluate(ClockSim *sim, int64_t t)
+{
+	if(t >= sim->anchor) {
+		advance(sim, t);
+		return sim->time;
+	}
+
+	return sim->time - (sim->anchor - t) -
+		(int64_t)((sim->anchor - t) * clockSimRate(sim) / 1E9);
+}
+
+static Boolean
+clockSimGetTime(ClockBackend *backend, TimeInternal *time)
+{
+	ClockSim *sim = (ClockSim*)backend->data;
+
+	nsToInternal(evaluate(sim, referenceTime(sim)), time);
+	return TRUE;
+}
+
+/* the reference is the monotonic timebase when it is not the system clock */
+static Boolean
+clockSimGetTimeMonotonic(ClockBackend *backend, TimeInternal *time)
+{
+	ClockSim *sim = (ClockSim*)backend->data;
+
+	nsToInternal(referenceTime(sim), time);
+	return TRUE;
+}
+
+static Boolean
+clockSimSetTime(ClockBackend *backend, const TimeInternal *time)
+{
+	ClockSim *sim = (ClockSim*)backend->data;
+
+	advance(sim, referenceTime(sim));
+	sim->time = internalToNs(time);
+	sim->fraction = 0;
+
+	NOTICE("Stepped the simulated clock to %d.%09d\n",
+		time->seconds, time->nanoseconds);
+	return TRUE;
+}
+
+static Boolean
+clockSimAdjFreq(ClockBackend *backend, double adj)
+{
+	ClockSim *sim = (ClockSim*)backend->data;
+
+	if(adj > sim->maxAdj) {
+		adj = sim->maxAdj;
+	} else if(adj < -sim->maxAdj) {
+		adj = -sim->maxAdj;
+	}
+
+	/* the old rate applies up to now */
+	advance(sim, referenceTime(sim));
+	sim->adj = adj;
+	return TRUE;
+}
+
+static Boolean
+clockSimGetAdjFreq(ClockBackend *backend, double *adj)
+{
+	ClockSim *sim = (ClockSim*)backend->data;
+
+	*adj = sim->adj;
+	return TRUE;
+}
+
+static Boolean
+clockSimFromSystemTime(ClockBackend *backend, TimeInternal *time)
+{
+	ClockSim *sim = (ClockSim*)backend->data;
+
+	nsToInternal(evaluate(sim, internalToNs(time)), time);
+	return TRUE;
+}
+
+static void
+clockSimShutdown(ClockBackend *backend)
+{
+	ClockSim *sim = (ClockSim*)backend->data;
+
+	INFO("Simulated clock: frequency %.03f ppb (offset %.03f, wander %.03f, adjustment %.03f) at shutdown\n",
+		clockSimRate(sim), sim->config.frequencyOffset, sim->wanderFreq, sim->adj);
+}
+
+int
+clockSimParseSteps(const char *text, ClockSimStep *steps, int maxSteps)
+{
+	const char *p = text;
+	char *end;
+	double when, offset;
+	ClockSimStep tmp;
+	int count = 0;
+	int i;
+
+	while(*p) {
+		if(isspace((unsigned char)*p) || *p == ',' || *p == ';') {
+			p++;
+			continue;
+		}
+
+		when = strtod(p, &end);
+		if(end == p || *end != ':' || when < 0) {
+			return -1;
+		}
+		p = end + 1;
+		offset = strtod(p, &end);
+		if(end == p) {
+			return -1;
+		}
+		p = end;
+
+		if(count == maxSteps) {
+			return -1;
+		}
+		steps[count].when = (int64_t)(when * 1E9);
+		steps[count].offset = (int64_t)(offset * 1E9);
+
+		/* keep the list in time order */
+		for(i = count; i > 0 && steps[i - 1].when > steps[i].when; i--) {
+			tmp = steps[i - 1];
+			steps[i - 1] = steps[i];
+			steps[i] = tmp;
+		}
+		count++;
+	}
+
+	return count;
+}
+
+static Boolean
+clockSimInit(ClockSim *sim, ClockBackend *backend, const ClockSimConfig *config,
+	     double maxAdj, int64_t (*reference) (void))
+{
+	memset(sim, 0, sizeof(ClockSim));
+	memset(backend, 0, sizeof(ClockBackend));
+
+	sim->config = *config;
+	sim->maxAdj = maxAdj;
+	sim->reference = (reference != NULL) ? reference : systemReference;
+
+	if((sim->stepCount = clockSimParseSteps(config->steps, sim->steps, CLOCKSIM_MAX_STEPS)) < 0) {
+		ERROR("Simulated clock: could not parse step events \"%s\"\n", config->steps);
+		return FALSE;
+	}
+
+	/* xorshift must not start from zero */
+	sim->rng = ((uint64_t)config->seed << 32 | config->seed) ^ 0x9E3779B97F4A7C15ULL;
+
+	sim->start = sim->anchor = referenceTime(sim);
+	sim->time = sim->start + (int64_t)(config->initialOffset * 1E9);
+	sim->nextWander = (config->wander > 0) ? sim->start + CLOCKSIM_WANDER_INTERVAL : INT64_MAX;
+	processEvents(sim);
+
+	strncpy(backend->id, "simulated", CLOCKBACKEND_MAX_DESC);
+	backend->data = sim;
+	backend->getTime = clockSimGetTime;
+	if(reference != NULL) {
+		backend->getTimeMonotonic = clockSimGetTimeMonotonic;
+	}
+	backend->setTime = clockSimSetTime;
+	backend->adjFreq = clockSimAdjFreq;
+	backend->getAdjFreq = clockSimGetAdjFreq;
+	backend->fromSystemTime = clockSimFromSystemTime;
+	backend->shutdown = clockSimShutdown;
+
+	return TRUE;
+}
+
+Boolean
+clockSimSetup(const ClockSimConfig *config, double maxAdj)
+{
+	if(!clockSimInit(&clockSim, &clockSimBackend, config, maxAdj, NULL)) {
+		return FALSE;
+	}
+
+	clockBackendInstall(&clockSimBackend);
+
+	NOTICE("Using simulated clock: frequency offset %.03f ppb, wander %.03f ppb, "
+		"initial offset %.09f s, %d step events, seed %u\n",
+		config->frequencyOffset, config->wander, config->initialOffset,
+		clockSim.stepCount, config->seed);
+
+	return TRUE;
+}
+
+ClockBackend*
+clockSimCreate(const ClockSimConfig *config, double maxAdj, int64_t (*reference) (void))
+{
+	ClockSimInstance *instance;
+
+	if(!(instance = calloc(1, sizeof(ClockSimInstance)))) {
+		return NULL;
+	}
+
+	if(!clockSimInit(&instance->sim, &instance->backend, config, maxAdj, reference)) {
+		free(instance);
+		return NULL;
+	}
+
+	return &instance->backend;
+}
+
+void
+clockSimFree(ClockBackend **backend)
+{
+	if(backend == NULL || *backend == NULL) {
+		return;
+	}
+
+	/* the backend is the first member of its instance */
+	free(*backend);
+	*backend = NULL;
+}
@@ -0,0 +1,71 @@
+/*-
+ * Copyright (c) 2015 Wojciech Owczarek,
+ *
+ * All Rights Reserved
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHORS ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE AUTHORS OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+ * OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
+ * IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef CLOCKSIM_H_
+#define CLOCKSIM_H_
+
+/**
+ * @file   clocksim.h
+ * @date   Sun Oct 18 14:05:31 2026
+ *
+ * @brief  Software oscillator clock backend
+ *
+ */
+
+#include <stdint.h>
+
+#include "ptp_primitives.h"
+#include "dep/clockbackend.h"
+
+#define CLOCKSIM_MAX_STEPS	32
+#define CLOCKSIM_STEPS_MAX_LEN	512
+
+typedef struct {
+	double frequencyOffset;	/* ppb, positive runs fast */
+	double wander;		/* ppb, std dev of the frequency random walk every second */
+	double initialOffset;	/* seconds, clock error at startup */
+	uint32_t seed;		/* random walk seed - same seed, same oscillator */
+	char steps[CLOCKSIM_STEPS_MAX_LEN + 1];	/* "<after s>:<step s> ..." */
+} ClockSimConfig;
+
+typedef struct {
+	int64_t when;		/* ns after startup */
+	int64_t offset;		/* ns */
+} ClockSimStep;
+
+/* parse a step event list, returns the number of events or -1 on error */
+int clockSimParseSteps(const char *text, ClockSimStep *steps, int maxSteps);
+/* install the simulated clock as the clock backend */
+Boolean clockSimSetup(const ClockSimConfig *config, double maxAdj);
+/*
+ * create a simulated clock running against the given reference (ns),
+ * NULL for the system clock - the caller decides when it is installed
+ */
+ClockBackend *clockSimCreate(const ClockSimConfig *config, double maxAdj, int64_t (*reference) (void));
+void clockSimFree(ClockBackend **backend);
+
+#endif /* CLOCKSIM_H_ */
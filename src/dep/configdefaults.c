@@ -123,6 +123,7 @@ static const ConfigTemplate configTemplates[] = {
     { "full-logging", "Enable logging for all facilities (statistics, status, log file)", {
 	{"global:log_status", "y"},
 	{"global:status_file", "/var/run/ptpd2.status"},
+	{"global:status_shm", "/ptpd2.status"},
 	{"global:statistics_log_interval", "1"},
 	{"global:lock_file", "/var/run/ptpd2.pid"},
 	{"global:log_statistics", "y"},
@@ -136,6 +137,7 @@ static const ConfigTemplate configTemplates[] = {
     { "full-logging-instance", "Logging for all facilities using 'instance' variable which the user should provide", {
 	{"global:log_status", "y"},
 	{"global:status_file", "@rundir@/ptpd2.@instance@.status"},
+	{"global:status_shm", "/ptpd2.@instance@.status"},
 	{"global:statistics_log_interval", "1"},
 	{"global:lock_file", "@rundir@/ptpd2.@instance@.pid"},
 	{"global:log_statistics", "y"},
@@ -203,6 +205,7 @@ loadDefaultSettings( RunTimeOpts* rtOpts )
 	rtOpts->dot1AS = FALSE;
 
 	rtOpts->sysopts.disableUdpChecksums = TRUE;
+	rtOpts->sysopts.kernelFilter = TRUE;
 
 	rtOpts->unicastNegotiation = FALSE;
 	rtOpts->unicastNegotiationListening = FALSE;
@@ -210,10 +213,13 @@ loadDefaultSettings( RunTimeOpts* rtOpts )
 	rtOpts->unicastGrantDuration = 300;
 	rtOpts->unicastAcceptAny = FALSE;
 	rtOpts->unicastPortMask = 0;
+	rtOpts->unicastTableCapacity = UNICAST_MAX_DESTINATIONS;
+	rtOpts->unicastPacingSlots = 16;
 
 	rtOpts->noAdjust = NO_ADJUST;  // false
 	rtOpts->logStatistics = TRUE;
 	rtOpts->sysopts.statisticsTimestamp = TIMESTAMP_DATETIME;
+	rtOpts->sysopts.statisticsLogFormat = STATSLOG_CSV;
 
 	rtOpts->periodicUpdates = FALSE; /* periodically log a status update */
 
@@ -224,6 +230,7 @@ loadDefaultSettings( RunTimeOpts* rtOpts )
 	rtOpts->inboundLatency.nanoseconds = DEFAULT_INBOUND_LATENCY;
 	rtOpts->outboundLatency.nanoseconds = DEFAULT_OUTBOUND_LATENCY;
 	rtOpts->max_foreign_records = DEFAULT_MAX_FOREIGN_RECORDS;
+	rtOpts->foreignRecordTimeWindow = DEFAULT_FOREIGN_MASTER_TIME_WINDOW;
 	rtOpts->sysopts.nonDaemon = FALSE;
 
 	/*
@@ -232,6 +239,8 @@ loadDefaultSettings( RunTimeOpts* rtOpts )
 	rtOpts->ignore_delayreq_interval_master = FALSE;
 	rtOpts->do_IGMP_refresh = TRUE;
 	rtOpts->sysopts.useSysLog       = FALSE;
+	rtOpts->sysopts.logAsync        = TRUE;
+	rtOpts->sysopts.logAsyncBuffer  = 256;
 	rtOpts->announceReceiptTimeout  = DEFAULT_ANNOUNCE_RECEIPT_TIMEOUT;
 #ifdef RUNTIME_DEBUG
 	rtOpts->sysopts.debug_level = LOG_INFO;			/* by default debug messages as disabled, but INFO messages and below are printed */
@@ -289,6 +298,14 @@ loadDefaultSettings( RunTimeOpts* rtOpts )
 
 	/* ADJ_FREQ_MAX by default */
 	rtOpts->servoMaxPpb = ADJ_FREQ_MAX / 1000;
+
+	rtOpts->clockBackend = CLOCKBACKEND_SYSTEM;
+	rtOpts->clockSimConfig.frequencyOffset = 0.0;
+	rtOpts->clockSimConfig.wander = 0.0;
+	rtOpts->clockSimConfig.initialOffset = 0.0;
+	rtOpts->clockSimConfig.seed = 1;
+	rtOpts->clockSimConfig.steps[0] = '\0';
+
 	/* kP and kI are scaled to 10000 and are gains now - values same as originally */
 	rtOpts->servoKP = 0.1;
 	rtOpts->servoKI = 0.001;
@@ -312,6 +329,14 @@ loadDefaultSettings( RunTimeOpts* rtOpts )
 	rtOpts->sysopts.cpuNumber = -1;
 #endif /* (linux && HAVE_SCHED_H) || HAVE_SYS_CPUSET_H*/
 
+	rtOpts->sysopts.rxThread = FALSE;
+	rtOpts->sysopts.rxThreadCpu = -1;
+	rtOpts->sysopts.rxThreadQueue = 1024;
+
+	rtOpts->sysopts.realtime = FALSE;
+	rtOpts->sysopts.realtimePriority = 50;
+	rtOpts->sysopts.realtimeLogThread = TRUE;
+
 #ifdef PTPD_STATISTICS
 
 	rtOpts->oFilterMSConfig.enabled = FALSE;
@@ -443,6 +468,12 @@ loadDefaultSettings( RunTimeOpts* rtOpts )
 	rtOpts->sysopts.statusLogConfig.truncateOnReopen = FALSE;
 	rtOpts->sysopts.statusLogConfig.unlinkOnClose = TRUE;
 
+	rtOpts->sysopts.traceLogConfig.logID = "servo trace";
+	rtOpts->sysopts.traceLogConfig.openMode = "a+";
+	rtOpts->sysopts.traceLogConfig.truncateOnReopen = FALSE;
+	rtOpts->sysopts.traceLogConfig.unlinkOnClose = FALSE;
+	rtOpts->sysopts.traceLogConfig.maxSize = 0;
+
 /* Management message support settings */
 	rtOpts->managementEnabled = TRUE;
 	rtOpts->managementSetEnable = FALSE;
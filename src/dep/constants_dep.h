@@ -51,6 +51,11 @@ if it's POSIX compatible, if you succeed, report it to ptpd-devel@sourceforge.ne
 #  define UNICAST_MAX_DESTINATIONS 16
 #endif /* PTPD_UNICAST_MAX */
 
+/* upper bound for the number of slots a unicast Sync / Announce interval is paced over */
+#define UNICAST_PACING_MAX_SLOTS 256
+/* grant phase increment, 2^16 / golden ratio: consecutive entries spread evenly for any slot count */
+#define UNICAST_PACING_PHASE_STEP 40503
+
 /* dummy clock driver designation in preparation for generic clock driver API */
 #define DEFAULT_CLOCKDRIVER "kernelclock"
 /* default lock file location and mode */
@@ -81,6 +86,11 @@ enum {
 	DRIFT_KERNEL,
 	DRIFT_FILE
 };
+/* clock backend driven by the servo */
+enum {
+	CLOCKBACKEND_SYSTEM = 0,
+	CLOCKBACKEND_SIMULATED
+};
 /* IP transmission mode */
 enum {
 	IPMODE_MULTICAST = 0,
@@ -98,6 +108,12 @@ enum {
 	TIMESTAMP_BOTH
 };
 
+/* statistics file format */
+enum {
+	STATSLOG_CSV,
+	STATSLOG_BINARY
+};
+
 /* servo dT calculation mode */
 enum {
 	DT_NONE,
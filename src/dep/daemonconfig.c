@@ -62,6 +62,14 @@
 #include "dep/daemonconfig.h"
 #include "ptpd_logging.h"
 #include "ptpd_utils.h"
+#include "ptp_timers.h"
+
+/* lowest message interval accepted outside experimental builds */
+#ifdef PTPD_TIMERFD
+#  define CONFIG_LOG_MIN_INTERVAL LOG_MIN_INTERVAL
+#else
+#  define CONFIG_LOG_MIN_INTERVAL -7
+#endif /* PTPD_TIMERFD */
 
 static char configFile[PATH_MAX+1];
 
@@ -967,7 +975,8 @@ parseConfig ( int opCode, void *opArg, dictionary* dict, RunTimeOpts *rtOpts )
 
 	parseResult &= configMapSelectValue(opCode, opArg, dict, target, "ptpengine:transport",
 		PTPD_RESTART_NETWORK, &rtOpts->transport, rtOpts->transport,
-		"Transport type for PTP packets. Ethernet transport requires libpcap support.",
+		"Transport type for PTP packets. Ethernet transport requires libpcap\n"
+	"	 or AF_PACKET memory mapped ring (Linux) support.",
 				"ipv4",		UDP_IPV4,
 #if 0
 				"ipv6",		UDP_IPV6,
@@ -1018,6 +1027,20 @@ parseConfig ( int opCode, void *opArg, dictionary* dict, RunTimeOpts *rtOpts )
 	"	 This option can be used as a workaround where a node sends signaling messages and\n"
 	"	 timing messages with different port identities", RANGECHECK_RANGE, 0,65535);
 
+	parseResult &= configMapInt(opCode, opArg, dict, target, "ptpengine:unicast_table_capacity",
+		PTPD_RESTART_PROTOCOL, INTTYPE_INT, &rtOpts->unicastTableCapacity, rtOpts->unicastTableCapacity,
+		"Capacity of the unicast destination / grant table: the maximum number of unicast\n"
+	"        slaves served (with or without negotiation), or masters configured on a slave.\n"
+	"	 The table is resized when the protocol restarts, no rebuild required.", RANGECHECK_RANGE, 1, 65535);
+
+	parseResult &= configMapInt(opCode, opArg, dict, target, "ptpengine:unicast_pacing_slots",
+		PTPD_RESTART_NONE, INTTYPE_INT, &rtOpts->unicastPacingSlots, rtOpts->unicastPacingSlots,
+		"Number of slots the Sync and Announce intervals are divided into when sending to\n"
+	"	 unicast destinations: each slave is sent to in its own slot, spreading transmissions\n"
+	"	 evenly across the interval instead of sending one burst. 1 sends one burst per interval.\n"
+	"	 The number of slots is limited by the shortest supported timer interval.",
+		RANGECHECK_RANGE, 1, UNICAST_PACING_MAX_SLOTS);
+
 	CONFIG_KEY_CONDITIONAL_WARNING_ISSET((rtOpts->transport == IEEE_802_3) && rtOpts->unicastNegotiation,
 	 			    "ptpengine:unicast_negotiation",
 				"Unicast negotiation cannot be used with Ethernet transport\n");
@@ -1041,6 +1064,19 @@ parseConfig ( int opCode, void *opArg, dictionary* dict, RunTimeOpts *rtOpts )
 		"When unicast negotiation enabled on a master clock, \n"
 	"	 reply to transmission requests also in LISTENING state.");
 
+#ifdef PTPD_PACKET_MMAP
+	parseResult &= configMapBoolean(opCode, opArg, dict, target, "ptpengine:use_packet_mmap",
+		PTPD_RESTART_NETWORK, &rtOpts->sysopts.packetMmap, rtOpts->sysopts.packetMmap,
+		"Use AF_PACKET sockets with memory mapped receive and transmit rings\n"
+	"	 instead of libpcap in Ethernet mode (automatically enabled in Ethernet\n"
+	"	 mode when built without libpcap).");
+#ifndef PTPD_PCAP
+	/* no libpcap: in ethernet mode, packet rings are the only way */
+	CONFIG_KEY_CONDITIONAL_TRIGGER(rtOpts->transport==IEEE_802_3,
+				       rtOpts->sysopts.packetMmap,TRUE, rtOpts->sysopts.packetMmap);
+#endif /* !PTPD_PCAP */
+#endif /* PTPD_PACKET_MMAP */
+
 #if defined(PTPD_PCAP) && defined(__sun) && !defined(PTPD_EXPERIMENTAL)
 	if(CONFIG_ISTRUE("ptpengine:use_libpcap"))
 	INFO("Libpcap support is currently marked broken/experimental on Solaris platforms.\n"
@@ -1063,8 +1099,8 @@ parseConfig ( int opCode, void *opArg, dictionary* dict, RunTimeOpts *rtOpts )
 		"Use libpcap for sending and receiving traffic (automatically enabled\n"
 	"	 in Ethernet mode).");
 
-	/* in ethernet mode, activate pcap and overwrite previous setting */
-	CONFIG_KEY_CONDITIONAL_TRIGGER(rtOpts->transport==IEEE_802_3,
+	/* in ethernet mode, activate pcap unless using packet rings, and overwrite previous setting */
+	CONFIG_KEY_CONDITIONAL_TRIGGER(rtOpts->transport==IEEE_802_3 && !rtOpts->sysopts.packetMmap,
 				       rtOpts->sysopts.pcap,TRUE, rtOpts->sysopts.pcap);
 #else
 	if(CONFIG_ISTRUE("ptpengine:use_libpcap"))
@@ -1077,13 +1113,15 @@ parseConfig ( int opCode, void *opArg, dictionary* dict, RunTimeOpts *rtOpts )
 		"Use libpcap for sending and receiving traffic (automatically enabled\n"
 	"	 in Ethernet mode).");
 
-	/* cannot set ethernet transport without libpcap */
+#ifndef PTPD_PACKET_MMAP
+	/* cannot set ethernet transport without libpcap or packet rings */
 	CONFIG_KEY_VALUE_FORBIDDEN("ptpengine:transport",
 				    rtOpts->transport == IEEE_802_3,
 				    "ethernet",
 	    "Libpcap support disabled or not available. Please install libpcap,\n"
 	     "build without --disable-pcap, or try building with ---with-pcap-config\n"
 	     "to use Ethernet transport. "PTPD_PROGNAME" was built with no libpcap support.\n");
+#endif /* !PTPD_PACKET_MMAP */
 
 #endif /* PTPD_PCAP */
 
@@ -1093,6 +1131,14 @@ parseConfig ( int opCode, void *opArg, dictionary* dict, RunTimeOpts *rtOpts )
 	"        Workaround for situations where a node (like Transparent Clock).\n"
 	"        does not rewrite checksums\n");
 
+	parseResult &= configMapBoolean(opCode, opArg, dict, target, "ptpengine:kernel_filter",
+		PTPD_RESTART_NETWORK, &rtOpts->sysopts.kernelFilter, rtOpts->sysopts.kernelFilter,
+		"Attach kernel (BPF) filters to the UDP sockets, dropping messages with the wrong\n"
+	"        PTP version or domain, messages of types not handled in the current port state\n"
+	"        and general messages sent by ourselves before they reach "PTPD_PROGNAME" (Linux only).\n"
+	"        Messages dropped this way are not included in the discarded message counters.\n"
+	"        Domain filtering is not used with global:enable_alarms or ptpengine:any_domain.\n");
+
 	parseResult &= configMapSelectValue(opCode, opArg, dict, target, "ptpengine:delay_mechanism",
 		PTPD_RESTART_PROTOCOL, &rtOpts->delayMechanism, rtOpts->delayMechanism,
 		 "Delay detection mode used - use DELAY_DISABLED for syntonisation only\n"
@@ -1216,7 +1262,7 @@ parseConfig ( int opCode, void *opArg, dictionary* dict, RunTimeOpts *rtOpts )
 #ifdef PTPD_EXPERIMENTAL
     "	"LOG2_HELP,RANGECHECK_RANGE,-30,30);
 #else
-    "	"LOG2_HELP,RANGECHECK_RANGE,-7,7);
+    "	"LOG2_HELP,RANGECHECK_RANGE,CONFIG_LOG_MIN_INTERVAL,7);
 #endif
 
 	parseResult &= configMapInt(opCode, opArg, dict, target, "ptpengine:log_sync_interval_max", PTPD_UPDATE_DATASETS, INTTYPE_I8, &rtOpts->logMaxSyncInterval, rtOpts->logMaxSyncInterval,
@@ -1247,7 +1293,7 @@ parseConfig ( int opCode, void *opArg, dictionary* dict, RunTimeOpts *rtOpts )
 #ifdef PTPD_EXPERIMENTAL
     "	"LOG2_HELP,RANGECHECK_RANGE,-30,30);
 #else
-    "	"LOG2_HELP,RANGECHECK_RANGE,-7,7);
+    "	"LOG2_HELP,RANGECHECK_RANGE,CONFIG_LOG_MIN_INTERVAL,7);
 #endif
 
 	/* take the delayreq_interval from config, otherwise use the initial setting as default */
@@ -1260,7 +1306,7 @@ parseConfig ( int opCode, void *opArg, dictionary* dict, RunTimeOpts *rtOpts )
 #ifdef PTPD_EXPERIMENTAL
     "	"LOG2_HELP,RANGECHECK_RANGE,-30,30);
 #else
-    "	"LOG2_HELP,RANGECHECK_RANGE,-7,7);
+    "	"LOG2_HELP,RANGECHECK_RANGE,CONFIG_LOG_MIN_INTERVAL,7);
 #endif
 
 	parseResult &= configMapInt(opCode, opArg, dict, target, "ptpengine:log_delayreq_interval_max", PTPD_UPDATE_DATASETS, INTTYPE_I8, &rtOpts->logMaxDelayReqInterval, rtOpts->logMaxDelayReqInterval,
@@ -1283,7 +1329,7 @@ parseConfig ( int opCode, void *opArg, dictionary* dict, RunTimeOpts *rtOpts )
 #ifdef PTPD_EXPERIMENTAL
     "	"LOG2_HELP,RANGECHECK_RANGE,-30,30);
 #else
-    "	"LOG2_HELP,RANGECHECK_RANGE,-7,7);
+    "	"LOG2_HELP,RANGECHECK_RANGE,CONFIG_LOG_MIN_INTERVAL,7);
 #endif
 
 	parseResult &= configMapInt(opCode, opArg, dict, target, "ptpengine:log_peer_delayreq_interval_max",
@@ -1300,8 +1346,15 @@ parseConfig ( int opCode, void *opArg, dictionary* dict, RunTimeOpts *rtOpts )
 					"ptpengine:log_peer_delayreq_interval value must be lower than ptpengine:log_peer_delayreq_interval_max\n");
 
 	parseResult &= configMapInt(opCode, opArg, dict, target, "ptpengine:foreignrecord_capacity",
-		PTPD_RESTART_DAEMON, INTTYPE_I16, &rtOpts->max_foreign_records, rtOpts->max_foreign_records,
-	"Foreign master record size (Maximum number of foreign masters).",RANGECHECK_RANGE,5,10);
+		PTPD_RESTART_PROTOCOL, INTTYPE_I16, &rtOpts->max_foreign_records, rtOpts->max_foreign_records,
+	"Foreign master record size (Maximum number of foreign masters). When the table is full,\n"
+	"	 the least recently heard from foreign master other than the best master is replaced.",RANGECHECK_RANGE,5,1024);
+
+	parseResult &= configMapInt(opCode, opArg, dict, target, "ptpengine:foreignrecord_time_window",
+		PTPD_RESTART_NONE, INTTYPE_INT, &rtOpts->foreignRecordTimeWindow, rtOpts->foreignRecordTimeWindow,
+	"Foreign master time window: foreign masters not heard from for this many of their\n"
+	"	 Announce intervals are removed from the foreign master table. The best master is only\n"
+	"	 removed on Announce receipt timeout. 0 = keep records until the table is reset.",RANGECHECK_RANGE,0,255);
 
 	parseResult &= configMapInt(opCode, opArg, dict, target, "ptpengine:ptp_allan_variance", PTPD_UPDATE_DATASETS, INTTYPE_U16, &rtOpts->clockQuality.offsetScaledLogVariance, rtOpts->clockQuality.offsetScaledLogVariance,
 	"Specify Allan variance announced in master state.",RANGECHECK_RANGE,0,65535);
@@ -1532,7 +1585,7 @@ parseConfig ( int opCode, void *opArg, dictionary* dict, RunTimeOpts *rtOpts )
 
 	parseResult &= configMapInt(opCode, opArg, dict, target, "ptpengine:sync_stat_filter_window",
 		PTPD_RESTART_FILTERS, INTTYPE_INT, &rtOpts->filterMSOpts.windowSize, rtOpts->filterMSOpts.windowSize,
-		"Number of samples used for the Sync statistical filter",RANGECHECK_RANGE,3,128);
+		"Number of samples used for the Sync statistical filter",RANGECHECK_RANGE,3,STATFILTER_MAX_SAMPLES);
 
 	parseResult &= configMapSelectValue(opCode, opArg, dict, target, "ptpengine:sync_stat_filter_window_type",
 		PTPD_RESTART_FILTERS, &rtOpts->filterMSOpts.windowType, rtOpts->filterMSOpts.windowType,
@@ -1558,7 +1611,7 @@ parseConfig ( int opCode, void *opArg, dictionary* dict, RunTimeOpts *rtOpts )
 
 	parseResult &= configMapInt(opCode, opArg, dict, target, "ptpengine:delay_stat_filter_window",
 		PTPD_RESTART_FILTERS, INTTYPE_INT, &rtOpts->filterSMOpts.windowSize, rtOpts->filterSMOpts.windowSize,
-		"Number of samples used for the Delay statistical filter",RANGECHECK_RANGE,3,128);
+		"Number of samples used for the Delay statistical filter",RANGECHECK_RANGE,3,STATFILTER_MAX_SAMPLES);
 
 	parseResult &= configMapSelectValue(opCode, opArg, dict, target, "ptpengine:delay_stat_filter_window_type",
 		PTPD_RESTART_FILTERS, &rtOpts->filterSMOpts.windowType, rtOpts->filterSMOpts.windowType,
@@ -1998,6 +2051,50 @@ parseConfig ( int opCode, void *opArg, dictionary* dict, RunTimeOpts *rtOpts )
 	ADJ_FREQ_MAX/1000,ADJ_FREQ_MAX/500);
 #endif /* HAVE_STRUCT_TIMEX_TICK */
 
+	parseResult &= configMapSelectValue(opCode, opArg, dict, target, "clock:backend",
+		PTPD_RESTART_DAEMON, &rtOpts->clockBackend, rtOpts->clockBackend,
+		"Clock disciplined by the servo:\n"
+	"	 system: the operating system clock\n"
+	"	 simulated: a software oscillator (see clock:sim_*), for deterministic\n"
+	"	 servo testing and benchmarking. The system clock is not touched.",
+				"system",	CLOCKBACKEND_SYSTEM,
+				"simulated",	CLOCKBACKEND_SIMULATED, NULL
+				);
+
+	parseResult &= configMapDouble(opCode, opArg, dict, target, "clock:sim_frequency_offset",
+		PTPD_RESTART_DAEMON, &rtOpts->clockSimConfig.frequencyOffset, rtOpts->clockSimConfig.frequencyOffset,
+		"Simulated clock: frequency error of the oscillator (ppb, positive runs fast)",
+		RANGECHECK_RANGE, -1000000.0, 1000000.0);
+
+	parseResult &= configMapDouble(opCode, opArg, dict, target, "clock:sim_wander",
+		PTPD_RESTART_DAEMON, &rtOpts->clockSimConfig.wander, rtOpts->clockSimConfig.wander,
+		"Simulated clock: frequency wander - standard deviation (ppb) of the\n"
+	"	 random walk step applied to the oscillator frequency every second. 0 - no wander.",
+		RANGECHECK_RANGE, 0.0, 10000.0);
+
+	parseResult &= configMapDouble(opCode, opArg, dict, target, "clock:sim_initial_offset",
+		PTPD_RESTART_DAEMON, &rtOpts->clockSimConfig.initialOffset, rtOpts->clockSimConfig.initialOffset,
+		"Simulated clock: offset (seconds) from the system clock at startup",
+		RANGECHECK_RANGE, -1000000.0, 1000000.0);
+
+	parseResult &= configMapInt(opCode, opArg, dict, target, "clock:sim_seed",
+		PTPD_RESTART_DAEMON, INTTYPE_U32, &rtOpts->clockSimConfig.seed, rtOpts->clockSimConfig.seed,
+		"Simulated clock: random walk seed - the same seed gives the same oscillator",
+		RANGECHECK_NONE, 0, 0);
+
+	parseResult &= configMapString(opCode, opArg, dict, target, "clock:sim_steps",
+		PTPD_RESTART_DAEMON, rtOpts->clockSimConfig.steps, sizeof(rtOpts->clockSimConfig.steps),
+		rtOpts->clockSimConfig.steps,
+		"Simulated clock: step events as a list of <time>:<step> pairs in seconds,\n"
+	"	 time counted from startup, for example \"300:0.5 600:-0.002\"");
+
+	{
+		ClockSimStep steps[CLOCKSIM_MAX_STEPS];
+		CONFIG_CONDITIONAL_ASSERTION(clockSimParseSteps(rtOpts->clockSimConfig.steps,
+			steps, CLOCKSIM_MAX_STEPS) < 0,
+			"clock:sim_steps must be a list of up to 32 <time>:<step> pairs, time >= 0");
+	}
+
 	/*
 	 * TimeProperties DS - in future when clock driver API is implemented,
 	 * a slave PTP engine should inform a clock about this, and then that
@@ -2140,6 +2237,18 @@ parseConfig ( int opCode, void *opArg, dictionary* dict, RunTimeOpts *rtOpts )
 		"Send log messages to syslog. Disabling this\n"
 	"        sends all messages to stdout (or speficied log file).");
 
+	parseResult &= configMapBoolean(opCode, opArg, dict, target, "global:log_async",
+		PTPD_RESTART_LOGGING, &rtOpts->sysopts.logAsync, rtOpts->sysopts.logAsync,
+		"Write log messages from a separate thread: messages are only formatted\n"
+	"	 and queued where they are logged, and file, syslog and console output\n"
+	"	 and log rotation do not hold up the protocol.");
+
+	parseResult &= configMapInt(opCode, opArg, dict, target, "global:log_async_buffer",
+		PTPD_RESTART_LOGGING, INTTYPE_INT, &rtOpts->sysopts.logAsyncBuffer, rtOpts->sysopts.logAsyncBuffer,
+		"Number of log messages that can be waiting to be written out with global:log_async\n"
+	"	 (rounded up to a power of 2). When the queue is full, messages are dropped\n"
+	"	 and the number of dropped messages is logged.", RANGECHECK_RANGE, 16, 65536);
+
 	parseResult &= configMapString(opCode, opArg, dict, target, "global:lock_file",
 				       PTPD_RESTART_DAEMON, rtOpts->sysopts.lockFile,
 				       sizeof(rtOpts->sysopts.lockFile), rtOpts->sysopts.lockFile,
@@ -2192,6 +2301,37 @@ parseConfig ( int opCode, void *opArg, dictionary* dict, RunTimeOpts *rtOpts )
 		"Truncate the sync packet record file every time it is (re) opened:\n"
 	"	 startup and SIGHUP.");
 
+	/* if servo trace file specified, enable servo input recording */
+	CONFIG_KEY_TRIGGER("global:servo_trace_file", rtOpts->sysopts.traceLogConfig.logInitiallyEnabled,TRUE,FALSE);
+	parseResult &= configMapString(opCode, opArg, dict, target, "global:servo_trace_file",
+				       PTPD_RESTART_LOGGING, rtOpts->sysopts.traceLogConfig.logPath,
+				       sizeof(rtOpts->sysopts.traceLogConfig.logPath),
+				       rtOpts->sysopts.traceLogConfig.logPath,
+		"File used to record the timestamps, frequency adjustments and clock steps\n"
+	"	 seen by the clock servo. Enables recording when set. The trace can be\n"
+	"	 replayed offline with --replay to evaluate servo and filter settings.");
+
+	parseResult &= configMapInt(opCode, opArg, dict, target, "global:servo_trace_file_max_size",
+				    PTPD_RESTART_LOGGING, INTTYPE_U32,
+				    &rtOpts->sysopts.traceLogConfig.maxSize,
+				    rtOpts->sysopts.traceLogConfig.maxSize,
+		"Maximum servo trace file size (in kB) - file will be truncated\n"
+	"	if size exceeds the limit. 0 - no limit.", RANGECHECK_MIN,0,0);
+
+	parseResult &= configMapInt(opCode, opArg, dict, target, "global:servo_trace_file_max_files",
+				    PTPD_RESTART_LOGGING, INTTYPE_INT,
+				    &rtOpts->sysopts.traceLogConfig.maxFiles,
+				    rtOpts->sysopts.traceLogConfig.maxFiles,
+		"Enable log rotation of the servo trace file up to n files.\n"
+	"	 0 - do not rotate.\n", RANGECHECK_RANGE,0, 100);
+
+	parseResult &= configMapBoolean(opCode, opArg, dict, target, "global:servo_trace_file_truncate",
+					PTPD_RESTART_LOGGING,
+					&rtOpts->sysopts.traceLogConfig.truncateOnReopen,
+					rtOpts->sysopts.traceLogConfig.truncateOnReopen,
+		"Truncate the servo trace file every time it is (re) opened:\n"
+	"	 startup and SIGHUP.");
+
 	/* if status file specified, enable status logging*/
 	CONFIG_KEY_TRIGGER("global:status_file", rtOpts->sysopts.statusLogConfig.logInitiallyEnabled,TRUE,FALSE);
 	parseResult &= configMapString(opCode, opArg, dict, target, "global:status_file",
@@ -2210,6 +2350,14 @@ parseConfig ( int opCode, void *opArg, dictionary* dict, RunTimeOpts *rtOpts )
 		"Status file update interval in seconds.", RANGECHECK_RANGE,
 	1,30);
 
+	parseResult &= configMapString(opCode, opArg, dict, target, "global:status_shm",
+				       PTPD_RESTART_LOGGING, rtOpts->sysopts.statusShmName,
+				       sizeof(rtOpts->sysopts.statusShmName),
+				       rtOpts->sysopts.statusShmName,
+	"Name of a POSIX shared memory segment (/name) to publish "PTPD_PROGNAME" status in,\n"
+	"	 updated on every clock update, state change and status update interval.\n"
+	"	 Read it with ptpd2-status. Empty: status is not published.");
+
 #ifdef RUNTIME_DEBUG
 	parseResult &= configMapSelectValue(opCode, opArg, dict, target, "global:debug_level",
 		PTPD_RESTART_NONE, (uint8_t*)&rtOpts->sysopts.debug_level, rtOpts->sysopts.debug_level,
@@ -2360,6 +2508,19 @@ parseConfig ( int opCode, void *opArg, dictionary* dict, RunTimeOpts *rtOpts )
 		"both",		TIMESTAMP_BOTH, NULL
 		);
 
+	parseResult &= configMapSelectValue(opCode, opArg, dict, target, "global:statistics_log_format",
+					    PTPD_RESTART_LOGGING, &rtOpts->sysopts.statisticsLogFormat,
+					    rtOpts->sysopts.statisticsLogFormat,
+		"Format of the statistics file (global:statistics_file):\n"
+	"        csv - comma separated text, one line per entry\n"
+	"        binary - fixed size binary records, converted to csv with ptpd2-statsconv.\n"
+	"                 Statistics logged to standard output are always csv.\n",
+		"csv",		STATSLOG_CSV,
+		"binary",	STATSLOG_BINARY, NULL
+		);
+
+	rtOpts->sysopts.statisticsLogConfig.binary = (rtOpts->sysopts.statisticsLogFormat == STATSLOG_BINARY);
+
 	/* If statistics file is enabled but logStatistics isn't, disable logging to file */
 	CONFIG_KEY_CONDITIONAL_TRIGGER(rtOpts->sysopts.statisticsLogConfig.logInitiallyEnabled && !rtOpts->logStatistics,
 				       rtOpts->sysopts.statisticsLogConfig.logInitiallyEnabled, FALSE,
@@ -2372,6 +2533,42 @@ parseConfig ( int opCode, void *opArg, dictionary* dict, RunTimeOpts *rtOpts )
 	-1,255);
 #endif /* (linux && HAVE_SCHED_H) || HAVE_SYS_CPUSET_H */
 
+	parseResult &= configMapBoolean(opCode, opArg, dict, target, "global:rx_thread",
+		PTPD_RESTART_NETWORK, &rtOpts->sysopts.rxThread, rtOpts->sysopts.rxThread,
+		"Read the UDP sockets from a separate thread which timestamps and queues incoming\n"
+	"        messages for the protocol, so that a busy protocol thread does not let the socket\n"
+	"        buffers overflow (Linux only, not used with libpcap).\n");
+
+	parseResult &= configMapInt(opCode, opArg, dict, target, "global:rx_thread_cpucore",
+		PTPD_RESTART_NETWORK, INTTYPE_INT, &rtOpts->sysopts.rxThreadCpu, rtOpts->sysopts.rxThreadCpu,
+		"Bind the receive thread (global:rx_thread) to a selected CPU core number.\n"
+	"        -1 = do not bind to a single core.", RANGECHECK_RANGE,
+	-1,255);
+
+	parseResult &= configMapInt(opCode, opArg, dict, target, "global:rx_thread_queue",
+		PTPD_RESTART_NETWORK, INTTYPE_INT, &rtOpts->sysopts.rxThreadQueue, rtOpts->sysopts.rxThreadQueue,
+		"Number of messages the receive thread (global:rx_thread) can queue for each socket,\n"
+	"        rounded up to a power of 2. Messages arriving when the queue is full are dropped.", RANGECHECK_RANGE,
+	16,65536);
+
+	parseResult &= configMapBoolean(opCode, opArg, dict, target, "global:realtime",
+		PTPD_RESTART_DAEMON, &rtOpts->sysopts.realtime, rtOpts->sysopts.realtime,
+		"Run "PTPD_PROGNAME" with SCHED_FIFO real-time scheduling (global:realtime_priority),\n"
+	"        with all of its memory locked and the stack and protocol data faulted in\n"
+	"        at startup, so that it is not held up by other processes or page faults (Linux only).\n"
+	"        The receive thread (global:rx_thread) also runs at this priority.\n");
+
+	parseResult &= configMapInt(opCode, opArg, dict, target, "global:realtime_priority",
+		PTPD_RESTART_DAEMON, INTTYPE_INT, &rtOpts->sysopts.realtimePriority, rtOpts->sysopts.realtimePriority,
+		"SCHED_FIFO priority used with global:realtime.", RANGECHECK_RANGE,
+	1,99);
+
+	parseResult &= configMapBoolean(opCode, opArg, dict, target, "global:realtime_log_thread",
+		PTPD_RESTART_LOGGING, &rtOpts->sysopts.realtimeLogThread, rtOpts->sysopts.realtimeLogThread,
+		"With global:realtime, always write log messages from a separate thread\n"
+	"        (as with global:log_async) running with normal scheduling, so that log\n"
+	"        output never runs at real-time priority.\n");
+
 	parseResult &= configMapInt(opCode, opArg, dict, target, "global:statistics_update_interval",
 		PTPD_RESTART_NONE, INTTYPE_INT, &rtOpts->statsUpdateInterval,
 								rtOpts->statsUpdateInterval,
@@ -2380,7 +2577,8 @@ parseConfig ( int opCode, void *opArg, dictionary* dict, RunTimeOpts *rtOpts )
 	parseResult &= configMapBoolean(opCode, opArg, dict, target, "global:periodic_updates",
 		PTPD_RESTART_LOGGING, &rtOpts->periodicUpdates, rtOpts->periodicUpdates,
 		"Log a status update every time statistics are updated (global:statistics_update_interval).\n"
-	"        The updates are logged even when ptpd is configured without statistics support");
+	"        The updates are logged even when ptpd is configured without statistics support.\n"
+	"        They include page faults and involuntary context switches since the previous update.");
 
 #ifdef PTPD_STATISTICS
 
@@ -2822,12 +3020,13 @@ Boolean loadCommandLineOptions(RunTimeOpts* rtOpts, dictionary* dict, int argc,
 	    {"unicast",		optional_argument, 0, 'U'},
 	    {"unicast-negotiation",		optional_argument, 0, 'g'},
 	    {"unicast-destinations",		required_argument, 0, 'u'},
+	    {"replay",		required_argument, 0, 'z'},
 	    {0,			0		 , 0, 0}
 	};
 
-	while ((c = getopt_long(argc, argv, "?c:kb:i:d:sgmGMWyUu:nf:S:r:DvCVHTt:he:Y:tOLEPAaR:l:p", long_options, &opt_index)) != -1) {
+	while ((c = getopt_long(argc, argv, "?c:kb:i:d:sgmGMWyUu:nf:S:r:DvCVHTt:he:Y:tOLEPAaR:l:pz:", long_options, &opt_index)) != -1) {
 #else
-	while ((c = getopt(argc, argv, "?c:kb:i:d:sgmGMWyUu:nf:S:r:DvCVHTt:he:Y:tOLEPAaR:l:p")) != -1) {
+	while ((c = getopt(argc, argv, "?c:kb:i:d:sgmGMWyUu:nf:S:r:DvCVHTt:he:Y:tOLEPAaR:l:pz:")) != -1) {
 #endif
 	    switch(c) {
 /* non-config options first */
@@ -2993,6 +3192,15 @@ short_help:
 		case 'R':
 			dictionary_set(dict,"global:lock_directory", optarg);
 			break;
+		/* replay a servo trace offline */
+		case 'z':
+			strncpy(rtOpts->replayFile, optarg, PATH_MAX);
+			rtOpts->sysopts.nonDaemon=1;
+			/* no network is used, but the interface is a required setting */
+			if(dictionary_get(dict, "ptpengine:interface", NULL) == NULL) {
+				dictionary_set(dict,"ptpengine:interface", "replay");
+			}
+			break;
 		default:
 			break;
 
@@ -3073,6 +3281,8 @@ printShortHelp()
 			"-T --show-templates		display available configuration templates\n"
 			"-t --templates [name],[name],[...]\n"
 			"                               apply configuration template(s) - see man(5) ptpd2.conf\n"
+			"-z --replay [path]		Replay a servo trace (global:servo_trace_file) offline\n"
+			"				and exit: no network is used and the clock is virtual\n"
 			"\n"
 			"Basic PTP protocol and daemon configuration options: \n"
 			"\n"
@@ -3489,6 +3699,11 @@ Boolean runTimeOptsInit(int argc, char **argv, Integer16* ret, RunTimeOpts* rtOp
 	/* we don't need the candidate config any more */
 	dictionary_del(&candidateConfig);
 
+	/* a replay runs against a virtual clock and does not touch the network */
+	if(strlen(rtOpts->replayFile) > 0) {
+		goto configcheck;
+	}
+
 	/* Check network before going into background */
 	if(!testInterface(rtOpts->sysopts.primaryIfaceName, rtOpts)) {
 		ERROR("Error: Cannot use %s interface\n",rtOpts->sysopts.primaryIfaceName);
@@ -55,11 +55,11 @@ EventTimer
             return NULL;
         }
 
+	/* the timer comes zeroed - name it first so that setup errors can say which one failed */
+        strncpy(timer->id, id, EVENTTIMER_MAX_DESC);
 
 	setupEventTimer(timer);
 
-        strncpy(timer->id, id, EVENTTIMER_MAX_DESC);
-
 	/* maintain the linked list */
 
 	if(_first == NULL) {
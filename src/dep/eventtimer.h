@@ -36,6 +36,8 @@
 
 #define EVENTTIMER_MAX_DESC		20
 #define EVENTTIMER_MIN_INTERVAL_US	250 /* 4000/sec */
+/* timerfd timers are not signal driven, so the only floor is a non-zero value */
+#define EVENTTIMER_TIMERFD_MIN_INTERVAL_NS	1000
 
 typedef struct EventTimer EventTimer;
 
@@ -45,6 +47,7 @@ struct EventTimer {
 	char id[EVENTTIMER_MAX_DESC + 1];
 	Boolean expired;
 	Boolean running;
+	Boolean expiryReported;	/* timeLeft() has offered the latched expiry to the main loop */
 
 	/* "methods" */
 	void (*start) (EventTimer* timer, double interval);
@@ -53,14 +56,22 @@ struct EventTimer {
 	void (*shutdown) (EventTimer* timer);
 	Boolean (*isExpired) (EventTimer* timer);
 	Boolean (*isRunning) (EventTimer* timer);
+	/* seconds until the next expiry, negative if not running */
+	double (*timeLeft) (EventTimer* timer);
 
 	/* implementation data */
-#ifdef PTPD_PTIMERS
+#if defined(PTPD_NETSIM)
+	int64_t interval;	/* virtual time, ns */
+	int64_t nextExpiry;
+#elif defined(PTPD_TIMERFD)
+	int timerFd;
+	double nextExpiry; /* CLOCK_MONOTONIC seconds, refreshed on expiry */
+#elif defined(PTPD_PTIMERS)
 	timer_t timerId;
 #else
 	int32_t itimerInterval;
 	int32_t itimerLeft;
-#endif /* PTPD_PTIMERS */
+#endif /* PTPD_NETSIM / PTPD_TIMERFD / PTPD_PTIMERS */
 
 	/* linked list */
 	EventTimer *_first;
@@ -75,6 +86,8 @@ void setupEventTimer(EventTimer *timer);
 
 void startEventTimers();
 void shutdownEventTimers();
+/* descriptor readable on timer expiry, -1 if the implementation uses signals */
+int getEventTimerFd();
 
 
 #endif /* EVENTTIMER_H_ */
@@ -73,6 +73,7 @@ static void eventTimerReset_itimer(EventTimer *timer);
 static void eventTimerShutdown_itimer(EventTimer *timer);
 static Boolean eventTimerIsRunning_itimer(EventTimer *timer);
 static Boolean eventTimerIsExpired_itimer(EventTimer *timer);
+static double eventTimerTimeLeft_itimer(EventTimer *timer);
 
 static void itimerUpdate(EventTimer *et);
 static void timerSignalHandler(int sig);
@@ -84,14 +85,13 @@ setupEventTimer(EventTimer *timer)
 	    return;
 	}
 
-	memset(timer, 0, sizeof(EventTimer));
-
 	timer->start = eventTimerStart_itimer;
 	timer->stop = eventTimerStop_itimer;
 	timer->reset = eventTimerReset_itimer;
 	timer->shutdown = eventTimerShutdown_itimer;
 	timer->isExpired = eventTimerIsExpired_itimer;
 	timer->isRunning = eventTimerIsRunning_itimer;
+	timer->timeLeft = eventTimerTimeLeft_itimer;
 }
 
 static void
@@ -195,6 +195,19 @@ eventTimerIsExpired_itimer(EventTimer *timer)
 	return ret;
 }
 
+static double
+eventTimerTimeLeft_itimer(EventTimer *timer)
+{
+	itimerUpdate(timer);
+
+	if(!timer->running) {
+	    return -1.0;
+	}
+
+	/* resolution is one tick - the signal will interrupt us anyway */
+	return (timer->itimerLeft * US_TIMER_INTERVAL) / 1E6;
+}
+
 void
 startEventTimers(void)
 {
@@ -221,6 +234,13 @@ startEventTimers(void)
 	setitimer(ITIMER_REAL, &itimer, 0);
 }
 
+int
+getEventTimerFd(void)
+{
+	/* expiry is signalled with SIGALRM */
+	return -1;
+}
+
 void
 shutdownEventTimers(void)
 {
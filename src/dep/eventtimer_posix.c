@@ -62,6 +62,7 @@ static void eventTimerReset_posix(EventTimer *timer);
 static void eventTimerShutdown_posix(EventTimer *timer);
 static Boolean eventTimerIsRunning_posix(EventTimer *timer);
 static Boolean eventTimerIsExpired_posix(EventTimer *timer);
+static double eventTimerTimeLeft_posix(EventTimer *timer);
 static void timerSignalHandler(int sig, siginfo_t *info, void *usercontext);
 
 void
@@ -74,7 +75,6 @@ setupEventTimer(EventTimer *timer)
 	}
 
 	memset(&sev, 0, sizeof(sev));
-	memset(timer, 0, sizeof(EventTimer));
 
 	timer->start = eventTimerStart_posix;
 	timer->stop = eventTimerStop_posix;
@@ -82,6 +82,7 @@ setupEventTimer(EventTimer *timer)
 	timer->shutdown = eventTimerShutdown_posix;
 	timer->isExpired = eventTimerIsExpired_posix;
 	timer->isRunning = eventTimerIsRunning_posix;
+	timer->timeLeft = eventTimerTimeLeft_posix;
 
 	sev.sigev_notify = SIGEV_SIGNAL;
 	sev.sigev_signo = TIMER_SIGNAL;
@@ -184,6 +185,28 @@ eventTimerIsExpired_posix(EventTimer *timer)
 	return ret;
 }
 
+static double
+eventTimerTimeLeft_posix(EventTimer *timer)
+{
+	struct itimerspec its;
+
+	if(!timer->running) {
+	    return -1.0;
+	}
+
+	if(timer_gettime(timer->timerId, &its) < 0) {
+		PERROR("could not read posix timer %s", timer->id);
+		return -1.0;
+	}
+
+	/* disarmed behind our back */
+	if(!its.it_value.tv_sec && !its.it_value.tv_nsec) {
+		return -1.0;
+	}
+
+	return its.it_value.tv_sec + its.it_value.tv_nsec / 1E9;
+}
+
 void
 startEventTimers(void)
 {
@@ -205,6 +228,13 @@ startEventTimers(void)
 	}
 }
 
+int
+getEventTimerFd(void)
+{
+	/* expiry is signalled with SIGALRM */
+	return -1;
+}
+
 void
 shutdownEventTimers(void)
 {
@@ -0,0 +1,190 @@
+/*-
+ * Copyright (c) 2015      Wojciech Owczarek,
+ *
+ * All Rights Reserved
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHORS ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE AUTHORS OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+ * OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
+ * IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+/**
+ * @file   eventtimer_sim.c
+ * @date   Sun Oct 18 19:20:44 2026
+ *
+ * @brief  EventTimer implementation running on the network simulator's virtual time
+ *
+ * Timers are just deadlines on the virtual timebase. Nothing fires on
+ * its own: the simulator asks every port for its next deadline, moves
+ * virtual time there and runs the port, which then finds the timer
+ * expired. Periodic timers keep their phase, as kernel timers do.
+ */
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "ptp_primitives.h"
+#include "ptpd_logging.h"
+#include "dep/eventtimer.h"
+#include "dep/netsim.h"
+
+/* the floor timerfd timers use */
+#define EVENTTIMER_SIM_MIN_INTERVAL_NS	EVENTTIMER_TIMERFD_MIN_INTERVAL_NS
+
+static void eventTimerStart_sim(EventTimer *timer, double interval);
+static void eventTimerStop_sim(EventTimer *timer);
+static void eventTimerReset_sim(EventTimer *timer);
+static void eventTimerShutdown_sim(EventTimer *timer);
+static Boolean eventTimerIsRunning_sim(EventTimer *timer);
+static Boolean eventTimerIsExpired_sim(EventTimer *timer);
+static double eventTimerTimeLeft_sim(EventTimer *timer);
+
+/* latch an expiry that is due and move the deadline past now */
+static void
+eventTimerUpdate_sim(EventTimer *timer)
+{
+	int64_t now = netSimNow();
+	int64_t overrun;
+
+	if(!timer->running || now < timer->nextExpiry) {
+		return;
+	}
+
+	timer->expired = TRUE;
+
+	overrun = (now - timer->nextExpiry) / timer->interval;
+	if(overrun > 0) {
+		DBG2("timerUpdate:    Timer %s overrun by %lld intervals\n", timer->id,
+			(long long)overrun);
+	}
+
+	timer->nextExpiry += (overrun + 1) * timer->interval;
+}
+
+void
+setupEventTimer(EventTimer *timer)
+{
+	if(timer == NULL) {
+	    return;
+	}
+
+	timer->start = eventTimerStart_sim;
+	timer->stop = eventTimerStop_sim;
+	timer->reset = eventTimerReset_sim;
+	timer->shutdown = eventTimerShutdown_sim;
+	timer->isExpired = eventTimerIsExpired_sim;
+	timer->isRunning = eventTimerIsRunning_sim;
+	timer->timeLeft = eventTimerTimeLeft_sim;
+}
+
+static void
+eventTimerStart_sim(EventTimer *timer, double interval)
+{
+	timer->interval = interval * 1E9;
+
+	if(timer->interval < EVENTTIMER_SIM_MIN_INTERVAL_NS) {
+	    timer->interval = EVENTTIMER_SIM_MIN_INTERVAL_NS;
+	}
+
+	timer->nextExpiry = netSimNow() + timer->interval;
+	timer->expired = FALSE;
+	timer->running = TRUE;
+
+	DBG2("timerStart:     Set timer %s to %f\n", timer->id, interval);
+}
+
+static void
+eventTimerStop_sim(EventTimer *timer)
+{
+	timer->running = FALSE;
+	timer->expired = FALSE;
+
+	DBG2("timerStop: stopped timer %s\n", timer->id);
+}
+
+static void
+eventTimerReset_sim(EventTimer *timer)
+{
+}
+
+static void
+eventTimerShutdown_sim(EventTimer *timer)
+{
+	timer->running = FALSE;
+}
+
+static Boolean
+eventTimerIsRunning_sim(EventTimer *timer)
+{
+	DBG2("timerIsRunning:   Timer %s %s running\n", timer->id,
+		timer->running ? "is" : "is not");
+
+	return timer->running;
+}
+
+static Boolean
+eventTimerIsExpired_sim(EventTimer *timer)
+{
+	Boolean ret;
+
+	eventTimerUpdate_sim(timer);
+
+	ret = timer->expired;
+
+	DBG2("timerIsExpired:   Timer %s %s expired\n", timer->id,
+		timer->expired ? "is" : "is not");
+
+	if(ret) {
+	    timer->expired = FALSE;
+	}
+
+	return ret;
+}
+
+static double
+eventTimerTimeLeft_sim(EventTimer *timer)
+{
+	if(!timer->running) {
+	    return -1.0;
+	}
+
+	eventTimerUpdate_sim(timer);
+
+	return (timer->nextExpiry - netSimNow()) / 1E9;
+}
+
+/* nothing to poll - the simulator drives the timers */
+int
+getEventTimerFd(void)
+{
+	return -1;
+}
+
+void
+startEventTimers(void)
+{
+}
+
+void
+shutdownEventTimers(void)
+{
+}
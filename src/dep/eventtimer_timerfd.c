@@ -0,0 +1,309 @@
+/*-
+ * Copyright (c) 2015      Wojciech Owczarek,
+ *
+ * All Rights Reserved
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHORS ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE AUTHORS OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+ * OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
+ * IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/**
+ * @file   eventtimer_timerfd.c
+ * @date   Sat Oct 17 18:02:11 2026
+ *
+ * @brief  EventTimer implementation using Linux timerfd
+ *
+ * Signal-free timer implementation: each timer is a timerfd on
+ * CLOCK_MONOTONIC, and all of them are collected in one epoll set
+ * whose descriptor the main loop polls together with the sockets.
+ * Expiry no longer interrupts system calls, and intervals are not
+ * limited to EVENTTIMER_MIN_INTERVAL_US.
+ */
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+#include <unistd.h>
+#include <errno.h>
+#include <time.h>
+#include <sys/epoll.h>
+#include <sys/timerfd.h>
+
+#include "ptp_primitives.h"
+#include "ptpd_logging.h"
+#include "dep/eventtimer.h"
+
+/* all timerfds are registered here - readable when any timer has expired */
+static int timerSet = -1;
+
+static void eventTimerStart_timerfd(EventTimer *timer, double interval);
+static void eventTimerStop_timerfd(EventTimer *timer);
+static void eventTimerReset_timerfd(EventTimer *timer);
+static void eventTimerShutdown_timerfd(EventTimer *timer);
+static Boolean eventTimerIsRunning_timerfd(EventTimer *timer);
+static Boolean eventTimerIsExpired_timerfd(EventTimer *timer);
+static double eventTimerTimeLeft_timerfd(EventTimer *timer);
+
+static double
+monotonicNow(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+
+	return ts.tv_sec + ts.tv_nsec / 1E9;
+}
+
+/*
+ * Consume any pending expirations of the timer and re-read the time
+ * of the next one. Called only once our estimate of the next expiry
+ * has passed, so the hot path does not need any system calls.
+ * Returns FALSE if the timer is no longer armed.
+ */
+static Boolean
+eventTimerUpdate_timerfd(EventTimer *timer)
+{
+	uint64_t expirations = 0;
+	struct itimerspec its;
+	double now = monotonicNow();
+
+	if(read(timer->timerFd, &expirations, sizeof(expirations)) == sizeof(expirations) &&
+	    expirations > 0) {
+		timer->expired = TRUE;
+		if(expirations > 1) {
+		    DBG2("timerUpdate:    Timer %s overrun by %llu intervals\n", timer->id,
+			(unsigned long long)(expirations - 1));
+		}
+	}
+
+	if(timerfd_gettime(timer->timerFd, &its) < 0) {
+		PERROR("could not read timerfd timer %s", timer->id);
+		return FALSE;
+	}
+
+	/* disarmed behind our back */
+	if(!its.it_value.tv_sec && !its.it_value.tv_nsec) {
+		return FALSE;
+	}
+
+	timer->nextExpiry = now + its.it_value.tv_sec + its.it_value.tv_nsec / 1E9;
+
+	return TRUE;
+}
+
+void
+setupEventTimer(EventTimer *timer)
+{
+	struct epoll_event ev;
+
+	if(timer == NULL) {
+	    return;
+	}
+
+	timer->start = eventTimerStart_timerfd;
+	timer->stop = eventTimerStop_timerfd;
+	timer->reset = eventTimerReset_timerfd;
+	timer->shutdown = eventTimerShutdown_timerfd;
+	timer->isExpired = eventTimerIsExpired_timerfd;
+	timer->isRunning = eventTimerIsRunning_timerfd;
+	timer->timeLeft = eventTimerTimeLeft_timerfd;
+
+	if((timer->timerFd = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC)) < 0) {
+	    PERROR("Could not create timerfd timer %s", timer->id);
+	    return;
+	}
+
+	memset(&ev, 0, sizeof(ev));
+	ev.events = EPOLLIN;
+	ev.data.ptr = timer;
+
+	if(epoll_ctl(timerSet, EPOLL_CTL_ADD, timer->timerFd, &ev) < 0) {
+	    PERROR("Could not add timerfd timer %s to timer set", timer->id);
+	} else {
+	    DBGV("Created timerfd timer %s ",timer->id);
+	}
+}
+
+static void
+eventTimerStart_timerfd(EventTimer *timer, double interval)
+{
+	struct timespec ts;
+	struct itimerspec its;
+
+	memset(&its, 0, sizeof(its));
+
+	ts.tv_sec = interval;
+	ts.tv_nsec = (interval - ts.tv_sec) * 1E9;
+
+	/* a zero value would disarm the timer */
+	if(!ts.tv_sec && ts.tv_nsec < EVENTTIMER_TIMERFD_MIN_INTERVAL_NS) {
+	    ts.tv_nsec = EVENTTIMER_TIMERFD_MIN_INTERVAL_NS;
+	}
+
+	DBGV("Timer %s start requested at %d.%4d sec interval\n", timer->id, ts.tv_sec, ts.tv_nsec);
+
+	its.it_interval = ts;
+	its.it_value = ts;
+
+	if (timerfd_settime(timer->timerFd, 0, &its, NULL) < 0) {
+		PERROR("could not arm timerfd timer %s", timer->id);
+		return;
+	}
+
+	DBG2("timerStart:     Set timer %s to %f\n", timer->id, interval);
+
+	timer->nextExpiry = monotonicNow() + ts.tv_sec + ts.tv_nsec / 1E9;
+	timer->expired = FALSE;
+	timer->expiryReported = FALSE;
+	timer->running = TRUE;
+}
+
+static void
+eventTimerStop_timerfd(EventTimer *timer)
+{
+	struct itimerspec its;
+
+	DBGV("Timer %s stop requested\n", timer->id);
+
+	memset(&its, 0, sizeof(its));
+
+	/* disarming also clears any unread expirations */
+	if (timerfd_settime(timer->timerFd, 0, &its, NULL) < 0) {
+		PERROR("could not stop timerfd timer %s", timer->id);
+		return;
+	}
+
+	timer->running = FALSE;
+
+	DBG2("timerStop: stopped timer %s\n", timer->id);
+}
+
+static void
+eventTimerReset_timerfd(EventTimer *timer)
+{
+}
+
+static void
+eventTimerShutdown_timerfd(EventTimer *timer)
+{
+	/* closing the descriptor also removes it from the timer set */
+	if(timer->timerFd >= 0 && close(timer->timerFd) == -1) {
+	    PERROR("Could not delete timer %s!", timer->id);
+	}
+	timer->timerFd = -1;
+}
+
+static Boolean
+eventTimerIsRunning_timerfd(EventTimer *timer)
+{
+	DBG2("timerIsRunning:   Timer %s %s running\n", timer->id,
+		timer->running ? "is" : "is not");
+
+	return timer->running;
+}
+
+static Boolean
+eventTimerIsExpired_timerfd(EventTimer *timer)
+{
+	Boolean ret;
+
+	if(timer->running && !timer->expired && monotonicNow() >= timer->nextExpiry) {
+	    eventTimerUpdate_timerfd(timer);
+	}
+
+	ret = timer->expired;
+
+	DBG2("timerIsExpired:   Timer %s %s expired\n", timer->id,
+		timer->expired ? "is" : "is not");
+
+	if(ret) {
+	    timer->expired = FALSE;
+	    timer->expiryReported = FALSE;
+	}
+
+	return ret;
+}
+
+/*
+ * This also drains the descriptor of a timer that has expired,
+ * so that the timer set does not stay readable while nobody is
+ * interested in this particular timer.
+ */
+static double
+eventTimerTimeLeft_timerfd(EventTimer *timer)
+{
+	double now;
+
+	if(!timer->running) {
+	    return -1.0;
+	}
+
+	now = monotonicNow();
+
+	if(now >= timer->nextExpiry) {
+	    if(!eventTimerUpdate_timerfd(timer)) {
+		return -1.0;
+	    }
+	    now = monotonicNow();
+	}
+
+	/*
+	 * latched but not serviced yet - nextExpiry already points at the following
+	 * period, so report it as due. Only once though: a timer the current state
+	 * does not poll would otherwise keep the main loop from ever sleeping.
+	 */
+	if(timer->expired && !timer->expiryReported) {
+	    timer->expiryReported = TRUE;
+	    return 0.0;
+	}
+
+	return (timer->nextExpiry > now) ? timer->nextExpiry - now : 0.0;
+}
+
+int
+getEventTimerFd(void)
+{
+	return timerSet;
+}
+
+void
+startEventTimers(void)
+{
+	DBG("initTimer\n");
+
+	if(timerSet >= 0) {
+	    return;
+	}
+
+	if((timerSet = epoll_create1(EPOLL_CLOEXEC)) < 0) {
+	    PERROR("Could not create timerfd timer set");
+	}
+}
+
+void
+shutdownEventTimers(void)
+{
+	if(timerSet >= 0) {
+	    close(timerSet);
+	}
+
+	timerSet = -1;
+}
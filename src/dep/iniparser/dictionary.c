@@ -71,6 +71,64 @@ static char * xstrdup(const char * s)
     return t ;
 }
 
+/* Smallest power of 2 hash index keeping 'size' entries at most half full */
+static int index_size(int size)
+{
+    int buckets = 1 ;
+
+    while (buckets < 2 * size)
+        buckets <<= 1 ;
+    return buckets ;
+}
+
+/*-------------------------------------------------------------------------*/
+/**
+  @brief    Find the hash index slot of a key
+  @param    d       dictionary object to search.
+  @param    key     Key to look for.
+  @param    hash    Hash of the key.
+  @return   Slot holding the key, or the empty slot where it would go
+
+  Probes linearly from the home slot of the hash. The index is never more
+  than half full, so an empty slot always ends the probe.
+ */
+/*--------------------------------------------------------------------------*/
+static int dictionary_slot(dictionary * d, const char * key, unsigned hash)
+{
+    unsigned    mask = d->buckets - 1 ;
+    unsigned    b ;
+    int         e ;
+
+    for (b = hash & mask ; d->index[b] ; b = (b + 1) & mask) {
+        e = d->index[b] - 1 ;
+        if (d->hash[e] == hash && !strcmp(key, d->key[e]))
+            break ;
+    }
+    return b ;
+}
+
+/* Rebuild the hash index for 'buckets' slots from the entry list */
+static int dictionary_reindex(dictionary * d, int buckets)
+{
+    int *       index ;
+    unsigned    mask = buckets - 1 ;
+    unsigned    b ;
+    int         i ;
+
+    index = (int *)calloc(buckets, sizeof(int)) ;
+    if (index == NULL)
+        return -1 ;
+    for (i = 0 ; i < d->n ; i++) {
+        for (b = d->hash[i] & mask ; index[b] ; b = (b + 1) & mask)
+            ;
+        index[b] = i + 1 ;
+    }
+    free(d->index) ;
+    d->index = index ;
+    d->buckets = buckets ;
+    return 0 ;
+}
+
 /*---------------------------------------------------------------------------
                             Function codes
  ---------------------------------------------------------------------------*/
@@ -129,6 +187,12 @@ dictionary * dictionary_new(int size)
     d->val  = (char **)calloc(size, sizeof(char*));
     d->key  = (char **)calloc(size, sizeof(char*));
     d->hash = (unsigned int *)calloc(size, sizeof(unsigned));
+    d->buckets = index_size(size) ;
+    d->index = (int *)calloc(d->buckets, sizeof(int));
+    if (d->val == NULL || d->key == NULL || d->hash == NULL || d->index == NULL) {
+        dictionary_del(&d) ;
+        return NULL ;
+    }
     return d ;
 }
 
@@ -146,7 +210,7 @@ void dictionary_del(dictionary ** d)
     int     i ;
 
     if (*d==NULL) return ;
-    for (i=0 ; i<(*d)->size ; i++) {
+    for (i=0 ; i<(*d)->n ; i++) {
         if ((*d)->key[i]!=NULL)
             free((*d)->key[i]);
         if ((*d)->val[i]!=NULL)
@@ -155,6 +219,7 @@ void dictionary_del(dictionary ** d)
     free((*d)->val);
     free((*d)->key);
     free((*d)->hash);
+    free((*d)->index);
     free(*d);
     *d = NULL;
     return ;
@@ -176,21 +241,11 @@ void dictionary_del(dictionary ** d)
 /*--------------------------------------------------------------------------*/
 char * dictionary_get(dictionary * d, const char * key, char * def)
 {
-    unsigned    hash ;
-    int         i ;
+    int         b ;
 
-    hash = dictionary_hash(key);
-    for (i=0 ; i<d->size ; i++) {
-        if (d->key[i]==NULL)
-            continue ;
-        /* Compare hash */
-        if (hash==d->hash[i]) {
-            /* Compare string, to avoid hash collisions */
-            if (!strcmp(key, d->key[i])) {
-                return d->val[i] ;
-            }
-        }
-    }
+    b = dictionary_slot(d, key, dictionary_hash(key));
+    if (d->index[b])
+        return d->val[d->index[b] - 1] ;
     return def ;
 }
 
@@ -223,28 +278,22 @@ char * dictionary_get(dictionary * d, const char * key, char * def)
 int dictionary_set(dictionary * d, const char * key, const char * val)
 {
     int         i ;
+    int         b ;
     unsigned    hash ;
 
     if (d==NULL || key==NULL) return -1 ;
-   
+
     /* Compute hash for this key */
     hash = dictionary_hash(key) ;
     /* Find if value is already in dictionary */
-    if (d->n>0) {
-        for (i=0 ; i<d->size ; i++) {
-            if (d->key[i]==NULL)
-                continue ;
-            if (hash==d->hash[i]) { /* Same hash value */
-                if (!strcmp(key, d->key[i])) {   /* Same key */
-                    /* Found a value: modify and return */
-                    if (d->val[i]!=NULL)
-                        free(d->val[i]);
-                    d->val[i] = val ? xstrdup(val) : NULL ;
-                    /* Value has been modified: return */
-                    return 0 ;
-                }
-            }
-        }
+    b = dictionary_slot(d, key, hash) ;
+    if (d->index[b]) {
+        /* Found a value: modify and return */
+        i = d->index[b] - 1 ;
+        if (d->val[i]!=NULL)
+            free(d->val[i]);
+        d->val[i] = val ? xstrdup(val) : NULL ;
+        return 0 ;
     }
     /* Add a new value */
     /* See if dictionary needs to grow */
@@ -260,18 +309,18 @@ int dictionary_set(dictionary * d, const char * key, const char * val)
         }
         /* Double size */
         d->size *= 2 ;
+        /* Keep the index at most half full */
+        if (dictionary_reindex(d, index_size(d->size)) != 0)
+            return -1 ;
+        b = dictionary_slot(d, key, hash) ;
     }
 
-    /* Insert key in the first empty slot. Start at d->n and wrap at
-       d->size. Because d->n < d->size this will necessarily
-       terminate. */
-    for (i=d->n ; d->key[i] ; ) {
-        if(++i == d->size) i = 0;
-    }
-    /* Copy key */
+    /* Append the entry, keeping insertion order */
+    i = d->n ;
     d->key[i]  = xstrdup(key);
     d->val[i]  = val ? xstrdup(val) : NULL ;
     d->hash[i] = hash;
+    d->index[b] = i + 1 ;
     d->n ++ ;
 
     return 0 ;
@@ -290,38 +339,50 @@ int dictionary_set(dictionary * d, const char * key, const char * val)
 /*--------------------------------------------------------------------------*/
 void dictionary_unset(dictionary * d, const char * key)
 {
-    unsigned    hash ;
+    unsigned    mask ;
+    unsigned    b, j, home ;
     int         i ;
 
     if (key == NULL) {
         return;
     }
 
-    hash = dictionary_hash(key);
-    for (i=0 ; i<d->size ; i++) {
-        if (d->key[i]==NULL)
-            continue ;
-        /* Compare hash */
-        if (hash==d->hash[i]) {
-            /* Compare string, to avoid hash collisions */
-            if (!strcmp(key, d->key[i])) {
-                /* Found key */
-                break ;
-            }
-        }
-    }
-    if (i>=d->size)
+    mask = d->buckets - 1 ;
+    b = dictionary_slot(d, key, dictionary_hash(key));
+    if (!d->index[b])
         /* Key not found */
         return ;
+    i = d->index[b] - 1 ;
+
+    /* Empty the slot, moving back later entries of the probe run
+       that would otherwise no longer be reachable from their home slot */
+    d->index[b] = 0 ;
+    for (j = (b + 1) & mask ; d->index[j] ; j = (j + 1) & mask) {
+        home = d->hash[d->index[j] - 1] & mask ;
+        if (((j - home) & mask) >= ((j - b) & mask)) {
+            d->index[b] = d->index[j] ;
+            d->index[j] = 0 ;
+            b = j ;
+        }
+    }
 
     free(d->key[i]);
-    d->key[i] = NULL ;
-    if (d->val[i]!=NULL) {
+    if (d->val[i]!=NULL)
         free(d->val[i]);
-        d->val[i] = NULL ;
+
+    /* Close the gap in the entry list and renumber the moved entries */
+    for (j = i + 1 ; j < d->n ; j++) {
+        for (b = d->hash[j] & mask ; d->index[b] != j + 1 ; b = (b + 1) & mask)
+            ;
+        d->index[b] = j ;
     }
-    d->hash[i] = 0 ;
+    memmove(&d->key[i], &d->key[i + 1], (d->n - i - 1) * sizeof(char*));
+    memmove(&d->val[i], &d->val[i + 1], (d->n - i - 1) * sizeof(char*));
+    memmove(&d->hash[i], &d->hash[i + 1], (d->n - i - 1) * sizeof(unsigned));
     d->n -- ;
+    d->key[d->n] = NULL ;
+    d->val[d->n] = NULL ;
+    d->hash[d->n] = 0 ;
     return ;
 }
 
@@ -424,7 +485,7 @@ void dictionary_dump(dictionary * d, FILE * out)
         fprintf(out, "empty dictionary\n");
         return ;
     }
-    for (i=0 ; i<d->size ; i++) {
+    for (i=0 ; i<d->n ; i++) {
         if (d->key[i]) {
             fprintf(out, "%20s\t[%s]\n",
                     d->key[i],
@@ -33,17 +33,22 @@
   @brief    Dictionary object
 
   This object contains a list of string/string associations. Each
-  association is identified by a unique string key. Looking up values
-  in the dictionary is speeded up by the use of a (hopefully collision-free)
-  hash function.
+  association is identified by a unique string key. Entries are kept
+  densely in insertion order in key[0..n-1], so the dictionary can be
+  walked and dumped in the order it was built. Keys are located through
+  an open-addressing (linear probing) hash index over those entries,
+  which is kept at most half full, so lookups and updates take constant
+  time on average.
  */
 /*-------------------------------------------------------------------------*/
 typedef struct _dictionary_ {
-    int             n ;     /** Number of entries in dictionary */
-    int             size ;  /** Storage size */
-    char        **  val ;   /** List of string values */
-    char        **  key ;   /** List of string keys */
-    unsigned     *  hash ;  /** List of hash values for keys */
+    int             n ;       /** Number of entries in dictionary */
+    int             size ;    /** Storage size */
+    char        **  val ;     /** List of string values */
+    char        **  key ;     /** List of string keys */
+    unsigned     *  hash ;    /** List of hash values for keys */
+    int             buckets ; /** Number of hash index slots, a power of 2 */
+    int          *  index ;   /** Hash index: entry number + 1, 0 if empty */
 } dictionary ;
 
 
@@ -142,7 +147,8 @@ int dictionary_set(dictionary * vd, const char * key, const char * val);
   @return   void
 
   This function deletes a key in a dictionary. Nothing is done if the
-  key cannot be found.
+  key cannot be found. The entries following it are moved down to keep
+  the insertion order, so this is linear in the number of entries.
  */
 /*--------------------------------------------------------------------------*/
 void dictionary_unset(dictionary * d, const char * key);
@@ -33,6 +33,10 @@
  *
  * Functions in this file parse, create and match IPv4 ACLs.
  *
+ * Mask tables are compiled into a binary trie of network prefixes, so an address
+ * is matched in at most 32 steps however long the table is, and the last few
+ * hundred addresses matched are remembered with the entries they matched.
+ *
  */
 
 #ifdef HAVE_CONFIG_H
@@ -67,17 +71,40 @@ typedef struct AclEntry {
 	uint32_t hitCount;
 } AclEntry;
 
+/* size of the direct-mapped cache of matched addresses */
+#define ACL_CACHE_BITS 8
+#define ACL_CACHE_SIZE (1 << ACL_CACHE_BITS)
+
+typedef struct AclTrieNode {
+	int32_t child[2];	/* node for the next address bit being 0 / 1, 0: none (root is node 0) */
+	int32_t entry;		/* first entry with exactly this prefix + 1, 0: none */
+} AclTrieNode;
+
 typedef struct MaskTable {
 	int numEntries;
 	AclEntry* entries;
+	AclTrieNode* trie;	/* entries with contiguous masks */
+	int trieNodes;
+	int trieCapacity;
+	int* irregular;		/* entries with non-contiguous masks, matched linearly */
+	int numIrregular;
 } MaskTable;
 
+typedef struct AclCacheEntry {
+	uint32_t addr;
+	int32_t permitEntry;	/* matching entry, -1: none */
+	int32_t denyEntry;	/* matching entry, -1: none */
+	uint8_t valid;
+} AclCacheEntry;
+
 typedef struct Ipv4AccessList {
 	MaskTable* permitTable;
 	MaskTable* denyTable;
 	int processingOrder;
 	uint32_t passedCounter;
 	uint32_t droppedCounter;
+	uint32_t cacheHits;
+	AclCacheEntry cache[ACL_CACHE_SIZE];
 } Ipv4AccessList;
 
 /* count tokens in string delimited by delim */
@@ -285,6 +312,84 @@ maskParser(const char* input, AclEntry* output)
 	return found;
 }
 
+/* Get a new empty trie node, -1 if out of memory */
+static int
+newTrieNode(MaskTable* table)
+{
+	AclTrieNode* trie;
+
+	if(table->trieNodes == table->trieCapacity) {
+		trie = (AclTrieNode*)realloc(table->trie, 2 * table->trieCapacity * sizeof(AclTrieNode));
+		if(trie == NULL)
+			return -1;
+		table->trie = trie;
+		table->trieCapacity *= 2;
+	}
+
+	memset(&table->trie[table->trieNodes], 0, sizeof(AclTrieNode));
+	return table->trieNodes++;
+}
+
+/*
+ * Build the prefix trie of a parsed MaskTable. The entries are matched in table order,
+ * so each prefix node keeps the first entry with that prefix; masks like 255.255.253.0
+ * are not prefixes and are kept in a list matched linearly.
+ */
+static Boolean
+compileMaskTable(MaskTable* table)
+{
+	int i, bit, node, next;
+	uint32_t prefixMask;
+	AclEntry* entry;
+
+	table->trieCapacity = 64;
+	table->trie = (AclTrieNode*)calloc(table->trieCapacity, sizeof(AclTrieNode));
+	table->irregular = (int*)calloc(table->numEntries + 1, sizeof(int));
+	if(table->trie == NULL || table->irregular == NULL)
+		return FALSE;
+	table->trieNodes = 1;
+
+	for(i = 0; i < table->numEntries; i++) {
+		entry = &table->entries[i];
+		prefixMask = entry->netmask ? ~0U << (32 - entry->netmask) : 0;
+
+		if(entry->bitmask != prefixMask) {
+			table->irregular[table->numIrregular++] = i;
+			continue;
+		}
+
+		for(node = 0, bit = 0; bit < entry->netmask; bit++, node = next) {
+			next = table->trie[node].child[(entry->network >> (31 - bit)) & 1];
+			if(!next) {
+				if((next = newTrieNode(table)) < 0)
+					return FALSE;
+				table->trie[node].child[(entry->network >> (31 - bit)) & 1] = next;
+			}
+		}
+
+		if(!table->trie[node].entry)
+			table->trie[node].entry = i + 1;
+	}
+
+	return TRUE;
+}
+
+/* Free a MaskTable structure */
+static void freeMaskTable(MaskTable** table)
+{
+    if(*table == NULL)
+	return;
+
+    if((*table)->entries != NULL) {
+	free((*table)->entries);
+	(*table)->entries = NULL;
+    }
+    free((*table)->trie);
+    free((*table)->irregular);
+    free(*table);
+    *table = NULL;
+}
+
 /* Create a maskTable from a text ACL */
 static MaskTable*
 createMaskTable(const char* input)
@@ -295,6 +400,10 @@ createMaskTable(const char* input)
 		ret=(MaskTable*)calloc(1,sizeof(MaskTable));
 		ret->entries = (AclEntry*)calloc(masksFound, sizeof(AclEntry));
 		ret->numEntries = maskParser(input,ret->entries);
+		if(!compileMaskTable(ret)) {
+			ERROR("Could not allocate memory for access list: \"%s\"\n", input);
+			freeMaskTable(&ret);
+		}
 		return ret;
 	} else {
 		ERROR("Error while parsing access list: \"%s\"\n", input);
@@ -310,7 +419,7 @@ dumpMaskTable(MaskTable* table)
 	uint32_t network;
 	if(table == NULL)
 	    return;
-	INFO("number of entries: %d\n",table->numEntries);
+	INFO("number of entries: %d, trie nodes: %d\n",table->numEntries, table->trieNodes);
 	if(table->entries != NULL) {
 		for(i = 0; i < table->numEntries; i++) {
 		    AclEntry this = table->entries[i];
@@ -323,20 +432,6 @@ dumpMaskTable(MaskTable* table)
 	}
 }
 
-/* Free a MaskTable structure */
-static void freeMaskTable(MaskTable** table)
-{
-    if(*table == NULL)
-	return;
-
-    if((*table)->entries != NULL) {
-	free((*table)->entries);
-	(*table)->entries = NULL;
-    }
-    free(*table);
-    *table = NULL;
-}
-
 /* Destroy an Ipv4AccessList structure */
 void
 freeIpv4AccessList(Ipv4AccessList** acl)
@@ -368,22 +463,38 @@ createIpv4AccessList(const char* permitList, const char* denyList, int processin
 }
 
 
-/* Match an IP address against a MaskTable */
+/* Find the first entry in a MaskTable matching an IP address, -1 if none */
 static int
-matchAddress(const uint32_t addr, MaskTable* table)
+matchAddress(const uint32_t addr, const MaskTable* table)
 {
-	int i;
+	int i, node, depth;
+	int found = 0; /* entry + 1 */
+
 	if(table == NULL || table->entries == NULL || table->numEntries==0)
 	    return -1;
-	for(i = 0; i < table->numEntries; i++) {
-		DBGV("addr: %08x, addr & mask: %08x, network: %08x\n",addr, table->entries[i].bitmask & addr, table->entries[i].network);
-		if((table->entries[i].bitmask & addr) == table->entries[i].network) {
-			table->entries[i].hitCount++;
-			return 1;
+
+	/* the first entry of all prefixes of the address */
+	for(node = 0, depth = 0; ; depth++) {
+		if(table->trie[node].entry && (!found || table->trie[node].entry < found))
+			found = table->trie[node].entry;
+		if(depth == 32)
+			break;
+		if(!(node = table->trie[node].child[(addr >> (31 - depth)) & 1]))
+			break;
+	}
+
+	for(i = 0; i < table->numIrregular; i++) {
+		if(found && table->irregular[i] >= found - 1)
+			break;
+		if((table->entries[table->irregular[i]].bitmask & addr) == table->entries[table->irregular[i]].network) {
+			found = table->irregular[i] + 1;
+			break;
 		}
 	}
 
-	return 0;
+	DBGV("addr: %08x, matching entry: %d\n", addr, found - 1);
+
+	return found - 1;
 }
 
 /* Test an IP address against an ACL */
@@ -393,6 +504,7 @@ matchIpv4AccessList(Ipv4AccessList* acl, const uint32_t addr)
 	int ret;
 	int matchPermit = 0;
 	int matchDeny = 0;
+	AclCacheEntry *cached;
 
 	/* Non-functional ACL permits everything */
 	if(acl == NULL) {
@@ -400,11 +512,26 @@ matchIpv4AccessList(Ipv4AccessList* acl, const uint32_t addr)
 		goto end;
 	}
 
-	if(acl->permitTable != NULL)
-		matchPermit = matchAddress(addr,acl->permitTable) > 0;
+	cached = &acl->cache[(addr * 2654435761U) >> (32 - ACL_CACHE_BITS)];
 
-	if(acl->denyTable != NULL)
-		matchDeny = matchAddress(addr,acl->denyTable) > 0;
+	if(cached->valid && cached->addr == addr) {
+		acl->cacheHits++;
+	} else {
+		cached->addr = addr;
+		cached->permitEntry = matchAddress(addr,acl->permitTable);
+		cached->denyEntry = matchAddress(addr,acl->denyTable);
+		cached->valid = TRUE;
+	}
+
+	if(cached->permitEntry >= 0) {
+		acl->permitTable->entries[cached->permitEntry].hitCount++;
+		matchPermit = 1;
+	}
+
+	if(cached->denyEntry >= 0) {
+		acl->denyTable->entries[cached->denyEntry].hitCount++;
+		matchDeny = 1;
+	}
 
 	switch(acl->processingOrder) {
 		case ACL_PERMIT_DENY:
@@ -451,8 +578,8 @@ void dumpIpv4AccessList(Ipv4AccessList* acl)
 	switch(acl->processingOrder) {
 		case ACL_DENY_PERMIT:
 		    INFO("ACL order: deny,permit\n");
-		    INFO("Passed packets: %d, dropped packets: %d\n",
-				acl->passedCounter, acl->droppedCounter);
+		    INFO("Passed packets: %d, dropped packets: %d, cache hits: %d\n",
+				acl->passedCounter, acl->droppedCounter, acl->cacheHits);
 		    INFO("--------\n");
 		    INFO("Deny list:\n");
 		    dumpMaskTable(acl->denyTable);
@@ -463,8 +590,8 @@ void dumpIpv4AccessList(Ipv4AccessList* acl)
 		case ACL_PERMIT_DENY:
 		default:
 		    INFO("ACL order: permit,deny\n");
-		    INFO("Passed packets: %d, dropped packets: %d\n",
-				acl->passedCounter, acl->droppedCounter);
+		    INFO("Passed packets: %d, dropped packets: %d, cache hits: %d\n",
+				acl->passedCounter, acl->droppedCounter, acl->cacheHits);
 		    INFO("--------\n");
 		    INFO("Permit list:\n");
 		    dumpMaskTable(acl->permitTable);
@@ -497,6 +624,7 @@ void clearIpv4AccessListCounters(Ipv4AccessList* acl)
 		return;
 	acl->passedCounter=0;
 	acl->droppedCounter=0;
+	acl->cacheHits=0;
 	clearMaskTableCounters(acl->permitTable);
 	clearMaskTableCounters(acl->denyTable);
 }
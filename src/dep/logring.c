@@ -0,0 +1,306 @@
+/*-
+ * Copyright (c) 2015 Wojciech Owczarek,
+ *
+ * All Rights Reserved
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHORS ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE AUTHORS OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+ * OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
+ * IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/**
+ * @file   logring.c
+ * @date   Mon Oct 19 09:12:05 2026
+ *
+ * @brief  Lock-free log message queue and its writer thread
+ *
+ * A bounded multi-producer queue: every slot carries a sequence number
+ * telling producers and the consumer whose turn it is, so claiming a
+ * slot is one compare-and-swap and nobody ever waits on a lock. The
+ * writer thread only sleeps on a semaphore when the queue is empty, and
+ * producers only post it when it says it is asleep.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stddef.h>
+#include <string.h>
+#include <stdint.h>
+#include <pthread.h>
+#include <semaphore.h>
+#include <signal.h>
+#include <sched.h>
+#include <syslog.h>
+
+#include "dep/logring.h"
+
+typedef struct {
+	uint64_t sequence;
+	LogRecord record;
+} LogSlot;
+
+static LogSlot *slots = NULL;
+static uint64_t mask = 0;
+
+/* producers and consumer positions kept on separate cache lines */
+static uint64_t head __attribute__((aligned(64))) = 0;
+static uint64_t tail __attribute__((aligned(64))) = 0;
+static uint64_t dropped __attribute__((aligned(64))) = 0;
+
+static int sleeping = 0;
+static int stopping = 0;
+static Boolean running = FALSE;
+static Boolean exitHook = FALSE;
+
+static sem_t wakeup;
+static pthread_t writer;
+static void (*outputFunc) (const LogRecord *record) = NULL;
+
+#define SLOT_OF(record) ((LogSlot*)((char*)(record) - offsetof(LogSlot, record)))
+
+LogRecord *
+logRingClaim(void)
+{
+	uint64_t pos = __atomic_load_n(&head, __ATOMIC_RELAXED);
+	LogSlot *slot;
+	int64_t diff;
+
+	for(;;) {
+		slot = &slots[pos & mask];
+		diff = (int64_t)__atomic_load_n(&slot->sequence, __ATOMIC_ACQUIRE) - (int64_t)pos;
+		if(diff == 0) {
+			if(__atomic_compare_exchange_n(&head, &pos, pos + 1, TRUE,
+			    __ATOMIC_RELAXED, __ATOMIC_RELAXED)) {
+				return &slot->record;
+			}
+			/* lost the race - pos now holds the current head */
+		} else if(diff < 0) {
+			/* the writer has not caught up yet */
+			__atomic_add_fetch(&dropped, 1, __ATOMIC_RELAXED);
+			return NULL;
+		} else {
+			pos = __atomic_load_n(&head, __ATOMIC_RELAXED);
+		}
+	}
+}
+
+void
+logRingCommit(LogRecord *record)
+{
+	LogSlot *slot = SLOT_OF(record);
+	uint64_t pos = __atomic_load_n(&slot->sequence, __ATOMIC_RELAXED);
+
+	__atomic_store_n(&slot->sequence, pos + 1, __ATOMIC_RELEASE);
+
+	/* pairs with the fence in waitForRecords() */
+	__atomic_thread_fence(__ATOMIC_SEQ_CST);
+	if(__atomic_exchange_n(&sleeping, 0, __ATOMIC_RELAXED)) {
+		sem_post(&wakeup);
+	}
+}
+
+/* consumer side: the next committed record, or NULL */
+static LogSlot *
+nextSlot(void)
+{
+	LogSlot *slot = &slots[tail & mask];
+
+	if(__atomic_load_n(&slot->sequence, __ATOMIC_ACQUIRE) != tail + 1) {
+		return NULL;
+	}
+
+	return slot;
+}
+
+static void
+releaseSlot(LogSlot *slot)
+{
+	__atomic_store_n(&slot->sequence, tail + mask + 1, __ATOMIC_RELEASE);
+	tail++;
+}
+
+static void
+reportDropped(void)
+{
+	LogRecord record;
+	uint64_t count = __atomic_exchange_n(&dropped, 0, __ATOMIC_RELAXED);
+
+	if(count == 0) {
+		return;
+	}
+
+	memset(&record, 0, sizeof(record));
+	gettimeofday(&record.time, NULL);
+	record.priority = LOG_WARNING;
+	record.state = "___";
+	strncpy(record.iface, "logging", sizeof(record.iface) - 1);
+	snprintf(record.text, sizeof(record.text),
+	    "Log queue full: %llu log messages dropped\n", (unsigned long long)count);
+	outputFunc(&record);
+}
+
+/* empty queue: sleep unless something arrives or we are asked to stop */
+static void
+waitForRecords(void)
+{
+	__atomic_store_n(&sleeping, 1, __ATOMIC_RELAXED);
+	__atomic_thread_fence(__ATOMIC_SEQ_CST);
+
+	if(nextSlot() != NULL || __atomic_load_n(&stopping, __ATOMIC_RELAXED)) {
+		/* a producer may still post for this - harmless extra wakeup */
+		__atomic_store_n(&sleeping, 0, __ATOMIC_RELAXED);
+		return;
+	}
+
+	while(sem_wait(&wakeup) != 0) {
+		;
+	}
+}
+
+static void *
+writerThread(void *arg)
+{
+	LogSlot *slot;
+
+	for(;;) {
+		while((slot = nextSlot()) != NULL) {
+			outputFunc(&slot->record);
+			releaseSlot(slot);
+		}
+
+		reportDropped();
+
+		if(__atomic_load_n(&stopping, __ATOMIC_ACQUIRE)) {
+			/* one last look - stop() is only called once producers are quiet */
+			if(nextSlot() == NULL) {
+				break;
+			}
+			continue;
+		}
+
+		waitForRecords();
+	}
+
+	return NULL;
+}
+
+Boolean
+logRingStart(int capacity, void (*output) (const LogRecord *record), Boolean timeshare)
+{
+	uint64_t size = 1;
+	uint64_t i;
+	sigset_t all, old;
+	pthread_attr_t attr;
+	struct sched_param param;
+	int ret;
+
+	if(running) {
+		logRingStop();
+	}
+
+	if(capacity < LOGRING_MIN_CAPACITY) {
+		capacity = LOGRING_MIN_CAPACITY;
+	}
+	if(capacity > LOGRING_MAX_CAPACITY) {
+		capacity = LOGRING_MAX_CAPACITY;
+	}
+	while(size < (uint64_t)capacity) {
+		size <<= 1;
+	}
+
+	slots = calloc(size, sizeof(LogSlot));
+	if(slots == NULL) {
+		return FALSE;
+	}
+
+	for(i = 0; i < size; i++) {
+		slots[i].sequence = i;
+	}
+
+	mask = size - 1;
+	head = 0;
+	tail = 0;
+	dropped = 0;
+	sleeping = 0;
+	stopping = 0;
+	outputFunc = output;
+
+	if(sem_init(&wakeup, 0, 0) != 0) {
+		free(slots);
+		slots = NULL;
+		return FALSE;
+	}
+
+	pthread_attr_init(&attr);
+	if(timeshare) {
+		/* otherwise the writer inherits the caller's policy and priority */
+		memset(&param, 0, sizeof(param));
+		pthread_attr_setinheritsched(&attr, PTHREAD_EXPLICIT_SCHED);
+		pthread_attr_setschedpolicy(&attr, SCHED_OTHER);
+		pthread_attr_setschedparam(&attr, &param);
+	}
+
+	/* signals stay with the main thread */
+	sigfillset(&all);
+	pthread_sigmask(SIG_SETMASK, &all, &old);
+	ret = pthread_create(&writer, &attr, writerThread, NULL);
+	pthread_sigmask(SIG_SETMASK, &old, NULL);
+	pthread_attr_destroy(&attr);
+
+	if(ret != 0) {
+		sem_destroy(&wakeup);
+		free(slots);
+		slots = NULL;
+		return FALSE;
+	}
+
+	if(!exitHook) {
+		atexit(logRingStop);
+		exitHook = TRUE;
+	}
+
+	running = TRUE;
+	return TRUE;
+}
+
+void
+logRingStop(void)
+{
+	if(!running) {
+		return;
+	}
+
+	/* from here on logMessage() writes directly */
+	running = FALSE;
+	__atomic_store_n(&stopping, 1, __ATOMIC_RELEASE);
+	sem_post(&wakeup);
+	pthread_join(writer, NULL);
+
+	sem_destroy(&wakeup);
+	free(slots);
+	slots = NULL;
+	outputFunc = NULL;
+}
+
+Boolean
+logRingRunning(void)
+{
+	return running;
+}
@@ -0,0 +1,78 @@
+/*-
+ * Copyright (c) 2015 Wojciech Owczarek,
+ *
+ * All Rights Reserved
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHORS ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE AUTHORS OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+ * OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
+ * IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef LOGRING_H_
+#define LOGRING_H_
+
+/**
+ * @file   logring.h
+ * @date   Mon Oct 19 09:12:05 2026
+ *
+ * @brief  Lock-free log message queue and its writer thread
+ *
+ */
+
+#include <sys/time.h>
+#include <net/if.h>
+
+#include "ptp_primitives.h"
+
+/* longer messages are cut short */
+#define LOGRING_MESSAGE_MAX	1024
+#define LOGRING_MIN_CAPACITY	16
+#define LOGRING_MAX_CAPACITY	65536
+
+/* a log message as captured by logMessage(), waiting to be written out */
+typedef struct {
+	struct timeval time;
+	int priority;
+	Boolean startup;
+	const char *state;	/* port state tag, a string constant */
+	char iface[IF_NAMESIZE];
+	char text[LOGRING_MESSAGE_MAX];
+} LogRecord;
+
+/*
+ * start the writer thread: output() is called from it for every record,
+ * in order. Capacity is rounded up to a power of 2. With timeshare set,
+ * the thread runs in the normal time-sharing scheduling class even if the
+ * caller runs at real-time priority. FALSE if the thread could not be
+ * started - the caller keeps writing messages itself.
+ */
+Boolean logRingStart(int capacity, void (*output) (const LogRecord *record), Boolean timeshare);
+/* write out everything queued, then stop the writer thread */
+void logRingStop(void);
+Boolean logRingRunning(void);
+
+/*
+ * producer side, any thread: claim a free record, fill it in and commit it.
+ * NULL when the queue is full - the message is dropped and counted.
+ */
+LogRecord *logRingClaim(void);
+void logRingCommit(LogRecord *record);
+
+#endif /* LOGRING_H_ */
@@ -1711,11 +1711,25 @@ msgPackHeader(Octet * buf, PtpClock * ptpClock)
 }
 
 
-#ifndef PTPD_SLAVE_ONLY
-/*Pack SYNC message into OUT buffer of ptpClock*/
+/*
+ * Message templates: the parts of Sync, FollowUp, DelayResp and Announce that do not
+ * change between transmissions are packed once, and every message is a copy of its
+ * template with sequenceId, timestamps and the other per-message fields patched in.
+ * Anything that changes a template's inputs must call msgInvalidateTemplates().
+ */
 void
-msgPackSync(Octet * buf, UInteger16 sequenceId, Timestamp * originTimestamp, PtpClock * ptpClock)
+msgInvalidateTemplates(PtpClock * ptpClock, UInteger8 which)
 {
+	ptpClock->msgTemplates.valid &= ~which;
+}
+
+#ifndef PTPD_SLAVE_ONLY
+/*Pack the constant part of a SYNC message into a template*/
+static void
+msgPackSyncTemplate(Octet * buf, PtpClock * ptpClock)
+{
+	memset(buf, 0, SYNC_LENGTH);
+
 	msgPackHeader(buf, ptpClock);
 
 	/* changes in header */
@@ -1727,13 +1741,28 @@ msgPackSync(Octet * buf, UInteger16 sequenceId, Timestamp * originTimestamp, Ptp
 		*(UInteger8 *) (buf + 6) |= PTP_TWO_STEP;
 	/* Table 19 */
 	*(UInteger16 *) (buf + 2) = flip16(SYNC_LENGTH);
-	*(UInteger16 *) (buf + 30) = flip16(sequenceId);
 	*(UInteger8 *) (buf + 32) = 0x00;
 
 	 /* Table 24 - unless it's multicast, logMessageInterval remains    0x7F */
 	 if(rtOpts.transport == IEEE_802_3 || rtOpts.ipMode != IPMODE_UNICAST )
 		*(Integer8 *) (buf + 33) = ptpClock->portDS.logSyncInterval;
 	memset((buf + 8), 0, 8);
+}
+
+/*Pack SYNC message into OUT buffer of ptpClock*/
+void
+msgPackSync(Octet * buf, UInteger16 sequenceId, Timestamp * originTimestamp, PtpClock * ptpClock)
+{
+	MsgTemplates *templates = &ptpClock->msgTemplates;
+
+	if(!(templates->valid & MSG_TEMPLATE_SYNC)) {
+		msgPackSyncTemplate(templates->sync, ptpClock);
+		templates->valid |= MSG_TEMPLATE_SYNC;
+	}
+
+	memcpy(buf, templates->sync, SYNC_LENGTH);
+
+	*(UInteger16 *) (buf + 30) = flip16(sequenceId);
 
 	/* Sync message */
 	*(UInteger16 *) (buf + 34) = flip16(originTimestamp->secondsField.msb);
@@ -1761,12 +1790,14 @@ msgUnpackSync(Octet * buf, MsgSync * sync)
 
 /* When building slave only, this code does not get compiled */
 #ifndef PTPD_SLAVE_ONLY
-/*Pack Announce message into OUT buffer of ptpClock*/
-void
-msgPackAnnounce(Octet * buf, UInteger16 sequenceId, Timestamp * originTimestamp, PtpClock * ptpClock)
+/*Pack the constant part of an Announce message into a template*/
+static void
+msgPackAnnounceTemplate(Octet * buf, PtpClock * ptpClock)
 {
 	UInteger16 stepsRemoved;
 
+	memset(buf, 0, ANNOUNCE_LENGTH);
+
 	msgPackHeader(buf, ptpClock);
 
 	/* changes in header */
@@ -1775,16 +1806,11 @@ msgPackAnnounce(Octet * buf, UInteger16 sequenceId, Timestamp * originTimestamp,
 	*(char *)(buf + 0) = *(char *)(buf + 0) | 0x0B;
 	/* Table 19 */
 	*(UInteger16 *) (buf + 2) = flip16(ANNOUNCE_LENGTH);
-	*(UInteger16 *) (buf + 30) = flip16(sequenceId);
 	*(UInteger8 *) (buf + 32) = 0x05;
 	/* Table 24: for Announce, logMessageInterval is never 0x7F */
 	*(Integer8 *) (buf + 33) = ptpClock->portDS.logAnnounceInterval;
 
 	/* Announce message */
-	*(UInteger16 *) (buf + 34) = flip16(originTimestamp->secondsField.msb);
-	*(UInteger32 *) (buf + 36) = flip32(originTimestamp->secondsField.lsb);
-	*(UInteger32 *) (buf + 40) = flip32(originTimestamp->nanosecondsField);
-
 	*(Integer16 *) (buf + 44) = flip16(ptpClock->timePropertiesDS.currentUtcOffset);
 	*(UInteger8 *) (buf + 47) = ptpClock->parentDS.grandmasterPriority1;
 	*(UInteger8 *) (buf + 48) = ptpClock->defaultDS.clockQuality.clockClass;
@@ -1809,6 +1835,26 @@ msgPackAnnounce(Octet * buf, UInteger16 sequenceId, Timestamp * originTimestamp,
 	*(UInteger8*) (buf + 7) |= (ptpClock->timePropertiesDS.timeTraceable)		<< 4;
 	*(UInteger8*) (buf + 7) |= (ptpClock->timePropertiesDS.frequencyTraceable)	<< 5;
 }
+
+/*Pack Announce message into OUT buffer of ptpClock*/
+void
+msgPackAnnounce(Octet * buf, UInteger16 sequenceId, Timestamp * originTimestamp, PtpClock * ptpClock)
+{
+	MsgTemplates *templates = &ptpClock->msgTemplates;
+
+	if(!(templates->valid & MSG_TEMPLATE_ANNOUNCE)) {
+		msgPackAnnounceTemplate(templates->announce, ptpClock);
+		templates->valid |= MSG_TEMPLATE_ANNOUNCE;
+	}
+
+	memcpy(buf, templates->announce, ANNOUNCE_LENGTH);
+
+	*(UInteger16 *) (buf + 30) = flip16(sequenceId);
+
+	*(UInteger16 *) (buf + 34) = flip16(originTimestamp->secondsField.msb);
+	*(UInteger32 *) (buf + 36) = flip32(originTimestamp->secondsField.lsb);
+	*(UInteger32 *) (buf + 40) = flip32(originTimestamp->nanosecondsField);
+}
 #endif /* PTPD_SLAVE_ONLY */
 
 /*Unpack Announce message from IN buffer of ptpClock to msgtmp.Announce*/
@@ -1844,10 +1890,12 @@ msgUnpackAnnounce(Octet * buf, MsgAnnounce * announce)
 }
 
 #ifndef PTPD_SLAVE_ONLY /* does not get compiled when building slave only */
-/*pack Follow_up message into OUT buffer of ptpClock*/
-void
-msgPackFollowUp(Octet * buf, Timestamp * preciseOriginTimestamp, PtpClock * ptpClock, const UInteger16 sequenceId)
+/*pack the constant part of a Follow_up message into a template*/
+static void
+msgPackFollowUpTemplate(Octet * buf, PtpClock * ptpClock)
 {
+	memset(buf, 0, FOLLOW_UP_LENGTH);
+
 	msgPackHeader(buf, ptpClock);
 
 	/* changes in header */
@@ -1856,12 +1904,27 @@ msgPackFollowUp(Octet * buf, Timestamp * preciseOriginTimestamp, PtpClock * ptpC
 	*(char *)(buf + 0) = *(char *)(buf + 0) | 0x08;
 	/* Table 19 */
 	*(UInteger16 *) (buf + 2) = flip16(FOLLOW_UP_LENGTH);
-	*(UInteger16 *) (buf + 30) = flip16(sequenceId);
 	*(UInteger8 *) (buf + 32) = 0x02;
 
 	 /* Table 24 - unless it's multicast, logMessageInterval remains    0x7F */
 	 if(rtOpts.transport == IEEE_802_3 || rtOpts.ipMode != IPMODE_UNICAST)
 		*(Integer8 *) (buf + 33) = ptpClock->portDS.logSyncInterval;
+}
+
+/*pack Follow_up message into OUT buffer of ptpClock*/
+void
+msgPackFollowUp(Octet * buf, Timestamp * preciseOriginTimestamp, PtpClock * ptpClock, const UInteger16 sequenceId)
+{
+	MsgTemplates *templates = &ptpClock->msgTemplates;
+
+	if(!(templates->valid & MSG_TEMPLATE_FOLLOWUP)) {
+		msgPackFollowUpTemplate(templates->followUp, ptpClock);
+		templates->valid |= MSG_TEMPLATE_FOLLOWUP;
+	}
+
+	memcpy(buf, templates->followUp, FOLLOW_UP_LENGTH);
+
+	*(UInteger16 *) (buf + 30) = flip16(sequenceId);
 
 	/* Follow_up message */
 	*(UInteger16 *) (buf + 34) =
@@ -1946,10 +2009,12 @@ msgPackDelayReq(Octet * buf, Timestamp * originTimestamp, PtpClock * ptpClock)
 	*(UInteger32 *) (buf + 40) = flip32(originTimestamp->nanosecondsField);
 }
 
-/*pack delayResp message into OUT buffer of ptpClock*/
-void
-msgPackDelayResp(Octet * buf, MsgHeader * header, Timestamp * receiveTimestamp, PtpClock * ptpClock)
+/*pack the constant part of a delayResp message into a template*/
+static void
+msgPackDelayRespTemplate(Octet * buf, PtpClock * ptpClock)
 {
+	memset(buf, 0, DELAY_RESP_LENGTH);
+
 	msgPackHeader(buf, ptpClock);
 
 	/* changes in header */
@@ -1958,11 +2023,26 @@ msgPackDelayResp(Octet * buf, MsgHeader * header, Timestamp * receiveTimestamp,
 	*(char *)(buf + 0) = *(char *)(buf + 0) | 0x09;
 	/* Table 19 */
 	*(UInteger16 *) (buf + 2) = flip16(DELAY_RESP_LENGTH);
-	*(UInteger8 *) (buf + 4) = header->domainNumber;
 
 	/* -- PTP_UNICAST flag will be set in netsend* if needed */
 
-	memset((buf + 8), 0, 8);
+	*(UInteger8 *) (buf + 32) = 0x03;
+}
+
+/*pack delayResp message into OUT buffer of ptpClock*/
+void
+msgPackDelayResp(Octet * buf, MsgHeader * header, Timestamp * receiveTimestamp, PtpClock * ptpClock)
+{
+	MsgTemplates *templates = &ptpClock->msgTemplates;
+
+	if(!(templates->valid & MSG_TEMPLATE_DELAYRESP)) {
+		msgPackDelayRespTemplate(templates->delayResp, ptpClock);
+		templates->valid |= MSG_TEMPLATE_DELAYRESP;
+	}
+
+	memcpy(buf, templates->delayResp, DELAY_RESP_LENGTH);
+
+	*(UInteger8 *) (buf + 4) = header->domainNumber;
 
 	/* Copy correctionField of PdelayReqMessage */
 	*(Integer32 *) (buf + 8) = flip32(header->correctionField.msb);
@@ -1970,8 +2050,6 @@ msgPackDelayResp(Octet * buf, MsgHeader * header, Timestamp * receiveTimestamp,
 
 	*(UInteger16 *) (buf + 30) = flip16(header->sequenceId);
 
-	*(UInteger8 *) (buf + 32) = 0x03;
-
 	 /* Table 24 - unless it's multicast, logMessageInterval remains    0x7F */
 	 /* really tempting to cheat here, at least for hybrid, but standard is a standard */
 	if ((header->flagField0 & PTP_UNICAST) != PTP_UNICAST) {
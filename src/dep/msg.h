@@ -23,6 +23,7 @@ void msgPackManagementErrorStatusTLV(Octet *,MsgManagement*,PtpClock*);
 void msgPackSignalingTLV(Octet *,MsgSignaling*, PtpClock*);
 
 void msgPackHeader(Octet * buf,PtpClock*);
+void msgInvalidateTemplates(PtpClock*, UInteger8);
 #ifndef PTPD_SLAVE_ONLY
 void msgPackSync(Octet * buf, UInteger16, Timestamp*, PtpClock*);
 void msgPackAnnounce(Octet * buf, UInteger16, Timestamp*, PtpClock*);
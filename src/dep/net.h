@@ -52,11 +52,25 @@ static inline uint8_t* ether_addr_octet(struct ether_addr* addr) {
 
 typedef struct NetPath NetPath;
 
+/**
+ * \brief Transmit timestamp of a queued event message, with the
+ * destination and sequence number it was sent with
+ */
+typedef struct {
+	TimeInternal timestamp;
+	Integer32 destination;
+	UInteger16 sequenceId;
+	Enumeration4 messageType;
+	/* PdelayResp only: the port whose PdelayReq it answers */
+	PortIdentity requestingPortIdentity;
+} NetTxTimestamp;
+
 Boolean netShutdown(NetPath*);
 Boolean testInterface(const char* ifaceName, const RunTimeOpts* rtOpts);
 Boolean hostLookup(const char* hostname, Integer32* addr);
 Boolean netInit(NetPath*,const RunTimeOpts*,PtpClock*);
 void netInitializeACLs(NetPath*, const RunTimeOpts*);
+void netUpdateFilter(NetPath*, const RunTimeOpts*, const PtpClock*);
 int netSelect(TimeInternal*,NetPath*,fd_set*);
 ssize_t netRecvEvent(Octet*,TimeInternal*,NetPath*,int,Boolean*);
 ssize_t netRecvGeneral(Octet*,NetPath*,Boolean*);
@@ -64,6 +78,12 @@ ssize_t netSendEvent(Octet*,UInteger16,NetPath*,const RunTimeOpts*,Integer32,Tim
 ssize_t netSendGeneral(Octet*,UInteger16,NetPath*,const RunTimeOpts*,Integer32 );
 ssize_t netSendPeerGeneral(Octet*,UInteger16,NetPath*,const RunTimeOpts*, Integer32);
 ssize_t netSendPeerEvent(Octet*,UInteger16,NetPath*,const RunTimeOpts*,Integer32,TimeInternal*);
+void netQueueEvent(Octet*,UInteger16,NetPath*,Integer32);
+void netQueueGeneral(Octet*,UInteger16,NetPath*,Integer32);
+int netFlushEvent(NetPath*,int*);
+int netFlushGeneral(NetPath*,int*);
+void netProcessTxTimestamps(NetPath*);
+Boolean netGetTxTimestamp(NetPath*,NetTxTimestamp*);
 Boolean netRefreshIGMP(NetPath *, const RunTimeOpts *, PtpClock *);
 
 struct ether_addr netPathGetMacAddress(const NetPath*);
@@ -86,9 +106,13 @@ uint64_t netPathGetTotalSentPacketCount(const NetPath*);
 uint64_t netPathGetTotalReceivedPacketsCount(const NetPath*);
 
 void netPathClearSockets(NetPath*);
+void netPathSetWakeupFd(NetPath*, int);
 
 Boolean netPathEventSocketIsSet(const NetPath*, fd_set*);
 Boolean netPathGeneralSocketIsSet(const NetPath*, fd_set*);
+Boolean netPathEventPending(const NetPath*);
+Boolean netPathGeneralPending(const NetPath*);
+Boolean netPathTxTimestampsPending(const NetPath*);
 
 void netPathFree(NetPath**);
 NetPath* netPathCreate(const RunTimeOpts*);
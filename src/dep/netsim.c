@@ -0,0 +1,544 @@
+/*-
+ * Copyright (c) 2015 Wojciech Owczarek,
+ *
+ * All Rights Reserved
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHORS ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE AUTHORS OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+ * OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
+ * IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+/**
+ * @file   netsim.c
+ * @date   Sun Oct 18 19:20:44 2026
+ *
+ * @brief  Simulated network and virtual timebase for the network simulator
+ *
+ * Every node of the simulation has an inbox for each of the two PTP
+ * ports. A packet sent is copied to every receiver (multicast) or to the
+ * addressed node (unicast) and put in flight with an arrival time of
+ * now + fixed delay +/- half the asymmetry + a random jitter sample +
+ * the queueing delay of a burst in progress - but never before a packet
+ * sent to the same node earlier, the way a switch port queues them.
+ * Packets in flight are kept in a heap ordered by arrival time, and
+ * reach the inboxes when virtual time is advanced past it. Virtual time only moves when the simulator
+ * says so, so nothing here ever blocks or looks at the system clock.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <arpa/inet.h>
+
+#include "ptp_primitives.h"
+#include "ptpd_logging.h"
+#include "dep/netsim.h"
+
+typedef struct {
+	Boolean attached;	/* netInit() done - otherwise nothing is received */
+	Boolean downstream;
+	NetSimPacket *inbox[2];	/* general, event */
+	NetSimPacket *inboxTail[2];
+	int64_t lastArrival;	/* the port towards the node is a FIFO */
+	Boolean ready;		/* on the ready list */
+} NetSimNode;
+
+typedef struct {
+	NetSimConfig config;
+	NetSimNode *nodes;
+	int nodeCount;
+	int64_t start;
+	int64_t now;
+	uint64_t order;
+	uint64_t rng;
+	/* packets in flight, a binary heap on arrival time */
+	NetSimPacket **flight;
+	int flightCount;
+	int flightSize;
+	NetSimPacket *spare;
+	/* nodes that received something since they were last handed out */
+	int *ready;
+	int readyHead;
+	int readyCount;
+	NetSimCounters counters;
+} NetSim;
+
+static NetSim netSim;
+
+/* xorshift64*, the same generator the simulated clock uses */
+static uint64_t
+nextRandom(void)
+{
+	netSim.rng ^= netSim.rng >> 12;
+	netSim.rng ^= netSim.rng << 25;
+	netSim.rng ^= netSim.rng >> 27;
+	return netSim.rng * 0x2545F4914F6CDD1DULL;
+}
+
+/* uniform in (0, 1] */
+static double
+nextUniform(void)
+{
+	return ((nextRandom() >> 11) + 1) * (1.0 / 9007199254740992.0);
+}
+
+static double
+jitterSample(void)
+{
+	double scale = netSim.config.jitter;
+
+	if(scale <= 0) {
+		return 0;
+	}
+
+	switch(netSim.config.jitterDistribution) {
+	case NETSIM_JITTER_NORMAL:
+		/* half-normal: a packet can not arrive before it was sent */
+		return scale * fabs(sqrt(-2.0 * log(nextUniform())) * cos(2.0 * M_PI * nextUniform()));
+	case NETSIM_JITTER_EXPONENTIAL:
+		return -scale * log(nextUniform());
+	case NETSIM_JITTER_UNIFORM:
+	default:
+		return scale * nextUniform();
+	}
+}
+
+/* a queue builds up for the first half of a burst and drains in the second */
+static double
+burstDelay(void)
+{
+	const NetSimConfig *config = &netSim.config;
+	double phase;
+
+	if(config->burstInterval <= 0 || config->burstLength <= 0 || config->burstDelay <= 0) {
+		return 0;
+	}
+
+	phase = fmod((netSim.now - netSim.start) / 1E9, config->burstInterval);
+
+	if(phase >= config->burstLength) {
+		return 0;
+	}
+
+	return config->burstDelay * (1.0 - fabs(2.0 * phase / config->burstLength - 1.0));
+}
+
+static int64_t
+linkDelay(int from)
+{
+	double delay = netSim.config.delay;
+
+	delay += (netSim.nodes[from].downstream ? 0.5 : -0.5) * netSim.config.asymmetry;
+	delay += jitterSample();
+	delay += burstDelay();
+
+	if(delay < 0) {
+		delay = 0;
+	}
+
+	return (int64_t)(delay * 1E9);
+}
+
+static Boolean
+arrivesBefore(const NetSimPacket *a, const NetSimPacket *b)
+{
+	return a->arrival < b->arrival || (a->arrival == b->arrival && a->order < b->order);
+}
+
+static Boolean
+flightPush(NetSimPacket *packet)
+{
+	NetSimPacket **grown;
+	NetSimPacket *tmp;
+	int i;
+
+	if(netSim.flightCount == netSim.flightSize) {
+		if(!(grown = realloc(netSim.flight, 2 * netSim.flightSize * sizeof(NetSimPacket*)))) {
+			return FALSE;
+		}
+		netSim.flight = grown;
+		netSim.flightSize *= 2;
+	}
+
+	i = netSim.flightCount++;
+	netSim.flight[i] = packet;
+
+	while(i > 0 && arrivesBefore(netSim.flight[i], netSim.flight[(i - 1) / 2])) {
+		tmp = netSim.flight[i];
+		netSim.flight[i] = netSim.flight[(i - 1) / 2];
+		netSim.flight[(i - 1) / 2] = tmp;
+		i = (i - 1) / 2;
+	}
+
+	return TRUE;
+}
+
+static NetSimPacket*
+flightPop(void)
+{
+	NetSimPacket *ret, *tmp;
+	int i = 0, child;
+
+	if(netSim.flightCount == 0) {
+		return NULL;
+	}
+
+	ret = netSim.flight[0];
+	netSim.flight[0] = netSim.flight[--netSim.flightCount];
+
+	for(;;) {
+		child = 2 * i + 1;
+		if(child >= netSim.flightCount) {
+			break;
+		}
+		if(child + 1 < netSim.flightCount &&
+		    arrivesBefore(netSim.flight[child + 1], netSim.flight[child])) {
+			child++;
+		}
+		if(!arrivesBefore(netSim.flight[child], netSim.flight[i])) {
+			break;
+		}
+		tmp = netSim.flight[i];
+		netSim.flight[i] = netSim.flight[child];
+		netSim.flight[child] = tmp;
+		i = child;
+	}
+
+	return ret;
+}
+
+static NetSimPacket*
+allocPacket(void)
+{
+	NetSimPacket *packet = netSim.spare;
+
+	if(packet != NULL) {
+		netSim.spare = packet->next;
+	} else if(!(packet = malloc(sizeof(NetSimPacket)))) {
+		return NULL;
+	}
+
+	packet->next = NULL;
+	return packet;
+}
+
+void
+netSimRelease(NetSimPacket *packet)
+{
+	if(packet == NULL) {
+		return;
+	}
+
+	packet->next = netSim.spare;
+	netSim.spare = packet;
+}
+
+static void
+dropInbox(NetSimNode *node, int port)
+{
+	NetSimPacket *packet;
+
+	while((packet = node->inbox[port]) != NULL) {
+		node->inbox[port] = packet->next;
+		netSimRelease(packet);
+	}
+
+	node->inboxTail[port] = NULL;
+}
+
+static void
+transmit(int from, int to, const Octet *buf, UInteger16 length, Integer32 destination, Boolean event)
+{
+	NetSimPacket *packet;
+
+	netSim.counters.sent++;
+
+	if(netSim.config.loss > 0 && nextUniform() <= netSim.config.loss) {
+		netSim.counters.lost++;
+		return;
+	}
+
+	if(!(packet = allocPacket())) {
+		netSim.counters.lost++;
+		return;
+	}
+
+	/* jitter does not reorder: a packet never overtakes one sent earlier to the same node */
+	packet->arrival = netSim.now + linkDelay(from);
+	if(packet->arrival < netSim.nodes[to].lastArrival) {
+		packet->arrival = netSim.nodes[to].lastArrival;
+	}
+	netSim.nodes[to].lastArrival = packet->arrival;
+	packet->order = netSim.order++;
+	packet->node = to;
+	packet->source = netSimNodeAddress(from);
+	packet->destination = destination;
+	packet->event = event;
+	packet->length = length;
+	memcpy(packet->data, buf, length);
+
+	if(!flightPush(packet)) {
+		netSimRelease(packet);
+		netSim.counters.lost++;
+	}
+}
+
+Boolean
+netSimInit(const NetSimConfig *config, int nodeCount, int64_t start)
+{
+	netSimShutdown();
+
+	if(nodeCount < 1) {
+		return FALSE;
+	}
+
+	if(!(netSim.nodes = calloc(nodeCount, sizeof(NetSimNode))) ||
+	    !(netSim.ready = malloc(nodeCount * sizeof(int))) ||
+	    !(netSim.flight = malloc(nodeCount * 4 * sizeof(NetSimPacket*)))) {
+		netSimShutdown();
+		return FALSE;
+	}
+
+	netSim.config = *config;
+	netSim.nodeCount = nodeCount;
+	netSim.flightSize = nodeCount * 4;
+	netSim.start = netSim.now = start;
+	/* xorshift must not start from zero */
+	netSim.rng = ((uint64_t)config->seed << 32 | config->seed) ^ 0xD1B54A32D192ED03ULL;
+
+	return TRUE;
+}
+
+void
+netSimShutdown(void)
+{
+	NetSimPacket *packet;
+	int i;
+
+	for(i = 0; i < netSim.nodeCount; i++) {
+		dropInbox(&netSim.nodes[i], 0);
+		dropInbox(&netSim.nodes[i], 1);
+	}
+
+	while((packet = flightPop()) != NULL) {
+		netSimRelease(packet);
+	}
+
+	while((packet = netSim.spare) != NULL) {
+		netSim.spare = packet->next;
+		free(packet);
+	}
+
+	free(netSim.nodes);
+	free(netSim.ready);
+	free(netSim.flight);
+	memset(&netSim, 0, sizeof(NetSim));
+}
+
+int64_t
+netSimNow(void)
+{
+	return netSim.now;
+}
+
+void
+netSimAdvance(int64_t to)
+{
+	NetSimPacket *packet;
+	NetSimNode *node;
+	int port;
+
+	while(netSim.flightCount > 0 && netSim.flight[0]->arrival <= to) {
+		packet = flightPop();
+		node = &netSim.nodes[packet->node];
+
+		if(!node->attached) {
+			netSim.counters.unreachable++;
+			netSimRelease(packet);
+			continue;
+		}
+
+		port = packet->event ? 1 : 0;
+		if(node->inboxTail[port] != NULL) {
+			node->inboxTail[port]->next = packet;
+		} else {
+			node->inbox[port] = packet;
+		}
+		node->inboxTail[port] = packet;
+		netSim.counters.delivered++;
+
+		if(!node->ready) {
+			node->ready = TRUE;
+			netSim.ready[netSim.readyCount++] = packet->node;
+		}
+	}
+
+	if(to > netSim.now) {
+		netSim.now = to;
+	}
+}
+
+int
+netSimNextReady(void)
+{
+	int node;
+
+	if(netSim.readyHead >= netSim.readyCount) {
+		netSim.readyHead = netSim.readyCount = 0;
+		return -1;
+	}
+
+	node = netSim.ready[netSim.readyHead++];
+	netSim.nodes[node].ready = FALSE;
+	return node;
+}
+
+int64_t
+netSimNextDelivery(void)
+{
+	return (netSim.flightCount > 0) ? netSim.flight[0]->arrival : INT64_MAX;
+}
+
+const NetSimCounters*
+netSimGetCounters(void)
+{
+	return &netSim.counters;
+}
+
+void
+netSimSetDownstream(int node, Boolean downstream)
+{
+	if(node >= 0 && node < netSim.nodeCount) {
+		netSim.nodes[node].downstream = downstream;
+	}
+}
+
+int
+netSimNodeFromName(const char *ifaceName)
+{
+	char *end;
+	long node;
+
+	if(strncmp(ifaceName, NETSIM_IFACE_PREFIX, strlen(NETSIM_IFACE_PREFIX))) {
+		return -1;
+	}
+
+	ifaceName += strlen(NETSIM_IFACE_PREFIX);
+	node = strtol(ifaceName, &end, 10);
+
+	if(end == ifaceName || *end != '\0' || node < 0 || node >= netSim.nodeCount) {
+		return -1;
+	}
+
+	return node;
+}
+
+Integer32
+netSimNodeAddress(int node)
+{
+	return htonl(NETSIM_ADDRESS_BASE + node);
+}
+
+static int
+nodeFromAddress(Integer32 address)
+{
+	int64_t node = (int64_t)ntohl(address) - NETSIM_ADDRESS_BASE;
+
+	return (node >= 0 && node < netSim.nodeCount) ? node : -1;
+}
+
+void
+netSimAttach(int node, Boolean attached)
+{
+	if(node < 0 || node >= netSim.nodeCount) {
+		return;
+	}
+
+	netSim.nodes[node].attached = attached;
+
+	if(!attached) {
+		dropInbox(&netSim.nodes[node], 0);
+		dropInbox(&netSim.nodes[node], 1);
+	}
+}
+
+Boolean
+netSimSend(int node, const Octet *buf, UInteger16 length, Integer32 destination, Boolean event)
+{
+	int i;
+
+	if(node < 0 || node >= netSim.nodeCount || length > PACKET_SIZE) {
+		return FALSE;
+	}
+
+	if(destination) {
+		i = nodeFromAddress(destination);
+		if(i < 0 || i == node) {
+			netSim.counters.unreachable++;
+		} else {
+			transmit(node, i, buf, length, destination, event);
+		}
+		return TRUE;
+	}
+
+	/* multicast: everyone else gets a copy */
+	for(i = 0; i < netSim.nodeCount; i++) {
+		if(i != node) {
+			transmit(node, i, buf, length, 0, event);
+		}
+	}
+
+	return TRUE;
+}
+
+NetSimPacket*
+netSimReceive(int node, Boolean event)
+{
+	NetSimNode *n;
+	NetSimPacket *packet;
+	int port = event ? 1 : 0;
+
+	if(node < 0 || node >= netSim.nodeCount) {
+		return NULL;
+	}
+
+	n = &netSim.nodes[node];
+
+	if((packet = n->inbox[port]) != NULL) {
+		n->inbox[port] = packet->next;
+		if(n->inbox[port] == NULL) {
+			n->inboxTail[port] = NULL;
+		}
+		packet->next = NULL;
+	}
+
+	return packet;
+}
+
+Boolean
+netSimPending(int node, Boolean event)
+{
+	if(node < 0 || node >= netSim.nodeCount) {
+		return FALSE;
+	}
+
+	return netSim.nodes[node].inbox[event ? 1 : 0] != NULL;
+}
@@ -0,0 +1,114 @@
+/*-
+ * Copyright (c) 2015 Wojciech Owczarek,
+ *
+ * All Rights Reserved
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHORS ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE AUTHORS OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+ * OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
+ * IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+#ifndef NETSIM_H_
+#define NETSIM_H_
+
+/**
+ * @file   netsim.h
+ * @date   Sun Oct 18 19:20:44 2026
+ *
+ * @brief  Simulated network and virtual timebase for the network simulator
+ *
+ */
+
+#include <stdint.h>
+
+#include "ptp_primitives.h"
+#include "dep/constants_dep.h"
+
+/* simulated interfaces are called sim0, sim1... node n has address 10.0.0.(n+1) */
+#define NETSIM_IFACE_PREFIX	"sim"
+#define NETSIM_ADDRESS_BASE	0x0A000001
+
+enum {
+	NETSIM_JITTER_UNIFORM = 0,
+	NETSIM_JITTER_NORMAL,
+	NETSIM_JITTER_EXPONENTIAL
+};
+
+typedef struct {
+	double delay;		/* s, fixed one-way delay */
+	double jitter;		/* s, scale of the random part of the delay */
+	int jitterDistribution;
+	double asymmetry;	/* s, downstream minus upstream delay */
+	double loss;		/* probability of losing a packet, 0..1 */
+	double burstInterval;	/* s between queueing bursts, 0 = no bursts */
+	double burstLength;	/* s */
+	double burstDelay;	/* s, peak queueing delay during a burst */
+	uint32_t seed;
+} NetSimConfig;
+
+typedef struct NetSimPacket NetSimPacket;
+
+struct NetSimPacket {
+	int64_t arrival;	/* virtual time, ns */
+	uint64_t order;		/* keeps packets arriving together in send order */
+	int node;		/* receiving node */
+	Integer32 source;
+	Integer32 destination;	/* 0 for multicast */
+	Boolean event;
+	UInteger16 length;
+	Octet data[PACKET_SIZE];
+	NetSimPacket *next;
+};
+
+typedef struct {
+	uint64_t sent;		/* copies put on the wire, one per receiver */
+	uint64_t delivered;
+	uint64_t lost;		/* random loss */
+	uint64_t unreachable;	/* no such node, or node not listening */
+} NetSimCounters;
+
+Boolean netSimInit(const NetSimConfig *config, int nodeCount, int64_t start);
+void netSimShutdown(void);
+
+/* virtual time, ns - also the reference the simulated clocks run against */
+int64_t netSimNow(void);
+/* move virtual time forward, delivering everything due by then */
+void netSimAdvance(int64_t to);
+/* next node that received something during netSimAdvance(), -1 when there are no more */
+int netSimNextReady(void);
+/* arrival time of the next packet in flight, INT64_MAX if none */
+int64_t netSimNextDelivery(void);
+const NetSimCounters *netSimGetCounters(void);
+
+/* masters are downstream: their packets get the positive half of the asymmetry */
+void netSimSetDownstream(int node, Boolean downstream);
+/* node number of a simulated interface name, -1 if it is not one */
+int netSimNodeFromName(const char *ifaceName);
+Integer32 netSimNodeAddress(int node);
+
+/* used by the simulated NetPath */
+void netSimAttach(int node, Boolean attached);
+Boolean netSimSend(int node, const Octet *buf, UInteger16 length, Integer32 destination, Boolean event);
+NetSimPacket *netSimReceive(int node, Boolean event);
+void netSimRelease(NetSimPacket *packet);
+Boolean netSimPending(int node, Boolean event);
+
+#endif /* NETSIM_H_ */
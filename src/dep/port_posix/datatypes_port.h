@@ -21,6 +21,7 @@ typedef struct LogFileConfig {
 	Boolean unlinkOnClose;
 	int maxFiles;
 	UInteger32 maxSize;
+	Boolean binary;	/* block buffered, flushed by the writer - no lines to flush on */
 } LogFileConfig;
 
 #define PTPD_HAS_SYSOPTS
@@ -29,6 +30,9 @@ typedef struct sysopts_s {
 	/* Receive and send packets using libpcap, bypassing
 	   the network stack. */
 	Boolean pcap;
+	/* Ethernet transport over AF_PACKET sockets with memory
+	   mapped rings instead of libpcap */
+	Boolean packetMmap;
 	Boolean ignore_daemon_lock;
 
 	// NET
@@ -49,6 +53,8 @@ typedef struct sysopts_s {
 
 	/* disable UDP checksum validation where supported */
 	Boolean disableUdpChecksums;
+	/* drop irrelevant messages in the kernel with socket filters where supported */
+	Boolean kernelFilter;
 
 	/* list of unicast destinations for use with unicast
 	   with or without signaling */
@@ -68,16 +74,26 @@ typedef struct sysopts_s {
 #if (defined(linux) && defined(HAVE_SCHED_H)) || defined(HAVE_SYS_CPUSET_H) || defined (__QNXNTO__)
 	int cpuNumber;
 #endif /* linux && HAVE_SCHED_H || HAVE_SYS_CPUSET_H*/
+	Boolean rxThread;		/* receive on a separate thread, queueing packets for the protocol */
+	int rxThreadCpu;		/* CPU core to bind the receive thread to, -1: none */
+	int rxThreadQueue;		/* packets queued per socket */
+	Boolean realtime;		/* SCHED_FIFO, locked and pre-faulted memory */
+	int realtimePriority;		/* SCHED_FIFO priority in real-time mode */
+	Boolean realtimeLogThread;	/* real-time mode: write log messages from a time-sharing thread */
 
 	Boolean clearCounters;
 	Enumeration8 statisticsTimestamp;
+	Enumeration8 statisticsLogFormat;
 	Enumeration8 logLevel;
 	int statisticsLogInterval;
 	Boolean useSysLog;
+	Boolean logAsync;		/* write log messages from a separate thread */
+	int logAsyncBuffer;		/* log message queue size when logAsync is set */
 	LogFileConfig statisticsLogConfig;
 	LogFileConfig recordLogConfig;
 	LogFileConfig eventLogConfig;
 	LogFileConfig statusLogConfig;
+	LogFileConfig traceLogConfig;
 	Boolean  nonDaemon;
 	char lockFile[PATH_MAX+1]; /* lock file location */
 	char driftFile[PATH_MAX+1]; /* drift file location */
@@ -88,6 +104,7 @@ typedef struct sysopts_s {
 	Boolean autoLockFile; /* mode and interface specific lock files are used
 				    * when set to TRUE */
 	char leapFile[PATH_MAX+1]; /* leap seconds file location */
+	char statusShmName[PATH_MAX+1]; /* shared memory status segment, empty: none */
 
 } SysOpts;
 
@@ -59,6 +59,11 @@
 #  include <config.h>
 #endif /* HAVE_CONFIG_H */
 
+/* recvmmsg() */
+#if defined(linux) && !defined(_GNU_SOURCE)
+#  define _GNU_SOURCE
+#endif
+
 /* Disable SO_TIMESTAMPING if configured to do so */
 #ifdef PTPD_DISABLE_SOTIMESTAMPING
 #  ifdef SO_TIMESTAMPING
@@ -111,8 +116,11 @@
 #  define ETHER_HDR_LEN sizeof (struct ether_header)
 #endif /* ETHER_HDR_LEN */
 
-#ifdef PTPD_PCAP
+#if defined(PTPD_PCAP) || defined(PTPD_PACKET_MMAP)
 #  include <netinet/ether.h> // For ether_aton
+#endif
+
+#ifdef PTPD_PCAP
 #  define PCAP_TIMEOUT 1 /* expressed in milliseconds */
 #  if defined(HAVE_PCAP_PCAP_H)
 #    include <pcap/pcap.h>
@@ -131,6 +139,21 @@
 #include "datatypes.h"
 #include "ptpd_logging.h"
 #include "ptpd_utils.h"
+#include "dep/sys.h"
+#include "display.h"
+
+#ifdef PTPD_PACKET_MMAP
+#  include "packetmmap.h"
+#endif /* PTPD_PACKET_MMAP */
+
+#include "rxthread.h"
+
+#ifdef HAVE_LINUX_FILTER_H
+#  include <linux/filter.h>
+#  ifdef SO_ATTACH_FILTER
+#    define NET_SOCKET_FILTER
+#  endif /* SO_ATTACH_FILTER */
+#endif /* HAVE_LINUX_FILTER_H */
 
 /* choose kernel-level nanoseconds or microseconds resolution on the client-side */
 #if !defined(SO_TIMESTAMPING) && !defined(SO_TIMESTAMPNS) && !defined(SO_TIMESTAMP) && !defined(SO_BINTIME)
@@ -141,8 +164,15 @@
 #  include <linux/net_tstamp.h>
 #  include <linux/sockios.h>
 #  include <linux/ethtool.h>
+#  include <linux/errqueue.h>
 #endif /* SO_TIMESTAMPING */
 
+#ifdef PTPD_EPOLL
+#  include <sys/epoll.h>
+/* we only ever watch a handful of descriptors */
+#  define NET_EPOLL_MAX_EVENTS 8
+#endif /* PTPD_EPOLL */
+
 #if defined PTPD_SNMP
 #  include <net-snmp/net-snmp-config.h>
 #  include <net-snmp/net-snmp-includes.h>
@@ -160,6 +190,13 @@
 #define PACKET_BEGIN_UDP (ETHER_HDR_LEN + sizeof(struct ip) + sizeof(struct udphdr))
 #define PACKET_BEGIN_ETHER (ETHER_HDR_LEN)
 
+#ifdef PTPD_PACKET_MMAP
+/* Ethernet transport over packet rings rather than libpcap */
+#  define NET_USE_PACKET_RING(rtOpts) ((rtOpts)->transport == IEEE_802_3 && (rtOpts)->sysopts.packetMmap)
+#else
+#  define NET_USE_PACKET_RING(rtOpts) FALSE
+#endif /* PTPD_PACKET_MMAP */
+
 /**
  * \brief Struct containing interface information and capabilities
  */
@@ -173,6 +210,102 @@ typedef struct InterfaceInfo {
 	int ifIndex;
 } InterfaceInfo;
 
+#ifdef HAVE_RECVMMSG
+/* maximum number of datagrams drained from a socket with one recvmmsg() call */
+#  define NET_RECV_BATCH 32
+
+/**
+ * \brief Datagrams received in one go, handed out one at a time
+ */
+typedef struct {
+	struct mmsghdr hdr[NET_RECV_BATCH];
+	struct iovec vec[NET_RECV_BATCH];
+	struct sockaddr_in from[NET_RECV_BATCH];
+	Octet buf[NET_RECV_BATCH][PACKET_SIZE];
+	union {
+		struct cmsghdr cm;
+		char	control[256];
+	} cmsg[NET_RECV_BATCH];
+	/* number of datagrams received and the next one to hand out */
+	int count;
+	int next;
+} NetRecvBatch;
+#endif /* HAVE_RECVMMSG */
+
+/* maximum number of datagrams handed to the kernel with one sendmmsg() call */
+#define NET_SEND_BATCH 64
+
+/**
+ * \brief Unicast datagrams queued for transmission, sent in one go
+ */
+typedef struct {
+#ifdef HAVE_SENDMMSG
+	struct mmsghdr hdr[NET_SEND_BATCH];
+#endif /* HAVE_SENDMMSG */
+	struct iovec vec[NET_SEND_BATCH];
+	struct sockaddr_in to[NET_SEND_BATCH];
+	Octet buf[NET_SEND_BATCH][PACKET_SIZE];
+	/* copy sent to ourselves to get a timestamp from the loop */
+	Boolean looped[NET_SEND_BATCH];
+	int count;
+	/* messages sent and messages that could not be sent since the last flush */
+	int sent;
+	int failed;
+} NetSendBatch;
+
+#ifdef SO_TIMESTAMPING
+/* minimum number of transmit timestamps tracked at any one time - must be a power of 2 */
+#  define NET_TX_PENDING 256
+/* how long we wait for a transmit timestamp before giving up on SO_TIMESTAMPING */
+#  define NET_TX_TIMEOUT_US (10 * LATE_TXTIMESTAMP_US)
+
+enum {
+	NET_TX_FREE = 0,
+	NET_TX_WAITING,
+	NET_TX_DONE
+};
+
+/**
+ * \brief Event message sent with SO_TIMESTAMPING, waiting for its transmit timestamp
+ */
+typedef struct {
+	UInteger32 id;
+	Integer32 destination;
+	UInteger16 sequenceId;
+	UInteger16 length;
+	Enumeration4 messageType;
+	Enumeration4 state;
+	/* PdelayResp only: the port whose PdelayReq it answers */
+	PortIdentity requestingPortIdentity;
+	/* monotonic time the message was sent at, used to expire the entry */
+	TimeInternal sent;
+	TimeInternal timestamp;
+} NetTxEntry;
+
+/**
+ * \brief Transmit timestamps outstanding and completed, indexed by the
+ * per-socket datagram counter the kernel reports with SOF_TIMESTAMPING_OPT_ID
+ */
+typedef struct {
+	NetTxEntry *entry;
+	/* number of entries, a power of 2 - sized so a Sync burst to all unicast destinations fits */
+	UInteger32 size;
+	/* id the kernel will assign to the next datagram sent on the event socket */
+	UInteger32 nextId;
+	/* correction applied to the ids reported, should we ever lose step with the kernel */
+	UInteger32 idOffset;
+	/* oldest id that may still be waiting: entries are sent in id order, so it is the first to expire */
+	UInteger32 oldest;
+	/* completed entries, oldest first */
+	UInteger32 *done;
+	int doneHead;
+	int doneCount;
+	/* entries still waiting for their timestamp */
+	int waiting;
+	uint64_t unmatched;
+} NetTxTable;
+#endif /* SO_TIMESTAMPING */
+
 /**
  * \brief Struct describing network transport data
  */
@@ -204,8 +337,20 @@ typedef struct NetPath {
 	Integer32 pcapEventSock;
 	Integer32 pcapGeneralSock;
 #endif
+#ifdef PTPD_PACKET_MMAP
+	/* Ethernet transport over AF_PACKET rings, in place of the UDP sockets */
+	PacketRing packetRing;
+#endif /* PTPD_PACKET_MMAP */
 	Integer32 headerOffset;
 
+	/* extra descriptor netSelect() waits on, e.g. for timer expiry */
+	int wakeupFd;
+
+#ifdef PTPD_EPOLL
+	/* epoll instance watching the sockets in use, set up in netInit() */
+	int epollFd;
+#endif /* PTPD_EPOLL */
+
 	/* used for tracking the last TTL set */
 	int ttlGeneral;
 	int ttlEvent;
@@ -220,8 +365,87 @@ typedef struct NetPath {
 
 	Boolean runningBackupInterface;
 
+#ifdef HAVE_RECVMMSG
+	NetRecvBatch eventBatch;
+	NetRecvBatch generalBatch;
+#endif /* HAVE_RECVMMSG */
+#ifdef PTPD_RX_THREAD
+	/* the sockets are read by this thread when it is running, we read its queues */
+	RxThread rxThread;
+#endif /* PTPD_RX_THREAD */
+
+	NetSendBatch eventQueue;
+	NetSendBatch generalQueue;
+
+#ifdef SO_TIMESTAMPING
+	NetTxTable txTable;
+#endif /* SO_TIMESTAMPING */
+
 } NetPath;
 
+#ifdef SO_TIMESTAMPING
+/* forget all transmit timestamps due, keeping the table allocated */
+static void
+netTxTableReset(NetTxTable* table)
+{
+	if(table->entry != NULL) {
+		memset(table->entry, 0, table->size * sizeof(NetTxEntry));
+	}
+	if(table->done != NULL) {
+		memset(table->done, 0, table->size * sizeof(UInteger32));
+	}
+	table->nextId = 0;
+	table->idOffset = 0;
+	table->oldest = 0;
+	table->doneHead = 0;
+	table->doneCount = 0;
+	table->waiting = 0;
+	table->unmatched = 0;
+}
+
+static void
+netTxTableFree(NetTxTable* table)
+{
+	SAFE_FREE(table->entry);
+	SAFE_FREE(table->done);
+	table->size = 0;
+}
+
+/* size the table so a Sync burst to every unicast destination fits twice over */
+static Boolean
+netTxTableAlloc(NetTxTable* table, int destinations)
+{
+	UInteger32 size = NET_TX_PENDING;
+	NetTxEntry *entry;
+	UInteger32 *done;
+
+	while(size < 2 * destinations) {
+		size <<= 1;
+	}
+
+	if(size != table->size) {
+		entry = (NetTxEntry*)calloc(size, sizeof(NetTxEntry));
+		done = (UInteger32*)calloc(size, sizeof(UInteger32));
+		if(entry == NULL || done == NULL) {
+			PERROR("failed to allocate memory for %d transmit timestamps", size);
+			free(entry);
+			free(done);
+			return (table->entry != NULL);
+		}
+		netTxTableFree(table);
+		table->entry = entry;
+		table->done = done;
+		table->size = size;
+		DBG("allocated %d bytes for %d transmit timestamps\n",
+		    (int)(size * (sizeof(NetTxEntry) + sizeof(UInteger32))), size);
+	}
+
+	netTxTableReset(table);
+
+	return TRUE;
+}
+#endif /* SO_TIMESTAMPING */
+
 /**
  * shutdown the IPv4 multicast for specific address
  *
@@ -292,6 +516,10 @@ netShutdown(NetPath * netPath)
 {
 	netShutdownMulticast(netPath);
 
+#ifdef PTPD_RX_THREAD
+	rxThreadStop(&netPath->rxThread);
+#endif /* PTPD_RX_THREAD */
+
 	/* Close sockets */
 	if (netPath->eventSock >= 0)
 		close(netPath->eventSock);
@@ -301,6 +529,18 @@ netShutdown(NetPath * netPath)
 		close(netPath->generalSock);
 	netPath->generalSock = -1;
 
+#ifdef HAVE_RECVMMSG
+	/* anything not yet processed went with the sockets */
+	netPath->eventBatch.count = netPath->eventBatch.next = 0;
+	netPath->generalBatch.count = netPath->generalBatch.next = 0;
+#endif /* HAVE_RECVMMSG */
+	netPath->eventQueue.count = netPath->generalQueue.count = 0;
+	netPath->eventQueue.sent = netPath->generalQueue.sent = 0;
+	netPath->eventQueue.failed = netPath->generalQueue.failed = 0;
+#ifdef SO_TIMESTAMPING
+	netTxTableReset(&netPath->txTable);
+#endif /* SO_TIMESTAMPING */
+
 #ifdef PTPD_PCAP
 	if (netPath->pcapEvent != NULL) {
 		pcap_close(netPath->pcapEvent);
@@ -312,6 +552,16 @@ netShutdown(NetPath * netPath)
 	}
 #endif
 
+#ifdef PTPD_PACKET_MMAP
+	packetRingClose(&netPath->packetRing);
+#endif /* PTPD_PACKET_MMAP */
+
+#ifdef PTPD_EPOLL
+	if (netPath->epollFd >= 0)
+		close(netPath->epollFd);
+	netPath->epollFd = -1;
+#endif /* PTPD_EPOLL */
+
 	freeIpv4AccessList(&netPath->timingAcl);
 	freeIpv4AccessList(&netPath->managementAcl);
 
@@ -797,6 +1047,13 @@ netSetMulticastLoopback(NetPath * netPath, Boolean value) {
 #endif
 	DBG("Going to set multicast loopback with %d \n", temp);
 
+#ifdef PTPD_PACKET_MMAP
+	/* no multicast loop on packet sockets - the receive ring sees outgoing frames instead */
+	if (netPath->packetRing.sock >= 0) {
+		return packetRingSetLoopback(&netPath->packetRing, value);
+	}
+#endif /* PTPD_PACKET_MMAP */
+
 	if (setsockopt(netPath->eventSock, IPPROTO_IP, IP_MULTICAST_LOOP,
 	       &temp, sizeof(temp)) < 0) {
 		PERROR("Failed to set multicast loopback");
@@ -806,74 +1063,250 @@ netSetMulticastLoopback(NetPath * netPath, Boolean value) {
 	return TRUE;
 }
 
+/* the socket event messages are sent and timestamped on */
+static int
+netTimestampSocket(const NetPath * netPath)
+{
+#ifdef PTPD_PACKET_MMAP
+	if (netPath->packetRing.txSock >= 0)
+		return netPath->packetRing.txSock;
+#endif /* PTPD_PACKET_MMAP */
+	return netPath->eventSock;
+}
+
 #if defined(SO_TIMESTAMPING) && defined(SO_TIMESTAMPNS)
-static Boolean
-getTxTimestamp(NetPath* netPath,TimeInternal* timeStamp) {
-	extern PtpClock *G_ptpClock;
-	ssize_t length;
-	fd_set tmpSet;
-	struct timeval timeOut = {0,0};
-	int val = 1;
-	int i = 0;
-	if(netPath->txTimestampFailure)
-		goto failure;
+/* revert the event socket to SO_TIMESTAMPNS, forgetting any transmit timestamps still due */
+static void
+netDisableTxTimestamping(NetPath* netPath)
+{
+	int val;
+
+	DBG("net.c: SO_TIMESTAMPING TX software timestamp failure - reverting to SO_TIMESTAMPNS\n");
+	/* unset SO_TIMESTAMPING first! otherwise we get an always-exiting select! */
+	val = 0;
+	if(setsockopt(netTimestampSocket(netPath), SOL_SOCKET, SO_TIMESTAMPING, &val, sizeof(int)) < 0) {
+		DBG("netDisableTxTimestamping: failed to unset SO_TIMESTAMPING");
+	}
+	val = 1;
+	if(setsockopt(netTimestampSocket(netPath), SOL_SOCKET, SO_TIMESTAMPNS, &val, sizeof(int)) < 0) {
+		DBG("netDisableTxTimestamping: failed to revert to SO_TIMESTAMPNS");
+	}
 
-	FD_ZERO(&tmpSet);
-	FD_SET(netPath->eventSock, &tmpSet);
+	netTxTableReset(&netPath->txTable);
+}
 
-	if(select(netPath->eventSock + 1, &tmpSet, NULL, NULL, &timeOut) > 0) {
-		if (FD_ISSET(netPath->eventSock, &tmpSet)) {
+/* record an event message just sent, so its transmit timestamp can be matched to it */
+static NetTxEntry*
+netTxRegister(NetPath* netPath, const Octet* buf, UInteger16 length, Integer32 destination)
+{
+	NetTxTable *table = &netPath->txTable;
+	NetTxEntry *entry;
+	UInteger16 sequenceId, portNumber;
 
-			length = netRecvEvent(G_ptpClock->msgIbuf, timeStamp,
-					      netPath, MSG_ERRQUEUE, NULL);
-			if (length > 0) {
-				DBG("getTxTimestamp: Grabbed sent msg via errqueue: %d bytes, at %d.%d\n", length, timeStamp->seconds, timeStamp->nanoseconds);
-				return TRUE;
-			} else if (length < 0) {
-				DBG("getTxTimestamp: Failed to poll error queue for SO_TIMESTAMPING transmit time\n");
-				G_ptpClock->counters.messageRecvErrors++;
-			} else if (length == 0) {
-				DBG("getTxTimestamp: Received no data from TX error queue\n");
-			}
-		}
+	if(table->entry == NULL) {
+		return NULL;
 	}
 
-	/* we're desperate here, aren't we... */
-	for(i = 0; i < 3; i++) {
-	    length = netRecvEvent(G_ptpClock->msgIbuf, timeStamp, netPath, MSG_ERRQUEUE, NULL);
-	    if(length > 0) {
-		DBG("getTxTimestamp: SO_TIMESTAMPING - delayed TX timestamp caught\n");
-		return TRUE;
-	    }
-	    usleep(10);
+	entry = &table->entry[table->nextId & (table->size - 1)];
+
+	if(entry->state == NET_TX_WAITING) {
+		DBG("netTxRegister: transmit timestamp %u never arrived\n", entry->id);
+		table->waiting--;
+	}
+
+	memcpy(&sequenceId, buf + 30, sizeof(sequenceId));
+
+	entry->id = table->nextId++;
+	entry->destination = destination;
+	entry->sequenceId = ntohs(sequenceId);
+	entry->length = length;
+	entry->messageType = buf[0] & 0x0F;
+	entry->state = NET_TX_WAITING;
+	memset(&entry->requestingPortIdentity, 0, sizeof(PortIdentity));
+	if(entry->messageType == PDELAY_RESP && length >= PDELAY_RESP_LENGTH) {
+		memcpy(entry->requestingPortIdentity.clockIdentity, buf + 44, CLOCK_IDENTITY_LENGTH);
+		memcpy(&portNumber, buf + 52, sizeof(portNumber));
+		entry->requestingPortIdentity.portNumber = ntohs(portNumber);
 	}
+	getTimeMonotonic(&entry->sent);
+	clearTime(&entry->timestamp);
+
+	table->waiting++;
 
-	/* try for the last time: sleep and poll the error queue, if nothing, consider SO_TIMESTAMPING inoperable */
-	usleep(LATE_TXTIMESTAMP_US);
+	return entry;
+}
 
-	length = netRecvEvent(G_ptpClock->msgIbuf, timeStamp, netPath, MSG_ERRQUEUE, NULL);
+/* the error queue returns the whole packet - the PTP message is at its end */
+static Boolean
+netTxPayloadMatches(const NetTxEntry* entry, const Octet* buf, ssize_t length)
+{
+	const Octet *msg;
+	UInteger16 sequenceId;
 
-	if(length > 0) {
-		DBG("getTxTimestamp: SO_TIMESTAMPING - even more delayed TX timestamp caught\n");
+	/* no payload to compare, e.g. truncated: the id is all we have */
+	if(length <= 0) {
 		return TRUE;
-	} else {
-		DBG("getTxTimestamp: SO_TIMESTAMPING - TX timestamp retry failed - will use loop from now on\n");
 	}
 
-failure:
-	DBG("net.c: SO_TIMESTAMPING TX software timestamp failure - reverting to SO_TIMESTAMPNS\n");
-	/* unset SO_TIMESTAMPING first! otherwise we get an always-exiting select! */
-	val = 0;
-	if(setsockopt(netPath->eventSock, SOL_SOCKET, SO_TIMESTAMPING, &val, sizeof(int)) < 0) {
-		DBG("getTxTimestamp: failed to unset SO_TIMESTAMPING");
+	if(length < entry->length) {
+		return FALSE;
 	}
-	val = 1;
-	if(setsockopt(netPath->eventSock, SOL_SOCKET, SO_TIMESTAMPNS, &val, sizeof(int)) < 0) {
-		DBG("getTxTimestamp: failed to revert to SO_TIMESTAMPNS");
+
+	msg = buf + length - entry->length;
+	memcpy(&sequenceId, msg + 30, sizeof(sequenceId));
+
+	return ((msg[0] & 0x0F) == entry->messageType) &&
+		(ntohs(sequenceId) == entry->sequenceId);
+}
+
+static NetTxEntry*
+netTxMatch(NetTxTable* table, const Octet* buf, ssize_t length, UInteger32 id, Boolean idValid)
+{
+	NetTxEntry *entry, *oldest = NULL;
+	int i;
+
+	if(idValid) {
+		entry = &table->entry[(id + table->idOffset) & (table->size - 1)];
+		if(entry->state == NET_TX_WAITING && entry->id == id + table->idOffset &&
+		    netTxPayloadMatches(entry, buf, length)) {
+			return entry;
+		}
 	}
 
-	return FALSE;
+	/*
+	 * no id reported, or the kernel counted a datagram we did not (e.g. a send that
+	 * failed half way) - take the oldest waiting message with the same contents
+	 */
+	for(i = 0; i < table->size; i++) {
+		entry = &table->entry[i];
+		if(entry->state != NET_TX_WAITING || !netTxPayloadMatches(entry, buf, length)) {
+			continue;
+		}
+		if(oldest == NULL || (Integer32)(entry->id - oldest->id) < 0) {
+			oldest = entry;
+		}
+	}
+
+	if(oldest != NULL && idValid) {
+		DBG("netTxMatch: transmit timestamp id %u resynchronised to %u\n", id, oldest->id);
+		table->idOffset = oldest->id - id;
+	}
+
+	return oldest;
+}
+
+/* read all transmit timestamps waiting in the event socket's error queue */
+static void
+netCollectTxTimestamps(NetPath* netPath)
+{
+	NetTxTable *table = &netPath->txTable;
+	NetTxEntry *entry;
+	Octet buf[PACKET_BEGIN_UDP + PACKET_SIZE];
+	struct msghdr msg;
+	struct iovec vec[1];
+	struct cmsghdr *cmsg;
+	struct timespec *ts;
+	TimeInternal timestamp;
+	UInteger32 id = 0;
+	Boolean idValid, timestampValid;
+	ssize_t ret;
+
+	union {
+		struct cmsghdr cm;
+		char	control[256];
+	}     cmsg_un;
+
+	for(;;) {
+		vec[0].iov_base = buf;
+		vec[0].iov_len = sizeof(buf);
+
+		memset(&msg, 0, sizeof(msg));
+		msg.msg_iov = vec;
+		msg.msg_iovlen = 1;
+		msg.msg_control = cmsg_un.control;
+		msg.msg_controllen = sizeof(cmsg_un.control);
+
+		ret = recvmsg(netTimestampSocket(netPath), &msg, MSG_ERRQUEUE | MSG_DONTWAIT);
+		if(ret < 0) {
+			if(errno != EAGAIN && errno != EINTR) {
+				DBG("netCollectTxTimestamps: failed to read error queue: %s\n", strerror(errno));
+			}
+			return;
+		}
+
+#ifdef PTPD_PACKET_MMAP
+		/* short frames come back padded to the Ethernet minimum - cut them down to the PTP message */
+		if(netPath->packetRing.txSock >= 0 && !(msg.msg_flags & MSG_TRUNC) &&
+		    ret >= PACKET_BEGIN_ETHER + 4) {
+			UInteger16 messageLength;
+			memcpy(&messageLength, buf + PACKET_BEGIN_ETHER + 2, sizeof(messageLength));
+			if(PACKET_BEGIN_ETHER + ntohs(messageLength) < ret) {
+				ret = PACKET_BEGIN_ETHER + ntohs(messageLength);
+			}
+		}
+#endif /* PTPD_PACKET_MMAP */
+
+		idValid = timestampValid = FALSE;
+
+		for (cmsg = CMSG_FIRSTHDR(&msg); cmsg != NULL;
+		     cmsg = CMSG_NXTHDR(&msg, cmsg)) {
+			if(cmsg->cmsg_level == SOL_SOCKET &&
+			    cmsg->cmsg_type == SO_TIMESTAMPING) {
+				/* software timestamp comes first */
+				ts = (struct timespec *)CMSG_DATA(cmsg);
+				timestamp.seconds = ts->tv_sec;
+				timestamp.nanoseconds = ts->tv_nsec;
+				timestampValid = (ts->tv_sec || ts->tv_nsec);
+			}
+#  if defined(HAVE_DECL_SOF_TIMESTAMPING_OPT_ID) && HAVE_DECL_SOF_TIMESTAMPING_OPT_ID
+			if(cmsg->cmsg_level == IPPROTO_IP &&
+			    cmsg->cmsg_type == IP_RECVERR) {
+				struct sock_extended_err *serr =
+				    (struct sock_extended_err *)CMSG_DATA(cmsg);
+				if(serr->ee_errno == ENOMSG &&
+				    serr->ee_origin == SO_EE_ORIGIN_TIMESTAMPING) {
+					id = serr->ee_data;
+					idValid = TRUE;
+				}
+			}
+#  endif /* HAVE_DECL_SOF_TIMESTAMPING_OPT_ID */
+		}
+
+		if(!timestampValid) {
+			table->unmatched++;
+			continue;
+		}
+
+		entry = netTxMatch(table, buf, (msg.msg_flags & MSG_TRUNC) ? 0 : ret, id, idValid);
+
+		if(entry == NULL) {
+			DBG("netCollectTxTimestamps: no message waiting for transmit timestamp %u\n", id);
+			table->unmatched++;
+			continue;
+		}
+
+		DBGV("netCollectTxTimestamps: message type %d seq %d TX timestamp: %us %dns\n",
+		     entry->messageType, entry->sequenceId, timestamp.seconds, timestamp.nanoseconds);
+
+		entry->timestamp = timestamp;
+		entry->state = NET_TX_DONE;
+
+		table->waiting--;
+		if(table->doneCount == table->size) {
+			table->doneHead = (table->doneHead + 1) & (table->size - 1);
+			table->doneCount--;
+		}
+		table->done[(table->doneHead + table->doneCount) & (table->size - 1)] = entry->id;
+		table->doneCount++;
+	}
+}
+
+static Boolean
+netTxEntryDone(const NetTxEntry* entry, UInteger32 id)
+{
+	return entry->id == id && entry->state == NET_TX_DONE;
 }
+
 #endif /* SO_TIMESTAMPING */
 
 
@@ -888,6 +1321,7 @@ static Boolean
 netInitTimestamping(NetPath * netPath, const RunTimeOpts * rtOpts)
 {
 	int val = 1;
+	int sock = netTimestampSocket(netPath);
 	Boolean result = TRUE;
 #if defined(SO_TIMESTAMPING) && defined(SO_TIMESTAMPNS)/* Linux - current API */
 	DBG("netInitTimestamping: trying to use SO_TIMESTAMPING\n");
@@ -908,7 +1342,7 @@ netInitTimestamping(NetPath * netPath, const RunTimeOpts * rtOpts)
         tsInfo.cmd = ETHTOOL_GET_TS_INFO;
         strncpy( ifRequest.ifr_name, netPathGetInterfaceName(netPath, rtOpts), IFNAMSIZ - 1);
         ifRequest.ifr_data = (char *) &tsInfo;
-        res = ioctl(netPath->eventSock, SIOCETHTOOL, &ifRequest);
+        res = ioctl(sock, SIOCETHTOOL, &ifRequest);
 
 	if (res < 0) {
 		PERROR("Could not retrieve ethtool timestamping capabilities for %s - reverting to SO_TIMESTAMPNS",
@@ -927,12 +1361,17 @@ netInitTimestamping(NetPath * netPath, const RunTimeOpts * rtOpts)
 #  endif /* PTPD_EXPERIMENTAL */
 
 	if(val == 1) {
-	    if (setsockopt(netPath->eventSock, SOL_SOCKET, SO_TIMESTAMPNS, &val, sizeof(int)) < 0) {
+	    if (setsockopt(sock, SOL_SOCKET, SO_TIMESTAMPNS, &val, sizeof(int)) < 0) {
 		    PERROR("netInitTimestamping: failed to enable SO_TIMESTAMPNS");
 		    result = FALSE;
 	    }
 	} else {
-	    if (setsockopt(netPath->eventSock, SOL_SOCKET, SO_TIMESTAMPING, &val, sizeof(int)) < 0) {
+#  if defined(HAVE_DECL_SOF_TIMESTAMPING_OPT_ID) && HAVE_DECL_SOF_TIMESTAMPING_OPT_ID
+	    /* have the kernel number our datagrams, so TX timestamps can be told apart */
+	    val |= SOF_TIMESTAMPING_OPT_ID;
+#  endif /* HAVE_DECL_SOF_TIMESTAMPING_OPT_ID */
+	    netTxTableReset(&netPath->txTable);
+	    if (setsockopt(sock, SOL_SOCKET, SO_TIMESTAMPING, &val, sizeof(int)) < 0) {
 		    PERROR("netInitTimestamping: failed to enable SO_TIMESTAMPING");
 		    result = FALSE;
 	    }
@@ -945,14 +1384,14 @@ netInitTimestamping(NetPath * netPath, const RunTimeOpts * rtOpts)
 #elif defined(SO_TIMESTAMPNS) /* Linux, Apple */
 	DBG("netInitTimestamping: trying to use SO_TIMESTAMPNS\n");
 
-	if (setsockopt(netPath->eventSock, SOL_SOCKET, SO_TIMESTAMPNS, &val, sizeof(int)) < 0) {
+	if (setsockopt(sock, SOL_SOCKET, SO_TIMESTAMPNS, &val, sizeof(int)) < 0) {
 		PERROR("netInitTimestamping: failed to enable SO_TIMESTAMPNS");
 		result = FALSE;
 	}
 #elif defined(SO_BINTIME) /* FreeBSD */
 	DBG("netInitTimestamping: trying to use SO_BINTIME\n");
 
-	if (setsockopt(netPath->eventSock, SOL_SOCKET, SO_BINTIME, &val, sizeof(int)) < 0) {
+	if (setsockopt(sock, SOL_SOCKET, SO_BINTIME, &val, sizeof(int)) < 0) {
 		PERROR("netInitTimestamping: failed to enable SO_BINTIME");
 		result = FALSE;
 	}
@@ -965,7 +1404,7 @@ netInitTimestamping(NetPath * netPath, const RunTimeOpts * rtOpts)
 	if (!result) {
 		DBG("netInitTimestamping: trying to use SO_TIMESTAMP\n");
 
-		if (setsockopt(netPath->eventSock, SOL_SOCKET, SO_TIMESTAMP, &val, sizeof(int)) < 0) {
+		if (setsockopt(sock, SOL_SOCKET, SO_TIMESTAMP, &val, sizeof(int)) < 0) {
 			PERROR("netInitTimestamping: failed to enable SO_TIMESTAMP");
 			result = FALSE;
 		}
@@ -1096,85 +1535,464 @@ static int parseUnicastConfig(const RunTimeOpts *rtOpts, int maxCount, UnicastDe
 }
 
 
+#ifdef PTPD_EPOLL
+static Boolean
+netEpollAdd(NetPath * netPath, int fd)
+{
+	struct epoll_event ev;
+
+	if(fd < 0) {
+		return TRUE;
+	}
+
+	memset(&ev, 0, sizeof(ev));
+	ev.events = EPOLLIN;
+	ev.data.fd = fd;
+
+	if(epoll_ctl(netPath->epollFd, EPOLL_CTL_ADD, fd, &ev) < 0) {
+		PERROR("Could not add descriptor %d to epoll set", fd);
+		return FALSE;
+	}
+
+	return TRUE;
+}
 
 /**
- * Init all network transports
+ * register the sockets in use with an epoll instance once, so that
+ * netSelect() does not have to rebuild and scan an fd_set every time
  *
  * @param netPath
- * @param rtOpts
- * @param ptpClock
  *
  * @return TRUE if successful
  */
-Boolean
-netInit(NetPath * netPath, const RunTimeOpts * rtOpts, PtpClock * ptpClock)
+static Boolean
+netInitEpoll(NetPath * netPath)
 {
+	if(netPath->epollFd >= 0) {
+		close(netPath->epollFd);
+	}
 
-#ifdef __QNXNTO__
-	unsigned char temp;
-#else
-	int temp;
-#endif
-	struct sockaddr_in addr;
-
-#ifdef PTPD_PCAP
-	struct bpf_program program;
-	char errbuf[PCAP_ERRBUF_SIZE];
-#endif
+	if((netPath->epollFd = epoll_create(NET_EPOLL_MAX_EVENTS)) < 0) {
+		PERROR("Could not create epoll instance");
+		return FALSE;
+	}
 
-	DBG("netInit\n");
+	if(!netEpollAdd(netPath, netPath->wakeupFd)) {
+		return FALSE;
+	}
 
 #ifdef PTPD_PCAP
-	netPath->pcapEvent = NULL;
-	netPath->pcapGeneral = NULL;
-	netPath->pcapEventSock = -1;
-	netPath->pcapGeneralSock = -1;
+	if (netPath->pcapEventSock >= 0) {
+		return netEpollAdd(netPath, netPath->pcapEventSock) &&
+		       netEpollAdd(netPath, netPath->pcapGeneralSock);
+	}
 #endif
-	netPath->generalSock = -1;
-	netPath->eventSock = -1;
+#ifdef PTPD_PACKET_MMAP
+	/* the transmit socket for its error queue, where TX timestamps arrive */
+	if (netPath->packetRing.sock >= 0) {
+		return netEpollAdd(netPath, netPath->packetRing.sock) &&
+		       netEpollAdd(netPath, netPath->packetRing.txSock);
+	}
+#endif /* PTPD_PACKET_MMAP */
+#ifdef PTPD_RX_THREAD
+	/* the receive thread watches the sockets and tells us when it has something */
+	if (netPath->rxThread.running) {
+		return netEpollAdd(netPath, netPath->rxThread.notifyFd);
+	}
+#endif /* PTPD_RX_THREAD */
+	return netEpollAdd(netPath, netPath->eventSock) &&
+	       netEpollAdd(netPath, netPath->generalSock);
+}
 
-#ifdef PTPD_PCAP
-	if (rtOpts->transport == IEEE_802_3) {
-		netPath->headerOffset = PACKET_BEGIN_ETHER;
-		memcpy(ether_addr_octet(&(netPath->etherDest)),
-		       ether_aton(PTP_ETHER_DST), ETHER_ADDR_LEN);
-		memcpy(ether_addr_octet(&netPath->peerEtherDest),
-		       ether_aton(PTP_ETHER_PEER), ETHER_ADDR_LEN);
-	} else
-#endif
-		netPath->headerOffset = PACKET_BEGIN_UDP;
+/* epoll equivalent of select(): ready descriptors are returned in readfds */
+static int
+netSelectEpoll(TimeInternal * timeout, NetPath * netPath, fd_set *readfds)
+{
+	struct epoll_event events[NET_EPOLL_MAX_EVENTS];
+	int i, ret, ms = -1;
 
-	/* open sockets */
-	if ((netPath->eventSock = socket(PF_INET, SOCK_DGRAM,
-					 IPPROTO_UDP)) < 0
-	    || (netPath->generalSock = socket(PF_INET, SOCK_DGRAM,
-					      IPPROTO_UDP)) < 0) {
-		PERROR("failed to initialize sockets");
-		return FALSE;
+	if (timeout) {
+		/* round up so we never wake up before the deadline */
+		ms = timeout->seconds * 1000 +
+		     (timeout->nanoseconds + 999999) / 1000000;
 	}
 
-	/* let's see if we have another interface left before we die */
-	if(!testInterface(netPathGetInterfaceName(netPath, rtOpts), rtOpts)) {
+	FD_ZERO(readfds);
 
-		/* backup not enabled - exit */
-		if(!rtOpts->sysopts.backupIfaceEnabled)
-		    return FALSE;
+	ret = epoll_wait(netPath->epollFd, events, NET_EPOLL_MAX_EVENTS, ms);
 
-		/* backup enabled - try the other interface */
-		netPathToggleUsePrimaryIf(netPath);
+	if (ret < 0) {
+		if (errno == EAGAIN || errno == EINTR)
+			return 0;
+		return ret;
+	}
 
-		NOTICE("Last resort - attempting to switch to %s interface\n",
-		       netPathGetUsePrimaryIf(ptpClock->netPath) ? "primary" : "backup");
-		/* if this fails, we have no reason to live */
-		if(!testInterface(netPathGetInterfaceName(netPath, rtOpts), rtOpts)) {
-		    return FALSE;
-		}
+	for (i = 0; i < ret; i++) {
+		FD_SET(events[i].data.fd, readfds);
 	}
 
+#ifdef PTPD_RX_THREAD
+	if (netPath->rxThread.running && FD_ISSET(netPath->rxThread.notifyFd, readfds))
+		rxThreadAcknowledge(&netPath->rxThread);
+#endif /* PTPD_RX_THREAD */
 
-	netPath->interfaceInfo.addressFamily = AF_INET;
+	return ret;
+}
+#endif /* PTPD_EPOLL */
 
-	/* the if is here only to get rid of an unused result warning. */
+#ifdef PTPD_PACKET_MMAP
+/* Ethernet transport over packet rings: event messages are timestamped on the transmit socket */
+static Boolean
+netInitPacketRing(NetPath * netPath, const RunTimeOpts * rtOpts, PtpClock * ptpClock)
+{
+	struct ether_addr groups[2];
+
+	if (!netPath->interfaceInfo.ifIndex) {
+		ERROR("Could not get the index of interface %s\n", netPathGetInterfaceName(netPath, rtOpts));
+		return FALSE;
+	}
+
+	groups[0] = netPath->etherDest;
+	groups[1] = netPath->peerEtherDest;
+
+	if (!packetRingOpen(&netPath->packetRing, netPath->interfaceInfo.ifIndex, groups, 2)) {
+		ERROR("Failed to set up packet rings on %s\n", netPathGetInterfaceName(netPath, rtOpts));
+		return FALSE;
+	}
+
+#ifdef SO_TIMESTAMPING
+	/* Reset the failure indicator when (re)starting network */
+	netPath->txTimestampFailure = FALSE;
+	if (!netTxTableAlloc(&netPath->txTable, ptpClock->unicastCapacity)) {
+		return FALSE;
+	}
+#endif /* SO_TIMESTAMPING */
+
+	if (!netInitTimestamping(netPath, rtOpts)) {
+		ERROR("Failed to enable packet time stamping\n");
+		return FALSE;
+	}
+
+	/* without TX timestamps, our own frames are the next best thing */
+#ifdef SO_TIMESTAMPING
+	return netSetMulticastLoopback(netPath, netPath->txTimestampFailure);
+#else
+	return netSetMulticastLoopback(netPath, TRUE);
+#endif /* SO_TIMESTAMPING */
+}
+#endif /* PTPD_PACKET_MMAP */
+
+/**
+ * \brief Pick the receive timestamp and destination address out of a
+ * received message's ancillary data. No logging: the receive thread calls
+ * this too.
+ *
+ * @return TRUE if a timestamp was found
+ */
+static Boolean
+netRecvControl(struct msghdr *msgp, TimeInternal *time, Integer32 *destAddr)
+{
+	struct cmsghdr *cmsg;
+
+#if defined(SO_TIMESTAMPNS) || defined(SO_TIMESTAMPING)
+	struct timespec * ts;
+#elif defined(SO_BINTIME)
+	struct bintime * bt;
+	struct timespec ts;
+#endif
+
+#if defined(SO_TIMESTAMP)
+	struct timeval * tv;
+#endif
+	Boolean timestampValid = FALSE;
+
+	for (cmsg = CMSG_FIRSTHDR(msgp); cmsg != NULL;
+	     cmsg = CMSG_NXTHDR(msgp, cmsg)) {
+
+#ifdef IP_PKTINFO
+		if ((cmsg->cmsg_level == IPPROTO_IP) &&
+		    (cmsg->cmsg_type == IP_PKTINFO)) {
+			struct in_pktinfo *pi =
+			(struct in_pktinfo *) CMSG_DATA(cmsg);
+			*destAddr = pi->ipi_addr.s_addr;
+		}
+#endif
+
+#ifdef IP_RECVDSTADDR
+		if ((cmsg->cmsg_level == IPPROTO_IP) &&
+		    (cmsg->cmsg_type == IP_RECVDSTADDR)) {
+			struct in_addr *pa = (struct in_addr *) CMSG_DATA(cmsg);
+			*destAddr = pa->s_addr;
+		}
+#endif
+
+		if (cmsg->cmsg_level == SOL_SOCKET) {
+#if defined(SO_TIMESTAMPING) && defined(SO_TIMESTAMPNS)
+			if(cmsg->cmsg_type == SO_TIMESTAMPING ||
+			    cmsg->cmsg_type == SO_TIMESTAMPNS) {
+				ts = (struct timespec *)CMSG_DATA(cmsg);
+				time->seconds = ts->tv_sec;
+				time->nanoseconds = ts->tv_nsec;
+				return TRUE;
+			}
+#elif defined(SO_TIMESTAMPNS)
+			if(cmsg->cmsg_type == SCM_TIMESTAMPNS) {
+				ts = (struct timespec *)CMSG_DATA(cmsg);
+				time->seconds = ts->tv_sec;
+				time->nanoseconds = ts->tv_nsec;
+				return TRUE;
+			}
+#elif defined(SO_BINTIME)
+			if(cmsg->cmsg_type == SCM_BINTIME) {
+				bt = (struct bintime *)CMSG_DATA(cmsg);
+				bintime2timespec(bt, &ts);
+				time->seconds = ts.tv_sec;
+				time->nanoseconds = ts.tv_nsec;
+				return TRUE;
+			}
+#endif
+
+#if defined(SO_TIMESTAMP)
+			if(cmsg->cmsg_type == SCM_TIMESTAMP) {
+				tv = (struct timeval *)CMSG_DATA(cmsg);
+				time->seconds = tv->tv_sec;
+				time->nanoseconds = tv->tv_usec * 1000;
+				timestampValid = TRUE;
+			}
+#endif
+		}
+	}
+
+	return timestampValid;
+}
+
+#ifdef PTPD_RX_THREAD
+/**
+ * \brief Receive thread side: read everything waiting on a socket straight
+ * into the queue, timestamps and all. Datagrams that do not fit are read
+ * and dropped here rather than left for the kernel to drop, so the socket
+ * is always empty when this returns - the thread is only woken up again
+ * when something new arrives.
+ */
+static void
+netRxDrain(RxQueue *queue, int sock)
+{
+	struct mmsghdr hdr[NET_RECV_BATCH];
+	struct iovec vec[NET_RECV_BATCH];
+	struct sockaddr_in from[NET_RECV_BATCH];
+	union {
+		struct cmsghdr cm;
+		char	control[256];
+	} cmsg[NET_RECV_BATCH];
+	Octet discard[PACKET_SIZE];
+	RxPacket *packet;
+	int count, ret, i;
+
+	for (;;) {
+		count = min(rxQueueSpace(queue), NET_RECV_BATCH);
+
+		/* queue full: the protocol thread is falling behind */
+		if (count == 0) {
+			while (recv(sock, discard, sizeof(discard), MSG_DONTWAIT) >= 0)
+				__atomic_fetch_add(&queue->overruns, 1, __ATOMIC_RELAXED);
+			return;
+		}
+
+		memset(hdr, 0, count * sizeof(struct mmsghdr));
+		for (i = 0; i < count; i++) {
+			packet = rxQueueSlot(queue, i);
+			vec[i].iov_base = packet->data;
+			vec[i].iov_len = PACKET_SIZE;
+			hdr[i].msg_hdr.msg_name = (caddr_t)&from[i];
+			hdr[i].msg_hdr.msg_namelen = sizeof(struct sockaddr_in);
+			hdr[i].msg_hdr.msg_iov = &vec[i];
+			hdr[i].msg_hdr.msg_iovlen = 1;
+			hdr[i].msg_hdr.msg_control = cmsg[i].control;
+			hdr[i].msg_hdr.msg_controllen = sizeof(cmsg[i].control);
+		}
+
+		ret = recvmmsg(sock, hdr, count, MSG_DONTWAIT, NULL);
+		if (ret <= 0)
+			return;
+
+		for (i = 0; i < ret; i++) {
+			packet = rxQueueSlot(queue, i);
+			packet->length = (hdr[i].msg_hdr.msg_flags & (MSG_TRUNC | MSG_CTRUNC)) ?
+					 0 : hdr[i].msg_len;
+			packet->sourceAddr = from[i].sin_addr.s_addr;
+			packet->destAddr = 0;
+			packet->timestampValid = hdr[i].msg_hdr.msg_controllen > 0 &&
+				netRecvControl(&hdr[i].msg_hdr, &packet->timestamp, &packet->destAddr);
+		}
+
+		rxQueuePublish(queue, ret);
+
+		/* recvmmsg() only returns fewer than asked for once the socket is empty */
+		if (ret < count)
+			return;
+	}
+}
+
+/**
+ * \brief Protocol thread side: take the next packet off a receive thread
+ * queue, skipping what cannot be used
+ *
+ * @return datagram length, 0 if nothing waiting
+ */
+static ssize_t
+netRecvQueued(RxQueue *queue, Octet *buf, TimeInternal *time, NetPath *netPath)
+{
+	RxPacket *packet;
+	ssize_t ret = 0;
+	uint64_t overruns = __atomic_load_n(&queue->overruns, __ATOMIC_RELAXED);
+
+	if (overruns != queue->overrunsReported) {
+		WARNING("Receive queue full: %llu messages dropped\n",
+			(unsigned long long)(overruns - queue->overrunsReported));
+		queue->overrunsReported = overruns;
+	}
+
+	while ((packet = rxQueuePeek(queue)) != NULL) {
+		if (!packet->length) {
+			ERROR("received truncated message\n");
+		} else if (time && !packet->timestampValid) {
+			DBG("netRecvEvent: no receive time stamp\n");
+		} else {
+			ret = packet->length;
+			memset(buf, 0, PACKET_SIZE);
+			memcpy(buf, packet->data, ret);
+			if (time)
+				*time = packet->timestamp;
+			netPath->lastSourceAddr = packet->sourceAddr;
+			netPath->lastDestAddr = packet->destAddr;
+		}
+		rxQueuePop(queue);
+
+		if (ret > 0)
+			break;
+	}
+
+	if (ret > 0) {
+		netPath->receivedPacketsTotal++;
+		/* do not report "from self" */
+		if(!netPath->lastSourceAddr || (netPath->lastSourceAddr != netPath->interfaceAddr.s_addr)) {
+			netPath->receivedPackets++;
+		}
+	}
+
+	return ret;
+}
+
+/* hand the sockets over to a receive thread, if we were asked to */
+static void
+netInitRxThread(NetPath * netPath, const RunTimeOpts * rtOpts)
+{
+	if (!rtOpts->sysopts.rxThread || netPath->eventSock < 0 || netPath->generalSock < 0) {
+		return;
+	}
+#ifdef PTPD_PCAP
+	if (netPath->pcapEvent != NULL) {
+		WARNING("Receive thread not used with libpcap\n");
+		return;
+	}
+#endif /* PTPD_PCAP */
+
+	if (!rxThreadStart(&netPath->rxThread, netPath->eventSock, netPath->generalSock,
+			   rtOpts->sysopts.rxThreadQueue, rtOpts->sysopts.rxThreadCpu, netRxDrain)) {
+		PERROR("Could not start receive thread - receiving on the main thread");
+		return;
+	}
+
+	if (rtOpts->sysopts.rxThreadCpu >= 0 && !netPath->rxThread.pinned) {
+		ERROR("Could not bind receive thread to CPU core %d\n", rtOpts->sysopts.rxThreadCpu);
+	}
+
+	INFO("Receive thread started%s, queueing up to %d messages per socket\n",
+	     netPath->rxThread.pinned ? " on its CPU core" : "", netPath->rxThread.event.mask + 1);
+}
+#endif /* PTPD_RX_THREAD */
+
+/**
+ * Init all network transports
+ *
+ * @param netPath
+ * @param rtOpts
+ * @param ptpClock
+ *
+ * @return TRUE if successful
+ */
+Boolean
+netInit(NetPath * netPath, const RunTimeOpts * rtOpts, PtpClock * ptpClock)
+{
+
+#ifdef __QNXNTO__
+	unsigned char temp;
+#else
+	int temp;
+#endif
+	struct sockaddr_in addr;
+
+#ifdef PTPD_PCAP
+	struct bpf_program program;
+	char errbuf[PCAP_ERRBUF_SIZE];
+#endif
+
+	DBG("netInit\n");
+
+#ifdef PTPD_PCAP
+	netPath->pcapEvent = NULL;
+	netPath->pcapGeneral = NULL;
+	netPath->pcapEventSock = -1;
+	netPath->pcapGeneralSock = -1;
+#endif
+	netPath->generalSock = -1;
+	netPath->eventSock = -1;
+#ifdef PTPD_PACKET_MMAP
+	packetRingClose(&netPath->packetRing);
+#endif /* PTPD_PACKET_MMAP */
+
+#if defined(PTPD_PCAP) || defined(PTPD_PACKET_MMAP)
+	if (rtOpts->transport == IEEE_802_3) {
+		netPath->headerOffset = PACKET_BEGIN_ETHER;
+		memcpy(ether_addr_octet(&(netPath->etherDest)),
+		       ether_aton(PTP_ETHER_DST), ETHER_ADDR_LEN);
+		memcpy(ether_addr_octet(&netPath->peerEtherDest),
+		       ether_aton(PTP_ETHER_PEER), ETHER_ADDR_LEN);
+	} else
+#endif
+		netPath->headerOffset = PACKET_BEGIN_UDP;
+
+	/* open sockets */
+	if ((netPath->eventSock = socket(PF_INET, SOCK_DGRAM,
+					 IPPROTO_UDP)) < 0
+	    || (netPath->generalSock = socket(PF_INET, SOCK_DGRAM,
+					      IPPROTO_UDP)) < 0) {
+		PERROR("failed to initialize sockets");
+		return FALSE;
+	}
+
+	/* let's see if we have another interface left before we die */
+	if(!testInterface(netPathGetInterfaceName(netPath, rtOpts), rtOpts)) {
+
+		/* backup not enabled - exit */
+		if(!rtOpts->sysopts.backupIfaceEnabled)
+		    return FALSE;
+
+		/* backup enabled - try the other interface */
+		netPathToggleUsePrimaryIf(netPath);
+
+		NOTICE("Last resort - attempting to switch to %s interface\n",
+		       netPathGetUsePrimaryIf(ptpClock->netPath) ? "primary" : "backup");
+		/* if this fails, we have no reason to live */
+		if(!testInterface(netPathGetInterfaceName(netPath, rtOpts), rtOpts)) {
+		    return FALSE;
+		}
+	}
+
+
+	netPath->interfaceInfo.addressFamily = AF_INET;
+
+	/* the if is here only to get rid of an unused result warning. */
 	if( getInterfaceInfo(netPathGetInterfaceName(netPath, rtOpts), &netPath->interfaceInfo)!= 1)
 		return FALSE;
 
@@ -1194,7 +2012,7 @@ netInit(NetPath * netPath, const RunTimeOpts * rtOpts, PtpClock * ptpClock)
 		((struct sockaddr_in*)&(netPath->interfaceInfo.afAddress))->sin_addr));
 
 #ifdef PTPD_PCAP
-	if (rtOpts->sysopts.pcap == TRUE) {
+	if (rtOpts->sysopts.pcap == TRUE && !NET_USE_PACKET_RING(rtOpts)) {
 
 		netPath->txTimestampFailure = TRUE;
 
@@ -1273,6 +2091,17 @@ netInit(NetPath * netPath, const RunTimeOpts * rtOpts, PtpClock * ptpClock)
 	}
 #endif
 
+#ifdef PTPD_PACKET_MMAP
+	if(NET_USE_PACKET_RING(rtOpts)) {
+		close(netPath->eventSock);
+		netPath->eventSock = -1;
+		close(netPath->generalSock);
+		netPath->generalSock = -1;
+		if(!netInitPacketRing(netPath, rtOpts, ptpClock)) {
+			return FALSE;
+		}
+	} else
+#endif /* PTPD_PACKET_MMAP */
 #ifdef PTPD_PCAP
 	if(rtOpts->transport == IEEE_802_3) {
 		close(netPath->eventSock);
@@ -1283,8 +2112,9 @@ netInit(NetPath * netPath, const RunTimeOpts * rtOpts, PtpClock * ptpClock)
 #  ifdef SO_TIMESTAMPING
 		netPath->txTimestampFailure = TRUE;
 #  endif /* SO_TIMESTAMPING */
-	} else {
+	} else
 #endif
+	{
 		/* save interface address for IGMP refresh */
 		{
 		    struct sockaddr_in* sin = (struct sockaddr_in*)&(netPath->interfaceInfo.afAddress);
@@ -1352,8 +2182,8 @@ netInit(NetPath * netPath, const RunTimeOpts * rtOpts, PtpClock * ptpClock)
 
                     DBG("eventSock rcvbuff : %d\n", n);
 
-                    if(n < (UNICAST_MAX_DESTINATIONS * 1024)) {
-                        n = UNICAST_MAX_DESTINATIONS * 1024;
+                    if(n < (ptpClock->unicastCapacity * 1024)) {
+                        n = ptpClock->unicastCapacity * 1024;
                         if (setsockopt(netPath->eventSock, SOL_SOCKET, SO_RCVBUF, &n, sizeof(n)) < 0) {
                             DBG("Failed to increase event socket receive buffer\n");
                         }
@@ -1365,8 +2195,8 @@ netInit(NetPath * netPath, const RunTimeOpts * rtOpts, PtpClock * ptpClock)
 
                     DBG("genetalSock rcvbuff : %d\n", n);
 
-                    if(n < (UNICAST_MAX_DESTINATIONS * 1024)) {
-                        n = UNICAST_MAX_DESTINATIONS * 1024;
+                    if(n < (ptpClock->unicastCapacity * 1024)) {
+                        n = ptpClock->unicastCapacity * 1024;
                         if (setsockopt(netPath->generalSock, SOL_SOCKET, SO_RCVBUF, &n, sizeof(n)) < 0) {
                             DBG("Failed to increase general socket receive buffer\n");
                         }
@@ -1422,7 +2252,7 @@ netInit(NetPath * netPath, const RunTimeOpts * rtOpts, PtpClock * ptpClock)
 		if(rtOpts->unicastDestinationsSet) {
 
 		    ptpClock->unicastDestinationCount = parseUnicastConfig(rtOpts,
-			    UNICAST_MAX_DESTINATIONS, ptpClock->unicastDestinations);
+			    ptpClock->unicastCapacity, ptpClock->unicastDestinations);
 			    DBG("configured %d unicast destinations\n",ptpClock->unicastDestinationCount);
 
 		}
@@ -1481,6 +2311,9 @@ netInit(NetPath * netPath, const RunTimeOpts * rtOpts, PtpClock * ptpClock)
 			netPath->txTimestampFailure = FALSE;
 			/* for SO_TIMESTAMPING we're receiving transmitted packets via ERRQUEUE */
 			temp = 0;
+			if(!netTxTableAlloc(&netPath->txTable, ptpClock->unicastCapacity)) {
+				return FALSE;
+			}
 #else
 			/* enable loopback */
 			temp = 1;
@@ -1501,14 +2334,27 @@ netInit(NetPath * netPath, const RunTimeOpts * rtOpts, PtpClock * ptpClock)
 			if(!netSetMulticastLoopback(netPath, temp)) {
 				return FALSE;
 			}
+	}
 
-#ifdef PTPD_PCAP
+#ifdef PTPD_RX_THREAD
+	netInitRxThread(netPath, rtOpts);
+#else
+	if (rtOpts->sysopts.rxThread) {
+		WARNING("Receive thread not supported on this platform - receiving on the main thread\n");
 	}
-#endif
+#endif /* PTPD_RX_THREAD */
+
+#ifdef PTPD_EPOLL
+	if(!netInitEpoll(netPath)) {
+		return FALSE;
+	}
+#endif /* PTPD_EPOLL */
 
 	/* Compile ACLs */
 	netInitializeACLs(netPath, rtOpts);
 
+	netUpdateFilter(netPath, rtOpts, ptpClock);
+
 	return TRUE;
 }
 
@@ -1529,6 +2375,202 @@ void netInitializeACLs(NetPath* netPath, const RunTimeOpts* rtOpts)
 	}
 }
 
+#ifdef NET_SOCKET_FILTER
+
+/* longest program built below, with every check and domain in it */
+#define NET_FILTER_LEN 32
+#define NET_FILTER_MAX_DOMAINS 8
+/* jump targets standing for the final accept and drop instructions, resolved once the program is complete */
+#define NET_FILTER_ACCEPT 0xfe
+#define NET_FILTER_DROP 0xff
+/* offset of a PTP header field - the program sees the datagram from its UDP header on */
+#define NET_FILTER_PTP(offset) (sizeof(struct udphdr) + (offset))
+
+/**
+ * \brief Message types handled in the current port state, one bit per
+ * messageType, 0 to accept all - the rest are discarded by the handlers
+ */
+static UInteger32
+netFilterMessageTypes(const RunTimeOpts *rtOpts, const PtpClock *ptpClock)
+{
+	UInteger32 types = (1 << MANAGEMENT) | (1 << SIGNALING);
+
+	/* unicast negotiation tracks the grants on receipt of any message, before looking at the state */
+	if(rtOpts->unicastNegotiation)
+		return 0;
+
+	switch(ptpClock->portDS.portState) {
+	case PTP_LISTENING:
+		types |= (1 << ANNOUNCE);
+		break;
+	case PTP_PASSIVE:
+		types |= (1 << ANNOUNCE) | (1 << PDELAY_REQ);
+		break;
+	case PTP_UNCALIBRATED:
+		types |= (1 << ANNOUNCE) | (1 << SYNC) | (1 << FOLLOW_UP);
+		break;
+	case PTP_MASTER:
+		types |= (1 << ANNOUNCE) | (1 << SYNC) | (1 << DELAY_REQ) |
+			 (1 << PDELAY_REQ) | (1 << PDELAY_RESP) | (1 << PDELAY_RESP_FOLLOW_UP);
+		break;
+	case PTP_SLAVE:
+		types |= (1 << ANNOUNCE) | (1 << SYNC) | (1 << FOLLOW_UP) | (1 << DELAY_REQ) | (1 << DELAY_RESP) |
+			 (1 << PDELAY_REQ) | (1 << PDELAY_RESP) | (1 << PDELAY_RESP_FOLLOW_UP);
+		break;
+	default:
+		break;
+	}
+
+	return types;
+}
+
+/**
+ * \brief Domains messages are accepted from
+ * @return number of domains, 0 to accept any domain
+ */
+static int
+netFilterDomains(const RunTimeOpts *rtOpts, const PtpClock *ptpClock, UInteger8 *domains)
+{
+	int count = 0;
+	int i, j;
+
+	/* the domain mismatch alarm is raised from the messages received from other domains */
+	if((ptpClock->defaultDS.slaveOnly && rtOpts->anyDomain) || rtOpts->alarmsEnabled)
+		return 0;
+
+	domains[count++] = ptpClock->defaultDS.domainNumber;
+
+	if(rtOpts->unicastNegotiation) {
+		for(i = 0; i < ptpClock->unicastDestinationCount; i++) {
+			for(j = 0; j < count && domains[j] != ptpClock->unicastGrants[i].domainNumber; j++);
+			if(j < count)
+				continue;
+			if(count == NET_FILTER_MAX_DOMAINS)
+				return 0;
+			domains[count++] = ptpClock->unicastGrants[i].domainNumber;
+		}
+	}
+
+	return count;
+}
+
+/**
+ * \brief Build the filter program for the event or general socket
+ * @return number of instructions
+ */
+static int
+netFilterBuild(struct sock_filter *prog, Boolean general, const RunTimeOpts *rtOpts, const PtpClock *ptpClock)
+{
+	static const ClockIdentity noIdentity;
+	const Octet *id = ptpClock->portDS.portIdentity.clockIdentity;
+	UInteger8 domains[NET_FILTER_MAX_DOMAINS];
+	UInteger32 types;
+	int count, len = 0, i;
+
+	/* a load past the end of the datagram drops it, so this drops anything shorter than the header */
+	prog[len++] = (struct sock_filter) BPF_STMT(BPF_LD | BPF_B | BPF_ABS, NET_FILTER_PTP(HEADER_LENGTH - 1));
+
+	/* versionPTP */
+	prog[len++] = (struct sock_filter) BPF_STMT(BPF_LD | BPF_B | BPF_ABS, NET_FILTER_PTP(1));
+	prog[len++] = (struct sock_filter) BPF_STMT(BPF_ALU | BPF_AND | BPF_K, 0x0f);
+	prog[len++] = (struct sock_filter) BPF_JUMP(BPF_JMP | BPF_JEQ | BPF_K, VERSION_PTP, 0, NET_FILTER_DROP);
+
+	/* domainNumber: a match skips the remaining comparisons */
+	count = netFilterDomains(rtOpts, ptpClock, domains);
+	if(count) {
+		prog[len++] = (struct sock_filter) BPF_STMT(BPF_LD | BPF_B | BPF_ABS, NET_FILTER_PTP(4));
+		for(i = 0; i < count; i++) {
+			prog[len++] = (struct sock_filter) BPF_JUMP(BPF_JMP | BPF_JEQ | BPF_K, domains[i],
+					count - 1 - i, (i == count - 1) ? NET_FILTER_DROP : 0);
+		}
+	}
+
+	/* messageType: test its bit in the set of types handled */
+	types = netFilterMessageTypes(rtOpts, ptpClock);
+	if(types) {
+		prog[len++] = (struct sock_filter) BPF_STMT(BPF_LD | BPF_B | BPF_ABS, NET_FILTER_PTP(0));
+		prog[len++] = (struct sock_filter) BPF_STMT(BPF_ALU | BPF_AND | BPF_K, 0x0f);
+		prog[len++] = (struct sock_filter) BPF_STMT(BPF_MISC | BPF_TAX, 0);
+		prog[len++] = (struct sock_filter) BPF_STMT(BPF_LD | BPF_IMM, 1);
+		prog[len++] = (struct sock_filter) BPF_STMT(BPF_ALU | BPF_LSH | BPF_X, 0);
+		prog[len++] = (struct sock_filter) BPF_JUMP(BPF_JMP | BPF_JSET | BPF_K, types, 0, NET_FILTER_DROP);
+	}
+
+	/*
+	 * sourcePortIdentity: general messages from ourselves are always ignored.
+	 * Event messages are not - they may be our transmit timestamp source.
+	 */
+	if(general && memcmp(id, noIdentity, CLOCK_IDENTITY_LENGTH)) {
+		prog[len++] = (struct sock_filter) BPF_STMT(BPF_LD | BPF_W | BPF_ABS, NET_FILTER_PTP(20));
+		prog[len++] = (struct sock_filter) BPF_JUMP(BPF_JMP | BPF_JEQ | BPF_K,
+				((UInteger32)id[0] << 24) | (id[1] << 16) | (id[2] << 8) | id[3], 0, NET_FILTER_ACCEPT);
+		prog[len++] = (struct sock_filter) BPF_STMT(BPF_LD | BPF_W | BPF_ABS, NET_FILTER_PTP(24));
+		prog[len++] = (struct sock_filter) BPF_JUMP(BPF_JMP | BPF_JEQ | BPF_K,
+				((UInteger32)id[4] << 24) | (id[5] << 16) | (id[6] << 8) | id[7], 0, NET_FILTER_ACCEPT);
+		prog[len++] = (struct sock_filter) BPF_STMT(BPF_LD | BPF_H | BPF_ABS, NET_FILTER_PTP(28));
+		prog[len++] = (struct sock_filter) BPF_JUMP(BPF_JMP | BPF_JEQ | BPF_K,
+				ptpClock->portDS.portIdentity.portNumber, NET_FILTER_DROP, NET_FILTER_ACCEPT);
+	}
+
+	prog[len++] = (struct sock_filter) BPF_STMT(BPF_RET | BPF_K, 0xffffffff);
+	prog[len++] = (struct sock_filter) BPF_STMT(BPF_RET | BPF_K, 0);
+
+	/* point the accept and drop jumps at the last two instructions */
+	for(i = 0; i < len; i++) {
+		if(BPF_CLASS(prog[i].code) != BPF_JMP)
+			continue;
+		if(prog[i].jt == NET_FILTER_ACCEPT)
+			prog[i].jt = len - 2 - (i + 1);
+		else if(prog[i].jt == NET_FILTER_DROP)
+			prog[i].jt = len - 1 - (i + 1);
+		if(prog[i].jf == NET_FILTER_ACCEPT)
+			prog[i].jf = len - 2 - (i + 1);
+		else if(prog[i].jf == NET_FILTER_DROP)
+			prog[i].jf = len - 1 - (i + 1);
+	}
+
+	return len;
+}
+
+#endif /* NET_SOCKET_FILTER */
+
+/**
+ * \brief Attach kernel filters to the UDP sockets, so the messages
+ * processMessage() would discard - wrong version or domain, or a type
+ * not handled in the current port state - never wake us up.
+ * Called again on every port state change.
+ */
+void
+netUpdateFilter(NetPath *netPath, const RunTimeOpts *rtOpts, const PtpClock *ptpClock)
+{
+#ifdef NET_SOCKET_FILTER
+	struct sock_filter prog[NET_FILTER_LEN];
+	struct sock_fprog program;
+
+	if(!rtOpts->sysopts.kernelFilter || rtOpts->transport != UDP_IPV4) {
+		return;
+	}
+
+	program.filter = prog;
+
+	if(netPath->eventSock >= 0) {
+		program.len = netFilterBuild(prog, FALSE, rtOpts, ptpClock);
+		if(setsockopt(netPath->eventSock, SOL_SOCKET, SO_ATTACH_FILTER, &program, sizeof(program)) < 0) {
+			PERROR("Could not attach kernel filter to event socket");
+		}
+	}
+
+	if(netPath->generalSock >= 0) {
+		program.len = netFilterBuild(prog, TRUE, rtOpts, ptpClock);
+		if(setsockopt(netPath->generalSock, SOL_SOCKET, SO_ATTACH_FILTER, &program, sizeof(program)) < 0) {
+			PERROR("Could not attach kernel filter to general socket");
+		}
+	}
+
+	DBG("Kernel filter set up for state %s\n", portState_getName(ptpClock->portDS.portState));
+#endif /* NET_SOCKET_FILTER */
+}
+
 /*Check if data has been received*/
 int
 netSelect(TimeInternal * timeout, NetPath * netPath, fd_set *readfds)
@@ -1555,8 +2597,29 @@ netSelect(TimeInternal * timeout, NetPath * netPath, fd_set *readfds)
 		tv_ptr = NULL;
 	}
 
+#ifdef PTPD_EPOLL
+	/* SNMP hands us an fd_set to wait on, so it keeps using select() */
+#  if defined PTPD_SNMP
+	if (netPath->epollFd >= 0 && !rtOpts.snmpEnabled)
+#  else
+	if (netPath->epollFd >= 0)
+#  endif
+		return netSelectEpoll(timeout, netPath, readfds);
+#endif /* PTPD_EPOLL */
+
 	FD_ZERO(readfds);
 	nfds = 0;
+#ifdef PTPD_PACKET_MMAP
+	if (netPath->packetRing.sock >= 0) {
+		FD_SET(netPath->packetRing.sock, readfds);
+		FD_SET(netPath->packetRing.txSock, readfds);
+
+		nfds = netPath->packetRing.sock;
+		if (netPath->packetRing.sock < netPath->packetRing.txSock)
+			nfds = netPath->packetRing.txSock;
+
+	} else
+#endif /* PTPD_PACKET_MMAP */
 #ifdef PTPD_PCAP
 	if (netPath->pcapEventSock >= 0) {
 		FD_SET(netPath->pcapEventSock, readfds);
@@ -1567,8 +2630,15 @@ netSelect(TimeInternal * timeout, NetPath * netPath, fd_set *readfds)
 		if (netPath->pcapEventSock < netPath->pcapGeneralSock)
 			nfds = netPath->pcapGeneralSock;
 
-	} else if (netPath->eventSock >= 0) {
+	} else if (netPath->eventSock >= 0)
 #endif
+#ifdef PTPD_RX_THREAD
+	if (netPath->rxThread.running) {
+		FD_SET(netPath->rxThread.notifyFd, readfds);
+		nfds = netPath->rxThread.notifyFd;
+	} else
+#endif /* PTPD_RX_THREAD */
+	{
 		FD_SET(netPath->eventSock, readfds);
 		if (netPath->generalSock >= 0)
 			FD_SET(netPath->generalSock, readfds);
@@ -1576,9 +2646,12 @@ netSelect(TimeInternal * timeout, NetPath * netPath, fd_set *readfds)
 		nfds = netPath->eventSock;
 		if (netPath->eventSock < netPath->generalSock)
 			nfds = netPath->generalSock;
-#ifdef PTPD_PCAP
 	}
-#endif
+	if (netPath->wakeupFd >= 0) {
+		FD_SET(netPath->wakeupFd, readfds);
+		if (nfds < netPath->wakeupFd)
+			nfds = netPath->wakeupFd;
+	}
 	nfds++;
 
 #if defined PTPD_SNMP
@@ -1600,6 +2673,10 @@ if (rtOpts.snmpEnabled) {
 		if (errno == EAGAIN || errno == EINTR)
 			return 0;
 	}
+#ifdef PTPD_RX_THREAD
+	if (ret > 0 && netPath->rxThread.running && FD_ISSET(netPath->rxThread.notifyFd, readfds))
+		rxThreadAcknowledge(&netPath->rxThread);
+#endif /* PTPD_RX_THREAD */
 #if defined PTPD_SNMP
 if (rtOpts.snmpEnabled) {
 	/* Maybe we have received SNMP related data */
@@ -1615,6 +2692,101 @@ if (rtOpts.snmpEnabled) {
 	return ret;
 }
 
+#ifdef HAVE_RECVMMSG
+/**
+ * hand out the next datagram waiting on a socket, draining up to
+ * NET_RECV_BATCH datagrams with a single recvmmsg() call whenever
+ * the previous batch has been used up
+ *
+ * @param batch
+ * @param sock
+ * @param msg set to the message header of the datagram returned
+ *
+ * @return datagram length, 0 if nothing waiting, negative on error
+ */
+static ssize_t
+netRecvBatched(NetRecvBatch *batch, int sock, struct msghdr **msg)
+{
+	int i, ret;
+
+	if (batch->next >= batch->count) {
+
+		batch->count = batch->next = 0;
+
+		for (i = 0; i < NET_RECV_BATCH; i++) {
+			batch->vec[i].iov_base = batch->buf[i];
+			batch->vec[i].iov_len = PACKET_SIZE;
+			memset(&batch->hdr[i], 0, sizeof(struct mmsghdr));
+			batch->hdr[i].msg_hdr.msg_name = (caddr_t)&batch->from[i];
+			batch->hdr[i].msg_hdr.msg_namelen = sizeof(struct sockaddr_in);
+			batch->hdr[i].msg_hdr.msg_iov = &batch->vec[i];
+			batch->hdr[i].msg_hdr.msg_iovlen = 1;
+			batch->hdr[i].msg_hdr.msg_control = batch->cmsg[i].control;
+			batch->hdr[i].msg_hdr.msg_controllen = sizeof(batch->cmsg[i].control);
+		}
+
+		ret = recvmmsg(sock, batch->hdr, NET_RECV_BATCH, MSG_DONTWAIT, NULL);
+
+		if (ret <= 0) {
+			if (errno == EAGAIN || errno == EINTR)
+				return 0;
+			return ret;
+		}
+
+		DBGV("netRecvBatched: received %d datagrams\n", ret);
+		batch->count = ret;
+	}
+
+	*msg = &batch->hdr[batch->next].msg_hdr;
+	return batch->hdr[batch->next++].msg_len;
+}
+#endif /* HAVE_RECVMMSG */
+
+#ifdef PTPD_PACKET_MMAP
+/* take the next PTP message off the receive ring, 0 if there is none */
+static ssize_t
+netRecvPacketRing(Octet * buf, TimeInternal * time, NetPath * netPath)
+{
+	PacketRingFrame frame;
+	ssize_t ret;
+
+	while (packetRingNext(&netPath->packetRing, &frame)) {
+		/* our own frames are only wanted as a loopback timestamp source */
+		if ((frame.outgoing && netPathCheckTxTsValid(netPath)) ||
+		    frame.length <= PACKET_BEGIN_ETHER) {
+			packetRingRelease(&netPath->packetRing);
+			continue;
+		}
+
+		if (!frame.timestamp.seconds && !frame.timestamp.nanoseconds) {
+			DBG("netRecvEvent: no receive time stamp\n");
+			packetRingRelease(&netPath->packetRing);
+			continue;
+		}
+
+		if (!frame.outgoing) {
+			netPath->receivedPackets++;
+		}
+		netPath->receivedPacketsTotal++;
+
+		ret = frame.length - PACKET_BEGIN_ETHER;
+		if (ret > PACKET_SIZE) {
+			ret = PACKET_SIZE;
+		}
+		memcpy(buf, frame.data + PACKET_BEGIN_ETHER, ret);
+		*time = frame.timestamp;
+		packetRingRelease(&netPath->packetRing);
+
+		DBGV("netRecvEvent: packet ring recv time stamp %us %dns\n",
+		     time->seconds, time->nanoseconds);
+
+		return ret;
+	}
+
+	return 0;
+}
+#endif /* PTPD_PACKET_MMAP */
+
 /**
  * store received data from network to "buf" , get and store the
  * SO_TIMESTAMP value in "time" for an event message
@@ -1636,9 +2808,9 @@ ssize_t
 netRecvEvent(Octet * buf, TimeInternal * time, NetPath * netPath, int flags, Boolean* did_timeout)
 {
 	ssize_t ret = 0;
-	struct msghdr msg;
+	struct msghdr msg, *msgp = &msg;
 	struct iovec vec[1];
-	struct sockaddr_in from_addr;
+	struct sockaddr_in from_addr, *from = &from_addr;
 
 #ifdef PTPD_PCAP
 	struct pcap_pkthdr *pkt_header;
@@ -1656,33 +2828,41 @@ netRecvEvent(Octet * buf, TimeInternal * time, NetPath * netPath, int flags, Boo
 		char	control[256];
 	}     cmsg_un;
 
-	struct cmsghdr *cmsg;
-
-#if defined(SO_TIMESTAMPNS) || defined(SO_TIMESTAMPING)
-	struct timespec * ts;
-#elif defined(SO_BINTIME)
-	struct bintime * bt;
-	struct timespec ts;
-#endif
-
-#if defined(SO_TIMESTAMP)
-	struct timeval * tv;
-#endif
 	Boolean timestampValid = FALSE;
 	netPath->lastDestAddr = 0;
 
 	if (did_timeout)
 		*did_timeout = FALSE;
 
+#ifdef PTPD_PACKET_MMAP
+	if (netPath->packetRing.sock >= 0)
+		return netRecvPacketRing(buf, time, netPath);
+#endif /* PTPD_PACKET_MMAP */
+#ifdef PTPD_RX_THREAD
+	if (netPath->rxThread.running && !flags)
+		return netRecvQueued(&netPath->rxThread.event, buf, time, netPath);
+#endif /* PTPD_RX_THREAD */
+
 #ifdef PTPD_PCAP
 	if (netPath->pcapEvent == NULL) { /* Using sockets */
 #endif
+		memset(buf, 0, PACKET_SIZE);
+
+#ifdef HAVE_RECVMMSG
+		/* error queue reads (TX timestamps) are never batched */
+		if (!flags) {
+			ret = netRecvBatched(&netPath->eventBatch, netPath->eventSock, &msgp);
+			if (ret <= 0)
+				return ret;
+			memcpy(buf, msgp->msg_iov[0].iov_base, ret);
+			from = (struct sockaddr_in *)msgp->msg_name;
+		} else {
+#endif /* HAVE_RECVMMSG */
 		vec[0].iov_base = buf;
 		vec[0].iov_len = PACKET_SIZE;
 
 		memset(&msg, 0, sizeof(msg));
 		memset(&from_addr, 0, sizeof(from_addr));
-		memset(buf, 0, PACKET_SIZE);
 		memset(&cmsg_un, 0, sizeof(cmsg_un));
 
 		msg.msg_name = (caddr_t)&from_addr;
@@ -1700,7 +2880,10 @@ netRecvEvent(Octet * buf, TimeInternal * time, NetPath * netPath, int flags, Boo
 
 			return ret;
 		};
-		if (msg.msg_flags & MSG_TRUNC) {
+#ifdef HAVE_RECVMMSG
+		}
+#endif /* HAVE_RECVMMSG */
+		if (msgp->msg_flags & MSG_TRUNC) {
 			ERROR("received truncated message\n");
 			return 0;
 		}
@@ -1709,7 +2892,7 @@ netRecvEvent(Octet * buf, TimeInternal * time, NetPath * netPath, int flags, Boo
 			ERROR("null receive time stamp argument\n");
 			return 0;
 		}
-		if (msg.msg_flags & MSG_CTRUNC) {
+		if (msgp->msg_flags & MSG_CTRUNC) {
 			ERROR("received truncated ancillary data\n");
 			return 0;
 		}
@@ -1717,7 +2900,7 @@ netRecvEvent(Octet * buf, TimeInternal * time, NetPath * netPath, int flags, Boo
 #if defined(HAVE_DECL_MSG_ERRQUEUE) && HAVE_DECL_MSG_ERRQUEUE
 		if(!(flags & MSG_ERRQUEUE))
 #endif
-		netPath->lastSourceAddr = from_addr.sin_addr.s_addr;
+		netPath->lastSourceAddr = from->sin_addr.s_addr;
 
 		netPath->receivedPacketsTotal++;
 
@@ -1726,84 +2909,17 @@ netRecvEvent(Octet * buf, TimeInternal * time, NetPath * netPath, int flags, Boo
 		    netPath->receivedPackets++;
 		}
 
-		if (msg.msg_controllen <= 0) {
+		if (msgp->msg_controllen <= 0) {
 			ERROR("received short ancillary data (%ld/%ld)\n",
-			      (long)msg.msg_controllen, (long)sizeof(cmsg_un.control));
+			      (long)msgp->msg_controllen, (long)sizeof(cmsg_un.control));
 
 			return 0;
 		}
 
-		for (cmsg = CMSG_FIRSTHDR(&msg); cmsg != NULL;
-		     cmsg = CMSG_NXTHDR(&msg, cmsg)) {
-
-#ifdef IP_PKTINFO
-			if ((cmsg->cmsg_level == IPPROTO_IP) &&
-			    (cmsg->cmsg_type == IP_PKTINFO)) {
-				struct in_pktinfo *pi =
-				(struct in_pktinfo *) CMSG_DATA(cmsg);
-				netPath->lastDestAddr = pi->ipi_addr.s_addr;
-				DBG("IP_PKTINFO Dst: %s\n", inet_ntoa(pi->ipi_addr));
-			}
-#endif
-
-#ifdef IP_RECVDSTADDR
-			if ((cmsg->cmsg_level == IPPROTO_IP) &&
-			    (cmsg->cmsg_type == IP_RECVDSTADDR)) {
-				struct in_addr *pa = (struct in_addr *) CMSG_DATA(cmsg);
-				netPath->lastDestAddr = pa->s_addr;
-				DBG("IP_RECVDSTADDR Dst: %s\n", inet_ntoa(*pa));
-			}
-#endif
-
-
-			if (cmsg->cmsg_level == SOL_SOCKET) {
-#if defined(SO_TIMESTAMPING) && defined(SO_TIMESTAMPNS)
-				if(cmsg->cmsg_type == SO_TIMESTAMPING ||
-				    cmsg->cmsg_type == SO_TIMESTAMPNS) {
-					ts = (struct timespec *)CMSG_DATA(cmsg);
-					time->seconds = ts->tv_sec;
-					time->nanoseconds = ts->tv_nsec;
-					timestampValid = TRUE;
-					DBG("rcvevent: SO_TIMESTAMP%s %s time stamp: %us %dns\n", netPath->txTimestampFailure ?
-					    "NS" : "ING",
-					    (flags & MSG_ERRQUEUE) ? "(TX)" : "(RX)" , time->seconds, time->nanoseconds);
-					break;
-				}
-#elif defined(SO_TIMESTAMPNS)
-				if(cmsg->cmsg_type == SCM_TIMESTAMPNS) {
-					ts = (struct timespec *)CMSG_DATA(cmsg);
-					time->seconds = ts->tv_sec;
-					time->nanoseconds = ts->tv_nsec;
-					timestampValid = TRUE;
-					DBGV("kernel NANO recv time stamp %us %dns\n",
-					     time->seconds, time->nanoseconds);
-					break;
-				}
-#elif defined(SO_BINTIME)
-				if(cmsg->cmsg_type == SCM_BINTIME) {
-					bt = (struct bintime *)CMSG_DATA(cmsg);
-					bintime2timespec(bt, &ts);
-					time->seconds = ts.tv_sec;
-					time->nanoseconds = ts.tv_nsec;
-					timestampValid = TRUE;
-					DBGV("kernel NANO recv time stamp %us %dns\n",
-					     time->seconds, time->nanoseconds);
-					break;
-				}
-#endif
-
-#if defined(SO_TIMESTAMP)
-				if(cmsg->cmsg_type == SCM_TIMESTAMP) {
-					tv = (struct timeval *)CMSG_DATA(cmsg);
-					time->seconds = tv->tv_sec;
-					time->nanoseconds = tv->tv_usec * 1000;
-					timestampValid = TRUE;
-					DBGV("kernel MICRO recv time stamp %us %dns\n",
-					     time->seconds, time->nanoseconds);
-				}
-#endif
-			 }
-
+		timestampValid = netRecvControl(msgp, time, &netPath->lastDestAddr);
+		if (timestampValid) {
+			DBG("rcvevent: %s time stamp: %us %dns\n",
+			    (flags & MSG_ERRQUEUE) ? "(TX)" : "(RX)", time->seconds, time->nanoseconds);
 		}
 
 
@@ -1904,17 +3020,34 @@ netRecvGeneral(Octet * buf, NetPath * netPath, Boolean* did_timeout)
 	struct pcap_pkthdr *pkt_header;
 	const u_char *pkt_data;
 #endif
+#ifdef HAVE_RECVMMSG
+	struct msghdr *msgp;
+#else
 	socklen_t from_addr_len = sizeof(from_addr);
+#endif /* HAVE_RECVMMSG */
 
 	netPath->lastSourceAddr = 0;
 
 	if (did_timeout)
 		*did_timeout = FALSE;
 
+#ifdef PTPD_RX_THREAD
+	if (netPath->rxThread.running)
+		return netRecvQueued(&netPath->rxThread.general, buf, NULL, netPath);
+#endif /* PTPD_RX_THREAD */
+
 #ifdef PTPD_PCAP
 	if (netPath->pcapGeneral == NULL) {
 #endif
+#ifdef HAVE_RECVMMSG
+		ret = netRecvBatched(&netPath->generalBatch, netPath->generalSock, &msgp);
+		if (ret <= 0)
+			return ret;
+		memcpy(buf, msgp->msg_iov[0].iov_base, ret);
+		memcpy(&from_addr, msgp->msg_name, sizeof(from_addr));
+#else
 		ret=recvfrom(netPath->generalSock, buf, PACKET_SIZE, MSG_DONTWAIT, (struct sockaddr*)&from_addr, &from_addr_len);
+#endif /* HAVE_RECVMMSG */
 		netPath->lastSourceAddr = from_addr.sin_addr.s_addr;
 
 		/* do not report "from self" */
@@ -1987,6 +3120,35 @@ netSendPcapEther(Octet * buf,  UInteger16 length,
 }
 #endif
 
+#ifdef PTPD_PACKET_MMAP
+/* send a message in an Ethernet frame through the transmit ring */
+static ssize_t
+netSendPacketRing(Octet * buf, UInteger16 length, NetPath * netPath,
+		  struct ether_addr * dst, Boolean event)
+{
+	ssize_t ret;
+
+	ret = packetRingSend(&netPath->packetRing, buf, length, dst, &netPath->interfaceID, event);
+	if (ret <= 0) {
+		DBG("Error sending ether multicast %s message: %s\n",
+		    event ? "event" : "general", strerror(errno));
+		return ret;
+	}
+
+	netPath->sentPackets++;
+	netPath->sentPacketsTotal++;
+
+#ifdef SO_TIMESTAMPING
+	/* the TX timestamp is collected later, see netProcessTxTimestamps() */
+	if (event && netPathCheckTxTsValid(netPath)) {
+		netTxRegister(netPath, buf, length, 0);
+	}
+#endif /* SO_TIMESTAMPING */
+
+	return ret;
+}
+#endif /* PTPD_PACKET_MMAP */
+
 //
 // destinationAddress: destination:
 //   if filled, send to this unicast dest;
@@ -2011,6 +3173,11 @@ netSendEvent(Octet * buf, UInteger16 length, NetPath * netPath,
 	getTime(&tmpTime);
 #endif
 
+#ifdef PTPD_PACKET_MMAP
+	if (netPath->packetRing.txSock >= 0)
+		return netSendPacketRing(buf, length, netPath, &netPath->etherDest, TRUE);
+#endif /* PTPD_PACKET_MMAP */
+
 #ifdef PTPD_PCAP
 
 	/* In PCAP Ethernet mode, we use pcapEvent for receiving all messages
@@ -2067,17 +3234,9 @@ netSendEvent(Octet * buf, UInteger16 length, NetPath * netPath,
 
 #else
 
-#  ifdef PTPD_PCAP
-			if((netPath->pcapEvent == NULL) && !netPath->txTimestampFailure) {
-#  else
-			if(!netPath->txTimestampFailure) {
-#  endif /* PTPD_PCAP */
-				if(!getTxTimestamp(netPath, tim)) {
-					netPath->txTimestampFailure = TRUE;
-					if (tim) {
-						clearTime(tim);
-					}
-				}
+			/* the TX timestamp is collected later, see netProcessTxTimestamps() */
+			if(ret > 0 && netPathCheckTxTsValid(netPath)) {
+				netTxRegister(netPath, buf, length, destinationAddress);
 			}
 
 			if(netPath->txTimestampFailure)
@@ -2111,22 +3270,9 @@ netSendEvent(Octet * buf, UInteger16 length, NetPath * netPath,
 				netPath->sentPacketsTotal++;
 			}
 #ifdef SO_TIMESTAMPING
-
-#  ifdef PTPD_PCAP
-			if((netPath->pcapEvent == NULL) && !netPath->txTimestampFailure) {
-#  else
-			if(!netPath->txTimestampFailure) {
-#  endif /* PTPD_PCAP */
-				if(!getTxTimestamp(netPath, tim)) {
-					if (tim) {
-						clearTime(tim);
-					}
-
-					netPath->txTimestampFailure = TRUE;
-
-					/* Try re-enabling MULTICAST_LOOP */
-					netSetMulticastLoopback(netPath, TRUE);
-				}
+			/* the TX timestamp is collected later, see netProcessTxTimestamps() */
+			if(ret > 0 && netPathCheckTxTsValid(netPath)) {
+				netTxRegister(netPath, buf, length, 0);
 			}
 #endif /* SO_TIMESTAMPING */
 		}
@@ -2147,6 +3293,11 @@ netSendGeneral(Octet * buf, UInteger16 length, NetPath * netPath,
 	addr.sin_family = AF_INET;
 	addr.sin_port = htons(PTP_GENERAL_PORT);
 
+#ifdef PTPD_PACKET_MMAP
+	if (netPath->packetRing.txSock >= 0)
+		return netSendPacketRing(buf, length, netPath, &netPath->etherDest, FALSE);
+#endif /* PTPD_PACKET_MMAP */
+
 #ifdef PTPD_PCAP
 	if ((netPath->pcapGeneral != NULL) && (rtOpts->transport == IEEE_802_3)) {
 		ret = netSendPcapEther(buf, length,
@@ -2217,6 +3368,11 @@ netSendPeerGeneral(Octet * buf, UInteger16 length, NetPath * netPath, const RunT
 	addr.sin_family = AF_INET;
 	addr.sin_port = htons(PTP_GENERAL_PORT);
 
+#ifdef PTPD_PACKET_MMAP
+	if (netPath->packetRing.txSock >= 0)
+		return netSendPacketRing(buf, length, netPath, &netPath->peerEtherDest, FALSE);
+#endif /* PTPD_PACKET_MMAP */
+
 #ifdef PTPD_PCAP
 	if ((netPath->pcapGeneral != NULL) && (rtOpts->transport == IEEE_802_3)) {
 		ret = netSendPcapEther(buf, length,
@@ -2281,6 +3437,11 @@ netSendPeerEvent(Octet * buf, UInteger16 length, NetPath * netPath, const RunTim
 	addr.sin_family = AF_INET;
 	addr.sin_port = htons(PTP_EVENT_PORT);
 
+#ifdef PTPD_PACKET_MMAP
+	if (netPath->packetRing.txSock >= 0)
+		return netSendPacketRing(buf, length, netPath, &netPath->peerEtherDest, TRUE);
+#endif /* PTPD_PACKET_MMAP */
+
 #ifdef PTPD_PCAP
 	if ((netPath->pcapGeneral != NULL) && (rtOpts->transport == IEEE_802_3)) {
 		ret = netSendPcapEther(buf, length,
@@ -2323,17 +3484,9 @@ netSendPeerEvent(Octet * buf, UInteger16 length, NetPath * netPath, const RunTim
 			DBG("Error looping back unicast peer event message\n");
 #else
 
-#  ifdef PTPD_PCAP
-		if((netPath->pcapEvent == NULL) && !netPath->txTimestampFailure) {
-#  else
-		if(!netPath->txTimestampFailure) {
-#  endif /* PTPD_PCAP */
-			if(!getTxTimestamp(netPath, tim)) {
-				netPath->txTimestampFailure = TRUE;
-				if (tim) {
-					clearTime(tim);
-				}
-			}
+		/* the TX timestamp is collected later, see netProcessTxTimestamps() */
+		if(ret > 0 && netPathCheckTxTsValid(netPath)) {
+			netTxRegister(netPath, buf, length, dst);
 		}
 
 		if(netPath->txTimestampFailure) {
@@ -2363,17 +3516,9 @@ netSendPeerEvent(Octet * buf, UInteger16 length, NetPath * netPath, const RunTim
 		if (ret <= 0)
 			DBG("Error sending multicast peer event message\n");
 #ifdef SO_TIMESTAMPING
-		if(!netPath->txTimestampFailure) {
-			if(!getTxTimestamp(netPath, tim)) {
-				if (tim) {
-					clearTime(tim);
-				}
-
-				netPath->txTimestampFailure = TRUE;
-
-				/* Try re-enabling MULTICAST_LOOP */
-				netSetMulticastLoopback(netPath, TRUE);
-			}
+		/* the TX timestamp is collected later, see netProcessTxTimestamps() */
+		if(ret > 0 && netPathCheckTxTsValid(netPath)) {
+			netTxRegister(netPath, buf, length, 0);
 		}
 #endif /* SO_TIMESTAMPING */
 	}
@@ -2388,6 +3533,237 @@ netSendPeerEvent(Octet * buf, UInteger16 length, NetPath * netPath, const RunTim
 
 
 
+/* send everything queued in a batch, return the number of messages sent */
+static int
+netSendBatch(NetPath * netPath, NetSendBatch * batch, int sock, Boolean event)
+{
+	int i, ret, sent = 0;
+
+#ifdef HAVE_SENDMMSG
+	for(i = 0; i < batch->count; i++) {
+		memset(&batch->hdr[i], 0, sizeof(struct mmsghdr));
+		batch->hdr[i].msg_hdr.msg_name = (caddr_t)&batch->to[i];
+		batch->hdr[i].msg_hdr.msg_namelen = sizeof(struct sockaddr_in);
+		batch->hdr[i].msg_hdr.msg_iov = &batch->vec[i];
+		batch->hdr[i].msg_hdr.msg_iovlen = 1;
+	}
+#endif /* HAVE_SENDMMSG */
+
+	i = 0;
+	while(i < batch->count) {
+#ifdef HAVE_SENDMMSG
+		ret = sendmmsg(sock, &batch->hdr[i], batch->count - i, 0);
+#else
+		ret = (sendto(sock, batch->buf[i], batch->vec[i].iov_len, 0,
+			     (struct sockaddr *)&batch->to[i],
+			     sizeof(struct sockaddr_in)) > 0) ? 1 : -1;
+#endif /* HAVE_SENDMMSG */
+
+		/* skip the message that failed and carry on with the rest */
+		if(ret <= 0) {
+			DBG("Error sending unicast %s message to %s\n",
+			    event ? "event" : "general", inet_ntoa(batch->to[i].sin_addr));
+			if(!batch->looped[i]) {
+				batch->failed++;
+			}
+			i++;
+			continue;
+		}
+
+		for(; ret > 0; ret--, i++) {
+			if(batch->looped[i]) {
+				continue;
+			}
+			sent++;
+			netPath->sentPackets++;
+			netPath->sentPacketsTotal++;
+#ifdef SO_TIMESTAMPING
+			if(event && netPathCheckTxTsValid(netPath)) {
+				netTxRegister(netPath, batch->buf[i], batch->vec[i].iov_len,
+					      batch->to[i].sin_addr.s_addr);
+			}
+#endif /* SO_TIMESTAMPING */
+		}
+	}
+
+	DBGV("netSendBatch: sent %d %s messages in a batch of %d\n", sent,
+	     event ? "event" : "general", batch->count);
+
+	batch->sent += sent;
+	batch->count = 0;
+	return sent;
+}
+
+/* add a unicast message to a send batch, sending the batch first if it is full */
+static void
+netQueueMessage(NetPath * netPath, NetSendBatch * batch, int sock, Boolean event,
+		Octet * buf, UInteger16 length, Integer32 destinationAddress, UInteger16 port, Boolean looped)
+{
+	int i;
+
+	if(batch->count == NET_SEND_BATCH) {
+		netSendBatch(netPath, batch, sock, event);
+	}
+
+	i = batch->count++;
+
+	memcpy(batch->buf[i], buf, length);
+	batch->vec[i].iov_base = batch->buf[i];
+	batch->vec[i].iov_len = length;
+	memset(&batch->to[i], 0, sizeof(struct sockaddr_in));
+	batch->to[i].sin_family = AF_INET;
+	batch->to[i].sin_port = htons(port);
+	batch->to[i].sin_addr.s_addr = destinationAddress;
+	batch->looped[i] = looped;
+}
+
+/**
+ * queue a unicast event message, to be sent along with others by
+ * netFlushEvent(). Transmit timestamps are handed out by
+ * netGetTxTimestamp() like for any other event message.
+ */
+void
+netQueueEvent(Octet * buf, UInteger16 length, NetPath * netPath, Integer32 destinationAddress)
+{
+	/* see netSendEvent() */
+	*(char *)(buf + 6) |= PTP_UNICAST;
+
+	netQueueMessage(netPath, &netPath->eventQueue, netPath->eventSock, TRUE,
+			buf, length, destinationAddress, PTP_EVENT_PORT, FALSE);
+
+#ifdef SO_TIMESTAMPING
+	if(netPath->txTimestampFailure)
+#endif /* SO_TIMESTAMPING */
+	{
+		/* no TX timestamps - loop the packet back to ourselves */
+		netQueueMessage(netPath, &netPath->eventQueue, netPath->eventSock, TRUE,
+				buf, length, netPath->interfaceAddr.s_addr, PTP_EVENT_PORT, TRUE);
+	}
+}
+
+/* queue a unicast general message, to be sent along with others by netFlushGeneral() */
+void
+netQueueGeneral(Octet * buf, UInteger16 length, NetPath * netPath, Integer32 destinationAddress)
+{
+	*(char *)(buf + 6) |= PTP_UNICAST;
+
+	netQueueMessage(netPath, &netPath->generalQueue, netPath->generalSock, FALSE,
+			buf, length, destinationAddress, PTP_GENERAL_PORT, FALSE);
+}
+
+/**
+ * send all queued event messages, return the number of messages sent since
+ * the last flush and store the number that could not be sent in failed
+ */
+int
+netFlushEvent(NetPath * netPath, int * failed)
+{
+	int sent;
+
+	netSendBatch(netPath, &netPath->eventQueue, netPath->eventSock, TRUE);
+	sent = netPath->eventQueue.sent;
+	*failed = netPath->eventQueue.failed;
+	netPath->eventQueue.sent = 0;
+	netPath->eventQueue.failed = 0;
+
+	return sent;
+}
+
+/* send all queued general messages, see netFlushEvent() */
+int
+netFlushGeneral(NetPath * netPath, int * failed)
+{
+	int sent;
+
+	netSendBatch(netPath, &netPath->generalQueue, netPath->generalSock, FALSE);
+	sent = netPath->generalQueue.sent;
+	*failed = netPath->generalQueue.failed;
+	netPath->generalQueue.sent = 0;
+	netPath->generalQueue.failed = 0;
+
+	return sent;
+}
+
+/**
+ * collect transmit timestamps from the error queue and check for any
+ * overdue ones - if they never arrive, SO_TIMESTAMPING is considered
+ * inoperable and we revert to looping packets back
+ */
+void
+netProcessTxTimestamps(NetPath * netPath)
+{
+#ifdef SO_TIMESTAMPING
+	NetTxTable *table = &netPath->txTable;
+	NetTxEntry *entry;
+	TimeInternal now, age;
+
+	if(!netPathCheckTxTsValid(netPath)) {
+		return;
+	}
+
+	netCollectTxTimestamps(netPath);
+
+	if(!table->waiting) {
+		return;
+	}
+
+	/* skip past everything completed or overwritten since - the oldest still waiting is what may be overdue */
+	for(; table->oldest != table->nextId; table->oldest++) {
+		entry = &table->entry[table->oldest & (table->size - 1)];
+		if(entry->id == table->oldest && entry->state == NET_TX_WAITING) {
+			break;
+		}
+	}
+
+	if(table->oldest == table->nextId) {
+		return;
+	}
+
+	getTimeMonotonic(&now);
+
+	subTime(&age, &now, &entry->sent);
+	if(age.seconds > 0 || age.nanoseconds > NET_TX_TIMEOUT_US * 1000) {
+		DBG("netProcessTxTimestamps: no TX timestamp for message type %d seq %d - will use loop from now on\n",
+		    entry->messageType, entry->sequenceId);
+		netDisableTxTimestamping(netPath);
+		netPath->txTimestampFailure = TRUE;
+		netSetMulticastLoopback(netPath, TRUE);
+	}
+#endif /* SO_TIMESTAMPING */
+}
+
+/* hand out the next transmit timestamp collected for an event message sent */
+Boolean
+netGetTxTimestamp(NetPath * netPath, NetTxTimestamp * txTimestamp)
+{
+#ifdef SO_TIMESTAMPING
+	NetTxTable *table = &netPath->txTable;
+	NetTxEntry *entry;
+	UInteger32 id;
+
+	while(table->doneCount > 0) {
+		id = table->done[table->doneHead];
+		table->doneHead = (table->doneHead + 1) & (table->size - 1);
+		table->doneCount--;
+
+		entry = &table->entry[id & (table->size - 1)];
+		/* entry reused since */
+		if(!netTxEntryDone(entry, id)) {
+			continue;
+		}
+
+		txTimestamp->timestamp = entry->timestamp;
+		txTimestamp->destination = entry->destination;
+		txTimestamp->sequenceId = entry->sequenceId;
+		txTimestamp->messageType = entry->messageType;
+		txTimestamp->requestingPortIdentity = entry->requestingPortIdentity;
+		entry->state = NET_TX_FREE;
+		return TRUE;
+	}
+#endif /* SO_TIMESTAMPING */
+	return FALSE;
+}
+
 /*
  * refresh IGMP on a timeout
  */
@@ -2503,17 +3879,80 @@ void netPathClearSockets(NetPath* netPath)
 	netPath->pcapEventSock = -1;
 	netPath->pcapGeneralSock = -1;
 #endif /* PTPD_PCAP */
+#ifdef PTPD_PACKET_MMAP
+	packetRingInit(&netPath->packetRing);
+#endif /* PTPD_PACKET_MMAP */
+#ifdef PTPD_RX_THREAD
+	rxThreadInit(&netPath->rxThread);
+#endif /* PTPD_RX_THREAD */
 
 	netPath->generalSock = -1;
 	netPath->eventSock = -1;
 }
 
+void netPathSetWakeupFd(NetPath* netPath, int fd)
+{
+	netPath->wakeupFd = fd;
+}
+
+/* more datagrams from the last batch receive waiting to be processed */
+Boolean netPathEventPending(const NetPath* netPath)
+{
+#ifdef PTPD_PACKET_MMAP
+	if(netPath->packetRing.sock >= 0)
+		return packetRingPending(&netPath->packetRing);
+#endif /* PTPD_PACKET_MMAP */
+#ifdef PTPD_RX_THREAD
+	if(netPath->rxThread.running)
+		return !rxQueueEmpty(&netPath->rxThread.event);
+#endif /* PTPD_RX_THREAD */
+#ifdef HAVE_RECVMMSG
+	return netPath->eventBatch.next < netPath->eventBatch.count;
+#else
+	return FALSE;
+#endif /* HAVE_RECVMMSG */
+}
+
+Boolean netPathGeneralPending(const NetPath* netPath)
+{
+#ifdef PTPD_RX_THREAD
+	if(netPath->rxThread.running)
+		return !rxQueueEmpty(&netPath->rxThread.general);
+#endif /* PTPD_RX_THREAD */
+#ifdef HAVE_RECVMMSG
+	return netPath->generalBatch.next < netPath->generalBatch.count;
+#else
+	return FALSE;
+#endif /* HAVE_RECVMMSG */
+}
+
+/* transmit timestamps of queued event messages still to be collected or handed out */
+Boolean netPathTxTimestampsPending(const NetPath* netPath)
+{
+#ifdef SO_TIMESTAMPING
+	return netPath->txTable.waiting > 0 || netPath->txTable.doneCount > 0;
+#else
+	return FALSE;
+#endif /* SO_TIMESTAMPING */
+}
+
 Boolean netPathEventSocketIsSet(const NetPath* netPath, fd_set* fds)
 {
 #ifdef PTPD_PCAP
 	if(netPath->pcapEvent != NULL)
 		return netPath->pcapEventSock >=0 && FD_ISSET(netPath->pcapEventSock, fds);
 #endif
+#ifdef PTPD_PACKET_MMAP
+	/* all frames are received here, the transmit socket has TX timestamps */
+	if(netPath->packetRing.sock >= 0)
+		return FD_ISSET(netPath->packetRing.sock, fds) ||
+		       FD_ISSET(netPath->packetRing.txSock, fds);
+#endif /* PTPD_PACKET_MMAP */
+#ifdef PTPD_RX_THREAD
+	/* queued messages, or TX timestamps on the error queue */
+	if(netPath->rxThread.running)
+		return FD_ISSET(netPath->rxThread.notifyFd, fds);
+#endif /* PTPD_RX_THREAD */
 	return FD_ISSET(netPath->eventSock, fds);
 }
 
@@ -2523,7 +3962,12 @@ Boolean netPathGeneralSocketIsSet(const NetPath* netPath, fd_set* fds)
 	if(netPath->pcapGeneral != NULL)
 		return netPath->pcapGeneralSock >=0 && FD_ISSET(netPath->pcapGeneralSock, fds);
 #endif
-	return FD_ISSET(netPath->generalSock, fds);
+#ifdef PTPD_RX_THREAD
+	if(netPath->rxThread.running)
+		return FD_ISSET(netPath->rxThread.notifyFd, fds) &&
+		       !rxQueueEmpty(&netPath->rxThread.general);
+#endif /* PTPD_RX_THREAD */
+	return netPath->generalSock >= 0 && FD_ISSET(netPath->generalSock, fds);
 }
 
 /**\brief Display Network info*/
@@ -2546,6 +3990,9 @@ void netPathFree(NetPath** netPath)
 	if(*netPath == NULL)
 		return;
 
+#ifdef SO_TIMESTAMPING
+	netTxTableFree(&(*netPath)->txTable);
+#endif /* SO_TIMESTAMPING */
 	free(*netPath);
 	*netPath = NULL;
 }
@@ -2555,6 +4002,16 @@ NetPath* netPathCreate(const RunTimeOpts* rtOpts)
 	NetPath* netPath = (NetPath*)calloc(1, sizeof(NetPath));
 	DBG("allocated %d bytes for protocol engine NetPath data\n", (int)sizeof(NetPath));
 	netPath->runningBackupInterface = FALSE;
+	netPath->wakeupFd = -1;
+#ifdef PTPD_EPOLL
+	netPath->epollFd = -1;
+#endif /* PTPD_EPOLL */
+#ifdef PTPD_PACKET_MMAP
+	packetRingInit(&netPath->packetRing);
+#endif /* PTPD_PACKET_MMAP */
+#ifdef PTPD_RX_THREAD
+	rxThreadInit(&netPath->rxThread);
+#endif /* PTPD_RX_THREAD */
 	return netPath;
 }
 
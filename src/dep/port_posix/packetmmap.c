@@ -0,0 +1,453 @@
+/*-
+ * Copyright (c) 2015 Wojciech Owczarek,
+ *
+ * All Rights Reserved
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHORS ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE AUTHORS OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+ * OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
+ * IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/**
+ * @file   packetmmap.c
+ * @date   Wed Oct 21 14:37:52 2026
+ *
+ * @brief  Linux AF_PACKET Ethernet transport with memory mapped rings
+ *
+ * The receive ring is made of blocks the kernel fills with frames and hands
+ * over once full, or PACKET_RX_BLOCK_TIMEOUT after its first frame. Blocks
+ * are read in ring order and handed back once all their frames are read.
+ * The transmit ring is made of fixed size TPACKET_V2 frames. Those are
+ * available to every kernel with transmit rings, which TPACKET_V3 only has
+ * from 4.11.
+ */
+
+#ifdef HAVE_CONFIG_H
+#  include <config.h>
+#endif /* HAVE_CONFIG_H */
+
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <arpa/inet.h> // For htons
+#include <linux/if_packet.h>
+#include <linux/if_ether.h>
+#include <linux/filter.h>
+#include <linux/net_tstamp.h>
+
+#include "dep/constants_dep.h" // For PTP_ETHER_TYPE, PACKET_SIZE
+#include "ptpd_logging.h"
+#include "packetmmap.h"
+
+/* receive ring: 8 blocks of 64 kB, frames up to 2 kB */
+#define PACKET_RX_BLOCK_SIZE	(1 << 16)
+#define PACKET_RX_BLOCK_COUNT	8
+#define PACKET_RX_FRAME_SIZE	(1 << 11)
+/* milliseconds a block with frames in it waits for more before it is handed over */
+#define PACKET_RX_BLOCK_TIMEOUT	1
+
+/* transmit ring: 64 frames of 512 bytes, 8 to a page sized block */
+#define PACKET_TX_FRAME_SIZE	512
+#define PACKET_TX_FRAME_COUNT	64
+#define PACKET_TX_BLOCK_SIZE	4096
+
+/* where frame data starts in a transmit ring frame */
+#define PACKET_TX_DATA_OFFSET	(TPACKET2_HDRLEN - sizeof(struct sockaddr_ll))
+
+/*
+ * accept frames of the PTP ethertype, whole, drop everything else - only needed
+ * while bound to all protocols to see outgoing frames, see packetRingSetLoopback()
+ */
+static struct sock_filter ptpEtherFilter[] = {
+	BPF_STMT(BPF_LD | BPF_H | BPF_ABS, 12),
+	BPF_JUMP(BPF_JMP | BPF_JEQ | BPF_K, PTP_ETHER_TYPE, 0, 1),
+	BPF_STMT(BPF_RET | BPF_K, 0xffff),
+	BPF_STMT(BPF_RET | BPF_K, 0),
+};
+
+void
+packetRingInit(PacketRing *ring)
+{
+	memset(ring, 0, sizeof(PacketRing));
+	ring->sock = -1;
+	ring->txSock = -1;
+}
+
+void
+packetRingClose(PacketRing *ring)
+{
+	if(ring->rxMap != NULL) {
+		munmap(ring->rxMap, ring->rxBlockSize * ring->rxBlockCount);
+	}
+	if(ring->txMap != NULL) {
+		munmap(ring->txMap, ring->txFrameSize * ring->txFrameCount);
+	}
+	if(ring->sock >= 0) {
+		close(ring->sock);
+	}
+	if(ring->txSock >= 0) {
+		close(ring->txSock);
+	}
+	packetRingInit(ring);
+}
+
+/*
+ * have the receive socket see the frames this host sends, or not: outgoing frames
+ * are only passed to sockets bound to all protocols, which then get a copy of
+ * every frame on the interface to filter - so that is only done when needed
+ */
+Boolean
+packetRingSetLoopback(PacketRing *ring, Boolean value)
+{
+	struct sockaddr_ll addr;
+
+	memset(&addr, 0, sizeof(addr));
+	addr.sll_family = AF_PACKET;
+	addr.sll_protocol = value ? htons(ETH_P_ALL) : htons(PTP_ETHER_TYPE);
+	addr.sll_ifindex = ring->ifIndex;
+	if(bind(ring->sock, (struct sockaddr*)&addr, sizeof(addr)) < 0) {
+		PERROR("failed to bind packet socket");
+		return FALSE;
+	}
+
+	return TRUE;
+}
+
+/* set up the receive socket and ring, bound to the interface and its PTP multicast groups */
+static Boolean
+packetRingOpenRx(PacketRing *ring, const struct ether_addr *groups, int groupCount)
+{
+	int version = TPACKET_V3;
+	int tsFlags = SOF_TIMESTAMPING_RX_SOFTWARE | SOF_TIMESTAMPING_SOFTWARE;
+	struct tpacket_req3 req;
+	struct sock_fprog program;
+	struct packet_mreq mreq;
+	void *map;
+	int i;
+
+	/* no protocol until bound, so nothing is queued before the filter is attached */
+	if((ring->sock = socket(PF_PACKET, SOCK_RAW, 0)) < 0) {
+		PERROR("failed to open packet socket");
+		return FALSE;
+	}
+
+	program.len = sizeof(ptpEtherFilter) / sizeof(struct sock_filter);
+	program.filter = ptpEtherFilter;
+	if(setsockopt(ring->sock, SOL_SOCKET, SO_ATTACH_FILTER, &program, sizeof(program)) < 0) {
+		PERROR("failed to attach packet socket filter");
+		return FALSE;
+	}
+
+	if(setsockopt(ring->sock, SOL_PACKET, PACKET_VERSION, &version, sizeof(version)) < 0) {
+		PERROR("TPACKET_V3 packet rings not supported");
+		return FALSE;
+	}
+
+	/* frames get the time they were received at rather than the time they were copied to the ring */
+	if(setsockopt(ring->sock, SOL_SOCKET, SO_TIMESTAMPING, &tsFlags, sizeof(tsFlags)) < 0 ||
+	    setsockopt(ring->sock, SOL_PACKET, PACKET_TIMESTAMP, &tsFlags, sizeof(tsFlags)) < 0) {
+		DBG("packetRingOpen: could not enable software receive timestamps: %s\n", strerror(errno));
+	}
+
+	memset(&req, 0, sizeof(req));
+	req.tp_block_size = PACKET_RX_BLOCK_SIZE;
+	req.tp_block_nr = PACKET_RX_BLOCK_COUNT;
+	req.tp_frame_size = PACKET_RX_FRAME_SIZE;
+	req.tp_frame_nr = PACKET_RX_BLOCK_SIZE / PACKET_RX_FRAME_SIZE * PACKET_RX_BLOCK_COUNT;
+	req.tp_retire_blk_tov = PACKET_RX_BLOCK_TIMEOUT;
+	if(setsockopt(ring->sock, SOL_PACKET, PACKET_RX_RING, &req, sizeof(req)) < 0) {
+		PERROR("failed to set up packet receive ring");
+		return FALSE;
+	}
+
+	map = mmap(NULL, req.tp_block_size * req.tp_block_nr, PROT_READ | PROT_WRITE, MAP_SHARED, ring->sock, 0);
+	if(map == MAP_FAILED) {
+		PERROR("failed to map packet receive ring");
+		return FALSE;
+	}
+	ring->rxMap = map;
+	ring->rxBlockSize = req.tp_block_size;
+	ring->rxBlockCount = req.tp_block_nr;
+
+	/* PTP frames only until asked to loop our own back */
+	if(!packetRingSetLoopback(ring, FALSE)) {
+		return FALSE;
+	}
+
+	for(i = 0; i < groupCount; i++) {
+		memset(&mreq, 0, sizeof(mreq));
+		mreq.mr_ifindex = ring->ifIndex;
+		mreq.mr_type = PACKET_MR_MULTICAST;
+		mreq.mr_alen = ETH_ALEN;
+		memcpy(mreq.mr_address, &groups[i], ETH_ALEN);
+		if(setsockopt(ring->sock, SOL_PACKET, PACKET_ADD_MEMBERSHIP, &mreq, sizeof(mreq)) < 0) {
+			PERROR("failed to join PTP Ethernet multicast group");
+			return FALSE;
+		}
+	}
+
+	return TRUE;
+}
+
+/* set up the transmit socket, with a transmit ring if we can have one */
+static Boolean
+packetRingOpenTx(PacketRing *ring)
+{
+	int version = TPACKET_V2;
+	struct tpacket_req req;
+	void *map;
+
+	/* never receives anything: frames are sent to an address, its own protocol stays 0 */
+	if((ring->txSock = socket(PF_PACKET, SOCK_RAW, 0)) < 0) {
+		PERROR("failed to open packet socket");
+		return FALSE;
+	}
+
+	memset(&req, 0, sizeof(req));
+	req.tp_block_size = PACKET_TX_BLOCK_SIZE;
+	req.tp_block_nr = PACKET_TX_FRAME_COUNT * PACKET_TX_FRAME_SIZE / PACKET_TX_BLOCK_SIZE;
+	req.tp_frame_size = PACKET_TX_FRAME_SIZE;
+	req.tp_frame_nr = PACKET_TX_FRAME_COUNT;
+
+	if(setsockopt(ring->txSock, SOL_PACKET, PACKET_VERSION, &version, sizeof(version)) < 0 ||
+	    setsockopt(ring->txSock, SOL_PACKET, PACKET_TX_RING, &req, sizeof(req)) < 0) {
+		DBG("packetRingOpen: no packet transmit ring: %s - frames will be copied\n", strerror(errno));
+		return TRUE;
+	}
+
+	map = mmap(NULL, req.tp_frame_size * req.tp_frame_nr, PROT_READ | PROT_WRITE, MAP_SHARED, ring->txSock, 0);
+	if(map == MAP_FAILED) {
+		PERROR("failed to map packet transmit ring");
+		return FALSE;
+	}
+	ring->txMap = map;
+	ring->txFrameSize = req.tp_frame_size;
+	ring->txFrameCount = req.tp_frame_nr;
+
+	return TRUE;
+}
+
+/* open the packet sockets on interface ifIndex, receiving frames sent to the given multicast groups */
+Boolean
+packetRingOpen(PacketRing *ring, int ifIndex, const struct ether_addr *groups, int groupCount)
+{
+	packetRingClose(ring);
+	ring->ifIndex = ifIndex;
+
+	if(!packetRingOpenRx(ring, groups, groupCount) || !packetRingOpenTx(ring)) {
+		packetRingClose(ring);
+		return FALSE;
+	}
+
+	DBG("packetRingOpen: %d kB receive ring, %s transmit ring\n",
+	    ring->rxBlockSize * ring->rxBlockCount / 1024, ring->txMap ? "with" : "no");
+
+	return TRUE;
+}
+
+static struct tpacket_block_desc*
+packetRingBlock(const PacketRing *ring, unsigned int block)
+{
+	return (struct tpacket_block_desc*)(ring->rxMap + block * ring->rxBlockSize);
+}
+
+/* check if a receive ring block has been handed over to us */
+static Boolean
+packetRingBlockReady(const PacketRing *ring, unsigned int block)
+{
+	return (__atomic_load_n(&packetRingBlock(ring, block)->hdr.bh1.block_status, __ATOMIC_ACQUIRE)
+		& TP_STATUS_USER) != 0;
+}
+
+/* frames still to be read from the receive ring */
+Boolean
+packetRingPending(const PacketRing *ring)
+{
+	if(ring->rxMap == NULL) {
+		return FALSE;
+	}
+
+	if(ring->rxFrame == NULL) {
+		return packetRingBlockReady(ring, ring->rxBlock);
+	}
+
+	return ring->rxFramesLeft > 0 ||
+		packetRingBlockReady(ring, (ring->rxBlock + 1) % ring->rxBlockCount);
+}
+
+/*
+ * done with the last frame from packetRingNext(): once all frames of a block
+ * are read, give it back, so the kernel does not report the socket readable
+ * for a block with nothing left in it
+ */
+void
+packetRingRelease(PacketRing *ring)
+{
+	if(ring->rxFrame == NULL || ring->rxFramesLeft > 0) {
+		return;
+	}
+
+	__atomic_store_n(&packetRingBlock(ring, ring->rxBlock)->hdr.bh1.block_status,
+			 TP_STATUS_KERNEL, __ATOMIC_RELEASE);
+	ring->rxFrame = NULL;
+	ring->rxBlock = (ring->rxBlock + 1) % ring->rxBlockCount;
+}
+
+/* get the next frame from the receive ring, FALSE if there is none */
+Boolean
+packetRingNext(PacketRing *ring, PacketRingFrame *frame)
+{
+	struct tpacket_block_desc *block;
+	struct tpacket3_hdr *hdr;
+	struct sockaddr_ll *from;
+
+	if(ring->rxMap == NULL) {
+		return FALSE;
+	}
+
+	for(;;) {
+		block = packetRingBlock(ring, ring->rxBlock);
+
+		if(ring->rxFrame == NULL) {
+			if(!packetRingBlockReady(ring, ring->rxBlock)) {
+				return FALSE;
+			}
+			ring->rxFrame = (Octet*)block + block->hdr.bh1.offset_to_first_pkt;
+			ring->rxFramesLeft = block->hdr.bh1.num_pkts;
+		}
+
+		if(ring->rxFramesLeft > 0) {
+			break;
+		}
+
+		packetRingRelease(ring);
+	}
+
+	hdr = (struct tpacket3_hdr*)ring->rxFrame;
+	from = (struct sockaddr_ll*)(ring->rxFrame + TPACKET_ALIGN(sizeof(struct tpacket3_hdr)));
+
+	frame->data = ring->rxFrame + hdr->tp_mac;
+	frame->length = hdr->tp_snaplen;
+	frame->timestamp.seconds = hdr->tp_sec;
+	frame->timestamp.nanoseconds = hdr->tp_nsec;
+	frame->outgoing = (from->sll_pkttype == PACKET_OUTGOING);
+
+	ring->rxFrame += hdr->tp_next_offset;
+	ring->rxFramesLeft--;
+
+	return TRUE;
+}
+
+/*
+ * send a PTP message in an Ethernet frame, return the frame length or -1;
+ * a transmit timestamp is only taken if txTimestamp is set
+ */
+ssize_t
+packetRingSend(PacketRing *ring, const Octet *buf, UInteger16 length,
+	       const struct ether_addr *dst, const struct ether_addr *src,
+	       Boolean txTimestamp)
+{
+	Octet copy[ETH_HLEN + PACKET_SIZE];
+	struct tpacket2_hdr *hdr = NULL;
+	struct sockaddr_ll addr;
+	struct msghdr msg;
+	struct iovec vec[1];
+	struct cmsghdr *cmsg;
+	Octet *frame = copy;
+	UInteger16 etherType = htons(PTP_ETHER_TYPE);
+	ssize_t ret;
+
+	union {
+		struct cmsghdr cm;
+		char	control[CMSG_SPACE(sizeof(uint32_t))];
+	}     cmsg_un;
+
+	if(ring->txSock < 0 || length > PACKET_SIZE) {
+		errno = EINVAL;
+		return -1;
+	}
+
+	if(ring->txMap != NULL) {
+		hdr = (struct tpacket2_hdr*)(ring->txMap + ring->txFrame * ring->txFrameSize);
+		switch(__atomic_load_n(&hdr->tp_status, __ATOMIC_ACQUIRE)) {
+		case TP_STATUS_AVAILABLE:
+			break;
+		case TP_STATUS_WRONG_FORMAT:
+			DBG("packetRingSend: kernel rejected transmit ring frame %u\n", ring->txFrame);
+			break;
+		default:
+			/* still being sent - it would be unusual for 64 frames to be in flight */
+			ring->txRingBusy++;
+			errno = EAGAIN;
+			return -1;
+		}
+		frame = (Octet*)hdr + PACKET_TX_DATA_OFFSET;
+	}
+
+	memcpy(frame, dst, ETH_ALEN);
+	memcpy(frame + ETH_ALEN, src, ETH_ALEN);
+	memcpy(frame + 2 * ETH_ALEN, &etherType, sizeof(etherType));
+	memcpy(frame + ETH_HLEN, buf, length);
+
+	memset(&addr, 0, sizeof(addr));
+	addr.sll_family = AF_PACKET;
+	addr.sll_protocol = etherType;
+	addr.sll_ifindex = ring->ifIndex;
+	addr.sll_halen = ETH_ALEN;
+	memcpy(addr.sll_addr, dst, ETH_ALEN);
+
+	memset(&msg, 0, sizeof(msg));
+	msg.msg_name = &addr;
+	msg.msg_namelen = sizeof(addr);
+
+	/* the socket timestamps what it sends - except this one */
+	if(!txTimestamp) {
+		memset(&cmsg_un, 0, sizeof(cmsg_un));
+		msg.msg_control = cmsg_un.control;
+		msg.msg_controllen = sizeof(cmsg_un.control);
+		cmsg = CMSG_FIRSTHDR(&msg);
+		cmsg->cmsg_level = SOL_SOCKET;
+		cmsg->cmsg_type = SO_TIMESTAMPING;
+		cmsg->cmsg_len = CMSG_LEN(sizeof(uint32_t));
+	}
+
+	if(hdr == NULL) {
+		vec[0].iov_base = frame;
+		vec[0].iov_len = ETH_HLEN + length;
+		msg.msg_iov = vec;
+		msg.msg_iovlen = 1;
+		return sendmsg(ring->txSock, &msg, MSG_DONTWAIT);
+	}
+
+	hdr->tp_len = ETH_HLEN + length;
+	__atomic_store_n(&hdr->tp_status, TP_STATUS_SEND_REQUEST, __ATOMIC_RELEASE);
+	ring->txFrame = (ring->txFrame + 1) % ring->txFrameCount;
+
+	ret = sendmsg(ring->txSock, &msg, MSG_DONTWAIT);
+
+	/* not taken: do not let it go out with whatever is sent next */
+	if(ret < 0 && __atomic_load_n(&hdr->tp_status, __ATOMIC_ACQUIRE) == TP_STATUS_SEND_REQUEST) {
+		__atomic_store_n(&hdr->tp_status, TP_STATUS_AVAILABLE, __ATOMIC_RELEASE);
+	}
+
+	return ret;
+}
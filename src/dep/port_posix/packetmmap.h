@@ -0,0 +1,94 @@
+/*-
+ * Copyright (c) 2015 Wojciech Owczarek,
+ *
+ * All Rights Reserved
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHORS ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE AUTHORS OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+ * OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
+ * IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef PACKETMMAP_H_
+#define PACKETMMAP_H_
+
+/**
+ * @file   packetmmap.h
+ * @date   Wed Oct 21 14:37:52 2026
+ *
+ * @brief  Linux AF_PACKET Ethernet transport with memory mapped rings
+ *
+ * Like the libpcap transport, this uses two packet sockets on the interface.
+ * The receive socket sees PTP frames only, behind a classic BPF program that
+ * lets just the PTP ethertype through - and the frames this host sends, when
+ * they are needed as a loopback timestamp source.
+ * Frames are read in place from its TPACKET_V3 receive ring, with the
+ * timestamp the kernel stored next to each. The transmit socket has frames
+ * written straight into its transmit ring, and its error queue returns
+ * their SO_TIMESTAMPING transmit timestamps.
+ */
+
+#include <sys/types.h>
+
+#include "ptp_primitives.h"
+#include "ptp_datatypes.h" // For TimeInternal
+#include "dep/net.h" // For struct ether_addr
+
+typedef struct PacketRing {
+	int sock;			/* receive socket, -1 when closed */
+	int txSock;			/* transmit socket, -1 when closed */
+	int ifIndex;
+
+	Octet *rxMap;			/* receive ring blocks */
+	unsigned int rxBlockSize;
+	unsigned int rxBlockCount;
+	unsigned int rxBlock;		/* block being read */
+	Octet *rxFrame;			/* next frame in it, NULL: block not handed over yet */
+	unsigned int rxFramesLeft;
+
+	Octet *txMap;			/* transmit ring frames, NULL: frames are copied by sendto() */
+	unsigned int txFrameSize;
+	unsigned int txFrameCount;
+	unsigned int txFrame;		/* next frame to fill */
+
+	uint64_t txRingBusy;		/* frames not sent because the next one was still in flight */
+} PacketRing;
+
+/**
+ * \brief A frame read from the receive ring, valid until packetRingRelease()
+ */
+typedef struct {
+	const Octet *data;		/* starting with the Ethernet header */
+	size_t length;
+	TimeInternal timestamp;
+	Boolean outgoing;		/* sent by this host */
+} PacketRingFrame;
+
+void packetRingInit(PacketRing*);
+Boolean packetRingOpen(PacketRing*, int ifIndex, const struct ether_addr *groups, int groupCount);
+void packetRingClose(PacketRing*);
+Boolean packetRingSetLoopback(PacketRing*, Boolean value);
+Boolean packetRingNext(PacketRing*, PacketRingFrame*);
+void packetRingRelease(PacketRing*);
+Boolean packetRingPending(const PacketRing*);
+ssize_t packetRingSend(PacketRing*, const Octet *buf, UInteger16 length,
+		       const struct ether_addr *dst, const struct ether_addr *src,
+		       Boolean txTimestamp);
+
+#endif /* PACKETMMAP_H_ */
@@ -0,0 +1,311 @@
+/*-
+ * Copyright (c) 2015 Wojciech Owczarek,
+ *
+ * All Rights Reserved
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHORS ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE AUTHORS OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+ * OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
+ * IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/**
+ * @file   rxthread.c
+ * @date   Thu Oct 22 10:05:41 2026
+ *
+ * @brief  Receive thread draining the UDP sockets into packet queues
+ *
+ * The sockets are watched edge-triggered, so the thread reads each one
+ * until it is empty and only wakes up again when something new arrives.
+ * That includes the event socket's error queue: transmit timestamps are
+ * still read by the protocol thread, the receive thread only tells it
+ * they are there.
+ */
+
+#ifdef HAVE_CONFIG_H
+#  include <config.h>
+#endif /* HAVE_CONFIG_H */
+
+#if defined(linux) && !defined(_GNU_SOURCE)
+#  define _GNU_SOURCE
+#endif
+
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <signal.h>
+#include <sched.h>
+
+#include "rxthread.h"
+
+#ifdef PTPD_RX_THREAD
+
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+
+void
+rxThreadInit(RxThread *rx)
+{
+	memset(rx, 0, sizeof(RxThread));
+	rx->eventSock = -1;
+	rx->generalSock = -1;
+	rx->epollFd = -1;
+	rx->notifyFd = -1;
+	rx->stopFd = -1;
+}
+
+static Boolean
+rxQueueAlloc(RxQueue *queue, int capacity)
+{
+	uint32_t size = 1;
+
+	while(size < (uint32_t)capacity) {
+		size <<= 1;
+	}
+
+	memset(queue, 0, sizeof(RxQueue));
+	if((queue->slots = calloc(size, sizeof(RxPacket))) == NULL) {
+		return FALSE;
+	}
+	queue->mask = size - 1;
+
+	return TRUE;
+}
+
+static void
+rxQueueFree(RxQueue *queue)
+{
+	free(queue->slots);
+	queue->slots = NULL;
+}
+
+uint32_t
+rxQueueSpace(const RxQueue *queue)
+{
+	return queue->mask + 1 - (queue->head - __atomic_load_n(&queue->tail, __ATOMIC_ACQUIRE));
+}
+
+RxPacket *
+rxQueueSlot(RxQueue *queue, uint32_t index)
+{
+	return &queue->slots[(queue->head + index) & queue->mask];
+}
+
+/* hand the next count slots, filled in, over to the consumer */
+void
+rxQueuePublish(RxQueue *queue, uint32_t count)
+{
+	__atomic_store_n(&queue->head, queue->head + count, __ATOMIC_RELEASE);
+}
+
+RxPacket *
+rxQueuePeek(RxQueue *queue)
+{
+	if(queue->tail == __atomic_load_n(&queue->head, __ATOMIC_ACQUIRE)) {
+		return NULL;
+	}
+
+	return &queue->slots[queue->tail & queue->mask];
+}
+
+void
+rxQueuePop(RxQueue *queue)
+{
+	__atomic_store_n(&queue->tail, queue->tail + 1, __ATOMIC_RELEASE);
+}
+
+Boolean
+rxQueueEmpty(const RxQueue *queue)
+{
+	return queue->tail == __atomic_load_n(&queue->head, __ATOMIC_ACQUIRE);
+}
+
+static void *
+rxThreadMain(void *arg)
+{
+	RxThread *rx = (RxThread*)arg;
+	struct epoll_event events[3];
+	uint64_t one = 1;
+	Boolean notify;
+	uint32_t before;
+	RxQueue *queue;
+	int i, ret;
+
+	for(;;) {
+		ret = epoll_wait(rx->epollFd, events, 3, -1);
+		if(ret < 0) {
+			if(errno == EINTR) {
+				continue;
+			}
+			break;
+		}
+
+		notify = FALSE;
+
+		for(i = 0; i < ret; i++) {
+			if(events[i].data.fd == rx->stopFd) {
+				return NULL;
+			}
+
+			queue = (events[i].data.fd == rx->eventSock) ? &rx->event : &rx->general;
+
+			if(events[i].events & EPOLLIN) {
+				before = queue->head;
+				rx->drain(queue, events[i].data.fd);
+				if(queue->head != before) {
+					notify = TRUE;
+				}
+			}
+
+			/* transmit timestamps waiting on the error queue */
+			if(events[i].events & EPOLLERR) {
+				notify = TRUE;
+			}
+		}
+
+		if(notify && write(rx->notifyFd, &one, sizeof(one)) < 0) {
+			/* the counter can only be full if the protocol thread is gone */
+			;
+		}
+	}
+
+	return NULL;
+}
+
+static Boolean
+rxThreadWatch(RxThread *rx, int fd, uint32_t events)
+{
+	struct epoll_event ev;
+
+	memset(&ev, 0, sizeof(ev));
+	ev.events = events;
+	ev.data.fd = fd;
+
+	return epoll_ctl(rx->epollFd, EPOLL_CTL_ADD, fd, &ev) == 0;
+}
+
+Boolean
+rxThreadStart(RxThread *rx, int eventSock, int generalSock, int capacity, int cpu, RxDrainFunc drain)
+{
+	sigset_t all, old;
+	int ret;
+
+	if(rx->running) {
+		rxThreadStop(rx);
+	}
+
+	if(capacity < RXTHREAD_MIN_CAPACITY) {
+		capacity = RXTHREAD_MIN_CAPACITY;
+	}
+	if(capacity > RXTHREAD_MAX_CAPACITY) {
+		capacity = RXTHREAD_MAX_CAPACITY;
+	}
+
+	rxThreadInit(rx);
+	rx->eventSock = eventSock;
+	rx->generalSock = generalSock;
+	rx->drain = drain;
+
+	if(!rxQueueAlloc(&rx->event, capacity) || !rxQueueAlloc(&rx->general, capacity)) {
+		goto failure;
+	}
+
+	if((rx->epollFd = epoll_create(3)) < 0 ||
+	   (rx->notifyFd = eventfd(0, EFD_NONBLOCK)) < 0 ||
+	   (rx->stopFd = eventfd(0, EFD_NONBLOCK)) < 0) {
+		goto failure;
+	}
+
+	if(!rxThreadWatch(rx, eventSock, EPOLLIN | EPOLLET) ||
+	   !rxThreadWatch(rx, generalSock, EPOLLIN | EPOLLET) ||
+	   !rxThreadWatch(rx, rx->stopFd, EPOLLIN)) {
+		goto failure;
+	}
+
+	/* signals stay with the main thread */
+	sigfillset(&all);
+	pthread_sigmask(SIG_SETMASK, &all, &old);
+	ret = pthread_create(&rx->thread, NULL, rxThreadMain, rx);
+	pthread_sigmask(SIG_SETMASK, &old, NULL);
+
+	if(ret != 0) {
+		errno = ret;
+		goto failure;
+	}
+
+	rx->running = TRUE;
+
+	/* if this fails, the thread runs unpinned - the caller reports it */
+	if(cpu >= 0 && cpu < CPU_SETSIZE) {
+		cpu_set_t mask;
+		CPU_ZERO(&mask);
+		CPU_SET(cpu, &mask);
+		rx->pinned = (pthread_setaffinity_np(rx->thread, sizeof(mask), &mask) == 0);
+	}
+
+	return TRUE;
+
+failure:
+	ret = errno;
+	rxThreadStop(rx);
+	errno = ret;
+	return FALSE;
+}
+
+void
+rxThreadStop(RxThread *rx)
+{
+	uint64_t one = 1;
+
+	if(rx->running) {
+		if(write(rx->stopFd, &one, sizeof(one)) < 0) {
+			;
+		}
+		pthread_join(rx->thread, NULL);
+		rx->running = FALSE;
+	}
+
+	if(rx->epollFd >= 0) {
+		close(rx->epollFd);
+	}
+	if(rx->notifyFd >= 0) {
+		close(rx->notifyFd);
+	}
+	if(rx->stopFd >= 0) {
+		close(rx->stopFd);
+	}
+
+	rxQueueFree(&rx->event);
+	rxQueueFree(&rx->general);
+	rxThreadInit(rx);
+}
+
+void
+rxThreadAcknowledge(RxThread *rx)
+{
+	uint64_t count;
+
+	if(read(rx->notifyFd, &count, sizeof(count)) < 0) {
+		/* nothing to reset */
+		;
+	}
+}
+
+#endif /* PTPD_RX_THREAD */
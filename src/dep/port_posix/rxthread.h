@@ -0,0 +1,123 @@
+/*-
+ * Copyright (c) 2015 Wojciech Owczarek,
+ *
+ * All Rights Reserved
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHORS ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE AUTHORS OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+ * OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
+ * IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef RXTHREAD_H_
+#define RXTHREAD_H_
+
+/**
+ * @file   rxthread.h
+ * @date   Thu Oct 22 10:05:41 2026
+ *
+ * @brief  Receive thread draining the UDP sockets into packet queues
+ *
+ * The thread sleeps on the event and general sockets and reads whatever
+ * arrives straight away, together with its kernel receive timestamp, into
+ * a single-producer/single-consumer queue of fixed-size packets per socket.
+ * The protocol thread takes packets off the queues at its own pace and is
+ * woken up through an eventfd, so slow work there cannot hold up reading
+ * the sockets and let their receive buffers overflow.
+ */
+
+#include <stdint.h>
+#include <pthread.h>
+
+#include "ptp_primitives.h"
+#include "ptp_datatypes.h" // For TimeInternal
+#include "dep/constants_dep.h" // For PACKET_SIZE
+
+/* Linux only: edge-triggered epoll, eventfd and recvmmsg */
+#if defined(PTPD_EPOLL) && defined(HAVE_SYS_EVENTFD_H) && defined(HAVE_RECVMMSG)
+#  define PTPD_RX_THREAD
+#endif
+
+#define RXTHREAD_MIN_CAPACITY	16
+#define RXTHREAD_MAX_CAPACITY	65536
+
+/**
+ * \brief A datagram as received, with what the kernel told us about it
+ */
+typedef struct {
+	TimeInternal timestamp;
+	Boolean timestampValid;
+	Integer32 sourceAddr;
+	Integer32 destAddr;
+	UInteger16 length;		/* 0: truncated or unusable */
+	Octet data[PACKET_SIZE];
+} RxPacket;
+
+/**
+ * \brief Single-producer/single-consumer packet queue
+ */
+typedef struct {
+	RxPacket *slots;
+	uint32_t mask;
+	/* written by the receive thread and the protocol thread only, kept on separate cache lines */
+	uint32_t head __attribute__((aligned(64)));
+	uint32_t tail __attribute__((aligned(64)));
+	/* datagrams read and thrown away because the queue was full */
+	uint64_t overruns __attribute__((aligned(64)));
+	uint64_t overrunsReported;
+} RxQueue;
+
+typedef struct RxThread RxThread;
+
+/* read everything waiting on the socket into the queue, called from the receive thread */
+typedef void (*RxDrainFunc) (RxQueue *queue, int sock);
+
+struct RxThread {
+	RxQueue event;
+	RxQueue general;
+	int eventSock;
+	int generalSock;
+	int epollFd;
+	int notifyFd;			/* eventfd the protocol thread waits on, -1 when not running */
+	int stopFd;
+	RxDrainFunc drain;
+	Boolean running;
+	Boolean pinned;			/* bound to the CPU core asked for */
+	pthread_t thread;
+};
+
+void rxThreadInit(RxThread*);
+/* cpu < 0: run wherever the process may run. FALSE if the thread could not be started */
+Boolean rxThreadStart(RxThread*, int eventSock, int generalSock, int capacity, int cpu, RxDrainFunc drain);
+/* stop the thread, dropping anything still queued */
+void rxThreadStop(RxThread*);
+/* reset the notification once the protocol thread has been woken up by it */
+void rxThreadAcknowledge(RxThread*);
+
+/* producer side */
+uint32_t rxQueueSpace(const RxQueue*);
+RxPacket *rxQueueSlot(RxQueue*, uint32_t index);
+void rxQueuePublish(RxQueue*, uint32_t count);
+
+/* consumer side */
+RxPacket *rxQueuePeek(RxQueue*);
+void rxQueuePop(RxQueue*);
+Boolean rxQueueEmpty(const RxQueue*);
+
+#endif /* RXTHREAD_H_ */
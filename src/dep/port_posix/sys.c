@@ -95,6 +95,21 @@
 #  include <netinet/ether.h>
 #endif
 
+#ifdef HAVE_SYS_MMAN_H
+#  include <sys/mman.h>
+#endif
+
+#ifdef HAVE_SYS_RESOURCE_H
+#  include <sys/resource.h>
+#endif
+
+/* real-time mode: SCHED_FIFO and locked memory */
+#if defined(linux) && defined(HAVE_SCHED_H) && defined(HAVE_SYS_MMAN_H) && defined(HAVE_MLOCKALL)
+#  define PTPD_REALTIME
+/* how much stack to fault in ahead of time */
+#  define REALTIME_STACK_PREFAULT (256 * 1024)
+#endif
+
 #ifdef HAVE_NET_ETHERNET_H
 #  include <net/ethernet.h>
 #endif
@@ -144,6 +159,11 @@
 #include "dep/sys.h" // For getTime, getTimexFlags
 #include "dep/daemonconfig.h"
 #include "dep/alarms.h"
+#include "dep/clockbackend.h"
+#include "dep/clocksim.h"
+#include "dep/logring.h"
+#include "dep/statsbin.h"
+#include "dep/statusshm.h"
 #include "protocol.h"
 #include "display.h"
 #include "ptpd_logging.h"
@@ -162,6 +182,13 @@ typedef struct LogFileHandler {
 
 static LogFileHandler logFiles[LOGFILE_MAX] = {0};
 
+/* status shared memory segment and the name it was created with */
+static PtpdStatusShm *statusShm = NULL;
+static char statusShmName[PATH_MAX + 1];
+
+/* stdio buffer for binary log files, flushed once a second by the writer */
+#define LOGFILE_BINARY_BUFSIZE	65536
+
 Boolean LogFileHandlerIsEnabled(LogFile_e id) {
 	if(id >= LOGFILE_MAX) return FALSE;
 	return logFiles[id].logEnabled;
@@ -182,6 +209,7 @@ Boolean initLogging(RunTimeOpts* rtOpts) {
 	if(!LogFileHandlerInit(LOGFILE_STATISTICS,&rtOpts->sysopts.statisticsLogConfig)) return FALSE;
 	if(!LogFileHandlerInit(LOGFILE_RECORD,    &rtOpts->sysopts.recordLogConfig)    ) return FALSE;
 	if(!LogFileHandlerInit(LOGFILE_EVENT,     &rtOpts->sysopts.eventLogConfig)     ) return FALSE;
+	if(!LogFileHandlerInit(LOGFILE_TRACE,     &rtOpts->sysopts.traceLogConfig)     ) return FALSE;
 	if(!LogFileHandlerInit(LOGFILE_MAX,       &rtOpts->sysopts.statusLogConfig)    ) return FALSE;
 	return TRUE;
 }
@@ -459,44 +487,35 @@ snprint_PortIdentity(char *s, int max_len, const PortIdentity *id)
 	return len;
 }
 
-/* Write a formatted string to file pointer */
-static int writeMessage(FILE* destination, uint32_t *lastHash, int priority, const char * format, va_list ap)
+/* Write a captured log message to file pointer */
+static int writeMessage(FILE* destination, uint32_t *lastHash, const LogRecord *record)
 {
 	extern RunTimeOpts rtOpts;
-	extern Boolean startupInProgress;
-	extern PtpClock *G_ptpClock;
 
 	int written;
+	int priority = record->priority;
 	char time_str[MAXTIMESTR];
-	struct timeval now;
 #ifndef RUNTIME_DEBUG
-	char buf[PATH_MAX +1];
 	uint32_t hash;
-	va_list ap1;
 #endif /* RUNTIME_DEBUG */
 
-	extern char *translatePortState(PtpClock *ptpClock);
-
 	if(destination == NULL)
 		return -1;
 
 	/* If we're starting up as daemon, only print <= WARN */
 	if ((destination == stderr) &&
-		!rtOpts.sysopts.nonDaemon && startupInProgress &&
+		!rtOpts.sysopts.nonDaemon && record->startup &&
 		(priority > LOG_WARNING)){
 		    return 1;
 		}
 
 #ifndef RUNTIME_DEBUG
 	/* check if this message produces the same hash as last */
-	memset(buf, 0, sizeof(buf));
-	va_copy(ap1, ap);
-	vsnprintf(buf, PATH_MAX, format, ap1);
-	hash = fnvHash(buf, sizeof(buf), 0);
+	hash = fnvHash((void*)record->text, strlen(record->text), 0);
 	if(lastHash != NULL) {
-	    if(format[0] != '\n' && lastHash != NULL) {
+	    if(record->text[0] != '\n') {
 		    /* last message was the same - don't print the next one */
-		    if( (lastHash != 0) && (hash == *lastHash)) {
+		    if( (*lastHash != 0) && (hash == *lastHash)) {
 		    return 0;
 		}
 	    }
@@ -507,17 +526,11 @@ static int writeMessage(FILE* destination, uint32_t *lastHash, int priority, con
 	/* Print timestamps and prefixes only if we're running in foreground or logging to file*/
 	if( rtOpts.sysopts.nonDaemon || destination != stderr) {
 
-		/*
-		 * select debug tagged with timestamps. This will slow down PTP itself if you send a lot of messages!
-		 * it also can cause problems in nested debug statements (which are solved by turning the signal
-		 *  handling synchronous, and not calling this function inside asycnhronous signal processing)
-		 */
-		gettimeofday(&now, 0);
-		strftime(time_str, MAXTIMESTR, "%F %X", localtime((time_t*)&now.tv_sec));
-		fprintf(destination, "%s.%06d ", time_str, (int)now.tv_usec);
+		/* the message was timestamped when it was logged, not when it is written out */
+		strftime(time_str, MAXTIMESTR, "%F %X", localtime(&record->time.tv_sec));
+		fprintf(destination, "%s.%06d ", time_str, (int)record->time.tv_usec);
 		fprintf(destination,PTPD_PROGNAME"[%d].%s (%-9s ",
-			(int)getpid(), startupInProgress ? "startup" :
-			netPathGetInterfaceName(G_ptpClock->netPath, &rtOpts),
+			(int)getpid(), record->iface,
 			priority == LOG_EMERG   ? "emergency)" :
 			priority == LOG_ALERT   ? "alert)" :
 			priority == LOG_CRIT    ? "critical)" :
@@ -531,11 +544,10 @@ static int writeMessage(FILE* destination, uint32_t *lastHash, int priority, con
 			"unk)");
 
 
-		fprintf(destination, " (%s) ", G_ptpClock ?
-		       translatePortState(G_ptpClock) : "___");
+		fprintf(destination, " (%s) ", record->state);
 	}
-	written = vfprintf(destination, format, ap);
-	return written;
+	written = fputs(record->text, destination);
+	return written < 0 ? written : (int)strlen(record->text);
 }
 
 static void
@@ -556,37 +568,55 @@ updateLogSize(LogFileHandler* handler)
 
 
 /*
- * Prints a message, randing from critical to debug.
- * This either prints the message to syslog, or with timestamp+state to stderr
+ * Format a message and take everything the prefix needs while it is still
+ * current: by the time the writer thread gets to it, the port may have
+ * changed state.
  */
-void
-logMessage(int priority, const char * format, ...)
+static void
+captureMessage(LogRecord *record, int priority, const char * format, va_list ap)
 {
-	extern RunTimeOpts rtOpts;
 	extern Boolean startupInProgress;
-	va_list ap , ap1;
+	extern PtpClock *G_ptpClock;
 
-	va_copy(ap1, ap);
-	va_start(ap1, format);
-	va_start(ap, format);
+	int len;
 
-#ifdef RUNTIME_DEBUG
-	if ((priority >= LOG_DEBUG) && (priority > rtOpts.sysopts.debug_level)) {
-		goto end;
+	gettimeofday(&record->time, 0);
+	record->priority = priority;
+	record->startup = startupInProgress;
+	record->state = G_ptpClock ? translatePortState(G_ptpClock) : "___";
+
+	if(startupInProgress || G_ptpClock == NULL) {
+		strncpy(record->iface, "startup", sizeof(record->iface) - 1);
+	} else {
+		strncpy(record->iface, netPathGetInterfaceName(G_ptpClock->netPath, G_ptpClock->rtOpts),
+		    sizeof(record->iface) - 1);
 	}
-#endif
+	record->iface[sizeof(record->iface) - 1] = '\0';
 
-	/* log level filter */
-	if(priority > rtOpts.sysopts.logLevel) {
-	    goto end;
+	len = vsnprintf(record->text, sizeof(record->text), format, ap);
+	/* cut short - keep the line terminated */
+	if(len >= (int)sizeof(record->text)) {
+		record->text[sizeof(record->text) - 2] = '\n';
 	}
+}
+
+/*
+ * Write a captured message out to the log file, syslog or stderr.
+ * Called by the log writer thread, or directly when it is not running.
+ */
+static void
+writeLogRecord(const LogRecord *record)
+{
+	extern RunTimeOpts rtOpts;
+	int priority = record->priority;
+
 	/* If we're using a log file and the message has been written OK, we're done*/
 	if(logFiles[LOGFILE_EVENT].logEnabled && logFiles[LOGFILE_EVENT].logFP != NULL) {
 	    if(writeMessage(logFiles[LOGFILE_EVENT].logFP, &logFiles[LOGFILE_EVENT].lastHash,
-			    priority, format, ap) > 0) {
+			    record) > 0) {
 		maintainLogSize(&logFiles[LOGFILE_EVENT]);
-		if(!startupInProgress)
-		    goto end;
+		if(!record->startup)
+		    return;
 		else {
 		    logFiles[LOGFILE_EVENT].lastHash = 0;
 		    goto std_err;
@@ -600,7 +630,7 @@ logMessage(int priority, const char * format, ...)
 	 * messages to syslog to at least leave a trace.
 	 */
 	if (rtOpts.sysopts.useSysLog ||
-	    (!rtOpts.sysopts.nonDaemon && startupInProgress)) {
+	    (!rtOpts.sysopts.nonDaemon && record->startup)) {
 		static Boolean syslogOpened;
 #ifdef RUNTIME_DEBUG
 		/*
@@ -616,9 +646,9 @@ logMessage(int priority, const char * format, ...)
 			openlog(PTPD_PROGNAME, LOG_PID, LOG_DAEMON);
 			syslogOpened = TRUE;
 		}
-		vsyslog(priority, format, ap);
-		if (!startupInProgress) {
-			goto end;
+		syslog(priority, "%s", record->text);
+		if (!record->startup) {
+			return;
 		}
 		else {
 			logFiles[LOGFILE_EVENT].lastHash = 0;
@@ -628,12 +658,49 @@ logMessage(int priority, const char * format, ...)
 std_err:
 
 	/* Either all else failed or we're running in foreground - or we also log to stderr */
-	writeMessage(stderr, &logFiles[LOGFILE_EVENT].lastHash, priority, format, ap1);
+	writeMessage(stderr, &logFiles[LOGFILE_EVENT].lastHash, record);
+}
+
+/*
+ * Prints a message, randing from critical to debug.
+ * This either prints the message to syslog, or with timestamp+state to stderr.
+ * Once the log writer thread runs, the message is only formatted here and
+ * queued - file, syslog and stderr I/O happen in the writer thread.
+ */
+void
+logMessage(int priority, const char * format, ...)
+{
+	extern RunTimeOpts rtOpts;
+	extern Boolean startupInProgress;
+	LogRecord local;
+	LogRecord *record;
+	va_list ap;
+
+#ifdef RUNTIME_DEBUG
+	if ((priority >= LOG_DEBUG) && (priority > rtOpts.sysopts.debug_level)) {
+		return;
+	}
+#endif
+
+	/* log level filter */
+	if(priority > rtOpts.sysopts.logLevel) {
+	    return;
+	}
+
+	va_start(ap, format);
+
+	if(logRingRunning() && !startupInProgress) {
+		/* queue full: dropped, the writer thread reports how many */
+		if((record = logRingClaim()) != NULL) {
+			captureMessage(record, priority, format, ap);
+			logRingCommit(record);
+		}
+	} else {
+		captureMessage(&local, priority, format, ap);
+		writeLogRecord(&local);
+	}
 
-end:
-	va_end(ap1);
 	va_end(ap);
-	return;
 }
 
 
@@ -661,8 +728,12 @@ restartLog(LogFileHandler* handler, Boolean quiet)
 			    handler->config->logID, handler->config->logPath);
 		}
 	}
-	/* \n flushes output for us, no need for fflush() - if you want something different, set it later */
-	setlinebuf(handler->logFP);
+	if(handler->config->binary) {
+		setvbuf(handler->logFP, NULL, _IOFBF, LOGFILE_BINARY_BUFSIZE);
+	} else {
+		/* \n flushes output for us, no need for fflush() - if you want something different, set it later */
+		setlinebuf(handler->logFP);
+	}
 	return TRUE;
 }
 
@@ -762,19 +833,150 @@ maintainLogSize(LogFileHandler* handler)
 void
 restartLogging()
 {
+	extern RunTimeOpts rtOpts;
+
+	/* the writer thread owns the event log file while it runs */
+	logRingStop();
+
 	for(int i = 0; i < LOGFILE_MAX; i++){
 		if(!restartLog(&logFiles[i], TRUE))
 			NOTIFY("Failed logging to %s file\n", logFiles[i].config->logID);
 	}
+
+	/* keep the segment across SIGHUP - readers stay attached to it */
+	if(statusShm != NULL && strcmp(statusShmName, rtOpts.sysopts.statusShmName)) {
+		statusShmDestroy(statusShm, statusShmName);
+		statusShm = NULL;
+	}
+	if(statusShm == NULL && strlen(rtOpts.sysopts.statusShmName) > 0) {
+		snprintf(statusShmName, sizeof(statusShmName), "%s", rtOpts.sysopts.statusShmName);
+		if((statusShm = statusShmCreate(statusShmName)) == NULL) {
+			PERROR("Could not create status shared memory segment %s", statusShmName);
+		}
+	}
+
+	/* in real-time mode, log output can be kept out of the real-time threads */
+	Boolean isolate = rtOpts.sysopts.realtime && rtOpts.sysopts.realtimeLogThread;
+
+	if((rtOpts.sysopts.logAsync || isolate) &&
+	    !logRingStart(rtOpts.sysopts.logAsyncBuffer, writeLogRecord, isolate)) {
+		WARNING("Could not start log writer thread - logging synchronously\n");
+	}
 }
 
 void
 stopLogging(RunTimeOpts* rtOpts)
 {
+	logRingStop();
+
 	for(int i = 0; i < LOGFILE_MAX; i++){
 		logFiles[i].logEnabled = FALSE;
 		closeLog(&logFiles[i]);
 	}
+
+	statusShmDestroy(statusShm, statusShmName);
+	statusShm = NULL;
+}
+
+static void
+writeStatisticsHeader(FILE *destination)
+{
+	extern RunTimeOpts rtOpts;
+	StatsBinHeader header;
+	unsigned char buf[STATSBIN_HEADER_SIZE];
+
+	memset(&header, 0, sizeof(header));
+	header.version = STATSBIN_VERSION;
+	header.headerSize = STATSBIN_HEADER_SIZE;
+	header.recordSize = STATSBIN_RECORD_SIZE;
+#ifdef PTPD_STATISTICS
+	header.flags |= STATSBIN_FLAG_STATISTICS;
+#endif /* PTPD_STATISTICS */
+	header.timestampFormat = rtOpts.sysopts.statisticsTimestamp;
+
+	statsBinPackHeader(buf, &header);
+	if(fwrite(buf, sizeof(buf), 1, destination) != 1) {
+		PERROR("Error while writing statistics file header");
+	}
+}
+
+/* one fixed size record with everything the csv line would show */
+static void
+writeStatisticsRecord(PtpClock *ptpClock, FILE *destination, const TimeInternal *now)
+{
+	extern RunTimeOpts rtOpts;
+	static Boolean errorMsg = FALSE;
+	static Integer32 lastFlush = 0;
+	StatsBinRecord record;
+	unsigned char buf[STATSBIN_RECORD_SIZE];
+
+	memset(&record, 0, sizeof(record));
+	record.time = *now;
+	record.portState = ptpClock->portDS.portState;
+	record.lastMessage = ptpClock->char_last_msg;
+	record.sequenceId = ptpClock->msgTmpHeader.sequenceId;
+	record.resetCount = ptpClock->resetCount;
+	record.parentPortIdentity = ptpClock->parentDS.parentPortIdentity;
+	memcpy(record.grandmasterIdentity, ptpClock->parentDS.grandmasterIdentity, CLOCK_IDENTITY_LENGTH);
+	if (memcmp(ptpClock->parentDS.grandmasterIdentity,
+		   ptpClock->parentDS.parentPortIdentity.clockIdentity,
+		   CLOCK_IDENTITY_LENGTH)) {
+		record.flags |= STATSBIN_RECORD_GM_DIFFERS;
+	}
+
+	if(rtOpts.delayMechanism == E2E) {
+		record.meanPathDelay = ptpClock->currentDS.meanPathDelay;
+		record.delaySM = ptpClock->delaySM;
+	} else {
+		record.meanPathDelay = ptpClock->portDS.peerMeanPathDelay;
+		record.delaySM = ptpClock->pdelaySM;
+	}
+	record.offsetFromMaster = ptpClock->currentDS.offsetFromMaster;
+	record.delayMS = ptpClock->delayMS;
+	record.observedDrift = ptpClock->servo.observedDrift;
+
+#ifdef PTPD_STATISTICS
+	record.mpdMean = ptpClock->slaveStats.mpdMean;
+	record.mpdStdDev = ptpClock->slaveStats.mpdStdDev;
+	record.ofmMean = ptpClock->slaveStats.ofmMean;
+	record.ofmStdDev = ptpClock->slaveStats.ofmStdDev;
+	record.driftMean = ptpClock->servo.driftMean;
+	record.driftStdDev = ptpClock->servo.driftStdDev;
+	record.rawDelayMS = ptpClock->rawDelayMS;
+	record.rawDelaySM = ptpClock->rawDelaySM;
+#endif /* PTPD_STATISTICS */
+
+	statsBinPackRecord(buf, &record);
+
+	/* fwrite may get interrupted by a signal - silently retry once */
+	if(fwrite(buf, sizeof(buf), 1, destination) != 1) {
+	    if(fwrite(buf, sizeof(buf), 1, destination) != 1) {
+		if(!errorMsg) {
+		    PERROR("Error while writing statistics");
+		}
+		errorMsg = TRUE;
+	    }
+	}
+
+	/* the file is block buffered: keep it no more than a second behind */
+	if(now->seconds != lastFlush) {
+		fflush(destination);
+		lastFlush = now->seconds;
+	}
+}
+
+/*
+ * push out buffered binary statistics records - the writer only flushes when a
+ * record with a new second arrives, so call this from the timers to catch the tail
+ */
+void
+flushStatistics(void)
+{
+	if(logFiles[LOGFILE_STATISTICS].logEnabled &&
+	   logFiles[LOGFILE_STATISTICS].logFP != NULL &&
+	   logFiles[LOGFILE_STATISTICS].config->binary) {
+		fflush(logFiles[LOGFILE_STATISTICS].logFP);
+	}
 }
 
 void
@@ -787,6 +989,7 @@ logStatistics(PtpClock * ptpClock)
 	TimeInternal now;
 	time_t time_s;
 	FILE* destination;
+	Boolean binary = FALSE;
 	static TimeInternal prev_now_sync, prev_now_delay;
 	char time_str[MAXTIMESTR];
 
@@ -795,20 +998,25 @@ logStatistics(PtpClock * ptpClock)
 	}
 
 	if(logFiles[LOGFILE_STATISTICS].logEnabled &&
-	   logFiles[LOGFILE_STATISTICS].logFP != NULL)
+	   logFiles[LOGFILE_STATISTICS].logFP != NULL) {
 	    destination = logFiles[LOGFILE_STATISTICS].logFP;
-	else
+	    binary = logFiles[LOGFILE_STATISTICS].config->binary;
+	} else
 	    destination = stdout;
 
 	if (ptpClock->resetStatisticsLog) {
 		ptpClock->resetStatisticsLog = FALSE;
-		fprintf(destination,"# %s, State, Clock ID, One Way Delay, "
-		       "Offset From Master, Slave to Master, "
-		       "Master to Slave, Observed Drift, Last packet Received, Sequence ID"
+		if(binary) {
+			writeStatisticsHeader(destination);
+		} else {
+			fprintf(destination,"# %s, State, Clock ID, One Way Delay, "
+			       "Offset From Master, Slave to Master, "
+			       "Master to Slave, Observed Drift, Last packet Received, Sequence ID"
 #ifdef PTPD_STATISTICS
-			", One Way Delay Mean, One Way Delay Std Dev, Offset From Master Mean, Offset From Master Std Dev, Observed Drift Mean, Observed Drift Std Dev, raw delayMS, raw delaySM"
+				", One Way Delay Mean, One Way Delay Std Dev, Offset From Master Mean, Offset From Master Std Dev, Observed Drift Mean, Observed Drift Std Dev, raw delayMS, raw delaySM"
 #endif
-			"\n", (rtOpts.sysopts.statisticsTimestamp == TIMESTAMP_BOTH) ? "Timestamp, Unix timestamp" : "Timestamp");
+				"\n", (rtOpts.sysopts.statisticsTimestamp == TIMESTAMP_BOTH) ? "Timestamp, Unix timestamp" : "Timestamp");
+		}
 	}
 
 	memset(sbuf, 0, sizeof(sbuf));
@@ -841,6 +1049,14 @@ logStatistics(PtpClock * ptpClock)
 		}
 	}
 
+	/* binary records are converted to the same csv offline - skip all the formatting */
+	if(binary) {
+		writeStatisticsRecord(ptpClock, destination, &now);
+		if (maintainLogSize(&logFiles[LOGFILE_STATISTICS]))
+			ptpClock->resetStatisticsLog = TRUE;
+		return;
+	}
+
 	time_s = now.seconds;
 
 	/* output date-time timestamp if configured */
@@ -977,6 +1193,32 @@ logStatistics(PtpClock * ptpClock)
 	}
 }
 
+#ifdef HAVE_GETRUSAGE
+/* page faults and involuntary context switches since the previous status update */
+static void
+reportResourceUsage(void)
+{
+    static struct rusage last;
+    struct rusage now;
+
+/* the protocol thread only where we can tell threads apart */
+#ifdef RUSAGE_THREAD
+    if(getrusage(RUSAGE_THREAD, &now) < 0) {
+#else
+    if(getrusage(RUSAGE_SELF, &now) < 0) {
+#endif /* RUSAGE_THREAD */
+	DBG("getrusage() failed: %s\n", strerror(errno));
+	return;
+    }
+
+    INFO("Status update: %ld minor / %ld major page faults, %ld involuntary context switches\n",
+	now.ru_minflt - last.ru_minflt, now.ru_majflt - last.ru_majflt,
+	now.ru_nivcsw - last.ru_nivcsw);
+
+    last = now;
+}
+#endif /* HAVE_GETRUSAGE */
+
 /* periodic status update */
 void
 periodicUpdate(const RunTimeOpts *rtOpts, PtpClock *ptpClock)
@@ -1049,6 +1291,12 @@ periodicUpdate(const RunTimeOpts *rtOpts, PtpClock *ptpClock)
     } else {
 	INFO("Status update: state %s\n", portState_getName(ptpClock->portDS.portState));
     }
+
+#ifdef HAVE_GETRUSAGE
+    reportResourceUsage();
+#endif /* HAVE_GETRUSAGE */
+
+    flushStatistics();
 }
 
 
@@ -1082,6 +1330,128 @@ displayStatus(PtpClock *ptpClock, const char *prefixMessage)
         NOTICE("%s",sbuf);
 }
 
+Boolean
+statusShmEnabled(void)
+{
+	return statusShm != NULL;
+}
+
+static int64_t
+timeToNs(const TimeInternal *time)
+{
+	return time->seconds * 1000000000LL + time->nanoseconds;
+}
+
+/* everything the status file shows that monitoring needs, without the formatting */
+void
+updateStatusShm(PtpClock *ptpClock, const RunTimeOpts *rtOpts)
+{
+	PtpdStatus *status;
+	TimeInternal now;
+	int n, i;
+
+	if(statusShm == NULL) {
+		return;
+	}
+
+	n = getAlarmSummary(NULL, 0, ptpClock->alarms, ALRM_MAX);
+	char alarmBuf[n];
+	getAlarmSummary(alarmBuf, n, ptpClock->alarms, ALRM_MAX);
+
+	getTime(&now);
+
+	statusShmWriteBegin(statusShm);
+	status = &statusShm->status;
+
+	status->updated = timeToNs(&now);
+	status->pid = getpid();
+	status->portState = ptpClock->portDS.portState;
+	status->delayMechanism = ptpClock->portDS.delayMechanism;
+	status->domainNumber = ptpClock->defaultDS.domainNumber;
+	strncpy(status->interface, netPathGetInterfaceName(ptpClock->netPath, rtOpts),
+	    STATUSSHM_IFACE_LEN - 1);
+
+	memcpy(status->portIdentity, ptpClock->portDS.portIdentity.clockIdentity, CLOCK_IDENTITY_LENGTH);
+	status->portNumber = ptpClock->portDS.portIdentity.portNumber;
+	memcpy(status->parentIdentity, ptpClock->parentDS.parentPortIdentity.clockIdentity, CLOCK_IDENTITY_LENGTH);
+	status->parentPortNumber = ptpClock->parentDS.parentPortIdentity.portNumber;
+	memcpy(status->grandmasterIdentity, ptpClock->parentDS.grandmasterIdentity, CLOCK_IDENTITY_LENGTH);
+	status->grandmasterPriority1 = ptpClock->parentDS.grandmasterPriority1;
+	status->grandmasterPriority2 = ptpClock->parentDS.grandmasterPriority2;
+	status->grandmasterClockClass = ptpClock->parentDS.grandmasterClockQuality.clockClass;
+
+	status->timeFlags =
+	    (ptpClock->timePropertiesDS.ptpTimescale ? STATUSSHM_TIME_PTP_TIMESCALE : 0) |
+	    (ptpClock->timePropertiesDS.timeTraceable ? STATUSSHM_TIME_TRACEABLE : 0) |
+	    (ptpClock->timePropertiesDS.frequencyTraceable ? STATUSSHM_FREQ_TRACEABLE : 0) |
+	    (ptpClock->timePropertiesDS.currentUtcOffsetValid ? STATUSSHM_UTC_VALID : 0) |
+	    (ptpClock->timePropertiesDS.leap59 ? STATUSSHM_LEAP59 : 0) |
+	    (ptpClock->timePropertiesDS.leap61 ? STATUSSHM_LEAP61 : 0);
+	status->utcOffset = ptpClock->timePropertiesDS.currentUtcOffset;
+
+	status->clockFlags =
+	    (ptpClock->clockControl.granted ? STATUSSHM_CLOCK_IN_CONTROL : 0) |
+	    (rtOpts->noAdjust ? STATUSSHM_CLOCK_READ_ONLY : 0) |
+	    (ptpClock->isCalibrated ? STATUSSHM_CLOCK_CALIBRATED : 0) |
+	    (ptpClock->panicMode ? STATUSSHM_CLOCK_PANIC : 0) |
+	    (ptpClock->servo.runningMaxOutput ? STATUSSHM_CLOCK_MAX_RATE : 0);
+
+	status->offsetFromMaster = timeToNs(&ptpClock->currentDS.offsetFromMaster);
+	status->meanPathDelay = timeToNs(ptpClock->portDS.delayMechanism == P2P ?
+	    &ptpClock->portDS.peerMeanPathDelay : &ptpClock->currentDS.meanPathDelay);
+	status->observedDrift = ptpClock->servo.observedDrift;
+
+#ifdef PTPD_STATISTICS
+	if(ptpClock->servo.isStable) {
+		status->clockFlags |= STATUSSHM_CLOCK_STABLE;
+	}
+	status->statsValid = ptpClock->slaveStats.statsCalculated;
+	status->ofmMean = ptpClock->slaveStats.ofmMean;
+	status->ofmStdDev = ptpClock->slaveStats.ofmStdDev;
+	status->mpdMean = ptpClock->slaveStats.mpdMean;
+	status->mpdStdDev = ptpClock->slaveStats.mpdStdDev;
+	status->driftMean = ptpClock->servo.driftMean;
+	status->driftStdDev = ptpClock->servo.driftStdDev;
+#endif /* PTPD_STATISTICS */
+
+	status->alarmsSet = 0;
+	status->alarmsCleared = 0;
+	for(i = 0; i < ALRM_MAX; i++) {
+		if(ptpClock->alarms[i].state == ALARM_SET) {
+			status->alarmsSet |= 1 << i;
+		} else if(ptpClock->alarms[i].state == ALARM_CLEARED) {
+			status->alarmsCleared |= 1 << i;
+		}
+	}
+	strncpy(status->alarms, alarmBuf, STATUSSHM_ALARMS_LEN - 1);
+
+	status->messageReceiveRate = ptpClock->counters.messageReceiveRate;
+	status->messageSendRate = ptpClock->counters.messageSendRate;
+	status->announceReceived = ptpClock->counters.announceMessagesReceived;
+	status->syncReceived = ptpClock->counters.syncMessagesReceived;
+	status->followUpReceived = ptpClock->counters.followUpMessagesReceived;
+	status->delayReqSent = ptpClock->counters.delayReqMessagesSent;
+	status->delayReqReceived = ptpClock->counters.delayReqMessagesReceived;
+	status->delayRespSent = ptpClock->counters.delayRespMessagesSent;
+	status->delayRespReceived = ptpClock->counters.delayRespMessagesReceived;
+	status->stateTransitions = ptpClock->counters.stateTransitions;
+	status->bestMasterChanges = ptpClock->counters.bestMasterChanges;
+	status->announceTimeouts = ptpClock->counters.announceTimeouts;
+	status->discardedMessages = ptpClock->counters.discardedMessages;
+	status->messageRecvErrors = ptpClock->counters.messageRecvErrors;
+	status->messageSendErrors = ptpClock->counters.messageSendErrors;
+
+	if(rtOpts->unicastNegotiation) {
+		status->slaveCount = ptpClock->slaveCount;
+	} else if(rtOpts->ipMode == IPMODE_UNICAST) {
+		status->slaveCount = ptpClock->unicastDestinationCount;
+	} else {
+		status->slaveCount = 0;
+	}
+
+	statusShmWriteEnd(statusShm);
+}
+
 #define STATUSPREFIX "%-19s:"
 void
 writeStatusFile(PtpClock *ptpClock,const RunTimeOpts *rtOpts, Boolean quiet)
@@ -1129,7 +1499,8 @@ writeStatusFile(PtpClock *ptpClock,const RunTimeOpts *rtOpts, Boolean quiet)
 		" (primary)" : "");
 	fprintf(out, 		STATUSPREFIX"  %s\n","Preset", dictionary_get(rtOpts->currentConfig, "ptpengine:preset", ""));
 	fprintf(out, 		STATUSPREFIX"  %s%s","Transport", dictionary_get(rtOpts->currentConfig, "ptpengine:transport", ""),
-		(rtOpts->transport==UDP_IPV4 && rtOpts->sysopts.pcap == TRUE)?" + libpcap":"");
+		(rtOpts->transport==UDP_IPV4 && rtOpts->sysopts.pcap == TRUE)?" + libpcap":
+		(rtOpts->transport==IEEE_802_3 && rtOpts->sysopts.packetMmap == TRUE)?" + packet mmap":"");
 
 	if(rtOpts->transport != IEEE_802_3) {
 	    fprintf(out,", %s", dictionary_get(rtOpts->currentConfig, "ptpengine:ip_mode", ""));
@@ -1404,6 +1775,16 @@ else {
 
 	fprintf(out,"\n");
 
+	if(ptpClock->portDS.portState == PTP_MASTER && rtOpts->ipMode == IPMODE_UNICAST &&
+	    rtOpts->transport == UDP_IPV4) {
+	fprintf(out, 		STATUSPREFIX"  ","Unicast pacing");
+	fprintf(out,"Sync %d in %d slots, burst %d max %d; Announce %d in %d slots, burst %d max %d\n",
+		    ptpClock->syncPacer.lastRound, ptpClock->syncPacer.lastSlots,
+		    ptpClock->syncPacer.lastBurst, ptpClock->syncPacer.maxBurst,
+		    ptpClock->announcePacer.lastRound, ptpClock->announcePacer.lastSlots,
+		    ptpClock->announcePacer.lastBurst, ptpClock->announcePacer.maxBurst);
+	}
+
 	if ( ptpClock->portDS.portState == PTP_SLAVE ||
 	    ptpClock->defaultDS.clockQuality.clockClass == 255 ) {
 
@@ -1503,6 +1884,95 @@ recordSync(UInteger16 sequenceId, TimeInternal * time)
 	}
 }
 
+/*
+ * Servo trace: one line per servo input, frequency adjustment and clock step,
+ * all times in nanoseconds, read back by replayServoTrace():
+ *   S <t1> <t2> <correction> <log sync interval>	Sync / Follow Up
+ *   D <t3> <t4> <correction>				Delay Response
+ *   F <local time> <adj ppb>				frequency adjustment applied
+ *   T <local time> <offset>				clock stepped by -offset
+ */
+
+static long long
+traceNanoseconds(const TimeInternal *time)
+{
+	return time->seconds * 1000000000LL + time->nanoseconds;
+}
+
+/* returns the trace stream, writing the trace prologue whenever the file was (re)opened */
+static FILE*
+getTraceStream()
+{
+	static FILE* lastFP = NULL;
+	LogFileHandler* trace = &logFiles[LOGFILE_TRACE];
+	TimeInternal now;
+	double adj = 0.0;
+
+	if(!trace->logEnabled || trace->logFP == NULL) {
+		return NULL;
+	}
+
+	if(trace->logFP != lastFP) {
+		lastFP = trace->logFP;
+		getTime(&now);
+#if defined(HAVE_SYS_TIMEX_H) && defined(PTPD_FEATURE_NTP)
+		adj = getAdjFreq();
+#endif /* defined(HAVE_SYS_TIMEX_H) && defined(PTPD_FEATURE_NTP) */
+		fprintf(lastFP, "# "PTPD_PROGNAME" servo trace\n");
+		fprintf(lastFP, "F %lld %.03f\n", traceNanoseconds(&now), adj);
+	}
+
+	return trace->logFP;
+}
+
+void
+traceServoSample(char type, const TimeInternal *send, const TimeInternal *recv,
+		 const TimeInternal *correction, Integer8 logInterval)
+{
+	FILE* out;
+
+	if((out = getTraceStream()) == NULL) {
+		return;
+	}
+
+	if(type == 'S') {
+		fprintf(out, "S %lld %lld %lld %d\n", traceNanoseconds(send), traceNanoseconds(recv),
+			traceNanoseconds(correction), logInterval);
+	} else {
+		fprintf(out, "%c %lld %lld %lld\n", type, traceNanoseconds(send), traceNanoseconds(recv),
+			traceNanoseconds(correction));
+	}
+	maintainLogSize(&logFiles[LOGFILE_TRACE]);
+}
+
+void
+traceServoAdjustment(double adj)
+{
+	FILE* out;
+	TimeInternal now;
+
+	if((out = getTraceStream()) == NULL) {
+		return;
+	}
+
+	getTime(&now);
+	fprintf(out, "F %lld %.03f\n", traceNanoseconds(&now), adj);
+	maintainLogSize(&logFiles[LOGFILE_TRACE]);
+}
+
+void
+traceServoStep(const TimeInternal *when, const TimeInternal *offset)
+{
+	FILE* out;
+
+	if((out = getTraceStream()) == NULL) {
+		return;
+	}
+
+	fprintf(out, "T %lld %lld\n", traceNanoseconds(when), traceNanoseconds(offset));
+	maintainLogSize(&logFiles[LOGFILE_TRACE]);
+}
+
 Boolean
 nanoSleep(TimeInternal * t)
 {
@@ -1551,6 +2021,9 @@ static const struct sigevent* timerIntHandler(void* data, int id) {
 
 void getTime(TimeInternal *time)
 {
+	if(clockBackendGetTime(time)) {
+		return;
+	}
 #ifdef __QNXNTO__
   static TimerIntData tmpData;
   int ret;
@@ -1628,6 +2101,9 @@ void getTime(TimeInternal *time)
 void
 getTimeMonotonic(TimeInternal * time)
 {
+	if(clockBackendGetTimeMonotonic(time)) {
+		return;
+	}
 #if defined(_POSIX_TIMERS) && (_POSIX_TIMERS > 0)
 	struct timespec tp;
 #  ifndef CLOCK_MONOTINIC
@@ -1652,6 +2128,10 @@ getTimeMonotonic(TimeInternal * time)
 void
 setTime(TimeInternal * time)
 {
+	if(clockBackendSetTime(time)) {
+		return;
+	}
+
 #if defined(_POSIX_TIMERS) && (_POSIX_TIMERS > 0)
 
 	struct timespec tp;
@@ -2099,6 +2579,10 @@ getAdjFreq(void)
 
 	DBGV("getAdjFreq called\n");
 
+	if(clockBackendGetAdjFreq(&dFreq)) {
+		return dFreq;
+	}
+
 	memset(&t, 0, sizeof(t));
 	t.modes = 0;
 	adjtimex(&t);
@@ -2812,6 +3296,97 @@ int setCpuAffinity(int cpu)
     return -1;
 }
 
+#ifdef PTPD_REALTIME
+/* write to every page of a buffer, so that it is mapped before the protocol needs it */
+static void
+prefaultMemory(void *buf, size_t len)
+{
+	volatile char *p = buf;
+	size_t page = sysconf(_SC_PAGESIZE);
+	size_t i;
+
+	if(buf == NULL || len == 0) {
+		return;
+	}
+
+	for(i = 0; i < len; i += page) {
+		p[i] = p[i];
+	}
+	p[len - 1] = p[len - 1];
+}
+
+/* grow the stack to its working size now rather than in the middle of a Sync */
+static void __attribute__((noinline))
+prefaultStack(void)
+{
+	volatile char stack[REALTIME_STACK_PREFAULT];
+	size_t page = sysconf(_SC_PAGESIZE);
+	size_t i;
+
+	for(i = 0; i < sizeof(stack); i += page) {
+		stack[i] = 0;
+	}
+}
+
+static void
+prefaultPtpClock(PtpClock *ptpClock)
+{
+	int i;
+
+	prefaultMemory(ptpClock, sizeof(PtpClock));
+
+	prefaultMemory(ptpClock->foreign, ptpClock->max_foreign_records * sizeof(ForeignMasterRecord));
+	prefaultMemory(ptpClock->foreignIndex.slots, ptpClock->foreignIndex.size * sizeof(int));
+
+	prefaultMemory(ptpClock->unicastGrants, ptpClock->unicastCapacity * sizeof(UnicastGrantTable));
+	prefaultMemory(ptpClock->unicastDestinations, ptpClock->unicastCapacity * sizeof(UnicastDestination));
+	prefaultMemory(ptpClock->syncDestTable.entry, ptpClock->syncDestTable.size * sizeof(SyncDestEntry));
+	prefaultMemory(ptpClock->syncPacer.order, 4 * ptpClock->unicastCapacity * sizeof(int));
+	for(i = 0; i < GRANT_INDEX_MAPS; i++) {
+		prefaultMemory(ptpClock->grantIndex.slots[i],
+			       ptpClock->grantIndex.size * sizeof(UnicastGrantTable*));
+	}
+}
+
+/*
+ * Real-time mode: run at a SCHED_FIFO priority, lock all memory, present and future,
+ * and fault in the stack and protocol data, so the protocol is neither preempted
+ * by ordinary processes nor held up by page faults. Threads started afterwards
+ * (the receive thread) inherit the scheduling policy. Each step is tried even if
+ * an earlier one failed.
+ */
+static Boolean
+setRealtime(const RunTimeOpts *rtOpts, PtpClock *ptpClock)
+{
+	struct sched_param param;
+	Boolean ret = TRUE;
+
+	memset(&param, 0, sizeof(param));
+	param.sched_priority = rtOpts->sysopts.realtimePriority;
+
+	if(sched_setscheduler(0, SCHED_FIFO, &param) < 0) {
+		PERROR("Could not set SCHED_FIFO scheduling with priority %d",
+		       rtOpts->sysopts.realtimePriority);
+		ret = FALSE;
+	}
+
+	if(mlockall(MCL_CURRENT | MCL_FUTURE) < 0) {
+		PERROR("Could not lock "PTPD_PROGNAME" memory");
+		ret = FALSE;
+	}
+
+	prefaultStack();
+	prefaultPtpClock(ptpClock);
+
+	if(ret) {
+		INFO("Running with SCHED_FIFO priority %d and memory locked\n",
+		     rtOpts->sysopts.realtimePriority);
+	}
+
+	return ret;
+}
+#endif /* PTPD_REALTIME */
+
  /*
  * Synchronous signal processing:
  * original idea: http://www.openbsd.org/cgi-bin/cvsweb/src/usr.sbin/ntpd/ntpd.c?rev=1.68;content-type=text%2Fplain
@@ -3040,6 +3615,13 @@ sysPrePtpClockInit(RunTimeOpts* rtOpts, Integer16* ret)
 	}
 #endif
 
+	/* the servo drives a software oscillator instead of the system clock */
+	if(rtOpts->clockBackend == CLOCKBACKEND_SIMULATED &&
+	    !clockSimSetup(&rtOpts->clockSimConfig, rtOpts->servoMaxPpb)) {
+		*ret = 1;
+		return FALSE;
+	}
+
 	/* establish signal handlers */
 	signal(SIGINT,  catchSignals);
 	signal(SIGTERM, catchSignals);
@@ -3069,6 +3651,17 @@ sysPostPtpClockInit(RunTimeOpts* rtOpts, PtpClock* ptpClock, Integer16* ret)
 		}
 	}
 
+	/* after daemon(): memory locks are not inherited across fork() */
+	if(rtOpts->sysopts.realtime) {
+#ifdef PTPD_REALTIME
+		if(!setRealtime(rtOpts, ptpClock)) {
+			WARNING("Real-time mode only partly enabled\n");
+		}
+#else
+		WARNING("Real-time mode not supported on this platform\n");
+#endif /* PTPD_REALTIME */
+	}
+
 	*ret = 0;
 	return TRUE;
 }
@@ -0,0 +1,714 @@
+/*-
+ * Copyright (c) 2015 Wojciech Owczarek,
+ *
+ * All Rights Reserved
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHORS ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE AUTHORS OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+ * OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
+ * IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+/**
+ * @file   net.c
+ * @date   Sun Oct 18 19:20:44 2026
+ *
+ * @brief  NetPath on top of the simulated network
+ *
+ * The network simulator's counterpart of port_posix/net.c. Interfaces
+ * are the simulated nodes (sim0, sim1...), datagrams go through the
+ * simulated network, receive timestamps are the virtual arrival times
+ * and every event message sent produces a transmit timestamp at the
+ * virtual time of sending, the way SO_TIMESTAMPING hands them back.
+ * Only UDP/IPv4 is simulated. Nothing here blocks: netSelect() reports
+ * what has already arrived.
+ */
+
+#ifdef HAVE_CONFIG_H
+#  include <config.h>
+#endif /* HAVE_CONFIG_H */
+
+#include <sys/types.h>
+#include <sys/select.h>
+#include <stdint.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <arpa/inet.h>
+
+#include "constants.h"
+#include "dep/constants_dep.h"
+#include "ptp_primitives.h"
+#include "dep/ipv4_acl.h"
+#include "ptp_datatypes.h"
+#include "dep/net.h"
+#include "datatypes.h"
+#include "ptpd_logging.h"
+#include "dep/netsim.h"
+
+/* descriptor numbers netSelect() uses to flag the two ports */
+#define NETSIM_EVENT_FD		0
+#define NETSIM_GENERAL_FD	1
+
+/* transmit timestamps waiting to be picked up - at least this many */
+#define NETSIM_TX_QUEUE_MIN	64
+
+typedef struct NetPath {
+	int node;		/* -1 when not initialised */
+	Boolean runningBackupInterface;
+
+	struct ether_addr interfaceID;
+	struct in_addr interfaceAddr;
+
+	Integer32 lastSourceAddr;
+	Integer32 lastDestAddr;
+
+	uint64_t sentPackets;
+	uint64_t sentPacketsTotal;
+	uint64_t receivedPackets;
+	uint64_t receivedPacketsTotal;
+
+	Ipv4AccessList* timingAcl;
+	Ipv4AccessList* managementAcl;
+
+	NetTxTimestamp *txQueue;
+	int txSize;
+	int txHead;
+	int txCount;
+
+	/* queued messages are sent right away - these count them until the flush */
+	int eventSent;
+	int eventFailed;
+	int generalSent;
+	int generalFailed;
+} NetPath;
+
+static void
+netTxQueueAdd(NetPath *netPath, const Octet *buf, UInteger16 length, Integer32 destination)
+{
+	NetTxTimestamp *entry;
+	UInteger16 sequenceId, portNumber;
+
+	if(netPath->txQueue == NULL) {
+		return;
+	}
+
+	/* nobody collected them - drop the oldest */
+	if(netPath->txCount == netPath->txSize) {
+		DBG("netTxQueueAdd: transmit timestamp queue full\n");
+		netPath->txHead = (netPath->txHead + 1) % netPath->txSize;
+		netPath->txCount--;
+	}
+
+	entry = &netPath->txQueue[(netPath->txHead + netPath->txCount) % netPath->txSize];
+	netPath->txCount++;
+
+	memcpy(&sequenceId, buf + 30, sizeof(sequenceId));
+
+	entry->destination = destination;
+	entry->sequenceId = ntohs(sequenceId);
+	entry->messageType = buf[0] & 0x0F;
+	memset(&entry->requestingPortIdentity, 0, sizeof(PortIdentity));
+	if(entry->messageType == PDELAY_RESP && length >= PDELAY_RESP_LENGTH) {
+		memcpy(entry->requestingPortIdentity.clockIdentity, buf + 44, CLOCK_IDENTITY_LENGTH);
+		memcpy(&portNumber, buf + 52, sizeof(portNumber));
+		entry->requestingPortIdentity.portNumber = ntohs(portNumber);
+	}
+	entry->timestamp.seconds = netSimNow() / 1000000000LL;
+	entry->timestamp.nanoseconds = netSimNow() % 1000000000LL;
+}
+
+static ssize_t
+netSimSendPacket(Octet * buf, UInteger16 length, NetPath * netPath, Integer32 destination, Boolean event)
+{
+	if(netPath->node < 0) {
+		return -1;
+	}
+
+	/* see port_posix/net.c: unicast messages carry the UNICAST flag */
+	if(destination) {
+		*(char *)(buf + 6) |= PTP_UNICAST;
+	}
+
+	if(!netSimSend(netPath->node, buf, length, destination, event)) {
+		DBG("Error sending %s message\n", event ? "event" : "general");
+		return 0;
+	}
+
+	netPath->sentPackets++;
+	netPath->sentPacketsTotal++;
+
+	if(event) {
+		netTxQueueAdd(netPath, buf, length, destination);
+	}
+
+	return length;
+}
+
+static ssize_t
+netSimRecvPacket(Octet * buf, TimeInternal * time, NetPath * netPath, Boolean event)
+{
+	NetSimPacket *packet;
+	ssize_t ret;
+
+	netPath->lastDestAddr = 0;
+
+	if(netPath->node < 0 || !(packet = netSimReceive(netPath->node, event))) {
+		return 0;
+	}
+
+	memset(buf, 0, PACKET_SIZE);
+	memcpy(buf, packet->data, packet->length);
+	ret = packet->length;
+
+	netPath->lastSourceAddr = packet->source;
+	netPath->lastDestAddr = packet->destination;
+	netPath->receivedPackets++;
+	netPath->receivedPacketsTotal++;
+
+	if(time != NULL) {
+		time->seconds = packet->arrival / 1000000000LL;
+		time->nanoseconds = packet->arrival % 1000000000LL;
+	}
+
+	netSimRelease(packet);
+
+	return ret;
+}
+
+Boolean
+hostLookup(const char* hostname, Integer32* addr)
+{
+	struct in_addr netAddr;
+
+	/* no name service in the simulation */
+	if(hostname[0] && inet_aton(hostname, &netAddr)) {
+		*addr = netAddr.s_addr;
+		return TRUE;
+	}
+
+	ERROR("failed to encode unicast address: %s\n", hostname);
+	return FALSE;
+}
+
+/* parse a list of hosts to a list of IP addresses - see port_posix/net.c */
+static int
+parseUnicastConfig(const RunTimeOpts *rtOpts, int maxCount, UnicastDestination * output)
+{
+	char* token;
+	char* stash;
+	char* text_;
+	char* text__;
+	int found = 0;
+	int total = 0;
+	int tmp;
+
+	if(strlen(rtOpts->sysopts.unicastDestinations) == 0) {
+		return 0;
+	}
+
+	text_ = strdup(rtOpts->sysopts.unicastDestinations);
+
+	for(text__ = text_; found < maxCount; text__ = NULL) {
+		token = strtok_r(text__, ", ;\t", &stash);
+		if(token == NULL) {
+			break;
+		}
+		if(hostLookup(token, &output[found].transportAddress)) {
+			found++;
+		}
+	}
+
+	free(text_);
+	total = found;
+
+	text_ = strdup(rtOpts->sysopts.unicastDomains);
+
+	for(found = 0, text__ = text_; found < total; text__ = NULL) {
+		token = strtok_r(text__, ", ;\t", &stash);
+		if(token == NULL) {
+			break;
+		}
+		if(sscanf(token, "%d", &tmp) == 1) {
+			output[found].domainNumber = tmp;
+			found++;
+		}
+	}
+
+	free(text_);
+
+	text_ = strdup(rtOpts->sysopts.unicastLocalPreference);
+
+	for(found = 0, text__ = text_; found < total; text__ = NULL) {
+		token = strtok_r(text__, ", ;\t", &stash);
+		tmp = LOWEST_LOCALPREFERENCE;
+		if(token != NULL && sscanf(token, "%d", &tmp) != 1) {
+			tmp = LOWEST_LOCALPREFERENCE;
+		}
+		output[found].localPreference = tmp;
+		found++;
+	}
+
+	free(text_);
+
+	return total;
+}
+
+Boolean
+testInterface(const char * ifaceName, const RunTimeOpts* rtOpts)
+{
+	if(netSimNodeFromName(ifaceName) < 0) {
+		ERROR("Interface %s is not a simulated interface\n", ifaceName);
+		return FALSE;
+	}
+
+	if(rtOpts->transport != UDP_IPV4) {
+		ERROR("Only UDP/IPv4 transport is simulated\n");
+		return FALSE;
+	}
+
+	return TRUE;
+}
+
+Boolean
+netShutdown(NetPath * netPath)
+{
+	netSimAttach(netPath->node, FALSE);
+	netPath->node = -1;
+	netPath->txHead = netPath->txCount = 0;
+
+	freeIpv4AccessList(&netPath->timingAcl);
+	freeIpv4AccessList(&netPath->managementAcl);
+
+	return TRUE;
+}
+
+Boolean
+netInit(NetPath * netPath, const RunTimeOpts * rtOpts, PtpClock * ptpClock)
+{
+	const char *ifaceName = netPathGetInterfaceName(netPath, rtOpts);
+	uint8_t *mac = ether_addr_octet(&netPath->interfaceID);
+	int node;
+	int txSize;
+
+	DBG("netInit\n");
+
+	if(!testInterface(ifaceName, rtOpts)) {
+		return FALSE;
+	}
+
+	node = netSimNodeFromName(ifaceName);
+
+	netPath->interfaceAddr.s_addr = netSimNodeAddress(node);
+
+	/* locally administered, and unique per node */
+	memset(mac, 0, ETHER_ADDR_LEN);
+	mac[0] = 0x02;
+	mac[3] = (node >> 16) & 0xFF;
+	mac[4] = (node >> 8) & 0xFF;
+	mac[5] = node & 0xFF;
+
+	DBG("Listening on IP: %s\n", inet_ntoa(netPath->interfaceAddr));
+
+	if(rtOpts->unicastDestinationsSet) {
+		ptpClock->unicastDestinationCount = parseUnicastConfig(rtOpts,
+			ptpClock->unicastCapacity, ptpClock->unicastDestinations);
+		DBG("configured %d unicast destinations\n", ptpClock->unicastDestinationCount);
+	}
+
+	if(rtOpts->delayMechanism == P2P && rtOpts->ipMode == IPMODE_UNICAST) {
+		ptpClock->unicastPeerDestination.transportAddress = 0;
+		if(!rtOpts->unicastPeerDestinationSet) {
+			ERROR("No P2P unicast destination specified\n");
+			return FALSE;
+		}
+		if(!hostLookup(rtOpts->sysopts.unicastPeerDestination,
+			       &ptpClock->unicastPeerDestination.transportAddress)) {
+			ERROR("Could not parse P2P unicast destination %s:\n",
+				rtOpts->sysopts.unicastPeerDestination);
+			return FALSE;
+		}
+	}
+
+	/* as many as the unicast table could have sent in one go */
+	txSize = 2 * ptpClock->unicastCapacity;
+	if(txSize < NETSIM_TX_QUEUE_MIN) {
+		txSize = NETSIM_TX_QUEUE_MIN;
+	}
+	if(txSize != netPath->txSize) {
+		free(netPath->txQueue);
+		if(!(netPath->txQueue = calloc(txSize, sizeof(NetTxTimestamp)))) {
+			netPath->txSize = 0;
+			return FALSE;
+		}
+		netPath->txSize = txSize;
+	}
+	netPath->txHead = netPath->txCount = 0;
+
+	netPath->node = node;
+	netSimAttach(node, TRUE);
+
+	netInitializeACLs(netPath, rtOpts);
+
+	return TRUE;
+}
+
+void netInitializeACLs(NetPath* netPath, const RunTimeOpts* rtOpts)
+{
+	if(rtOpts->sysopts.timingAclEnabled) {
+		freeIpv4AccessList(&netPath->timingAcl);
+		netPath->timingAcl=createIpv4AccessList(rtOpts->sysopts.timingAclPermitText,
+							rtOpts->sysopts.timingAclDenyText,
+							rtOpts->sysopts.timingAclOrder);
+	}
+	if(rtOpts->sysopts.managementAclEnabled) {
+		freeIpv4AccessList(&netPath->managementAcl);
+		netPath->managementAcl=createIpv4AccessList(rtOpts->sysopts.managementAclPermitText,
+							    rtOpts->sysopts.managementAclDenyText,
+							    rtOpts->sysopts.managementAclOrder);
+	}
+}
+
+/* simulated links carry PTP only, and the protocol discards the rest */
+void
+netUpdateFilter(NetPath *netPath, const RunTimeOpts *rtOpts, const PtpClock *ptpClock)
+{
+}
+
+/* report what has arrived so far - virtual time does not pass in here */
+int
+netSelect(TimeInternal * timeout, NetPath * netPath, fd_set *readfds)
+{
+	int ret = 0;
+
+	if(netPath->node < 0) {
+		return 0;
+	}
+
+	FD_ZERO(readfds);
+
+	if(netSimPending(netPath->node, TRUE)) {
+		FD_SET(NETSIM_EVENT_FD, readfds);
+		ret++;
+	}
+
+	if(netSimPending(netPath->node, FALSE)) {
+		FD_SET(NETSIM_GENERAL_FD, readfds);
+		ret++;
+	}
+
+	return ret;
+}
+
+ssize_t
+netRecvEvent(Octet * buf, TimeInternal * time, NetPath * netPath, int flags, Boolean* did_timeout)
+{
+	if(did_timeout) {
+		*did_timeout = FALSE;
+	}
+
+	return netSimRecvPacket(buf, time, netPath, TRUE);
+}
+
+ssize_t
+netRecvGeneral(Octet * buf, NetPath * netPath, Boolean* did_timeout)
+{
+	if(did_timeout) {
+		*did_timeout = FALSE;
+	}
+
+	return netSimRecvPacket(buf, NULL, netPath, FALSE);
+}
+
+ssize_t
+netSendEvent(Octet * buf, UInteger16 length, NetPath * netPath,
+	     const RunTimeOpts *rtOpts, Integer32 destinationAddress, TimeInternal * tim)
+{
+	return netSimSendPacket(buf, length, netPath, destinationAddress, TRUE);
+}
+
+ssize_t
+netSendGeneral(Octet * buf, UInteger16 length, NetPath * netPath,
+	       const RunTimeOpts *rtOpts, Integer32 destinationAddress)
+{
+	return netSimSendPacket(buf, length, netPath, destinationAddress, FALSE);
+}
+
+/* there is a single simulated segment, so the peer group is everyone */
+ssize_t
+netSendPeerGeneral(Octet * buf, UInteger16 length, NetPath * netPath, const RunTimeOpts *rtOpts, Integer32 dst)
+{
+	return netSimSendPacket(buf, length, netPath, dst, FALSE);
+}
+
+ssize_t
+netSendPeerEvent(Octet * buf, UInteger16 length, NetPath * netPath, const RunTimeOpts *rtOpts, Integer32 dst, TimeInternal * tim)
+{
+	return netSimSendPacket(buf, length, netPath, dst, TRUE);
+}
+
+/* a batch leaves at a single virtual instant - just send it straight away */
+void
+netQueueEvent(Octet * buf, UInteger16 length, NetPath * netPath, Integer32 destinationAddress)
+{
+	if(netSimSendPacket(buf, length, netPath, destinationAddress, TRUE) > 0) {
+		netPath->eventSent++;
+	} else {
+		netPath->eventFailed++;
+	}
+}
+
+void
+netQueueGeneral(Octet * buf, UInteger16 length, NetPath * netPath, Integer32 destinationAddress)
+{
+	if(netSimSendPacket(buf, length, netPath, destinationAddress, FALSE) > 0) {
+		netPath->generalSent++;
+	} else {
+		netPath->generalFailed++;
+	}
+}
+
+int
+netFlushEvent(NetPath * netPath, int * failed)
+{
+	int sent = netPath->eventSent;
+
+	*failed = netPath->eventFailed;
+	netPath->eventSent = 0;
+	netPath->eventFailed = 0;
+
+	return sent;
+}
+
+int
+netFlushGeneral(NetPath * netPath, int * failed)
+{
+	int sent = netPath->generalSent;
+
+	*failed = netPath->generalFailed;
+	netPath->generalSent = 0;
+	netPath->generalFailed = 0;
+
+	return sent;
+}
+
+/* transmit timestamps are queued as the messages are sent */
+void
+netProcessTxTimestamps(NetPath * netPath)
+{
+}
+
+Boolean
+netGetTxTimestamp(NetPath * netPath, NetTxTimestamp * txTimestamp)
+{
+	if(netPath->txCount == 0) {
+		return FALSE;
+	}
+
+	*txTimestamp = netPath->txQueue[netPath->txHead];
+	netPath->txHead = (netPath->txHead + 1) % netPath->txSize;
+	netPath->txCount--;
+
+	return TRUE;
+}
+
+Boolean
+netRefreshIGMP(NetPath * netPath, const RunTimeOpts * rtOpts, PtpClock * ptpClock)
+{
+	return TRUE;
+}
+
+struct ether_addr netPathGetMacAddress(const NetPath* netPath)
+{
+	return netPath->interfaceID;
+}
+
+struct in_addr netPathGetInterfaceAddr(const NetPath* netPath)
+{
+	return netPath->interfaceAddr;
+}
+
+int netPathGetInterfaceIndex(const NetPath* netPath)
+{
+	return netPath->node + 1;
+}
+
+Integer32 netPathGetLastSourceAddress(const NetPath* netPath)
+{
+	return netPath->lastSourceAddr;
+}
+
+Integer32 netPathGetLastDestAddress(const NetPath* netPath)
+{
+	return netPath->lastDestAddr;
+}
+
+Ipv4AccessList* netPathGetManagementACL(const NetPath* netPath)
+{
+	return netPath->managementAcl;
+}
+
+Ipv4AccessList* netPathGetTimingACL(const NetPath* netPath)
+{
+	return netPath->timingAcl;
+}
+
+Boolean netPathCheckTxTsValid(const NetPath* netPath)
+{
+	return TRUE;
+}
+
+uint64_t netPathGetSentPacketCount(const NetPath* netPath)
+{
+	return netPath->sentPackets;
+}
+
+void netPathResetSentPacketCount(NetPath* netPath)
+{
+	netPath->sentPackets = 0;
+}
+
+uint64_t netPathGetReceivedPacketCount(const NetPath* netPath)
+{
+	return netPath->receivedPackets;
+}
+
+void netPathResetReceivedPacketCount(NetPath* netPath)
+{
+	netPath->receivedPackets = 0;
+}
+
+void netPathIncReceivedPacketCount(NetPath* netPath)
+{
+	netPath->receivedPackets++;
+}
+
+uint64_t netPathGetTotalSentPacketCount(const NetPath* netPath)
+{
+	return netPath->sentPacketsTotal;
+}
+
+uint64_t netPathGetTotalReceivedPacketsCount(const NetPath* netPath)
+{
+	return netPath->receivedPacketsTotal;
+}
+
+void netPathClearSockets(NetPath* netPath)
+{
+}
+
+void netPathSetWakeupFd(NetPath* netPath, int fd)
+{
+}
+
+Boolean netPathEventPending(const NetPath* netPath)
+{
+	return netSimPending(netPath->node, TRUE);
+}
+
+Boolean netPathGeneralPending(const NetPath* netPath)
+{
+	return netSimPending(netPath->node, FALSE);
+}
+
+Boolean netPathTxTimestampsPending(const NetPath* netPath)
+{
+	return netPath->txCount > 0;
+}
+
+Boolean netPathEventSocketIsSet(const NetPath* netPath, fd_set* fds)
+{
+	return FD_ISSET(NETSIM_EVENT_FD, fds);
+}
+
+Boolean netPathGeneralSocketIsSet(const NetPath* netPath, fd_set* fds)
+{
+	return FD_ISSET(NETSIM_GENERAL_FD, fds);
+}
+
+void
+netPath_display(const NetPath* netPath)
+{
+	DBGV("simulated node : %d \n", netPath->node);
+}
+
+void netPathFree(NetPath** netPath)
+{
+	if(*netPath == NULL)
+		return;
+
+	free((*netPath)->txQueue);
+	free(*netPath);
+	*netPath = NULL;
+}
+
+NetPath* netPathCreate(const RunTimeOpts* rtOpts)
+{
+	NetPath* netPath = (NetPath*)calloc(1, sizeof(NetPath));
+
+	if(netPath != NULL) {
+		netPath->node = -1;
+	}
+
+	return netPath;
+}
+
+const char* netPathGetInterfaceName(const NetPath* netPath, const RunTimeOpts* rtOpts)
+{
+	if(rtOpts->sysopts.backupIfaceEnabled &&
+	   netPath->runningBackupInterface) {
+		return rtOpts->sysopts.backupIfaceName;
+	} else {
+		return rtOpts->sysopts.primaryIfaceName;
+	}
+}
+
+void netPathToggleUsePrimaryIf(NetPath* netPath)
+{
+	netPath->runningBackupInterface = !netPath->runningBackupInterface;
+}
+
+void netPathSetUsePrimaryIf(NetPath* netPath, Boolean use_primary)
+{
+	netPath->runningBackupInterface = !use_primary;
+}
+
+Boolean netPathGetUsePrimaryIf(const NetPath* netPath)
+{
+	return !netPath->runningBackupInterface;
+}
+
+const char* netGetInterfaceNameFromIndex(const RunTimeOpts* rtOpts, int index)
+{
+	switch(index) {
+	case 0: // Primary
+		return rtOpts->sysopts.primaryIfaceName;
+	case 1: // Secondary
+		return rtOpts->sysopts.backupIfaceName;
+	default:
+		return "{INV}";
+	}
+}
+
+Boolean netHasBackupInterface(const RunTimeOpts* rtOpts)
+{
+	return rtOpts->sysopts.backupIfaceEnabled;
+}
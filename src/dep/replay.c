@@ -0,0 +1,455 @@
+/*-
+ * Copyright (c) 2015      Wojciech Owczarek,
+ *
+ * All Rights Reserved
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHORS ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE AUTHORS OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+ * OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
+ * IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/**
+ * @file   replay.c
+ * @date   Sun Oct 18 10:12:40 2026
+ *
+ * @brief  Offline servo trace replay and the virtual clock it runs against
+ *
+ * A trace written with global:servo_trace_file holds the timestamps the
+ * servo was fed (Sync t1/t2, Delay t3/t4, correction), plus every
+ * frequency adjustment and step applied to the clock. Replay pushes the
+ * samples through updateOffset() / updateDelay() / updateClock() as fast
+ * as they can be read. The clock those functions see is virtual: it
+ * follows the recorded clock, plus the integral of the difference between
+ * the frequency the replayed servo applies and the one that was recorded,
+ * plus any difference in steps. Timestamps taken from the local clock
+ * (t2, t3) are moved onto the virtual clock; t1 and t4 are used as is.
+ * The virtual clock is installed as the clock backend for the duration
+ * of the replay.
+ */
+
+#ifdef HAVE_CONFIG_H
+#  include <config.h>
+#endif /* HAVE_CONFIG_H */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+
+#include "constants.h"
+#include "dep/constants_dep.h"
+#include "ptp_primitives.h"
+#include "ptp_datatypes.h"
+#include "ptp_timers.h"
+#include "arith.h"
+#include "datatypes.h"
+#include "bmc.h" // For initData, freeForeignMasterTable
+#include "protocol.h" // For toState
+#include "signaling.h" // For freeUnicastGrantTable
+#include "dep/net.h"
+#include "dep/servo.h"
+#include "dep/startup.h" // For ptpClockCreate
+#include "dep/sys.h"
+#include "dep/clockbackend.h"
+#include "dep/replay.h"
+#include "ptpd_logging.h"
+
+#define REPLAY_LINE_MAX 256
+
+/* virtual clock state, all times in recorded local clock nanoseconds */
+typedef struct {
+	long long now;		/* timestamp of the sample being processed */
+	long long anchor;	/* last time the frequency difference was integrated */
+	double delta;		/* replayed clock minus recorded clock, ns */
+	double recordedAdj;	/* frequency the recorded servo had applied, ppb */
+	double replayAdj;	/* frequency the replayed servo has applied, ppb */
+	double maxAdj;
+} ReplayClock;
+
+static ReplayClock replayClock;
+static ClockBackend replayBackend;
+
+static void
+nsToInternal(long long ns, TimeInternal *time)
+{
+	/* C division truncates, so seconds and nanoseconds keep the same sign */
+	time->seconds = ns / 1000000000LL;
+	time->nanoseconds = ns % 1000000000LL;
+}
+
+static long long
+internalToNs(const TimeInternal *time)
+{
+	return (long long)time->seconds * 1000000000LL + time->nanoseconds;
+}
+
+/* replayed minus recorded clock at recorded time t */
+static double
+deltaAt(long long t)
+{
+	return replayClock.delta + (replayClock.replayAdj - replayClock.recordedAdj) *
+		(t - replayClock.anchor) / 1E9;
+}
+
+static void
+advanceTo(long long t)
+{
+	if(t > replayClock.anchor) {
+		replayClock.delta = deltaAt(t);
+		replayClock.anchor = t;
+	}
+}
+
+static long long
+toReplayed(long long t)
+{
+	return t + (long long)deltaAt(t);
+}
+
+static Boolean
+replayGetTime(ClockBackend *backend, TimeInternal *time)
+{
+	nsToInternal(toReplayed(replayClock.now), time);
+	return TRUE;
+}
+
+static Boolean
+replayGetTimeMonotonic(ClockBackend *backend, TimeInternal *time)
+{
+	nsToInternal(replayClock.now, time);
+	return TRUE;
+}
+
+static Boolean
+replaySetTime(ClockBackend *backend, const TimeInternal *time)
+{
+	long long current;
+
+	advanceTo(replayClock.now);
+	current = toReplayed(replayClock.now);
+	replayClock.delta += internalToNs(time) - current;
+	INFO("Replay: stepped the virtual clock by %lld ns\n", internalToNs(time) - current);
+	return TRUE;
+}
+
+static Boolean
+replayAdjFreq(ClockBackend *backend, double adj)
+{
+	if(adj > replayClock.maxAdj) {
+		adj = replayClock.maxAdj;
+	} else if(adj < -replayClock.maxAdj) {
+		adj = -replayClock.maxAdj;
+	}
+
+	advanceTo(replayClock.now);
+	replayClock.replayAdj = adj;
+	return TRUE;
+}
+
+static Boolean
+replayGetAdjFreq(ClockBackend *backend, double *adj)
+{
+	*adj = replayClock.replayAdj;
+	return TRUE;
+}
+
+/* put the clock into the state the protocol engine would leave it in before the first Sync */
+static Boolean
+replaySetup(RunTimeOpts *rtOpts, PtpClock **ptpClockOut)
+{
+	extern PtpClock *G_ptpClock;
+	extern Boolean startupInProgress;
+	PtpClock *ptpClock;
+	Integer16 ret = 0;
+
+	if(!(ptpClock = ptpClockCreate(rtOpts, &ret, NULL))) {
+		return FALSE;
+	}
+
+	/* global variable for message(), now it can name the port */
+	G_ptpClock = ptpClock;
+	startupInProgress = FALSE;
+
+	initData(rtOpts, ptpClock);
+	initClock(rtOpts, ptpClock);
+	setupPIservo(&ptpClock->servo, rtOpts);
+
+	ptpClock->clockControl.available = TRUE;
+	ptpClock->clockControl.granted = TRUE;
+
+	if(ptpClock->defaultDS.clockQuality.clockClass > 127) {
+		restoreDrift(ptpClock, rtOpts, FALSE);
+	}
+
+	*ptpClockOut = ptpClock;
+	return TRUE;
+}
+
+static void
+replayTeardown(RunTimeOpts *rtOpts, PtpClock *ptpClock)
+{
+	extern PtpClock *G_ptpClock;
+	extern Boolean startupInProgress;
+
+	/*
+	 * not ptpdShutdown(): there is no network to shut down, and it would
+	 * remove the lock file of a daemon that may be running on this host
+	 */
+	timerShutdown(ptpClock->timers);
+	netPathFree(&ptpClock->netPath);
+	freeForeignMasterTable(ptpClock);
+	freeUnicastGrantTable(ptpClock);
+
+#ifdef PTPD_STATISTICS
+	ptpClock->oFilterMS.shutdown(&ptpClock->oFilterMS);
+	ptpClock->oFilterSM.shutdown(&ptpClock->oFilterSM);
+	freeDoubleMovingStatFilter(&ptpClock->filterMS);
+	freeDoubleMovingStatFilter(&ptpClock->filterSM);
+#endif /* PTPD_STATISTICS */
+
+	startupInProgress = TRUE;
+	free(ptpClock);
+	G_ptpClock = NULL;
+
+	if (rtOpts->currentConfig != NULL)
+		dictionary_del(&rtOpts->currentConfig);
+	if(rtOpts->cliConfig != NULL)
+		dictionary_del(&rtOpts->cliConfig);
+}
+
+/* the first F line carries the frequency the clock had when recording started */
+static Boolean
+readInitialState(FILE *fp)
+{
+	char line[REPLAY_LINE_MAX];
+	long long t;
+	double adj;
+	char type;
+
+	while(fgets(line, sizeof(line), fp) != NULL) {
+		if(line[0] == '#' || line[0] == '\n') {
+			continue;
+		}
+		if(sscanf(line, "%c %lld", &type, &t) != 2) {
+			continue;
+		}
+		replayClock.now = t;
+		replayClock.anchor = t;
+		if(type == 'F' && sscanf(line, "%c %lld %lf", &type, &t, &adj) == 3) {
+			replayClock.recordedAdj = adj;
+			replayClock.replayAdj = adj;
+		}
+		rewind(fp);
+		return TRUE;
+	}
+
+	return FALSE;
+}
+
+int
+replayServoTrace(RunTimeOpts *rtOpts)
+{
+	PtpClock *ptpClock = NULL;
+	FILE *fp;
+	char line[REPLAY_LINE_MAX];
+	char type;
+	long long a, b, c;
+	int interval;
+	double adj;
+	long lineNo = 0;
+	long syncCount = 0, delayCount = 0, adjCount = 0, stepCount = 0, badCount = 0;
+	long long firstSample = 0, lastSample = 0;
+	TimeInternal wallStart, wallEnd, wallTime, correction;
+#ifdef PTPD_STATISTICS
+	long long nextStatsUpdate = 0;
+#endif /* PTPD_STATISTICS */
+
+	if((fp = fopen(rtOpts->replayFile, "r")) == NULL) {
+		PERROR("Could not open servo trace %s", rtOpts->replayFile);
+		return 1;
+	}
+
+	/* a replay must never write to the trace it is reading, the drift file or the network */
+	rtOpts->sysopts.traceLogConfig.logInitiallyEnabled = FALSE;
+	if(rtOpts->sysopts.drift_recovery_method == DRIFT_FILE) {
+		rtOpts->sysopts.drift_recovery_method = DRIFT_KERNEL;
+	}
+	rtOpts->logStatistics = TRUE;
+	rtOpts->do_IGMP_refresh = FALSE;
+
+	initLogging(rtOpts);
+	restartLogging();
+
+	memset(&replayClock, 0, sizeof(replayClock));
+	replayClock.maxAdj = rtOpts->servoMaxPpb;
+
+	if(!readInitialState(fp)) {
+		ERROR("Servo trace %s contains no samples\n", rtOpts->replayFile);
+		fclose(fp);
+		stopLogging(rtOpts);
+		return 1;
+	}
+
+	NOTICE("Replaying servo trace %s\n", rtOpts->replayFile);
+
+	getTimeMonotonic(&wallStart);
+
+	memset(&replayBackend, 0, sizeof(ClockBackend));
+	strncpy(replayBackend.id, "replay", CLOCKBACKEND_MAX_DESC);
+	replayBackend.data = &replayClock;
+	replayBackend.getTime = replayGetTime;
+	replayBackend.getTimeMonotonic = replayGetTimeMonotonic;
+	replayBackend.setTime = replaySetTime;
+	replayBackend.adjFreq = replayAdjFreq;
+	replayBackend.getAdjFreq = replayGetAdjFreq;
+	clockBackendInstall(&replayBackend);
+
+	if(!replaySetup(rtOpts, &ptpClock)) {
+		ERROR("Could not set up the protocol engine for replay\n");
+		clockBackendInstall(NULL);
+		fclose(fp);
+		stopLogging(rtOpts);
+		return 2;
+	}
+
+	while(fgets(line, sizeof(line), fp) != NULL) {
+
+		lineNo++;
+
+		if(line[0] == '#' || line[0] == '\n') {
+			continue;
+		}
+
+		type = line[0];
+
+		switch(type) {
+
+		case 'F':
+			if(sscanf(line, "%c %lld %lf", &type, &a, &adj) != 3) {
+				goto bad;
+			}
+			advanceTo(a);
+			replayClock.recordedAdj = adj;
+			adjCount++;
+			break;
+
+		case 'T':
+			if(sscanf(line, "%c %lld %lld", &type, &a, &b) != 3) {
+				goto bad;
+			}
+			/* the recorded clock moved by -offset; the virtual one only moves if the replay steps */
+			advanceTo(a);
+			replayClock.delta += b;
+			stepCount++;
+			break;
+
+		case 'S':
+			if(sscanf(line, "%c %lld %lld %lld %d", &type, &a, &b, &c, &interval) != 5) {
+				goto bad;
+			}
+
+			replayClock.now = b;
+			if(!syncCount) {
+				firstSample = b;
+			}
+			lastSample = b;
+
+			if(ptpClock->portDS.portState != PTP_SLAVE) {
+				toState(PTP_SLAVE, rtOpts, ptpClock);
+				ptpClock->clockControl.available = TRUE;
+				ptpClock->clockControl.granted = TRUE;
+			}
+
+			ptpClock->portDS.logSyncInterval = interval;
+			ptpClock->char_last_msg = 'S';
+
+			{
+				TimeInternal send;
+				nsToInternal(a, &send);
+				nsToInternal(toReplayed(b), &ptpClock->sync_receive_time);
+				nsToInternal(c, &correction);
+
+				updateOffset(&send, &ptpClock->sync_receive_time,
+					     &ptpClock->ofm_filt, rtOpts, ptpClock, &correction);
+			}
+
+			checkOffset(rtOpts, ptpClock);
+			if (ptpClock->clockControl.updateOK) {
+				ptpClock->acceptedUpdates++;
+				updateClock(rtOpts, ptpClock);
+			}
+			ptpClock->offsetUpdates++;
+			syncCount++;
+
+#ifdef PTPD_STATISTICS
+			if(!nextStatsUpdate) {
+				nextStatsUpdate = b + rtOpts->statsUpdateInterval * 1000000000LL;
+			} else if(b >= nextStatsUpdate) {
+				updatePtpEngineStats(ptpClock, rtOpts);
+				nextStatsUpdate += rtOpts->statsUpdateInterval * 1000000000LL;
+			}
+#endif /* PTPD_STATISTICS */
+			break;
+
+		case 'D':
+			if(sscanf(line, "%c %lld %lld %lld", &type, &a, &b, &c) != 4) {
+				goto bad;
+			}
+
+			/* no Delay Response is used before the first Sync */
+			if(ptpClock->portDS.portState != PTP_SLAVE) {
+				break;
+			}
+
+			replayClock.now = a;
+			ptpClock->char_last_msg = 'D';
+			nsToInternal(toReplayed(a), &ptpClock->delay_req_send_time);
+			nsToInternal(b, &ptpClock->delay_req_receive_time);
+			nsToInternal(c, &correction);
+
+			updateDelay(&ptpClock->mpd_filt, rtOpts, ptpClock, &correction);
+			delayCount++;
+			break;
+
+		default:
+		bad:
+			DBG("Replay: could not parse line %ld of %s\n", lineNo, rtOpts->replayFile);
+			badCount++;
+			break;
+		}
+
+	}
+
+	fclose(fp);
+
+	replayTeardown(rtOpts, ptpClock);
+	clockBackendInstall(NULL);
+	getTimeMonotonic(&wallEnd);
+	subTime(&wallTime, &wallEnd, &wallStart);
+
+	NOTICE("Replay finished: %ld Sync, %ld Delay, %ld frequency and %ld step records "
+		"covering %.03f s replayed in %.03f s, %ld lines not understood\n",
+		syncCount, delayCount, adjCount, stepCount,
+		(lastSample - firstSample) / 1E9, timeInternalToDouble(&wallTime), badCount);
+
+	stopLogging(rtOpts);
+
+	return 0;
+}
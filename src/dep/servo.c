@@ -68,6 +68,7 @@
 #include "dep/servo.h"
 #include "dep/msg.h" // Only for msgDump
 #include "dep/alarms.h"
+#include "dep/clockbackend.h"
 #include "protocol.h"
 #include "ptpd_logging.h"
 #include "ptpd_utils.h"
@@ -146,6 +147,9 @@ initClock(const RunTimeOpts * rtOpts, PtpClock * ptpClock)
 void
 updateDelay(one_way_delay_filter * mpd_filt, const RunTimeOpts * rtOpts, PtpClock * ptpClock, TimeInternal * correctionField)
 {
+	traceServoSample('D', &ptpClock->delay_req_send_time, &ptpClock->delay_req_receive_time,
+			 correctionField, 0);
+
 	/* updates paused, leap second pending - do nothing */
 	if(ptpClock->leapSecondInProgress)
 		return;
@@ -472,6 +476,8 @@ updateOffset(TimeInternal * send_time, TimeInternal * recv_time,
 
 	Boolean maxDelayHit = FALSE;
 
+	traceServoSample('S', send_time, recv_time, correctionField, ptpClock->portDS.logSyncInterval);
+
 	DBGV("UTCOffset: %d | leap 59: %d |  leap61: %d\n",
 	     ptpClock->timePropertiesDS.currentUtcOffset,ptpClock->timePropertiesDS.leap59,ptpClock->timePropertiesDS.leap61);
 
@@ -722,6 +728,7 @@ stepClock(const RunTimeOpts * rtOpts, PtpClock * ptpClock)
 	getTime(&oldTime);
 	subTime(&newTime, &oldTime, &ptpClock->currentDS.offsetFromMaster);
 
+	traceServoStep(&oldTime, &ptpClock->currentDS.offsetFromMaster);
 	setTime(&newTime);
 
 	ptpClock->clockStatus.majorChange = TRUE;
@@ -781,6 +788,17 @@ adjFreq_wrapper(const RunTimeOpts * rtOpts, PtpClock * ptpClock, double adj)
 		return;
 	}
 
+	/* the value the clock ends up with - adjFreq() clamps the same way */
+	double applied = adj;
+	CLAMP(applied,rtOpts->servoMaxPpb);
+
+	traceServoAdjustment(applied);
+
+	/* a simulated or replayed clock takes the adjustment instead of the kernel */
+	if(clockBackendAdjFreq(applied)) {
+		return;
+	}
+
 /*
  * adjFreq simulation for QNX: correct clock by x ns per tick over clock adjust interval,
  * to make it equal adj ns per second. Makes sense only if intervals are regular.
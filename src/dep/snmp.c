@@ -786,6 +786,7 @@ snmpWriteClearCounters (int action, u_char *var_val, u_char var_val_type, size_t
 				/* all counters */
 				if(myOid2 == 5) {
 					memset(&snmpPtpClock->counters, 0, sizeof(PtpdCounters));
+					snmpPtpClock->counters.foreignCount = snmpPtpClock->number_foreign_records;
 					return SNMP_ERR_NOERROR;
 				}
 				/* message counters */
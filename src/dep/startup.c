@@ -81,11 +81,14 @@
 #  include "dep/snmp.h"
 #endif
 #include "datatypes.h"
+#include "signaling.h" // For allocUnicastGrantTable, freeUnicastGrantTable
+#include "bmc.h" // For allocForeignMasterTable, freeForeignMasterTable
 #include "dep/net.h"
 #include "dep/startup.h"
 #include "dep/servo.h"
 #include "dep/msg.h" // For freeManagementTLV, freeSignalingTLV
 #include "dep/alarms.h"
+#include "dep/clockbackend.h"
 #include "protocol.h"
 #include "display.h"
 #include "ptpd_logging.h"
@@ -158,6 +161,8 @@ restartSubsystems(RunTimeOpts *rtOpts, PtpClock *ptpClock)
 	if(rtOpts->restartSubsystems & PTPD_RESTART_ALARMS) {
 		NOTIFY("Applying alarm configuration\n");
 		configureAlarms(ptpClock->alarms, ALRM_MAX, (void*)ptpClock);
+		/* with alarms enabled, the kernel filter lets other domains through */
+		netUpdateFilter(ptpClock->netPath, rtOpts, ptpClock);
 	}
 
 #ifdef PTPD_STATISTICS
@@ -232,7 +237,8 @@ ptpdShutdown(PtpClock * ptpClock)
 	updateAlarms(ptpClock->alarms, ALRM_MAX);
 	netShutdown(ptpClock->netPath);
 	netPathFree(&ptpClock->netPath);
-	free(ptpClock->foreign);
+	freeForeignMasterTable(ptpClock);
+	freeUnicastGrantTable(ptpClock);
 
 	/* free management and signaling messages, they can have dynamic memory allocated */
 	if(ptpClock->msgTmpHeader.messageType == MANAGEMENT)
@@ -276,6 +282,8 @@ ptpdShutdown(PtpClock * ptpClock)
 
 	clearLockFile(&rtOpts);
 
+	clockBackendShutdown();
+
 	stopLogging(&rtOpts);
 }
 
@@ -298,15 +306,17 @@ ptpClockCreate(const RunTimeOpts* rtOpts, Integer16* ret, PtpClock* ptpClock_in)
 		DBG("allocated %d bytes for protocol engine data\n", (int)sizeof(PtpClock));
 	}
 
-	ptpClock->foreign = (ForeignMasterRecord *)
-		calloc(rtOpts->max_foreign_records, sizeof(ForeignMasterRecord));
-	if (!ptpClock->foreign) {
-		PERROR("failed to allocate memory for foreign master data");
+	if (!allocForeignMasterTable(ptpClock, rtOpts->max_foreign_records)) {
+		ERROR("failed to allocate memory for foreign master data\n");
 		*ret = 2;
 	        goto fail;
 	}
-	DBG("allocated %d bytes for foreign master data\n",
-	    (int)(rtOpts->max_foreign_records * sizeof(ForeignMasterRecord)));
+
+	if (!allocUnicastGrantTable(ptpClock, rtOpts->unicastTableCapacity)) {
+		ERROR("failed to allocate memory for unicast destination data\n");
+		*ret = 2;
+		goto fail;
+	}
 
 	if (!(ptpClock->netPath = netPathCreate(rtOpts))) {
 		PERROR("Error: Failed to allocate memory for protocol engine NetPath data");
@@ -350,6 +360,9 @@ ptpClockCreate(const RunTimeOpts* rtOpts, Integer16* ret, PtpClock* ptpClock_in)
 		goto fail;
 	}
 
+	/* non-signal timers have to be polled along with the sockets */
+	netPathSetWakeupFd(ptpClock->netPath, timerGetFd());
+
 	/* init alarms */
 	initAlarms(ptpClock->alarms, ALRM_MAX, (void*)ptpClock);
 	configureAlarms(ptpClock->alarms, ALRM_MAX, (void*)ptpClock);
@@ -365,8 +378,9 @@ ptpClockCreate(const RunTimeOpts* rtOpts, Integer16* ret, PtpClock* ptpClock_in)
 
  fail:
 	if(ptpClock) {
-		if(ptpClock->foreign)
-			free(ptpClock->foreign);
+		freeForeignMasterTable(ptpClock);
+
+		freeUnicastGrantTable(ptpClock);
 
 		if(ptpClock->netPath)
 			netPathFree(&ptpClock->netPath);
@@ -52,30 +52,6 @@ static int cmpInt32 (const void *vA, const void *vB)
 	return ((a < b) ? -1 : (a > b) ? 1 : 0);
 }
 
-static int cmpDouble (const void *vA, const void *vB)
-{
-	double a = *(double*)vA;
-	double b = *(double*)vB;
-
-	return ((a < b) ? -1 : (a > b) ? 1 : 0);
-}
-
-static int cmpAbsInt32 (const void *vA, const void *vB)
-{
-	int32_t a = abs(*(int32_t*)vA);
-	int32_t b = abs(*(int32_t*)vB);
-
-	return ((a < b) ? -1 : (a > b) ? 1 : 0);
-}
-
-static int cmpAbsDouble (const void *vA, const void *vB)
-{
-	double a = fabs(*(double*)vA);
-	double b = fabs(*(double*)vB);
-
-	return ((a < b) ? -1 : (a > b) ? 1 : 0);
-}
-
 static int32_t median3Int(int32_t *bucket, int count)
 {
 
@@ -300,6 +276,7 @@ resetIntMovingMean(IntMovingMean* container)
 	container->sum = 0;
 	container->mean = 0;
 	container->count = 0;
+	container->head = 0;
 	memset(container->samples, 0, sizeof(&container->samples));
 }
 
@@ -311,16 +288,15 @@ feedIntMovingMean(IntMovingMean* container, int32_t sample)
         /* sample buffer is full */
         if ( container->count == container->capacity ) {
 		/* keep the sum current - drop the oldest value */
-		container->sum -= container->samples[0];
-		/* shift the sample buffer left, dropping the oldest sample */
-		memmove(container->samples, container->samples + 1,
-			sizeof(sample) * (container->capacity - 1) );
+		container->sum -= container->samples[container->head];
+		/* the oldest slot takes the new sample */
+		container->head = (container->head + 1) % container->capacity;
 		/* counter will be incremented further, so we decrement it here */
 		container->count--;
 		container->full = TRUE;
 	}
 
-	container->samples[container->count++] = sample;
+	container->samples[(container->head + container->count++) % container->capacity] = sample;
 	container->sum += sample;
 	container->mean = container->sum / container->count;
 
@@ -357,6 +333,7 @@ resetIntMovingStdDev(IntMovingStdDev* container)
 	if(container == NULL)
 	    return;
 	resetIntMovingMean(container->meanContainer);
+	container->sampleSquares = 0;
 	container->squareSum = 0;
 	container->stdDev = 0;
 }
@@ -364,25 +341,33 @@ resetIntMovingStdDev(IntMovingStdDev* container)
 int32_t
 feedIntMovingStdDev(IntMovingStdDev* container, int32_t sample)
 {
-	int i = 0;
+	IntMovingMean* mean;
+	int64_t oldest;
 
 	if(container == NULL)
 		return 0;
 
-	feedIntMovingMean(container->meanContainer, sample);
+	mean = container->meanContainer;
+
+	if(mean->count == mean->capacity) {
+		oldest = mean->samples[mean->head];
+		container->sampleSquares -= oldest * oldest;
+	}
+
+	feedIntMovingMean(mean, sample);
+	container->sampleSquares += (int64_t)sample * sample;
 
-	if (container->meanContainer->count < 2) {
+	if (mean->count < 2) {
 		container->stdDev = 0;
 	} else {
 
-		container->squareSum = 0;
-		for(i = 0; i < container->meanContainer->count; i++) {
-			container->squareSum += ( container->meanContainer->samples[i] - container->meanContainer->mean ) *
-						( container->meanContainer->samples[i] - container->meanContainer->mean );
-		}
+		/* sum of (x - mean)^2 expanded, so no pass over the window is needed */
+		container->squareSum = container->sampleSquares
+					- 2 * (int64_t)mean->mean * mean->sum
+					+ (int64_t)mean->count * mean->mean * mean->mean;
 
 		container->stdDev = sqrt ( container->squareSum /
-					    (container->meanContainer->count - 1 ));
+					    (mean->count - 1 ));
 
 	}
 
@@ -425,6 +410,7 @@ resetDoubleMovingMean(DoubleMovingMean* container)
 	container->sum = 0;
 	container->mean = 0;
 	container->count = 0;
+	container->head = 0;
 	container->counter = 0;
 	memset(container->samples, 0, sizeof(&container->samples));
 }
@@ -438,15 +424,14 @@ feedDoubleMovingMean(DoubleMovingMean* container, double sample)
         /* sample buffer is full */
         if ( container->count == container->capacity ) {
 		/* keep the sum current - drop the oldest value */
-		container->sum -= container->samples[0];
-		/* shift the sample buffer left, dropping the oldest sample */
-		memmove(container->samples, container->samples + 1,
-			sizeof(sample) * (container->capacity - 1) );
+		container->sum -= container->samples[container->head];
+		/* the oldest slot takes the new sample */
+		container->head = (container->head + 1) % container->capacity;
 		/* counter will be incremented further, so we decrement it here */
 		container->count--;
 		container->full = TRUE;
 	}
-	container->samples[container->count++] = sample;
+	container->samples[(container->head + container->count++) % container->capacity] = sample;
 	container->sum += sample;
 	container->mean = container->sum / container->count;
 
@@ -489,30 +474,76 @@ resetDoubleMovingStdDev(DoubleMovingStdDev* container)
 	resetDoubleMovingMean(container->meanContainer);
 	container->squareSum = 0.0;
 	container->stdDev = 0.0;
+	container->squareSumPeak = 0.0;
+	container->sinceAnchor = 0;
+}
+
+/* recompute sum and squareSum from the window - bounds the drift of the running updates */
+static void
+reanchorDoubleMovingStdDev(DoubleMovingStdDev* container)
+{
+	DoubleMovingMean* mean = container->meanContainer;
+	double dev;
+	int i;
+
+	mean->sum = 0.0;
+	for(i = 0; i < mean->count; i++) {
+		mean->sum += mean->samples[i];
+	}
+	mean->mean = mean->sum / mean->count;
+
+	container->squareSum = 0.0;
+	for(i = 0; i < mean->count; i++) {
+		dev = mean->samples[i] - mean->mean;
+		container->squareSum += dev * dev;
+	}
+
+	container->squareSumPeak = container->squareSum;
+	container->sinceAnchor = 0;
 }
 
 double
 feedDoubleMovingStdDev(DoubleMovingStdDev* container, double sample)
 {
-	int i = 0;
+	DoubleMovingMean* mean;
+	double oldMean;
+	double oldest;
 
 	if(container == NULL)
 		return 0.0;
 
-	feedDoubleMovingMean(container->meanContainer, sample);
+	mean = container->meanContainer;
+	oldMean = mean->mean;
 
-	if (container->meanContainer->count < 2) {
-		container->stdDev = 0.0;
+	/* windowed Welford: replace the oldest sample, or grow the window */
+	if(mean->count == mean->capacity) {
+		oldest = mean->samples[mean->head];
+		feedDoubleMovingMean(mean, sample);
+		container->squareSum += (sample - oldest) * (sample - mean->mean + oldest - oldMean);
 	} else {
+		feedDoubleMovingMean(mean, sample);
+		container->squareSum += (sample - oldMean) * (sample - mean->mean);
+	}
+
+	if(container->squareSum > container->squareSumPeak) {
+		container->squareSumPeak = container->squareSum;
+	}
 
+	if((++container->sinceAnchor >= STATCONTAINER_REANCHOR_SAMPLES) ||
+	    (container->squareSum < container->squareSumPeak * STATCONTAINER_REANCHOR_RATIO)) {
+		reanchorDoubleMovingStdDev(container);
+	}
+
+	if(container->squareSum < 0.0) {
 		container->squareSum = 0.0;
-		for(i = 0; i < container->meanContainer->count; i++) {
-			container->squareSum += ( container->meanContainer->samples[i] - container->meanContainer->mean ) *
-						( container->meanContainer->samples[i] - container->meanContainer->mean );
-		}
+	}
+
+	if (mean->count < 2) {
+		container->stdDev = 0.0;
+	} else {
 
 		container->stdDev = sqrt ( container->squareSum /
-					    (container->meanContainer->count - 1));
+					    (mean->count - 1));
 
 	}
 
@@ -523,6 +554,288 @@ feedDoubleMovingStdDev(DoubleMovingStdDev* container, double sample)
 	return container->stdDev;
 }
 
+/* Order statistic sliding window */
+
+/* deque key: the front of the deque holds the sample with the lowest key in the window */
+static double
+orderStatKey(uint8_t filterType, double sample)
+{
+	switch(filterType) {
+	    case FILTER_MAX:
+		return -sample;
+	    case FILTER_ABSMIN:
+		return fabs(sample);
+	    case FILTER_ABSMAX:
+		return -fabs(sample);
+	    default:
+		return sample;
+	}
+}
+
+/* heap order: lower half is a max-heap, upper half is a min-heap */
+static Boolean
+heapBefore(const OrderStatWindow* window, Boolean lower, int slotA, int slotB)
+{
+	if(lower) {
+		return window->samples[slotA] > window->samples[slotB];
+	}
+	return window->samples[slotA] < window->samples[slotB];
+}
+
+static void
+heapSet(OrderStatWindow* window, Boolean lower, int i, int slot)
+{
+	if(lower) {
+		window->lower[i] = slot;
+		window->heapPos[slot] = i + 1;
+	} else {
+		window->upper[i] = slot;
+		window->heapPos[slot] = -(i + 1);
+	}
+}
+
+static void
+heapUp(OrderStatWindow* window, Boolean lower, int i)
+{
+	int* heap = lower ? window->lower : window->upper;
+	int slot = heap[i];
+
+	while(i > 0 && heapBefore(window, lower, slot, heap[(i - 1) / 2])) {
+		heapSet(window, lower, i, heap[(i - 1) / 2]);
+		i = (i - 1) / 2;
+	}
+	heapSet(window, lower, i, slot);
+}
+
+static void
+heapDown(OrderStatWindow* window, Boolean lower, int i)
+{
+	int* heap = lower ? window->lower : window->upper;
+	int count = lower ? window->lowerCount : window->upperCount;
+	int slot = heap[i];
+	int child;
+
+	while((child = 2 * i + 1) < count) {
+		if(child + 1 < count && heapBefore(window, lower, heap[child + 1], heap[child])) {
+			child++;
+		}
+		if(!heapBefore(window, lower, heap[child], slot)) {
+			break;
+		}
+		heapSet(window, lower, i, heap[child]);
+		i = child;
+	}
+	heapSet(window, lower, i, slot);
+}
+
+static void
+heapPush(OrderStatWindow* window, Boolean lower, int slot)
+{
+	int i = lower ? window->lowerCount++ : window->upperCount++;
+
+	heapSet(window, lower, i, slot);
+	heapUp(window, lower, i);
+}
+
+/* remove the entry at position i, return its ring slot */
+static int
+heapRemove(OrderStatWindow* window, Boolean lower, int i)
+{
+	int* heap = lower ? window->lower : window->upper;
+	int last = lower ? --window->lowerCount : --window->upperCount;
+	int slot = heap[i];
+
+	if(i < last) {
+		heapSet(window, lower, i, heap[last]);
+		heapUp(window, lower, i);
+		heapDown(window, lower, i);
+	}
+
+	return slot;
+}
+
+/* keep the lower half the same size as the upper half, or one larger */
+static void
+heapBalance(OrderStatWindow* window)
+{
+	while(window->lowerCount > window->upperCount + 1) {
+		heapPush(window, FALSE, heapRemove(window, TRUE, 0));
+	}
+	while(window->upperCount > window->lowerCount) {
+		heapPush(window, TRUE, heapRemove(window, FALSE, 0));
+	}
+}
+
+OrderStatWindow*
+createOrderStatWindow(int capacity, uint8_t filterType)
+{
+	OrderStatWindow* window;
+
+	if(capacity < 1) {
+		capacity = 1;
+	}
+	if(capacity > STATFILTER_MAX_SAMPLES) {
+		capacity = STATFILTER_MAX_SAMPLES;
+	}
+
+	if ( !(window = calloc (1, sizeof(OrderStatWindow))) ) {
+		return NULL;
+	}
+
+	window->capacity = capacity;
+	window->filterType = filterType;
+
+	if ( !(window->samples = calloc(capacity, sizeof(double))) ) {
+		goto failure;
+	}
+
+	switch(filterType) {
+	    case FILTER_MEDIAN:
+		if ( !(window->lower = calloc(capacity, sizeof(int))) ||
+		     !(window->upper = calloc(capacity, sizeof(int))) ||
+		     !(window->heapPos = calloc(capacity, sizeof(int))) ) {
+			goto failure;
+		}
+		break;
+	    case FILTER_MIN:
+	    case FILTER_MAX:
+	    case FILTER_ABSMIN:
+	    case FILTER_ABSMAX:
+		if ( !(window->deque = calloc(capacity, sizeof(uint32_t))) ) {
+			goto failure;
+		}
+		break;
+	    default:
+		break;
+	}
+
+	return window;
+
+failure:
+	freeOrderStatWindow(&window);
+	return NULL;
+}
+
+void
+freeOrderStatWindow(OrderStatWindow** window)
+{
+	if((window == NULL) || (*window == NULL)) {
+	    return;
+	}
+	free((*window)->samples);
+	free((*window)->lower);
+	free((*window)->upper);
+	free((*window)->heapPos);
+	free((*window)->deque);
+	free(*window);
+	*window = NULL;
+}
+
+void
+resetOrderStatWindow(OrderStatWindow* window)
+{
+	if(window == NULL)
+	    return;
+	window->count = 0;
+	window->fed = 0;
+	window->sum = 0;
+	window->lowerCount = 0;
+	window->upperCount = 0;
+	window->dequeHead = 0;
+	window->dequeCount = 0;
+}
+
+void
+feedOrderStatWindow(OrderStatWindow* window, double sample)
+{
+	int slot;
+	int back;
+	uint32_t number;
+	double key;
+
+	if(window == NULL)
+	    return;
+
+	number = window->fed++;
+	slot = number % window->capacity;
+
+	/* window full: the oldest sample occupies the slot this one goes into */
+	if(window->count == window->capacity) {
+		window->sum -= window->samples[slot];
+		if(window->filterType == FILTER_MEDIAN) {
+			if(window->heapPos[slot] > 0) {
+				heapRemove(window, TRUE, window->heapPos[slot] - 1);
+			} else {
+				heapRemove(window, FALSE, -window->heapPos[slot] - 1);
+			}
+		}
+	} else {
+		window->count++;
+	}
+
+	window->samples[slot] = sample;
+	window->sum += sample;
+
+	switch(window->filterType) {
+	    case FILTER_MEDIAN:
+		if(window->lowerCount == 0 || sample <= window->samples[window->lower[0]]) {
+			heapPush(window, TRUE, slot);
+		} else {
+			heapPush(window, FALSE, slot);
+		}
+		heapBalance(window);
+		break;
+	    case FILTER_MIN:
+	    case FILTER_MAX:
+	    case FILTER_ABSMIN:
+	    case FILTER_ABSMAX:
+		/* samples older than this one with a key no lower can never be the output again */
+		key = orderStatKey(window->filterType, sample);
+		while(window->dequeCount > 0) {
+			back = (window->dequeHead + window->dequeCount - 1) % window->capacity;
+			if(orderStatKey(window->filterType,
+			    window->samples[window->deque[back] % window->capacity]) < key) {
+				break;
+			}
+			window->dequeCount--;
+		}
+		/* the front has left the window */
+		if(window->dequeCount > 0 &&
+		    (number - window->deque[window->dequeHead]) >= (uint32_t)window->capacity) {
+			window->dequeHead = (window->dequeHead + 1) % window->capacity;
+			window->dequeCount--;
+		}
+		window->deque[(window->dequeHead + window->dequeCount) % window->capacity] = number;
+		window->dequeCount++;
+		break;
+	    default:
+		break;
+	}
+}
+
+/* current output of the window for its filter type */
+double
+getOrderStatWindowOutput(const OrderStatWindow* window)
+{
+	if(window == NULL || window->count == 0)
+	    return 0;
+
+	switch(window->filterType) {
+	    case FILTER_MEDIAN:
+		if(window->lowerCount > window->upperCount) {
+			return window->samples[window->lower[0]];
+		}
+		return (window->samples[window->lower[0]] + window->samples[window->upper[0]]) / 2;
+	    case FILTER_MIN:
+	    case FILTER_MAX:
+	    case FILTER_ABSMIN:
+	    case FILTER_ABSMAX:
+		return window->samples[window->deque[window->dequeHead] % window->capacity];
+	    default:
+		return window->sum / window->count;
+	}
+}
+
 IntMovingStatFilter* createIntMovingStatFilter(const StatFilterOptions *config, const char* id)
 {
 	IntMovingStatFilter* container;
@@ -535,7 +848,7 @@ IntMovingStatFilter* createIntMovingStatFilter(const StatFilterOptions *config,
 		return NULL;
 	}
 
-	if((container->meanContainer = createIntMovingMean(config->windowSize))
+	if((container->window = createOrderStatWindow(config->windowSize, config->filterType))
 		== NULL) {
 		free(container);
 		return NULL;
@@ -554,7 +867,7 @@ IntMovingStatFilter* createIntMovingStatFilter(const StatFilterOptions *config,
 void
 freeIntMovingStatFilter(IntMovingStatFilter** container)
 {
-	freeIntMovingMean(&((*container)->meanContainer));
+	freeOrderStatWindow(&((*container)->window));
 	free(*container);
 	*container = NULL;
 }
@@ -564,13 +877,15 @@ resetIntMovingStatFilter(IntMovingStatFilter* container)
 {
 	if(container == NULL)
 	    return;
-	resetIntMovingMean(container->meanContainer);
+	resetOrderStatWindow(container->window);
 	container->output = 0;
 }
 
 Boolean
 feedIntMovingStatFilter(IntMovingStatFilter* container, int32_t sample)
 {
+	OrderStatWindow* window;
+
 	if(container == NULL)
 		return 0;
 
@@ -579,94 +894,41 @@ feedIntMovingStatFilter(IntMovingStatFilter* container, int32_t sample)
 	    container->output = sample;
 	    return TRUE;
 
-	} else {
-	    /* cheat - the mean container is used as a general purpose sliding window */
-	    feedIntMovingMean(container->meanContainer, sample);
-
 	}
 
+	window = container->window;
+	feedOrderStatWindow(window, sample);
+
 	container->counter++;
-	container->counter = container->counter % container->meanContainer->capacity;
+	container->counter = container->counter % window->capacity;
 
 	switch(container->filterType) {
 
 	    case FILTER_MEAN:
-
-		container->output = container->meanContainer->mean;
+		container->output = (int32_t)window->sum / window->count;
 		break;
 
 	    case FILTER_MEDIAN:
-		{
-		    int count = container->meanContainer->count;
-		    int32_t sortedSamples[count];
-
-		    Boolean odd = ((count %2 ) == 1);
-	
-		    memcpy(sortedSamples, container->meanContainer->samples, count * sizeof(sample));
-
-		    qsort(sortedSamples, count, sizeof(sample), cmpInt32);
-
-		    if(odd) {
-
-			    container->output = sortedSamples[(count / 2)];
-
-		    } else {
-
-			    container->output = (sortedSamples[(count / 2) -1] + sortedSamples[(count / 2)]) / 2;
-
-		    }
-
+		/* integer median of an even window is the truncated mean of the middle pair */
+		if(window->lowerCount > window->upperCount) {
+			container->output = window->samples[window->lower[0]];
+		} else {
+			container->output = ((int32_t)window->samples[window->lower[0]] +
+					     (int32_t)window->samples[window->upper[0]]) / 2;
 		}
 		break;
 
 	    case FILTER_MIN:
-		{
-		    int count = container->meanContainer->count;
-		    int32_t sortedSamples[count];
-		    memcpy(sortedSamples, container->meanContainer->samples, count * sizeof(sample));
-		    qsort(sortedSamples, count, sizeof(sample), cmpInt32);
-		    container->output = sortedSamples[0];
-
-		}
-		break;
-
 	    case FILTER_MAX:
-		{
-		    int count = container->meanContainer->count;
-		    int32_t sortedSamples[count];
-		    memcpy(sortedSamples, container->meanContainer->samples, count * sizeof(sample));
-		    qsort(sortedSamples, count, sizeof(sample), cmpInt32);
-		    container->output = sortedSamples[count - 1];
-
-		}
-		break;
-
 	    case FILTER_ABSMIN:
-		{
-		    int count = container->meanContainer->count;
-		    int32_t sortedSamples[count];
-		    memcpy(sortedSamples, container->meanContainer->samples, count * sizeof(sample));
-		    qsort(sortedSamples, count, sizeof(sample), cmpAbsInt32);
-		    container->output = sortedSamples[0];
-
-		}
-		break;
-
 	    case FILTER_ABSMAX:
-		{
-		    int count = container->meanContainer->count;
-		    int32_t sortedSamples[count];
-		    memcpy(sortedSamples, container->meanContainer->samples, count * sizeof(sample));
-		    qsort(sortedSamples, count, sizeof(sample), cmpAbsInt32);
-		    container->output = sortedSamples[count - 1];
-
-		}
+		container->output = getOrderStatWindowOutput(window);
 		break;
+
 	    default:
 		container->output = sample;
 		return TRUE;
 	}
-		
 
 	DBGV("filter %s, Sample %d output %d\n", container->identifier, sample, container->output);
 
@@ -688,7 +950,7 @@ DoubleMovingStatFilter* createDoubleMovingStatFilter(const StatFilterOptions *co
 		return NULL;
 	}
 
-	if((container->meanContainer = createDoubleMovingMean(config->windowSize))
+	if((container->window = createOrderStatWindow(config->windowSize, config->filterType))
 		== NULL) {
 		free(container);
 		return NULL;
@@ -710,7 +972,7 @@ freeDoubleMovingStatFilter(DoubleMovingStatFilter** container)
 	if((container==NULL) || (*container==NULL)) {
 	    return;
 	}
-	freeDoubleMovingMean(&((*container)->meanContainer));
+	freeOrderStatWindow(&((*container)->window));
 	free(*container);
 	*container = NULL;
 }
@@ -720,7 +982,7 @@ resetDoubleMovingStatFilter(DoubleMovingStatFilter* container)
 {
 	if(container == NULL)
 	    return;
-	resetDoubleMovingMean(container->meanContainer);
+	resetOrderStatWindow(container->window);
 	container->output = 0;
 }
 
@@ -735,88 +997,24 @@ feedDoubleMovingStatFilter(DoubleMovingStatFilter* container, double sample)
 	    container->output = sample;
 	    return TRUE;
 
-	} else {
-	    /* cheat - the mean container is used as a general purpose sliding window */
-	    feedDoubleMovingMean(container->meanContainer, sample);
 	}
 
+	feedOrderStatWindow(container->window, sample);
+
 	container->counter++;
-	container->counter = container->counter % container->meanContainer->capacity;
+	container->counter = container->counter % container->window->capacity;
 
 	switch(container->filterType) {
 
 	    case FILTER_MEAN:
-
-		container->output = container->meanContainer->mean;
-		break;
-
 	    case FILTER_MEDIAN:
-		{
-		    int count = container->meanContainer->count;
-		    double sortedSamples[count];
-
-		    Boolean odd = ((count %2 ) == 1);
-	
-		    memcpy(sortedSamples, container->meanContainer->samples, count * sizeof(sample));
-
-		    qsort(sortedSamples, count, sizeof(sample), cmpDouble);
-
-		    if(odd) {
-
-			    container->output = sortedSamples[(count / 2)];
-
-		    } else {
-
-			    container->output = (sortedSamples[(count / 2) -1] + sortedSamples[(count / 2)]) / 2;
-
-		    }
-
-		}
-		break;
-
 	    case FILTER_MIN:
-		{
-		    int count = container->meanContainer->count;
-		    double sortedSamples[count];
-		    memcpy(sortedSamples, container->meanContainer->samples, count * sizeof(sample));
-		    qsort(sortedSamples, count, sizeof(sample), cmpDouble);
-		    container->output = sortedSamples[0];
-
-		}
-		break;
-
 	    case FILTER_MAX:
-		{
-		    int count = container->meanContainer->count;
-		    double sortedSamples[count];
-		    memcpy(sortedSamples, container->meanContainer->samples, count * sizeof(sample));
-		    qsort(sortedSamples, count, sizeof(sample), cmpDouble);
-		    container->output = sortedSamples[count - 1];
-
-		}
-		break;
-
 	    case FILTER_ABSMIN:
-		{
-		    int count = container->meanContainer->count;
-		    double sortedSamples[count];
-		    memcpy(sortedSamples, container->meanContainer->samples, count * sizeof(sample));
-		    qsort(sortedSamples, count, sizeof(sample), cmpAbsDouble);
-		    container->output = sortedSamples[0];
-
-		}
-		break;
-
 	    case FILTER_ABSMAX:
-		{
-		    int count = container->meanContainer->count;
-		    double sortedSamples[count];
-		    memcpy(sortedSamples, container->meanContainer->samples, count * sizeof(sample));
-		    qsort(sortedSamples, count, sizeof(sample), cmpAbsDouble);
-		    container->output = sortedSamples[count - 1];
-
-		}
+		container->output = getOrderStatWindowOutput(container->window);
 		break;
+
 	    default:
 		container->output = sample;
 		return TRUE;
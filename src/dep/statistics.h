@@ -16,6 +16,12 @@
 #include "ptp_primitives.h"
 
 #define STATCONTAINER_MAX_SAMPLES 60
+/* statistical filters keep their own window, order statistics cost O(log n) per sample */
+#define STATFILTER_MAX_SAMPLES 4096
+/* moving std dev is updated incrementally, recomputed from the window every n samples to shed rounding drift */
+#define STATCONTAINER_REANCHOR_SAMPLES 1024
+/* ...or once the squared deviations shrink this far below their peak and cancellation error would dominate */
+#define STATCONTAINER_REANCHOR_RATIO 1E-6
 
 /* "Permanent" i.e. non-moving statistics containers - useful for long term measurement */
 
@@ -88,6 +94,7 @@ typedef struct {
 	int32_t* samples;
 	Boolean full;
 	int count;
+	int head;		/* ring index of the oldest sample */
 	int capacity;
 
 } IntMovingMean;
@@ -99,6 +106,7 @@ typedef struct {
 	double* samples;
 	Boolean full;
 	int count;
+	int head;		/* ring index of the oldest sample */
 	int counter;
 	int capacity;
 
@@ -107,7 +115,8 @@ typedef struct {
 typedef struct {
 
 	IntMovingMean* meanContainer;
-	int32_t squareSum;
+	int64_t sampleSquares;	/* running sum of squared samples, exact */
+	int64_t squareSum;	/* sum of squared deviations from the mean, as wide as sampleSquares */
 	int32_t stdDev;
 	char* identifier[10];
 
@@ -116,18 +125,45 @@ typedef struct {
 typedef struct {
 
 	DoubleMovingMean* meanContainer;
-	double squareSum;
+	double squareSum;	/* running sum of squared deviations from the mean */
 	double stdDev;
+	double squareSumPeak;	/* largest squareSum since it was last recomputed */
+	int sinceAnchor;	/* samples since squareSum was last recomputed */
 	double periodicStdDev;
 	char identifier[10];
 
 } DoubleMovingStdDev;
 
+/*
+ * Sliding window maintaining one order statistic incrementally:
+ * median - two heaps of ring slots, lower half max-heap and upper half min-heap, O(log n) per sample
+ * min, max, absmin, absmax - monotonic deque of sample numbers, front is the output, amortised O(1)
+ */
 typedef struct {
 
-	IntMovingMean* meanContainer;
+	double* samples;	/* ring buffer: sample number n lives in samples[n % capacity] */
+	int capacity;
+	int count;		/* samples currently in the window */
+	uint32_t fed;		/* samples fed since last reset - number of the next sample */
+	double sum;		/* sum of the samples in the window, for the mean */
+	uint8_t filterType;
+	/* FILTER_MEDIAN */
+	int* lower;
+	int* upper;
+	int lowerCount;
+	int upperCount;
+	int* heapPos;		/* per ring slot: i + 1 if at lower[i], -(i + 1) if at upper[i] */
+	/* FILTER_MIN, FILTER_MAX, FILTER_ABSMIN, FILTER_ABSMAX */
+	uint32_t* deque;	/* ring of sample numbers with increasing key, oldest first */
+	int dequeHead;
+	int dequeCount;
+
+} OrderStatWindow;
+
+typedef struct {
+
+	OrderStatWindow* window;
 	int32_t output;
-	int32_t* sortedSamples;
 	char identifier[10];
 	int counter;
 	uint8_t filterType;
@@ -137,9 +173,8 @@ typedef struct {
 
 typedef struct {
 
-	DoubleMovingMean* meanContainer;
+	OrderStatWindow* window;
 	double output;
-	double* sortedSamples;
 	char identifier[10];
 	int counter;
 	uint8_t filterType;
@@ -176,6 +211,12 @@ void freeDoubleMovingStdDev(DoubleMovingStdDev** container);
 void resetDoubleMovingStdDev(DoubleMovingStdDev* container);
 double feedDoubleMovingStdDev(DoubleMovingStdDev* container, double sample);
 
+OrderStatWindow* createOrderStatWindow(int capacity, uint8_t filterType);
+void freeOrderStatWindow(OrderStatWindow** window);
+void resetOrderStatWindow(OrderStatWindow* window);
+void feedOrderStatWindow(OrderStatWindow* window, double sample);
+double getOrderStatWindowOutput(const OrderStatWindow* window);
+
 IntMovingStatFilter* createIntMovingStatFilter(const StatFilterOptions* config, const char* id);
 void freeIntMovingStatFilter(IntMovingStatFilter** container);
 void resetIntMovingStatFilter(IntMovingStatFilter* container);
@@ -0,0 +1,238 @@
+/*-
+ * Copyright (c) 2015 Wojciech Owczarek,
+ *
+ * All Rights Reserved
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHORS ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE AUTHORS OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+ * OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
+ * IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+/**
+ * @file   statsbin.c
+ * @date   Mon Oct 19 15:40:22 2026
+ *
+ * @brief  Binary statistics log format: record packing and unpacking
+ *
+ * Shared by ptpd2 and the ptpd2-statsconv converter - no logging and
+ * no dependencies on the rest of the daemon here.
+ */
+
+#include <string.h>
+
+#include "dep/statsbin.h"
+
+/* record field offsets */
+#define OFF_SECONDS		0
+#define OFF_NANOSECONDS		4
+#define OFF_PORTSTATE		8
+#define OFF_LASTMESSAGE		9
+#define OFF_SEQUENCEID		10
+#define OFF_RESETCOUNT		12
+#define OFF_PARENT		16
+#define OFF_PARENTPORT		24
+#define OFF_FLAGS		26
+#define OFF_GRANDMASTER		28
+#define OFF_PATHDELAY		36
+#define OFF_OFFSET		44
+#define OFF_DELAYSM		52
+#define OFF_DELAYMS		60
+#define OFF_DRIFT		68
+#define OFF_MPDMEAN		76
+#define OFF_MPDSTDDEV		84
+#define OFF_OFMMEAN		92
+#define OFF_OFMSTDDEV		100
+#define OFF_DRIFTMEAN		108
+#define OFF_DRIFTSTDDEV		116
+#define OFF_RAWDELAYMS		124
+#define OFF_RAWDELAYSM		132
+/* 140 .. 143 reserved */
+
+static void
+put16(unsigned char *buf, uint16_t value)
+{
+	buf[0] = value & 0xff;
+	buf[1] = value >> 8;
+}
+
+static void
+put32(unsigned char *buf, uint32_t value)
+{
+	buf[0] = value & 0xff;
+	buf[1] = (value >> 8) & 0xff;
+	buf[2] = (value >> 16) & 0xff;
+	buf[3] = value >> 24;
+}
+
+static void
+put64(unsigned char *buf, uint64_t value)
+{
+	put32(buf, value & 0xffffffff);
+	put32(buf + 4, value >> 32);
+}
+
+static uint16_t
+get16(const unsigned char *buf)
+{
+	return buf[0] | (buf[1] << 8);
+}
+
+static uint32_t
+get32(const unsigned char *buf)
+{
+	return (uint32_t)buf[0] | ((uint32_t)buf[1] << 8) |
+	    ((uint32_t)buf[2] << 16) | ((uint32_t)buf[3] << 24);
+}
+
+static uint64_t
+get64(const unsigned char *buf)
+{
+	return get32(buf) | ((uint64_t)get32(buf + 4) << 32);
+}
+
+/* doubles are stored as their IEEE 754 bit pattern */
+static void
+putDouble(unsigned char *buf, double value)
+{
+	uint64_t bits;
+
+	memcpy(&bits, &value, sizeof(bits));
+	put64(buf, bits);
+}
+
+static double
+getDouble(const unsigned char *buf)
+{
+	uint64_t bits = get64(buf);
+	double value;
+
+	memcpy(&value, &bits, sizeof(value));
+	return value;
+}
+
+static void
+putTimeField(unsigned char *buf, const TimeInternal *time)
+{
+	put32(buf, (uint32_t)time->seconds);
+	put32(buf + 4, (uint32_t)time->nanoseconds);
+}
+
+static void
+getTimeField(const unsigned char *buf, TimeInternal *time)
+{
+	time->seconds = (Integer32)get32(buf);
+	time->nanoseconds = (Integer32)get32(buf + 4);
+}
+
+void
+statsBinPackHeader(unsigned char *buf, const StatsBinHeader *header)
+{
+	memset(buf, 0, STATSBIN_HEADER_SIZE);
+	memcpy(buf, STATSBIN_MAGIC, STATSBIN_MAGIC_LEN);
+	put16(buf + 8, header->version);
+	put16(buf + 10, header->headerSize);
+	put16(buf + 12, header->recordSize);
+	put16(buf + 14, header->flags);
+	buf[16] = header->timestampFormat;
+}
+
+Boolean
+statsBinUnpackHeader(const unsigned char *buf, StatsBinHeader *header)
+{
+	if(!statsBinIsHeader(buf)) {
+		return FALSE;
+	}
+
+	header->version = get16(buf + 8);
+	header->headerSize = get16(buf + 10);
+	header->recordSize = get16(buf + 12);
+	header->flags = get16(buf + 14);
+	header->timestampFormat = buf[16];
+
+	/* later versions may only append fields, so the sizes must still cover ours */
+	return header->version >= STATSBIN_VERSION &&
+	    header->headerSize >= STATSBIN_HEADER_SIZE &&
+	    header->recordSize >= STATSBIN_RECORD_SIZE;
+}
+
+Boolean
+statsBinIsHeader(const unsigned char *buf)
+{
+	return memcmp(buf, STATSBIN_MAGIC, STATSBIN_MAGIC_LEN) == 0;
+}
+
+void
+statsBinPackRecord(unsigned char *buf, const StatsBinRecord *record)
+{
+	memset(buf, 0, STATSBIN_RECORD_SIZE);
+
+	putTimeField(buf + OFF_SECONDS, &record->time);
+	buf[OFF_PORTSTATE] = record->portState;
+	buf[OFF_LASTMESSAGE] = record->lastMessage;
+	put16(buf + OFF_SEQUENCEID, record->sequenceId);
+	put32(buf + OFF_RESETCOUNT, record->resetCount);
+	memcpy(buf + OFF_PARENT, record->parentPortIdentity.clockIdentity, CLOCK_IDENTITY_LENGTH);
+	put16(buf + OFF_PARENTPORT, record->parentPortIdentity.portNumber);
+	buf[OFF_FLAGS] = record->flags;
+	memcpy(buf + OFF_GRANDMASTER, record->grandmasterIdentity, CLOCK_IDENTITY_LENGTH);
+	putTimeField(buf + OFF_PATHDELAY, &record->meanPathDelay);
+	putTimeField(buf + OFF_OFFSET, &record->offsetFromMaster);
+	putTimeField(buf + OFF_DELAYSM, &record->delaySM);
+	putTimeField(buf + OFF_DELAYMS, &record->delayMS);
+	putDouble(buf + OFF_DRIFT, record->observedDrift);
+	putDouble(buf + OFF_MPDMEAN, record->mpdMean);
+	putDouble(buf + OFF_MPDSTDDEV, record->mpdStdDev);
+	putDouble(buf + OFF_OFMMEAN, record->ofmMean);
+	putDouble(buf + OFF_OFMSTDDEV, record->ofmStdDev);
+	putDouble(buf + OFF_DRIFTMEAN, record->driftMean);
+	putDouble(buf + OFF_DRIFTSTDDEV, record->driftStdDev);
+	putTimeField(buf + OFF_RAWDELAYMS, &record->rawDelayMS);
+	putTimeField(buf + OFF_RAWDELAYSM, &record->rawDelaySM);
+}
+
+void
+statsBinUnpackRecord(const unsigned char *buf, StatsBinRecord *record)
+{
+	memset(record, 0, sizeof(StatsBinRecord));
+
+	getTimeField(buf + OFF_SECONDS, &record->time);
+	record->portState = buf[OFF_PORTSTATE];
+	record->lastMessage = buf[OFF_LASTMESSAGE];
+	record->sequenceId = get16(buf + OFF_SEQUENCEID);
+	record->resetCount = get32(buf + OFF_RESETCOUNT);
+	memcpy(record->parentPortIdentity.clockIdentity, buf + OFF_PARENT, CLOCK_IDENTITY_LENGTH);
+	record->parentPortIdentity.portNumber = get16(buf + OFF_PARENTPORT);
+	record->flags = buf[OFF_FLAGS];
+	memcpy(record->grandmasterIdentity, buf + OFF_GRANDMASTER, CLOCK_IDENTITY_LENGTH);
+	getTimeField(buf + OFF_PATHDELAY, &record->meanPathDelay);
+	getTimeField(buf + OFF_OFFSET, &record->offsetFromMaster);
+	getTimeField(buf + OFF_DELAYSM, &record->delaySM);
+	getTimeField(buf + OFF_DELAYMS, &record->delayMS);
+	record->observedDrift = getDouble(buf + OFF_DRIFT);
+	record->mpdMean = getDouble(buf + OFF_MPDMEAN);
+	record->mpdStdDev = getDouble(buf + OFF_MPDSTDDEV);
+	record->ofmMean = getDouble(buf + OFF_OFMMEAN);
+	record->ofmStdDev = getDouble(buf + OFF_OFMSTDDEV);
+	record->driftMean = getDouble(buf + OFF_DRIFTMEAN);
+	record->driftStdDev = getDouble(buf + OFF_DRIFTSTDDEV);
+	getTimeField(buf + OFF_RAWDELAYMS, &record->rawDelayMS);
+	getTimeField(buf + OFF_RAWDELAYSM, &record->rawDelaySM);
+}
@@ -0,0 +1,102 @@
+/*-
+ * Copyright (c) 2015 Wojciech Owczarek,
+ *
+ * All Rights Reserved
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHORS ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE AUTHORS OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+ * OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
+ * IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef STATSBIN_H_
+#define STATSBIN_H_
+
+/**
+ * @file   statsbin.h
+ * @date   Mon Oct 19 15:40:22 2026
+ *
+ * @brief  Binary statistics log format
+ *
+ * A binary statistics file is a header followed by fixed size records,
+ * all fields little-endian. Every time the file is (re)opened or rotated
+ * a new header is written, so a file can hold several header + records
+ * segments. A record can never be mistaken for a header: the magic
+ * read as a record timestamp has a nanoseconds field above one second.
+ */
+
+#include <stdint.h>
+#include <stddef.h>
+
+#include "ptp_primitives.h"
+#include "ptp_datatypes.h"
+
+#define STATSBIN_MAGIC		"PTPDSTAT"
+#define STATSBIN_MAGIC_LEN	8
+#define STATSBIN_VERSION	1
+#define STATSBIN_HEADER_SIZE	32
+#define STATSBIN_RECORD_SIZE	144
+
+/* header flags */
+#define STATSBIN_FLAG_STATISTICS	0x0001	/* records carry the PTPD_STATISTICS fields */
+
+/* record flags */
+#define STATSBIN_RECORD_GM_DIFFERS	0x01	/* grandmaster is not the parent clock */
+
+typedef struct {
+	UInteger16 version;
+	UInteger16 headerSize;
+	UInteger16 recordSize;
+	UInteger16 flags;
+	UInteger8 timestampFormat;	/* statistics_timestamp_format when written */
+} StatsBinHeader;
+
+typedef struct {
+	TimeInternal time;
+	UInteger8 portState;
+	UInteger8 lastMessage;		/* char_last_msg: S, D, P... */
+	UInteger8 flags;
+	UInteger16 sequenceId;
+	UInteger32 resetCount;
+	PortIdentity parentPortIdentity;
+	ClockIdentity grandmasterIdentity;
+	TimeInternal meanPathDelay;	/* peer delay with P2P */
+	TimeInternal offsetFromMaster;
+	TimeInternal delaySM;		/* pdelaySM with P2P */
+	TimeInternal delayMS;
+	double observedDrift;
+	double mpdMean;
+	double mpdStdDev;
+	double ofmMean;
+	double ofmStdDev;
+	double driftMean;
+	double driftStdDev;
+	TimeInternal rawDelayMS;
+	TimeInternal rawDelaySM;
+} StatsBinRecord;
+
+void statsBinPackHeader(unsigned char *buf, const StatsBinHeader *header);
+/* FALSE if buf does not hold a header this code understands */
+Boolean statsBinUnpackHeader(const unsigned char *buf, StatsBinHeader *header);
+void statsBinPackRecord(unsigned char *buf, const StatsBinRecord *record);
+void statsBinUnpackRecord(const unsigned char *buf, StatsBinRecord *record);
+/* TRUE if the buffer (at least STATSBIN_MAGIC_LEN bytes) starts a new header */
+Boolean statsBinIsHeader(const unsigned char *buf);
+
+#endif /* STATSBIN_H_ */
@@ -0,0 +1,174 @@
+/*-
+ * Copyright (c) 2015 Wojciech Owczarek,
+ *
+ * All Rights Reserved
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHORS ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE AUTHORS OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+ * OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
+ * IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+/**
+ * @file   statusshm.c
+ * @date   Tue Oct 20 10:03:48 2026
+ *
+ * @brief  Status shared memory segment: mapping and the sequence lock
+ *
+ * Shared by ptpd2 and the ptpd2-status reader - no logging here, the
+ * daemon reports errors from errno.
+ */
+
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "dep/statusshm.h"
+
+/* give up after this many torn reads - the writer is never that busy */
+#define STATUSSHM_READ_RETRIES	1000
+
+PtpdStatusShm *
+statusShmCreate(const char *name)
+{
+	PtpdStatusShm *shm;
+	int fd;
+
+	fd = shm_open(name, O_RDWR | O_CREAT, 0644);
+	if(fd < 0) {
+		return NULL;
+	}
+
+	if(ftruncate(fd, sizeof(PtpdStatusShm)) < 0) {
+		close(fd);
+		return NULL;
+	}
+
+	shm = mmap(NULL, sizeof(PtpdStatusShm), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+	close(fd);
+	if(shm == MAP_FAILED) {
+		return NULL;
+	}
+
+	/* a reader attached to a previous instance sees the sequence keep going up */
+	__atomic_store_n(&shm->sequence, (shm->sequence + 1) | 1, __ATOMIC_RELAXED);
+	__atomic_thread_fence(__ATOMIC_RELEASE);
+	memset(&shm->status, 0, sizeof(PtpdStatus));
+	shm->magic = STATUSSHM_MAGIC;
+	shm->version = STATUSSHM_VERSION;
+	shm->size = sizeof(PtpdStatus);
+	__atomic_store_n(&shm->sequence, shm->sequence + 1, __ATOMIC_RELEASE);
+
+	return shm;
+}
+
+void
+statusShmDestroy(PtpdStatusShm *shm, const char *name)
+{
+	if(shm == NULL) {
+		return;
+	}
+
+	munmap(shm, sizeof(PtpdStatusShm));
+	shm_unlink(name);
+}
+
+void
+statusShmWriteBegin(PtpdStatusShm *shm)
+{
+	__atomic_store_n(&shm->sequence, shm->sequence + 1, __ATOMIC_RELAXED);
+	/* the odd sequence must be visible before any of the data changes */
+	__atomic_thread_fence(__ATOMIC_RELEASE);
+}
+
+void
+statusShmWriteEnd(PtpdStatusShm *shm)
+{
+	__atomic_store_n(&shm->sequence, shm->sequence + 1, __ATOMIC_RELEASE);
+}
+
+const PtpdStatusShm *
+statusShmAttach(const char *name)
+{
+	const PtpdStatusShm *shm;
+	struct stat st;
+	int fd;
+
+	fd = shm_open(name, O_RDONLY, 0);
+	if(fd < 0) {
+		return NULL;
+	}
+
+	if(fstat(fd, &st) < 0 || st.st_size < (off_t)sizeof(PtpdStatusShm)) {
+		close(fd);
+		errno = EINVAL;
+		return NULL;
+	}
+
+	shm = mmap(NULL, sizeof(PtpdStatusShm), PROT_READ, MAP_SHARED, fd, 0);
+	close(fd);
+	if(shm == MAP_FAILED) {
+		return NULL;
+	}
+
+	return shm;
+}
+
+void
+statusShmDetach(const PtpdStatusShm *shm)
+{
+	if(shm != NULL) {
+		munmap((void*)shm, sizeof(PtpdStatusShm));
+	}
+}
+
+Boolean
+statusShmRead(const PtpdStatusShm *shm, PtpdStatus *status)
+{
+	uint32_t before, after;
+	int i;
+
+	for(i = 0; i < STATUSSHM_READ_RETRIES; i++) {
+		before = __atomic_load_n(&shm->sequence, __ATOMIC_ACQUIRE);
+		if(before & 1) {
+			continue;
+		}
+
+		/* newer writers only append fields */
+		if(shm->magic != STATUSSHM_MAGIC || shm->version < STATUSSHM_VERSION ||
+		    shm->size < sizeof(PtpdStatus)) {
+			return FALSE;
+		}
+
+		memcpy(status, (const void*)&shm->status, sizeof(PtpdStatus));
+		/* the copy must be complete before the sequence is checked again */
+		__atomic_thread_fence(__ATOMIC_ACQUIRE);
+		after = __atomic_load_n(&shm->sequence, __ATOMIC_RELAXED);
+
+		if(before == after) {
+			return TRUE;
+		}
+	}
+
+	return FALSE;
+}
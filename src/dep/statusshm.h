@@ -0,0 +1,148 @@
+/*-
+ * Copyright (c) 2015 Wojciech Owczarek,
+ *
+ * All Rights Reserved
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHORS ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE AUTHORS OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+ * OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
+ * IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef STATUSSHM_H_
+#define STATUSSHM_H_
+
+/**
+ * @file   statusshm.h
+ * @date   Tue Oct 20 10:03:48 2026
+ *
+ * @brief  Status published in a POSIX shared memory segment
+ *
+ * The segment holds one PtpdStatus behind a sequence lock: the daemon
+ * makes the sequence odd, updates the status and makes it even again;
+ * readers copy the status and retry if the sequence was odd or moved
+ * while they were copying. Readers never block the daemon and never
+ * see a half-written update. Native byte order - the segment does not
+ * leave the host.
+ */
+
+#include <stdint.h>
+
+#include "ptp_primitives.h"
+
+#define STATUSSHM_MAGIC		0x53505450	/* "PTPS" */
+#define STATUSSHM_VERSION	1
+#define STATUSSHM_IFACE_LEN	16
+#define STATUSSHM_ALARMS_LEN	96
+
+/* PtpdStatus.clockFlags */
+#define STATUSSHM_CLOCK_IN_CONTROL	0x01
+#define STATUSSHM_CLOCK_READ_ONLY	0x02
+#define STATUSSHM_CLOCK_CALIBRATED	0x04
+#define STATUSSHM_CLOCK_STABLE		0x08	/* servo stability detection */
+#define STATUSSHM_CLOCK_PANIC		0x10
+#define STATUSSHM_CLOCK_MAX_RATE	0x20	/* slewing at the maximum rate */
+
+/* PtpdStatus.timeFlags */
+#define STATUSSHM_TIME_PTP_TIMESCALE	0x01
+#define STATUSSHM_TIME_TRACEABLE	0x02
+#define STATUSSHM_FREQ_TRACEABLE	0x04
+#define STATUSSHM_UTC_VALID		0x08
+#define STATUSSHM_LEAP59		0x10
+#define STATUSSHM_LEAP61		0x20
+
+/* fields are only ever appended - readers check the size */
+typedef struct {
+	int64_t updated;		/* ns since the epoch, daemon clock */
+	int32_t pid;
+	uint8_t portState;		/* PTP_* port states */
+	uint8_t delayMechanism;		/* E2E, P2P, DELAY_DISABLED */
+	uint8_t domainNumber;
+	uint8_t clockFlags;
+	char interface[STATUSSHM_IFACE_LEN];
+
+	uint8_t portIdentity[8];
+	uint16_t portNumber;
+	uint16_t parentPortNumber;
+	uint8_t parentIdentity[8];
+	uint8_t grandmasterIdentity[8];
+	uint8_t grandmasterPriority1;
+	uint8_t grandmasterPriority2;
+	uint8_t grandmasterClockClass;
+	uint8_t timeFlags;
+	int16_t utcOffset;
+	uint8_t statsValid;		/* the means and deviations below are set */
+	uint8_t reserved;
+
+	int64_t offsetFromMaster;	/* ns */
+	int64_t meanPathDelay;		/* ns, peer delay with P2P */
+	double observedDrift;		/* ppb */
+	double ofmMean;			/* s */
+	double ofmStdDev;		/* s */
+	double mpdMean;			/* s */
+	double mpdStdDev;		/* s */
+	double driftMean;		/* ppb */
+	double driftStdDev;		/* ppb */
+
+	uint32_t alarmsSet;		/* bit per alarm (ALRM_*) currently set */
+	uint32_t alarmsCleared;		/* bit per alarm cleared but not yet aged out */
+	char alarms[STATUSSHM_ALARMS_LEN];	/* the status file alarm summary */
+
+	uint32_t messageReceiveRate;	/* per second */
+	uint32_t messageSendRate;
+	uint32_t announceReceived;
+	uint32_t syncReceived;
+	uint32_t followUpReceived;
+	uint32_t delayReqSent;
+	uint32_t delayReqReceived;
+	uint32_t delayRespSent;
+	uint32_t delayRespReceived;
+	uint32_t stateTransitions;
+	uint32_t bestMasterChanges;
+	uint32_t announceTimeouts;
+	uint32_t discardedMessages;
+	uint32_t messageRecvErrors;
+	uint32_t messageSendErrors;
+	uint32_t slaveCount;
+} PtpdStatus;
+
+typedef struct {
+	uint32_t magic;
+	uint16_t version;
+	uint16_t size;			/* sizeof(PtpdStatus) of the writer */
+	uint32_t sequence;		/* odd while an update is in progress */
+	uint32_t reserved;
+	PtpdStatus status;
+} PtpdStatusShm;
+
+/* daemon side: create (or reuse) and map the named segment */
+PtpdStatusShm *statusShmCreate(const char *name);
+/* unmap and remove it */
+void statusShmDestroy(PtpdStatusShm *shm, const char *name);
+/* begin / end an update of shm->status */
+void statusShmWriteBegin(PtpdStatusShm *shm);
+void statusShmWriteEnd(PtpdStatusShm *shm);
+
+/* reader side: map an existing segment read-only, NULL on error */
+const PtpdStatusShm *statusShmAttach(const char *name);
+void statusShmDetach(const PtpdStatusShm *shm);
+/* take a consistent copy, FALSE if none after a number of attempts or a layout mismatch */
+Boolean statusShmRead(const PtpdStatusShm *shm, PtpdStatus *status);
+
+#endif /* STATUSSHM_H_ */
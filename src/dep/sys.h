@@ -24,11 +24,19 @@ Boolean initLogging(RunTimeOpts* rtOpts);
 void restartLogging();
 void stopLogging(RunTimeOpts* rtOpts);
 void logStatistics(PtpClock *ptpClock);
+void flushStatistics(void);
 void periodicUpdate(const RunTimeOpts *rtOpts, PtpClock *ptpClock);
 void displayStatus(PtpClock *ptpClock, const char *prefixMessage);
 void writeStatusFile(PtpClock *ptpClock, const RunTimeOpts *rtOpts, Boolean quiet);
+/* publish the current status in the shared memory segment, if enabled */
+void updateStatusShm(PtpClock *ptpClock, const RunTimeOpts *rtOpts);
+Boolean statusShmEnabled(void);
 void displayPortIdentity(PortIdentity *port, const char *prefixMessage);
 void recordSync(UInteger16 sequenceId, TimeInternal * time);
+void traceServoSample(char type, const TimeInternal *send, const TimeInternal *recv,
+		      const TimeInternal *correction, Integer8 logInterval);
+void traceServoAdjustment(double adj);
+void traceServoStep(const TimeInternal *when, const TimeInternal *offset);
 Boolean nanoSleep(TimeInternal*);
 
 void getTime(TimeInternal*);
@@ -877,18 +877,15 @@ displayCounters(const PtpClock * ptpClock)
 		(unsigned long)ptpClock->counters.unicastGrantsCancelAckSent);
 
     }
-/* not implemented yet */
-#if 0
 	INFO("FMR counters:\n");
 	INFO("                      foreignAdded : %lu\n",
 		(unsigned long)ptpClock->counters.foreignAdded);
-	INFO("                        foreignMax : %lu\n",
-		(unsigned long)ptpClock->counters.foreignMax);
+	INFO("                      foreignCount : %lu\n",
+		(unsigned long)ptpClock->counters.foreignCount);
 	INFO("                    foreignRemoved : %lu\n",
 		(unsigned long)ptpClock->counters.foreignRemoved);
-	INFO("                   foreignOverflow : %lu\n",
-		(unsigned long)ptpClock->counters.foreignOverflow);
-#endif /* 0 */
+	INFO("                  foreignOverflows : %lu\n",
+		(unsigned long)ptpClock->counters.foreignOverflows);
 
 	INFO("Protocol engine counters:\n");
 	INFO("                  stateTransitions : %lu\n",
@@ -931,6 +928,12 @@ displayCounters(const PtpClock * ptpClock)
 		(unsigned long)ptpClock->counters.delayMechanismMismatchErrors);
 	INFO("           maxDelayDrops : %lu\n",
 		(unsigned long)ptpClock->counters.maxDelayDrops);
+	INFO("             syncDestinationMisses : %lu\n",
+		(unsigned long)ptpClock->counters.syncDestinationMisses);
+	INFO("               unicastSyncBurstMax : %d\n",
+		ptpClock->syncPacer.maxBurst);
+	INFO("           unicastAnnounceBurstMax : %d\n",
+		ptpClock->announcePacer.maxBurst);
 
 
 #ifdef PTPD_STATISTICS
@@ -84,7 +84,7 @@ static void handleMMTimePropertiesDataSet(MsgManagement*, MsgManagement*, PtpClo
 static void handleMMPortDataSet(MsgManagement*, MsgManagement*, PtpClock*);
 static void handleMMPriority1(MsgManagement*, MsgManagement*, PtpClock*, dictionary*);
 static void handleMMPriority2(MsgManagement*, MsgManagement*, PtpClock*, dictionary*);
-static void handleMMDomain(MsgManagement*, MsgManagement*, PtpClock*, dictionary*);
+static void handleMMDomain(MsgManagement*, MsgManagement*, PtpClock*, const RunTimeOpts*, dictionary*);
 static void handleMMLogAnnounceInterval(MsgManagement*, MsgManagement*, PtpClock*, dictionary*);
 static void handleMMAnnounceReceiptTimeout(MsgManagement*, MsgManagement*, PtpClock*, dictionary*);
 static void handleMMLogSyncInterval(MsgManagement*, MsgManagement*, PtpClock*, dictionary*);
@@ -205,6 +205,8 @@ handleManagement(MsgHeader *header,
 	if (mgmtMsg->actionField & (SET | COMMAND)) {
 	    managementConfig = dictionary_new(0);
 	    dictionary_merge(rtOpts->currentConfig, managementConfig, 1, 0, NULL);
+	    /* the datasets outgoing messages are packed from may change */
+	    msgInvalidateTemplates(ptpClock, MSG_TEMPLATE_ALL);
 	}
 
 	switch(mgmtMsg->tlv->managementId)
@@ -318,7 +320,7 @@ handleManagement(MsgHeader *header,
 			ptpClock->counters.messageFormatErrors++;
 			goto end;
 		}
-                handleMMDomain(mgmtMsg, &ptpClock->outgoingManageTmp, ptpClock, managementConfig);
+                handleMMDomain(mgmtMsg, &ptpClock->outgoingManageTmp, ptpClock, rtOpts, managementConfig);
                 break;
 	case MM_SLAVE_ONLY:
 		DBGV("handleManagement: Slave Only\n");
@@ -1167,7 +1169,8 @@ static void handleMMPriority2(MsgManagement* incoming, MsgManagement* outgoing,
 }
 
 /**\brief Handle incoming DOMAIN management message type*/
-static void handleMMDomain(MsgManagement* incoming, MsgManagement* outgoing, PtpClock* ptpClock, dictionary* managementConfig)
+static void handleMMDomain(MsgManagement* incoming, MsgManagement* outgoing, PtpClock* ptpClock,
+			   const RunTimeOpts* rtOpts, dictionary* managementConfig)
 {
 	DBGV("received DOMAIN message\n");
 
@@ -1183,6 +1186,8 @@ static void handleMMDomain(MsgManagement* incoming, MsgManagement* outgoing, Ptp
 		data = (MMDomain*)incoming->tlv->dataField;
 		/* SET actions */
 		ptpClock->defaultDS.domainNumber = data->domainNumber;
+		/* the kernel filter would keep dropping the new domain */
+		netUpdateFilter(ptpClock->netPath, rtOpts, ptpClock);
 		tmpsnprintf(tmpStr, 4, "%d", data->domainNumber);
 		setConfig(managementConfig, "ptpengine:domain", tmpStr);
 		ptpClock->record_update = TRUE;
@@ -77,6 +77,7 @@
 #include "dep/net.h"
 #include "dep/startup.h"
 #include "dep/servo.h"
+#include "dep/clockbackend.h"
 #include "dep/msg.h"
 #include "management.h"
 #include "protocol.h"
@@ -108,7 +109,11 @@ static void issueAnnounce(const RunTimeOpts*,PtpClock*);
 static void issueAnnounceSingle(Integer32, UInteger16*, const RunTimeOpts*,PtpClock*);
 static void issueSync(const RunTimeOpts*,PtpClock*);
 static TimeInternal issueSyncSingle(Integer32, UInteger16*, const RunTimeOpts*,PtpClock*);
+static void queueAnnounceSingle(Integer32, UInteger16*, const RunTimeOpts*,PtpClock*);
+static void queueSyncSingle(Integer32, UInteger16*, const RunTimeOpts*,PtpClock*);
 static void issueFollowup(const TimeInternal*,const RunTimeOpts*,PtpClock*, Integer32, const UInteger16);
+static void startPacedRound(UnicastPacer*, int, int, Integer8, const RunTimeOpts*, PtpClock*);
+static Boolean issuePacedSlot(UnicastPacer*, int, const RunTimeOpts*, PtpClock*);
 #endif /* PTPD_SLAVE_ONLY */
 static void issuePdelayReq(const RunTimeOpts*,PtpClock*);
 static void issueDelayReq(const RunTimeOpts*,PtpClock*);
@@ -117,104 +122,135 @@ static void issueDelayResp(const TimeInternal*,MsgHeader*,Integer32,const RunTim
 static void issuePdelayRespFollowUp(const TimeInternal*,MsgHeader*, Integer32, const RunTimeOpts*,PtpClock*, const UInteger16);
 
 static void processMessage(RunTimeOpts* rtOpts, PtpClock* ptpClock, TimeInternal* timeStamp, ssize_t length);
+static void processTxTimestamps(const RunTimeOpts* rtOpts, PtpClock* ptpClock);
 
 #ifndef PTPD_SLAVE_ONLY /* does not get compiled when building slave only */
 static void processSyncFromSelf(const TimeInternal * tint, const RunTimeOpts * rtOpts, PtpClock * ptpClock, Integer32 dst, const UInteger16 sequenceId);
-static void indexSync(TimeInternal *timeStamp, UInteger16 sequenceId, Integer32 transportAddress, SyncDestEntry *index);
+static void indexSync(TimeInternal *timeStamp, UInteger16 sequenceId, Integer32 transportAddress, SyncDestTable *table);
+static void resetSyncIndex(SyncDestTable *table);
 #endif /* PTPD_SLAVE_ONLY */
 
 static void processDelayReqFromSelf(const TimeInternal * tint, const RunTimeOpts * rtOpts, PtpClock * ptpClock);
 static void processPdelayReqFromSelf(const TimeInternal * tint, const RunTimeOpts * rtOpts, PtpClock * ptpClock);
-static void processPdelayRespFromSelf(const TimeInternal * tint, const RunTimeOpts * rtOpts, PtpClock * ptpClock, Integer32 dst, const UInteger16 sequenceId);
+static void processPdelayRespFromSelf(const TimeInternal * tint, const RunTimeOpts * rtOpts, PtpClock * ptpClock, Integer32 dst, const UInteger16 sequenceId, const PortIdentity *requestingPortIdentity);
 
 /* this shouldn't really be in protocol.c, it will be moved later */
 static void timestampCorrection(const RunTimeOpts * rtOpts, PtpClock *ptpClock, TimeInternal *timeStamp);
 
-static Integer32 lookupSyncIndex(TimeInternal *timeStamp, UInteger16 sequenceId, SyncDestEntry *index);
-static Integer32 findSyncDestination(TimeInternal *timeStamp, const RunTimeOpts *rtOpts, PtpClock *ptpClock);
+static Integer32 lookupSyncIndex(TimeInternal *timeStamp, UInteger16 sequenceId, SyncDestTable *table);
 
 
+/* Sync index slot for the given Sync: its sequence ID and origin timestamp are all the looped back copy tells us */
+static uint32_t
+hashSyncIndex(TimeInternal *timeStamp, UInteger16 sequenceId, SyncDestTable *table)
+{
+    UInteger32 key[3];
+
+    key[0] = sequenceId;
+    key[1] = timeStamp->seconds;
+    key[2] = timeStamp->nanoseconds;
+
+    return fnvHash(key, sizeof(key), 0) & (table->size - 1);
+}
+
 #ifndef PTPD_SLAVE_ONLY
 
-/* store transportAddress in an index table */
+/* start a new round of Sync messages: everything indexed so far is stale */
+static void
+resetSyncIndex(SyncDestTable *table)
+{
+    if(table->entry == NULL) {
+	return;
+    }
+
+    table->filled = 0;
+
+    /* generation wrapped: stale entries could look current again */
+    if(++table->generation == 0) {
+	memset(table->entry, 0, table->size * sizeof(SyncDestEntry));
+	table->generation = 1;
+    }
+}
+
+/* store the Sync's transportAddress in the index table - existing entries are never evicted */
 static void
-indexSync(TimeInternal *timeStamp, UInteger16 sequenceId, Integer32 transportAddress, SyncDestEntry *index)
+indexSync(TimeInternal *timeStamp, UInteger16 sequenceId, Integer32 transportAddress, SyncDestTable *table)
 {
-    uint32_t hash = 0;
+    uint32_t i;
+    SyncDestEntry *entry;
 
 #if defined(RUNTIME_DEBUG) || defined (PTPD_DBGV)
 	struct in_addr tmpAddr;
 	tmpAddr.s_addr = transportAddress;
 #endif /* RUNTIME_DEBUG */
 
-    if(timeStamp == NULL || index == NULL) {
+    if(timeStamp == NULL || table == NULL || table->entry == NULL || !transportAddress) {
 	return;
     }
 
-    hash = fnvHash(timeStamp, sizeof(TimeInternal), UNICAST_MAX_DESTINATIONS);
+    /* more Syncs this round than the table was sized for - the lookup will count the miss */
+    if(table->filled >= (table->size / 4) * 3) {
+	DBG("indexSync: index full - not indexing %s seq %d\n", inet_ntoa(tmpAddr), sequenceId);
+	return;
+    }
 
-    if(index[hash].transportAddress) {
-	DBG("indexSync: hash collision - clearing entry %s:%04x\n", inet_ntoa(tmpAddr), hash);
-	index[hash].transportAddress = 0;
-    } else {
-	DBG("indexSync: indexed successfully %s:%04x\n", inet_ntoa(tmpAddr), hash);
-	index[hash].transportAddress = transportAddress;
+    /* first slot not holding a current entry - consumed entries can be reused */
+    for(i = hashSyncIndex(timeStamp, sequenceId, table); ; i = (i + 1) & (table->size - 1)) {
+	entry = &table->entry[i];
+	if(entry->generation != table->generation) {
+	    table->filled++;
+	    break;
+	}
+	if(!entry->transportAddress) {
+	    break;
+	}
     }
+
+    entry->generation = table->generation;
+    entry->transportAddress = transportAddress;
+    entry->sequenceId = sequenceId;
+    entry->originTimestamp = *timeStamp;
+
+    DBG("indexSync: indexed %s seq %d at %04x\n", inet_ntoa(tmpAddr), sequenceId, i);
 }
 
 #endif /* PTPD_SLAVE_ONLY */
 
-/* sync destination index lookup */
+/* sync destination index lookup - the entry is consumed */
 static Integer32
-lookupSyncIndex(TimeInternal *timeStamp, UInteger16 sequenceId, SyncDestEntry *index)
+lookupSyncIndex(TimeInternal *timeStamp, UInteger16 sequenceId, SyncDestTable *table)
 {
-    uint32_t hash = 0;
-    Integer32 previousAddress;
+    uint32_t i;
+    SyncDestEntry *entry;
+    Integer32 transportAddress;
 
-    if(timeStamp == NULL || index == NULL) {
+    if(timeStamp == NULL || table == NULL || table->entry == NULL) {
 	return 0;
     }
 
-    hash = fnvHash(timeStamp, sizeof(TimeInternal), UNICAST_MAX_DESTINATIONS);
+    /* a slot never written this round ends the probe sequence */
+    for(i = hashSyncIndex(timeStamp, sequenceId, table);
+	table->entry[i].generation == table->generation;
+	i = (i + 1) & (table->size - 1)) {
 
-    if(index[hash].transportAddress == 0) {
-	DBG("lookupSyncIndex: cache miss\n");
-	return 0;
-    } else {
-	DBG("lookupSyncIndex: cache hit - clearing old entry\n");
-	previousAddress =  index[hash].transportAddress;
-	index[hash].transportAddress = 0;
-	return previousAddress;
-    }
-}
-
-/* iterative search for Sync destination for the given cached timestamp */
-static Integer32
-findSyncDestination(TimeInternal *timeStamp, const RunTimeOpts *rtOpts, PtpClock *ptpClock)
-{
-    int i = 0;
+	entry = &table->entry[i];
 
-    for(i = 0; i < UNICAST_MAX_DESTINATIONS; i++) {
-
-	if(rtOpts->unicastNegotiation) {
-		if( (timeStamp->seconds == ptpClock->unicastGrants[i].lastSyncTimestamp.seconds) &&
-		    (timeStamp->nanoseconds == ptpClock->unicastGrants[i].lastSyncTimestamp.nanoseconds)) {
-			clearTime(&ptpClock->unicastGrants[i].lastSyncTimestamp);
-			return ptpClock->unicastGrants[i].transportAddress;
-		    }
-	} else {
-		if( (timeStamp->seconds == ptpClock->unicastDestinations[i].lastSyncTimestamp.seconds) &&
-		    (timeStamp->nanoseconds == ptpClock->unicastDestinations[i].lastSyncTimestamp.nanoseconds)) {
-			clearTime(&ptpClock->unicastDestinations[i].lastSyncTimestamp);
-			return ptpClock->unicastDestinations[i].transportAddress;
-		    }
+	if(entry->transportAddress && entry->sequenceId == sequenceId &&
+	    entry->originTimestamp.seconds == timeStamp->seconds &&
+	    entry->originTimestamp.nanoseconds == timeStamp->nanoseconds) {
+		DBG("lookupSyncIndex: found seq %d at %04x\n", sequenceId, i);
+		transportAddress = entry->transportAddress;
+		entry->transportAddress = 0;
+		return transportAddress;
 	}
     }
 
+    DBG("lookupSyncIndex: seq %d not found\n", sequenceId);
     return 0;
 }
 
-static void addForeign(Octet*,MsgHeader*,PtpClock*, UInteger8, UInteger32);
+static void addForeign(Octet*,MsgHeader*,PtpClock*, UInteger8, UInteger32, const RunTimeOpts*);
+static Boolean announceChanged(const Octet*, const ForeignMasterRecord*);
 
 /* loop forever. doState() has a switch for the actions and events to be
    checked for 'port_state'. the actions and events may or may not change
@@ -222,10 +258,30 @@ static void addForeign(Octet*,MsgHeader*,PtpClock*, UInteger8, UInteger32);
    again and perform the actions required for the new 'port_state'. */
 void
 protocol(RunTimeOpts *rtOpts, PtpClock *ptpClock)
+{
+	timerStart(&ptpClock->timers[TIMINGDOMAIN_UPDATE_TIMER],timingDomain.updateInterval);
+
+	protocolStart(rtOpts, ptpClock);
+
+	for (;;)
+	{
+		protocolStep(rtOpts, ptpClock);
+
+		if (timerExpired(&ptpClock->timers[TIMINGDOMAIN_UPDATE_TIMER])) {
+			timingDomain.update(&timingDomain);
+		}
+
+		/* Perform the heavy signal processing synchronously */
+		checkSignals(rtOpts, ptpClock);
+	}
+}
+
+/* bring the port up - the part of protocol() that runs once */
+void
+protocolStart(RunTimeOpts *rtOpts, PtpClock *ptpClock)
 {
 	DBG("event POWERUP\n");
 
-	timerStart(&ptpClock->timers[TIMINGDOMAIN_UPDATE_TIMER],timingDomain.updateInterval);
 	timerStart(&ptpClock->timers[ALARM_UPDATE_TIMER],ALARM_UPDATE_INTERVAL);
 
 	ptpClock->disabled = rtOpts->portDisabled;
@@ -254,105 +310,103 @@ protocol(RunTimeOpts *rtOpts, PtpClock *ptpClock)
 	DBG("Debug Initializing...\n");
 
 	writeStatusFile(ptpClock, rtOpts, TRUE);
+}
 
-	for (;;)
-	{
-		/* 20110701: this main loop was rewritten to be more clear */
-		if(ptpClock->disabled && ptpClock->portDS.portState != PTP_DISABLED) {
-			toState(PTP_DISABLED, rtOpts, ptpClock);
-		}
-
-		if(!ptpClock->disabled && ptpClock->portDS.portState == PTP_DISABLED) {
-			toState(PTP_INITIALIZING, rtOpts, ptpClock);
-		}
-
-		if (ptpClock->portDS.portState == PTP_INITIALIZING) {
+/*
+ * one pass of the main loop for a single port: state machine, alarms
+ * and unicast grants. Anything process-wide is left to the caller.
+ */
+void
+protocolStep(RunTimeOpts *rtOpts, PtpClock *ptpClock)
+{
+	/* 20110701: this main loop was rewritten to be more clear */
+	if(ptpClock->disabled && ptpClock->portDS.portState != PTP_DISABLED) {
+		toState(PTP_DISABLED, rtOpts, ptpClock);
+	}
 
-			/*
-			 * DO NOT shut down once started. We have to "wait intelligently",
-			 * that is keep processing signals. If init failed, wait for n seconds
-			 * until next retry, do not exit. Wait in chunks so SIGALRM can interrupt.
-			 */
-			if(ptpClock->initFailure) {
-				usleep(10000);
-				ptpClock->initFailureTimeout--;
-			}
+	if(!ptpClock->disabled && ptpClock->portDS.portState == PTP_DISABLED) {
+		toState(PTP_INITIALIZING, rtOpts, ptpClock);
+	}
 
-			if(!ptpClock->initFailure || ptpClock->initFailureTimeout <= 0) {
-				if(!doInit(rtOpts, ptpClock)) {
-					ERROR("PTPd init failed - will retry in %d seconds\n", DEFAULT_FAILURE_WAITTIME);
-					writeStatusFile(ptpClock, rtOpts, TRUE);
-					ptpClock->initFailure = TRUE;
-					ptpClock->initFailureTimeout = 100 * DEFAULT_FAILURE_WAITTIME;
-					SET_ALARM(ALRM_NETWORK_FLT, TRUE);
-				} else {
-					ptpClock->initFailure = FALSE;
-					ptpClock->initFailureTimeout = 0;
-					SET_ALARM(ALRM_NETWORK_FLT, FALSE);
-				}
+	if (ptpClock->portDS.portState == PTP_INITIALIZING) {
 
+		/*
+		 * DO NOT shut down once started. We have to "wait intelligently",
+		 * that is keep processing signals. If init failed, wait for n seconds
+		 * until next retry, do not exit. Wait in chunks so SIGALRM can interrupt.
+		 */
+		if(ptpClock->initFailure) {
+			usleep(10000);
+			ptpClock->initFailureTimeout--;
+		}
+
+		if(!ptpClock->initFailure || ptpClock->initFailureTimeout <= 0) {
+			if(!doInit(rtOpts, ptpClock)) {
+				ERROR("PTPd init failed - will retry in %d seconds\n", DEFAULT_FAILURE_WAITTIME);
+				writeStatusFile(ptpClock, rtOpts, TRUE);
+				ptpClock->initFailure = TRUE;
+				ptpClock->initFailureTimeout = 100 * DEFAULT_FAILURE_WAITTIME;
+				SET_ALARM(ALRM_NETWORK_FLT, TRUE);
+			} else {
+				ptpClock->initFailure = FALSE;
+				ptpClock->initFailureTimeout = 0;
+				SET_ALARM(ALRM_NETWORK_FLT, FALSE);
 			}
 
-		} else {
-			doState(rtOpts, ptpClock);
 		}
 
-		if(ptpClock->disabled && ptpClock->portDS.portState != PTP_DISABLED) {
-			toState(PTP_DISABLED, rtOpts, ptpClock);
-		}
+	} else {
+		doState(rtOpts, ptpClock);
+	}
 
-		if (ptpClock->message_activity)
-			DBGV("activity\n");
+	if(ptpClock->disabled && ptpClock->portDS.portState != PTP_DISABLED) {
+		toState(PTP_DISABLED, rtOpts, ptpClock);
+	}
 
-		/* Configuration has changed */
-		if(rtOpts->restartSubsystems > 0) {
-			restartSubsystems(rtOpts, ptpClock);
-		}
+	if (ptpClock->message_activity)
+		DBGV("activity\n");
 
-		if (timerExpired(&ptpClock->timers[TIMINGDOMAIN_UPDATE_TIMER])) {
-			timingDomain.update(&timingDomain);
-		}
+	/* Configuration has changed */
+	if(rtOpts->restartSubsystems > 0) {
+		restartSubsystems(rtOpts, ptpClock);
+	}
 
-		if(ptpClock->defaultDS.slaveOnly) {
-			SET_ALARM(ALRM_PORT_STATE, ptpClock->portDS.portState != PTP_SLAVE);
-		}
+	if(ptpClock->defaultDS.slaveOnly) {
+		SET_ALARM(ALRM_PORT_STATE, ptpClock->portDS.portState != PTP_SLAVE);
+	}
 
-		if(ptpClock->defaultDS.clockQuality.clockClass < 128) {
-			SET_ALARM(ALRM_PORT_STATE,
-				  ptpClock->portDS.portState != PTP_MASTER &&
-				  ptpClock->portDS.portState != PTP_PASSIVE );
-		}
+	if(ptpClock->defaultDS.clockQuality.clockClass < 128) {
+		SET_ALARM(ALRM_PORT_STATE,
+			  ptpClock->portDS.portState != PTP_MASTER &&
+			  ptpClock->portDS.portState != PTP_PASSIVE );
+	}
 
-		if (timerExpired(&ptpClock->timers[ALARM_UPDATE_TIMER])) {
-			if(rtOpts->alarmInitialDelay && (ptpClock->alarmDelay > 0)) {
-				ptpClock->alarmDelay -= ALARM_UPDATE_INTERVAL;
-				if(ptpClock->alarmDelay <= 0 && rtOpts->alarmsEnabled) {
-					INFO("Alarm delay expired - starting alarm processing\n");
-					enableAlarms(ptpClock->alarms, ALRM_MAX, TRUE);
-				}
+	if (timerExpired(&ptpClock->timers[ALARM_UPDATE_TIMER])) {
+		if(rtOpts->alarmInitialDelay && (ptpClock->alarmDelay > 0)) {
+			ptpClock->alarmDelay -= ALARM_UPDATE_INTERVAL;
+			if(ptpClock->alarmDelay <= 0 && rtOpts->alarmsEnabled) {
+				INFO("Alarm delay expired - starting alarm processing\n");
+				enableAlarms(ptpClock->alarms, ALRM_MAX, TRUE);
 			}
-			updateAlarms(ptpClock->alarms, ALRM_MAX);
 		}
+		updateAlarms(ptpClock->alarms, ALRM_MAX);
+	}
 
 
-		if (timerExpired(&ptpClock->timers[UNICAST_GRANT_TIMER])) {
-			if(rtOpts->unicastDestinationsSet) {
-				refreshUnicastGrants(ptpClock->unicastGrants,
-						     ptpClock->unicastDestinationCount,
-						     rtOpts, ptpClock);
-			} else {
-				refreshUnicastGrants(ptpClock->unicastGrants,
-						     UNICAST_MAX_DESTINATIONS, rtOpts, ptpClock);
-			}
-			if(ptpClock->unicastPeerDestination.transportAddress) {
-				refreshUnicastGrants(&ptpClock->peerGrants,
-						     1, rtOpts, ptpClock);
-
-			}
+	if (timerExpired(&ptpClock->timers[UNICAST_GRANT_TIMER])) {
+		if(rtOpts->unicastDestinationsSet) {
+			refreshUnicastGrants(ptpClock->unicastGrants,
+					     ptpClock->unicastDestinationCount,
+					     rtOpts, ptpClock);
+		} else {
+			refreshUnicastGrants(ptpClock->unicastGrants,
+					     ptpClock->grantIndex.used, rtOpts, ptpClock);
 		}
+		if(ptpClock->unicastPeerDestination.transportAddress) {
+			refreshUnicastGrants(&ptpClock->peerGrants,
+					     1, rtOpts, ptpClock);
 
-		/* Perform the heavy signal processing synchronously */
-		checkSignals(rtOpts, ptpClock);
+		}
 	}
 }
 
@@ -385,6 +439,9 @@ toState(UInteger8 state, const RunTimeOpts *rtOpts, PtpClock *ptpClock)
 {
 	ptpClock->message_activity = TRUE;
 
+	/* BMC and protocol (re)initialisation change datasets without telling anyone */
+	msgInvalidateTemplates(ptpClock, MSG_TEMPLATE_ALL);
+
 	/* leaving state tasks */
 	switch (ptpClock->portDS.portState)
 	{
@@ -392,12 +449,17 @@ toState(UInteger8 state, const RunTimeOpts *rtOpts, PtpClock *ptpClock)
 
 		timerStop(&ptpClock->timers[SYNC_INTERVAL_TIMER]);
 		timerStop(&ptpClock->timers[ANNOUNCE_INTERVAL_TIMER]);
+		timerStop(&ptpClock->timers[SYNC_PACING_TIMER]);
+		timerStop(&ptpClock->timers[ANNOUNCE_PACING_TIMER]);
+		/* drop what is left of the paced rounds */
+		ptpClock->syncPacer.next = ptpClock->syncPacer.slots;
+		ptpClock->announcePacer.next = ptpClock->announcePacer.slots;
 		timerStop(&ptpClock->timers[PDELAYREQ_INTERVAL_TIMER]);
 		timerStop(&ptpClock->timers[DELAY_RECEIPT_TIMER]);
 		timerStop(&ptpClock->timers[MASTER_NETREFRESH_TIMER]);
 
 		if(rtOpts->unicastNegotiation && rtOpts->ipMode==IPMODE_UNICAST) {
-		    cancelAllGrants(ptpClock->unicastGrants, UNICAST_MAX_DESTINATIONS,
+		    cancelAllGrants(ptpClock->unicastGrants, ptpClock->grantIndex.used,
 				rtOpts, ptpClock);
 		    if(ptpClock->portDS.delayMechanism == P2P) {
 			    cancelAllGrants(&ptpClock->peerGrants, 1,
@@ -468,7 +530,7 @@ toState(UInteger8 state, const RunTimeOpts *rtOpts, PtpClock *ptpClock)
 
 			initUnicastGrantTable(ptpClock->unicastGrants,
 				ptpClock->portDS.delayMechanism,
-				UNICAST_MAX_DESTINATIONS, NULL,
+				ptpClock->unicastCapacity, NULL,
 				rtOpts, ptpClock);
 
 			if(rtOpts->unicastDestinationsSet) {
@@ -552,8 +614,7 @@ toState(UInteger8 state, const RunTimeOpts *rtOpts, PtpClock *ptpClock)
 		/* if we're ignoring announces (disable_bmca), go straight to master */
 		if(ptpClock->defaultDS.clockQuality.clockClass <= 127 && rtOpts->disableBMCA) {
 			DBG("unicast master only and ignoreAnnounce: going into MASTER state\n");
-			ptpClock->number_foreign_records = 0;
-			ptpClock->foreign_record_i = 0;
+			clearForeignMasters(ptpClock);
 			m1(rtOpts,ptpClock);
 			toState(PTP_MASTER, rtOpts, ptpClock);
 			break;
@@ -750,8 +811,13 @@ toState(UInteger8 state, const RunTimeOpts *rtOpts, PtpClock *ptpClock)
 		break;
 	}
 
+	/* let the kernel drop what the new state does not handle */
+	netUpdateFilter(ptpClock->netPath, rtOpts, ptpClock);
+
 	if (rtOpts->logStatistics)
 		logStatistics(ptpClock);
+
+	updateStatusShm(ptpClock, rtOpts);
 }
 
 
@@ -764,6 +830,26 @@ doInit(RunTimeOpts *rtOpts, PtpClock *ptpClock)
 		MANUFACTURER_ID_OUI0,
 		MANUFACTURER_ID_OUI1,
 		MANUFACTURER_ID_OUI2);
+	/* resize the unicast destination table if its capacity was changed */
+	if(rtOpts->unicastTableCapacity != ptpClock->unicastCapacity) {
+		if(allocUnicastGrantTable(ptpClock, rtOpts->unicastTableCapacity)) {
+			INFO("Unicast destination table capacity set to %d\n", ptpClock->unicastCapacity);
+		} else {
+			WARNING("Could not resize unicast destination table, keeping capacity %d\n",
+				ptpClock->unicastCapacity);
+		}
+	}
+
+	/* resize the foreign master table if its capacity was changed */
+	if(rtOpts->max_foreign_records != ptpClock->max_foreign_records) {
+		if(allocForeignMasterTable(ptpClock, rtOpts->max_foreign_records)) {
+			INFO("Foreign master table capacity set to %d\n", ptpClock->max_foreign_records);
+		} else {
+			WARNING("Could not resize foreign master table, keeping capacity %d\n",
+				ptpClock->max_foreign_records);
+		}
+	}
+
 	/* initialize networking */
 	netShutdown(ptpClock->netPath);
 
@@ -855,9 +941,7 @@ doState(RunTimeOpts *rtOpts, PtpClock *ptpClock)
 
 			if(!ptpClock->defaultDS.slaveOnly &&
 			   ptpClock->defaultDS.clockQuality.clockClass != SLAVE_ONLY_CLOCK_CLASS) {
-				ptpClock->number_foreign_records = 0;
-				ptpClock->foreign_record_i = 0;
-				ptpClock->bestMaster = NULL;
+				clearForeignMasters(ptpClock);
 				m1(rtOpts,ptpClock);
 				toState(PTP_MASTER, rtOpts, ptpClock);
 
@@ -876,6 +960,7 @@ doState(RunTimeOpts *rtOpts, PtpClock *ptpClock)
 				*/
 				if (!ptpClock->bestMaster->disqualified) {
 					ptpClock->bestMaster->disqualified = TRUE;
+					invalidateForeignBest(ptpClock);
 					WARNING("GM announce timeout, disqualified current best GM\n");
 					ptpClock->counters.announceTimeouts++;
 				}
@@ -894,9 +979,7 @@ doState(RunTimeOpts *rtOpts, PtpClock *ptpClock)
 					INFO("Waiting for new master, %d of %d attempts\n",ptpClock->announceTimeouts,rtOpts->announceTimeoutGracePeriod);
 				} else {
 					WARNING("No active masters present. Resetting port.\n");
-					ptpClock->number_foreign_records = 0;
-					ptpClock->foreign_record_i = 0;
-					ptpClock->bestMaster = NULL;
+					clearForeignMasters(ptpClock);
 					/* if flipping between primary and backup interface, a full network re-init is required */
 					if(netHasBackupInterface(rtOpts)) {
 						netPathToggleUsePrimaryIf(ptpClock->netPath);
@@ -1021,6 +1104,7 @@ doState(RunTimeOpts *rtOpts, PtpClock *ptpClock)
 		if (timerExpired(&ptpClock->timers[STATISTICS_UPDATE_TIMER])) {
 			if(!rtOpts->enablePanicMode || !ptpClock->panicMode)
 				updatePtpEngineStats(ptpClock, rtOpts);
+			flushStatistics();
 		}
 #endif /* PTPD_STATISTICS */
 
@@ -1145,11 +1229,23 @@ doState(RunTimeOpts *rtOpts, PtpClock *ptpClock)
 
 			issueSync(rtOpts, ptpClock);
 		}
+
+		/* next slot of the paced unicast rounds */
+		if (timerExpired(&ptpClock->timers[SYNC_PACING_TIMER])) {
+			if(issuePacedSlot(&ptpClock->syncPacer, SYNC_INDEXED, rtOpts, ptpClock)) {
+				timerStop(&ptpClock->timers[SYNC_PACING_TIMER]);
+			}
+		}
+		if (timerExpired(&ptpClock->timers[ANNOUNCE_PACING_TIMER])) {
+			if(issuePacedSlot(&ptpClock->announcePacer, ANNOUNCE_INDEXED, rtOpts, ptpClock)) {
+				timerStop(&ptpClock->timers[ANNOUNCE_PACING_TIMER]);
+			}
+		}
 		if(!ptpClock->warnedUnicastCapacity) {
-		    if(ptpClock->slaveCount >= UNICAST_MAX_DESTINATIONS ||
-			ptpClock->unicastDestinationCount >= UNICAST_MAX_DESTINATIONS) {
+		    if(ptpClock->slaveCount >= ptpClock->unicastCapacity ||
+			ptpClock->unicastDestinationCount >= ptpClock->unicastCapacity) {
 			    if(rtOpts->ipMode == IPMODE_UNICAST) {
-				WARNING("Maximum unicast slave capacity reached: %d\n",UNICAST_MAX_DESTINATIONS);
+				WARNING("Maximum unicast slave capacity reached: %d\n",ptpClock->unicastCapacity);
 				ptpClock->warnedUnicastCapacity = TRUE;
 			    }
 		    }
@@ -1188,8 +1284,11 @@ doState(RunTimeOpts *rtOpts, PtpClock *ptpClock)
 		periodicUpdate(rtOpts, ptpClock);
 	}
 
-        if(LogFileHandlerIsEnabled(LOGFILE_STATUS) && timerExpired(&ptpClock->timers[STATUSFILE_UPDATE_TIMER])) {
+        if((LogFileHandlerIsEnabled(LOGFILE_STATUS) || statusShmEnabled()) &&
+	    timerExpired(&ptpClock->timers[STATUSFILE_UPDATE_TIMER])) {
                 writeStatusFile(ptpClock,rtOpts,TRUE);
+		/* masters and unsynchronised slaves have no servo updates - keep counters and rates current */
+		updateStatusShm(ptpClock, rtOpts);
 		/* ensures that the current updare interval is used */
 		timerStart(&ptpClock->timers[STATUSFILE_UPDATE_TIMER],rtOpts->statusFileUpdateInterval);
         }
@@ -1260,6 +1359,11 @@ processMessage(RunTimeOpts* rtOpts, PtpClock* ptpClock, TimeInternal* timeStamp,
      * wowczarek: added compatibility flag to always respect the
      * announced UTC offset, preventing clock jumps with some GMs
      */
+    /* kernel timestamps are taken from the system clock - move them onto ours */
+    if (timeStamp->seconds || timeStamp->nanoseconds) {
+	clockBackendFromSystemTime(timeStamp);
+    }
+
     DBGV("__UTC_offset: %d %d \n", ptpClock->timePropertiesDS.currentUtcOffsetValid, ptpClock->timePropertiesDS.currentUtcOffset);
     if (respectUtcOffset(rtOpts, ptpClock) == TRUE) {
 	timeStamp->seconds += ptpClock->timePropertiesDS.currentUtcOffset;
@@ -1448,6 +1552,62 @@ processMessage(RunTimeOpts* rtOpts, PtpClock* ptpClock, TimeInternal* timeStamp,
 }
 
 
+/*
+ * pick up the transmit timestamps of event messages as they come back
+ * through the error queue, and carry on where issue*() left off
+ */
+static void
+processTxTimestamps(const RunTimeOpts *rtOpts, PtpClock *ptpClock)
+{
+    NetTxTimestamp txTimestamp;
+
+    netProcessTxTimestamps(ptpClock->netPath);
+
+    while (netGetTxTimestamp(ptpClock->netPath, &txTimestamp)) {
+
+	clockBackendFromSystemTime(&txTimestamp.timestamp);
+
+	if (respectUtcOffset(rtOpts, ptpClock) == TRUE) {
+	    txTimestamp.timestamp.seconds += ptpClock->timePropertiesDS.currentUtcOffset;
+	}
+
+	switch (txTimestamp.messageType) {
+#ifndef PTPD_SLAVE_ONLY /* does not get compiled when building slave only */
+	case SYNC:
+	    processSyncFromSelf(&txTimestamp.timestamp, rtOpts, ptpClock,
+				txTimestamp.destination, txTimestamp.sequenceId);
+	    break;
+#endif /* PTPD_SLAVE_ONLY */
+	case DELAY_REQ:
+	    /* only the last one we sent is of any use */
+	    if (txTimestamp.sequenceId != (UInteger16)(ptpClock->sentDelayReqSequenceId - 1)) {
+		DBG("processTxTimestamps: stale DelayReq TX timestamp (seq %d)\n",
+		    txTimestamp.sequenceId);
+		break;
+	    }
+	    processDelayReqFromSelf(&txTimestamp.timestamp, rtOpts, ptpClock);
+	    break;
+	case PDELAY_REQ:
+	    if (txTimestamp.sequenceId != (UInteger16)(ptpClock->sentPdelayReqSequenceId - 1)) {
+		DBG("processTxTimestamps: stale PdelayReq TX timestamp (seq %d)\n",
+		    txTimestamp.sequenceId);
+		break;
+	    }
+	    processPdelayReqFromSelf(&txTimestamp.timestamp, rtOpts, ptpClock);
+	    break;
+	case PDELAY_RESP:
+	    processPdelayRespFromSelf(&txTimestamp.timestamp, rtOpts, ptpClock,
+				      txTimestamp.destination, txTimestamp.sequenceId,
+				      &txTimestamp.requestingPortIdentity);
+	    break;
+	default:
+	    DBG("processTxTimestamps: unexpected TX timestamp for message type %d\n",
+		txTimestamp.messageType);
+	    break;
+	}
+    }
+}
+
 /* check and handle received messages */
 static void
 handle(RunTimeOpts *rtOpts, PtpClock *ptpClock)
@@ -1457,11 +1617,20 @@ handle(RunTimeOpts *rtOpts, PtpClock *ptpClock)
     Boolean timeout = FALSE;
 
     TimeInternal timeStamp = { 0, 0 };
+    TimeInternal timeLeft;
+    double nextExpiry;
     fd_set readfds;
 
     FD_ZERO(&readfds);
     if (!ptpClock->message_activity) {
-	ret = netSelect(NULL, ptpClock->netPath, &readfds);
+	/* sleep until the next timer deadline unless a message arrives first */
+	nextExpiry = timerNextExpiry(ptpClock->timers);
+	/* do not oversleep TX timestamps that fail to arrive */
+	if (netPathTxTimestampsPending(ptpClock->netPath) &&
+	    (nextExpiry < 0 || nextExpiry > LATE_TXTIMESTAMP_US / 1E6))
+	    nextExpiry = LATE_TXTIMESTAMP_US / 1E6;
+	timeLeft = doubleToTimeInternal(nextExpiry);
+	ret = netSelect(nextExpiry < 0 ? NULL : &timeLeft, ptpClock->netPath, &readfds);
 	if (ret < 0) {
 	    PERROR("failed to poll sockets");
 	    ptpClock->counters.messageRecvErrors++;
@@ -1469,6 +1638,8 @@ handle(RunTimeOpts *rtOpts, PtpClock *ptpClock)
 	    return;
 	} else if (!ret) {
 	    /* DBGV("handle: nothing\n"); */
+	    if (netPathTxTimestampsPending(ptpClock->netPath))
+		processTxTimestamps(rtOpts, ptpClock);
 	    return;
 	}
 	/* else length > 0 */
@@ -1476,8 +1647,18 @@ handle(RunTimeOpts *rtOpts, PtpClock *ptpClock)
 
     DBG("handle: something\n");
 
+    /* TX timestamps arrive on the event socket's error queue */
+    if (netPathTxTimestampsPending(ptpClock->netPath) ||
+	netPathEventSocketIsSet(ptpClock->netPath, &readfds))
+	processTxTimestamps(rtOpts, ptpClock);
+
+    /*
+     * the network layer may have received several datagrams in one go -
+     * keep going until the whole batch has been processed
+     */
     if (netPathEventSocketIsSet(ptpClock->netPath, &readfds)) {
-      length = netRecvEvent(ptpClock->msgIbuf, &timeStamp, ptpClock->netPath, 0, &timeout);
+      do {
+        length = netRecvEvent(ptpClock->msgIbuf, &timeStamp, ptpClock->netPath, 0, &timeout);
         if (timeout) /* timeout, return for now */
             return;
         if (length < 0) {
@@ -1486,13 +1667,18 @@ handle(RunTimeOpts *rtOpts, PtpClock *ptpClock)
             ptpClock->counters.messageRecvErrors++;
             return;
         }
+        /* nothing usable in this slot (error queue wakeup, bad message) - the rest of the batch still is */
+        if (!length)
+            continue;
         if (ptpClock->leapSecondInProgress) {
             DBG("Leap second in progress - will not process event message\n");
         } else {
             processMessage(rtOpts, ptpClock, &timeStamp, length);
         }
+      } while (netPathEventPending(ptpClock->netPath));
     }
     if (netPathGeneralSocketIsSet(ptpClock->netPath, &readfds)) {
+      do {
         length = netRecvGeneral(ptpClock->msgIbuf, ptpClock->netPath, &timeout);
         if (timeout) /* timeout, return for now */
             return;
@@ -1503,6 +1689,7 @@ handle(RunTimeOpts *rtOpts, PtpClock *ptpClock)
             return;
         }
         processMessage(rtOpts, ptpClock, &timeStamp, length);
+      } while (netPathGeneralPending(ptpClock->netPath));
     }
 }
 
@@ -1532,7 +1719,7 @@ handleAnnounce(MsgHeader *header, ssize_t length,
 	if(rtOpts->unicastNegotiation && rtOpts->ipMode == IPMODE_UNICAST) {
 
 		nodeTable = findUnicastGrants(&header->sourcePortIdentity, 0,
-							ptpClock->unicastGrants, &ptpClock->grantIndex, UNICAST_MAX_DESTINATIONS,
+							ptpClock->unicastGrants, &ptpClock->grantIndex, ptpClock->unicastCapacity,
 							FALSE);
 		if(nodeTable == NULL || !(nodeTable->grantData[ANNOUNCE_INDEXED].granted)) {
 			if(!rtOpts->unicastAcceptAny) {
@@ -1585,6 +1772,11 @@ handleAnnounce(MsgHeader *header, ssize_t length,
 			       header,sizeof(MsgHeader));
 			memcpy(&ptpClock->bestMaster->announce,
 			       &ptpClock->msgTmp.announce,sizeof(MsgAnnounce));
+			touchForeignMaster(ptpClock, ptpClock->bestMaster);
+			if(announceChanged(ptpClock->msgIbuf, ptpClock->bestMaster)) {
+				memcpy(ptpClock->bestMaster->announceData, ptpClock->msgIbuf, ANNOUNCE_LENGTH);
+				foreignMasterChanged(ptpClock, ptpClock->bestMaster, rtOpts);
+			}
 
 			if(ptpClock->leapSecondInProgress) {
 				/*
@@ -1660,7 +1852,7 @@ handleAnnounce(MsgHeader *header, ssize_t length,
 			 * the slave will  sit idle if current parent
 			 * is not announcing, but another GM is
 			 */
-			addForeign(ptpClock->msgIbuf,header,ptpClock,localPreference,netPathGetLastSourceAddress(ptpClock->netPath));
+			addForeign(ptpClock->msgIbuf,header,ptpClock,localPreference,netPathGetLastSourceAddress(ptpClock->netPath), rtOpts);
 			break;
 
 		default:
@@ -1705,6 +1897,9 @@ handleAnnounce(MsgHeader *header, ssize_t length,
 			 */
 			/* update datasets (file bmc.c) */
 			s1(header,&ptpClock->msgTmp.announce,ptpClock, rtOpts);
+			if(ptpClock->bestMaster) {
+				touchForeignMaster(ptpClock, ptpClock->bestMaster);
+			}
 
 			DBG("___ Announce: received Announce from current Master, so reset the Announce timer\n\n");
 
@@ -1721,7 +1916,7 @@ handleAnnounce(MsgHeader *header, ssize_t length,
 
 			DBG("___ Announce: received Announce from another master, will add to the list, as it might be better\n\n");
 			DBGV("this is to be decided immediatly by bmc())\n\n");
-			addForeign(ptpClock->msgIbuf,header,ptpClock,localPreference,netPathGetLastSourceAddress(ptpClock->netPath));
+			addForeign(ptpClock->msgIbuf,header,ptpClock,localPreference,netPathGetLastSourceAddress(ptpClock->netPath), rtOpts);
 		}
 		break;
 
@@ -1739,7 +1934,7 @@ handleAnnounce(MsgHeader *header, ssize_t length,
 		}
 		ptpClock->counters.announceMessagesReceived++;
 		DBGV("Announce message from another foreign master\n");
-		addForeign(ptpClock->msgIbuf,header,ptpClock, localPreference,netPathGetLastSourceAddress(ptpClock->netPath));
+		addForeign(ptpClock->msgIbuf,header,ptpClock, localPreference,netPathGetLastSourceAddress(ptpClock->netPath), rtOpts);
 		ptpClock->record_update = TRUE;    /* run BMC() as soon as possible */
 		break;
 
@@ -1774,7 +1969,7 @@ handleSync(const MsgHeader *header, ssize_t length,
 	if(!isFromSelf && rtOpts->unicastNegotiation && rtOpts->ipMode == IPMODE_UNICAST) {
 	    UnicastGrantTable *nodeTable = NULL;
 	    nodeTable = findUnicastGrants(&header->sourcePortIdentity, 0,
-			ptpClock->unicastGrants, &ptpClock->grantIndex, UNICAST_MAX_DESTINATIONS,
+			ptpClock->unicastGrants, &ptpClock->grantIndex, ptpClock->unicastCapacity,
 			FALSE);
 	    if(nodeTable != NULL) {
 		nodeTable->grantData[SYNC_INDEXED].receiving = header->sequenceId;
@@ -1907,6 +2102,7 @@ handleSync(const MsgHeader *header, ssize_t length,
 				if (ptpClock->clockControl.updateOK) {
 					ptpClock->acceptedUpdates++;
 					updateClock(rtOpts,ptpClock);
+					updateStatusShm(ptpClock, rtOpts);
 				}
 				ptpClock->offsetUpdates++;
 
@@ -1936,28 +2132,23 @@ handleSync(const MsgHeader *header, ssize_t length,
 				msgUnpackSync(ptpClock->msgIbuf,
 					      &ptpClock->msgTmp.sync);
 				toInternalTime(&OriginTimestamp, &ptpClock->msgTmp.sync.originTimestamp);
-			    dst = lookupSyncIndex(&OriginTimestamp, header->sequenceId, ptpClock->syncDestIndex);
+			    dst = lookupSyncIndex(&OriginTimestamp, header->sequenceId, &ptpClock->syncDestTable);
+
+			    /* give up. Better than sending FollowUp to random destinations*/
+			    if(!dst) {
+				DBG("handleSync: master sync dest not found for followUp. Giving up.\n");
+				ptpClock->counters.syncDestinationMisses++;
+				return;
+			    }
 
 #ifdef RUNTIME_DEBUG
 			    {
 				struct in_addr tmpAddr;
 				tmpAddr.s_addr = dst;
-				DBG("handleSync: master sync dest cache hit: %s\n", inet_ntoa(tmpAddr));
+				DBG("handleSync: master sync dest found: %s\n", inet_ntoa(tmpAddr));
 			    }
 #endif /* RUNTIME_DEBUG */
 
-			    if(!dst) {
-				DBG("handleSync: master sync dest cache miss - searching\n");
-				dst = findSyncDestination(&OriginTimestamp, rtOpts, ptpClock);
-				/* give up. Better than sending FollowUp to random destinations*/
-				if(!dst) {
-				    DBG("handleSync: master sync dest not found for followUp. Giving up.\n");
-				    return;
-				} else {
-				    DBG("unicast destination found.\n");
-				}
-			    }
-
 			}
 
 #ifndef PTPD_SLAVE_ONLY /* does not get compiled when building slave only */
@@ -2050,6 +2241,7 @@ handleFollowUp(const MsgHeader *header, ssize_t length,
 					if (ptpClock->clockControl.updateOK) {
 						ptpClock->acceptedUpdates++;
 						updateClock(rtOpts,ptpClock);
+						updateStatusShm(ptpClock, rtOpts);
 					}
 					ptpClock->offsetUpdates++;
 
@@ -2101,7 +2293,7 @@ handleDelayReq(const MsgHeader *header, ssize_t length,
 
 		if(!isFromSelf && rtOpts->unicastNegotiation && rtOpts->ipMode == IPMODE_UNICAST) {
 		    nodeTable = findUnicastGrants(&header->sourcePortIdentity, 0,
-				ptpClock->unicastGrants, &ptpClock->grantIndex, UNICAST_MAX_DESTINATIONS,
+				ptpClock->unicastGrants, &ptpClock->grantIndex, ptpClock->unicastCapacity,
 				FALSE);
 		    if(nodeTable == NULL || !(nodeTable->grantData[DELAY_RESP_INDEXED].granted)) {
 			DBG("Ignoring Delay Request from slave: unicast transmission not granted\n");
@@ -2227,7 +2419,7 @@ handleDelayResp(const MsgHeader *header, ssize_t length,
 		if(rtOpts->unicastNegotiation && rtOpts->ipMode == IPMODE_UNICAST) {
 		    UnicastGrantTable *nodeTable = NULL;
 		    nodeTable = findUnicastGrants(&header->sourcePortIdentity, 0,
-				ptpClock->unicastGrants, &ptpClock->grantIndex, UNICAST_MAX_DESTINATIONS,
+				ptpClock->unicastGrants, &ptpClock->grantIndex, ptpClock->unicastCapacity,
 				FALSE);
 		    if(nodeTable != NULL) {
 			nodeTable->grantData[DELAY_RESP_INDEXED].receiving = header->sequenceId;
@@ -2393,7 +2585,7 @@ handlePdelayReq(MsgHeader *header, ssize_t length,
 
 		if(!isFromSelf && rtOpts->unicastNegotiation && rtOpts->ipMode == IPMODE_UNICAST) {
 		    nodeTable = findUnicastGrants(&header->sourcePortIdentity, 0,
-				ptpClock->unicastGrants, &ptpClock->grantIndex, UNICAST_MAX_DESTINATIONS,
+				ptpClock->unicastGrants, &ptpClock->grantIndex, ptpClock->unicastCapacity,
 				FALSE);
 		    if(nodeTable == NULL || !(nodeTable->grantData[PDELAY_RESP_INDEXED].granted)) {
 			DBG("Ignoring Peer Delay Request from peer: unicast transmission not granted\n");
@@ -2432,8 +2624,10 @@ handlePdelayReq(MsgHeader *header, ssize_t length,
 				break;
 			} else {
 				ptpClock->counters.pdelayReqMessagesReceived++;
-				msgUnpackHeader(ptpClock->msgIbuf,
-						&ptpClock->PdelayReqHeader);
+				/* kept for the follow-up - oldest overwritten */
+				ptpClock->pdelayReqPending[ptpClock->pdelayReqPendingNext].header = *header;
+				ptpClock->pdelayReqPending[ptpClock->pdelayReqPendingNext].pending = TRUE;
+				ptpClock->pdelayReqPendingNext = (ptpClock->pdelayReqPendingNext + 1) % PDELAY_REQ_PENDING;
 				issuePdelayResp(tint, header, sourceAddress, rtOpts,
 						ptpClock);
 				break;
@@ -2511,12 +2705,13 @@ handlePdelayResp(const MsgHeader *header, TimeInternal *tint,
 
 		case PTP_SLAVE:
 		case PTP_MASTER:
+			msgUnpackPdelayResp(ptpClock->msgIbuf,
+					    &ptpClock->msgTmp.presp);
 			if (ptpClock->defaultDS.twoStepFlag && isFromSelf) {
-				processPdelayRespFromSelf(tint, rtOpts, ptpClock, dst, header->sequenceId);
+				processPdelayRespFromSelf(tint, rtOpts, ptpClock, dst, header->sequenceId,
+							  &ptpClock->msgTmp.presp.requestingPortIdentity);
 				break;
 			}
-			msgUnpackPdelayResp(ptpClock->msgIbuf,
-					    &ptpClock->msgTmp.presp);
 
 			if (ptpClock->sentPdelayReqSequenceId !=
 			       ((UInteger16)(header->sequenceId + 1))) {
@@ -2628,13 +2823,32 @@ handlePdelayResp(const MsgHeader *header, TimeInternal *tint,
 }
 
 static void
-processPdelayRespFromSelf(const TimeInternal * tint, const RunTimeOpts * rtOpts, PtpClock * ptpClock, Integer32 dst, const UInteger16 sequenceId)
+processPdelayRespFromSelf(const TimeInternal * tint, const RunTimeOpts * rtOpts, PtpClock * ptpClock, Integer32 dst, const UInteger16 sequenceId, const PortIdentity *requestingPortIdentity)
 {
 	TimeInternal timestamp;
+	PdelayReqRecord *request;
+	int i;
+
+	/* the request this response answered, not just the last one handled */
+	for (i = 0; i < PDELAY_REQ_PENDING; i++) {
+		request = &ptpClock->pdelayReqPending[i];
+		if (request->pending && request->header.sequenceId == sequenceId &&
+		    !cmpPortIdentity(&request->header.sourcePortIdentity, requestingPortIdentity)) {
+			break;
+		}
+	}
+
+	if (i == PDELAY_REQ_PENDING) {
+		DBG("processPdelayRespFromSelf: PdelayReq %d no longer known - no follow-up sent\n",
+		    sequenceId);
+		return;
+	}
+
+	request->pending = FALSE;
 
 	addTime(&timestamp, tint, &rtOpts->outboundLatency);
 
-	issuePdelayRespFollowUp(&timestamp, &ptpClock->PdelayReqHeader, dst,
+	issuePdelayRespFollowUp(&timestamp, &request->header, dst,
 		rtOpts, ptpClock, sequenceId);
 }
 
@@ -2812,42 +3026,20 @@ static void
 issueAnnounce(const RunTimeOpts *rtOpts,PtpClock *ptpClock)
 {
 	Integer32 dst = 0;
-	int i = 0;
-	UnicastGrantData *grant = NULL;
-	Boolean okToSend = TRUE;
+
+	/*
+	 * the Announce body follows the BMC and time properties, which change all the time:
+	 * pack it once per round, every destination gets a copy
+	 */
+	msgInvalidateTemplates(ptpClock, MSG_TEMPLATE_ANNOUNCE);
 
 	/* send Announce to Ethernet or multicast */
 	if(rtOpts->transport == IEEE_802_3 || (rtOpts->ipMode != IPMODE_UNICAST)) {
 		issueAnnounceSingle(dst, &ptpClock->sentAnnounceSequenceId, rtOpts, ptpClock);
-	/* send Announce to unicast destination(s) */
+	/* send Announce to unicast destination(s), spread across the interval */
 	} else {
-	    /* send to granted only */
-	    if(rtOpts->unicastNegotiation) {
-		for(i = 0; i < UNICAST_MAX_DESTINATIONS; i++) {
-		    grant = &(ptpClock->unicastGrants[i].grantData[ANNOUNCE_INDEXED]);
-		    okToSend = TRUE;
-		    if(grant->logInterval > ptpClock->portDS.logAnnounceInterval ) {
-			grant->intervalCounter %= (UInteger32)(pow(2,grant->logInterval - ptpClock->portDS.logAnnounceInterval));
-			if(grant->intervalCounter != 0) {
-			    okToSend = FALSE;
-			}
-			grant->intervalCounter++;
-		    }
-		    if(grant->granted) {
-			if(okToSend) {
-			    issueAnnounceSingle(ptpClock->unicastGrants[i].transportAddress,
-			    &grant->sentSeqId,rtOpts, ptpClock);
-			}
-		    }
-		}
-	    /* send to fixed unicast destinations */
-	    } else {
-		for(i = 0; i < ptpClock->unicastDestinationCount; i++) {
-			issueAnnounceSingle(ptpClock->unicastDestinations[i].transportAddress,
-			&(ptpClock->unicastGrants[i].grantData[ANNOUNCE_INDEXED].sentSeqId),
-						rtOpts, ptpClock);
-		    }
-		}
+		startPacedRound(&ptpClock->announcePacer, ANNOUNCE_INDEXED, ANNOUNCE_PACING_TIMER,
+				ptpClock->portDS.logAnnounceInterval, rtOpts, ptpClock);
 	}
 }
 
@@ -2875,59 +3067,252 @@ issueAnnounceSingle(Integer32 dst, UInteger16 *sequenceId, const RunTimeOpts *rt
 	}
 }
 
+/* pack a single unicast Announce and queue it, to be sent with the rest of its slot by issuePacedSlot() */
+static void
+queueAnnounceSingle(Integer32 dst, UInteger16 *sequenceId, const RunTimeOpts *rtOpts,PtpClock *ptpClock)
+{
+	Timestamp originTimestamp;
+	TimeInternal internalTime;
+
+	getTime(&internalTime);
+	fromInternalTime(&internalTime,&originTimestamp);
+
+	msgPackAnnounce(ptpClock->msgObuf, *sequenceId, &originTimestamp, ptpClock);
+
+	netQueueGeneral(ptpClock->msgObuf, ANNOUNCE_LENGTH, ptpClock->netPath, dst);
+
+	DBGV("Announce MSG queued ! \n");
+	(*sequenceId)++;
+}
+
 /* send Sync to all destinations */
 static void
 issueSync(const RunTimeOpts *rtOpts,PtpClock *ptpClock)
 {
 	Integer32 dst = 0;
-	int i = 0;
-	UnicastGrantData *grant = NULL;
-	Boolean okToSend = TRUE;
 
 	/* send Sync to Ethernet or multicast */
 	if(rtOpts->transport == IEEE_802_3 || (rtOpts->ipMode != IPMODE_UNICAST)) {
 		(void)issueSyncSingle(dst, &ptpClock->sentSyncSequenceId, rtOpts, ptpClock);
 
-	/* send Sync to unicast destination(s) */
+	/*
+	 * send Sync to unicast destination(s), spread across the interval -
+	 * FollowUps go out as the TX timestamps come back through the event loop,
+	 * see processTxTimestamps()
+	 */
 	} else {
-	    for(i = 0; i < UNICAST_MAX_DESTINATIONS; i++) {
-		ptpClock->syncDestIndex[i].transportAddress = 0;
-		clearTime(&ptpClock->unicastGrants[i].lastSyncTimestamp);
-		clearTime(&ptpClock->unicastDestinations[i].lastSyncTimestamp);
-	    }
-	    /* send to granted only */
-	    if(rtOpts->unicastNegotiation) {
-		for(i = 0; i < UNICAST_MAX_DESTINATIONS; i++) {
-		    grant = &(ptpClock->unicastGrants[i].grantData[SYNC_INDEXED]);
-		    okToSend = TRUE;
-		    /* handle different intervals */
-		    if(grant->logInterval > ptpClock->portDS.logSyncInterval ) {
-			grant->intervalCounter %= (UInteger32)(pow(2,grant->logInterval - ptpClock->portDS.logSyncInterval));
-			if(grant->intervalCounter != 0) {
-			    okToSend = FALSE;
-			}
-			DBG("mixed interval to %d counter: %d\n", grant->parent->transportAddress,grant->intervalCounter);
-			grant->intervalCounter++;
-		    }
+		startPacedRound(&ptpClock->syncPacer, SYNC_INDEXED, SYNC_PACING_TIMER,
+				ptpClock->portDS.logSyncInterval, rtOpts, ptpClock);
+	}
+}
 
-		    if(grant->granted) {
-			if(okToSend) {
-			    ptpClock->unicastGrants[i].lastSyncTimestamp =
-				issueSyncSingle(ptpClock->unicastGrants[i].transportAddress,
-				&grant->sentSeqId,rtOpts, ptpClock);
-			}
+/*
+ * Start a new round of unicast Sync or Announce messages. Instead of
+ * sending to every destination in one burst, the interval is divided into
+ * slots and every grant goes out in the slot given by its phase, one slot
+ * per tick of the pacing timer. The first slot is sent right away.
+ */
+static void
+startPacedRound(UnicastPacer *pacer, int messageIndex, int pacingTimer, Integer8 logInterval,
+		const RunTimeOpts *rtOpts, PtpClock *ptpClock)
+{
+	int i, slot;
+	int count = 0;
+	int slots = rtOpts->unicastPacingSlots;
+	double interval = pow(2, logInterval);
+	UnicastGrantData *grant = NULL;
+	Boolean okToSend = TRUE;
+
+	if(pacer->order == NULL) {
+		return;
+	}
+
+	/* new generation first, so that the leftover Syncs below are indexed in it */
+	if(messageIndex == SYNC_INDEXED) {
+		resetSyncIndex(&ptpClock->syncDestTable);
+	}
+
+	/* anything left over from the previous round goes out first */
+	while(pacer->next < pacer->slots) {
+		issuePacedSlot(pacer, messageIndex, rtOpts, ptpClock);
+	}
+
+	/* send to granted only */
+	if(rtOpts->unicastNegotiation) {
+	    for(i = 0; i < ptpClock->grantIndex.used; i++) {
+		grant = &(ptpClock->unicastGrants[i].grantData[messageIndex]);
+		okToSend = TRUE;
+		/* handle different intervals */
+		if(grant->logInterval > logInterval) {
+		    grant->intervalCounter %= (UInteger32)(pow(2,grant->logInterval - logInterval));
+		    if(grant->intervalCounter != 0) {
+			okToSend = FALSE;
 		    }
+		    DBG("mixed interval to %d counter: %d\n", grant->parent->transportAddress,grant->intervalCounter);
+		    grant->intervalCounter++;
 		}
-	    /* send to fixed unicast destinations */
-	    } else {
-		for(i = 0; i < ptpClock->unicastDestinationCount; i++) {
-			ptpClock->unicastDestinations[i].lastSyncTimestamp =
-			    issueSyncSingle(ptpClock->unicastDestinations[i].transportAddress,
-			    &(ptpClock->unicastGrants[i].grantData[SYNC_INDEXED].sentSeqId),
-						rtOpts, ptpClock);
+		if(grant->granted && okToSend) {
+		    pacer->due[count++] = i;
+		}
+	    }
+	/* send to fixed unicast destinations */
+	} else {
+	    for(i = 0; i < ptpClock->unicastDestinationCount; i++) {
+		pacer->due[count++] = i;
+	    }
+	}
+
+	/* no slot shorter than the timers can do, nothing to pace with no messages */
+	if(slots > interval / pow(2, LOG_MIN_INTERVAL)) {
+		slots = interval / pow(2, LOG_MIN_INTERVAL);
+	}
+	if(slots < 1 || count == 0) {
+		slots = 1;
+	}
+
+	/* bucket the due entries by slot: count, prefix sum, scatter */
+	memset(pacer->start, 0, (slots + 1) * sizeof(int));
+	for(i = 0; i < count; i++) {
+		grant = &(ptpClock->unicastGrants[pacer->due[i]].grantData[messageIndex]);
+		pacer->start[((grant->phase * slots) >> 16) + 1]++;
+	}
+	for(slot = 1; slot <= slots; slot++) {
+		pacer->start[slot] += pacer->start[slot - 1];
+	}
+	for(i = 0; i < count; i++) {
+		grant = &(ptpClock->unicastGrants[pacer->due[i]].grantData[messageIndex]);
+		pacer->order[pacer->start[(grant->phase * slots) >> 16]++] = pacer->due[i];
+	}
+	/* scattering moved every start to the next slot's start */
+	for(slot = slots; slot > 0; slot--) {
+		pacer->start[slot] = pacer->start[slot - 1];
+	}
+	pacer->start[0] = 0;
+
+	pacer->slots = slots;
+	pacer->next = 0;
+	pacer->roundBurst = 0;
+	pacer->roundSent = 0;
+
+	DBGV("unicast %s round: %d messages in %d slots\n",
+		getMessageTypeName(messageIndex == SYNC_INDEXED ? SYNC : ANNOUNCE), count, slots);
+
+	if(slots > 1) {
+		timerStart(&ptpClock->timers[pacingTimer], interval / slots);
+	} else {
+		timerStop(&ptpClock->timers[pacingTimer]);
+	}
+
+	issuePacedSlot(pacer, messageIndex, rtOpts, ptpClock);
+}
+
+/* send the next slot of the current paced round in one batch, return TRUE once the round is complete */
+static Boolean
+issuePacedSlot(UnicastPacer *pacer, int messageIndex, const RunTimeOpts *rtOpts, PtpClock *ptpClock)
+{
+	int i, n;
+	int sent = 0;
+	int failed = 0;
+	int burst = 0;
+	Integer32 dst;
+	UnicastGrantData *grant;
+
+	if(pacer->next >= pacer->slots) {
+		return TRUE;
+	}
+
+	for(i = pacer->start[pacer->next]; i < pacer->start[pacer->next + 1]; i++) {
+		n = pacer->order[i];
+		grant = &(ptpClock->unicastGrants[n].grantData[messageIndex]);
+		if(rtOpts->unicastNegotiation) {
+		    /* grant cancelled or expired since the round started */
+		    if(!grant->granted) {
+			continue;
 		    }
+		    dst = ptpClock->unicastGrants[n].transportAddress;
+		} else {
+		    dst = ptpClock->unicastDestinations[n].transportAddress;
 		}
+		if(messageIndex == SYNC_INDEXED) {
+		    queueSyncSingle(dst, &grant->sentSeqId, rtOpts, ptpClock);
+		} else {
+		    queueAnnounceSingle(dst, &grant->sentSeqId, rtOpts, ptpClock);
+		}
+		burst++;
+	}
+
+	/* send the whole slot in one go - only what actually went out counts as sent */
+	if(burst > 0) {
+		if(messageIndex == SYNC_INDEXED) {
+		    sent = netFlushEvent(ptpClock->netPath, &failed);
+		    ptpClock->counters.syncMessagesSent += sent;
+		} else {
+		    sent = netFlushGeneral(ptpClock->netPath, &failed);
+		    ptpClock->counters.announceMessagesSent += sent;
+		}
+	}
+	if(failed > 0) {
+		ptpClock->counters.messageSendErrors += failed;
+		DBG("%d unicast %s messages could not be sent\n", failed,
+			getMessageTypeName(messageIndex == SYNC_INDEXED ? SYNC : ANNOUNCE));
+	}
+
+	pacer->roundSent += sent;
+
+	if(burst > pacer->roundBurst) {
+		pacer->roundBurst = burst;
+	}
+	if(burst > pacer->maxBurst) {
+		pacer->maxBurst = burst;
+	}
+
+	if(++pacer->next < pacer->slots) {
+		return FALSE;
+	}
+
+	pacer->lastSlots = pacer->slots;
+	pacer->lastRound = pacer->roundSent;
+	pacer->lastBurst = pacer->roundBurst;
+
+	return TRUE;
+}
+
+/*
+ * pack a single unicast Sync, index its destination under the origin timestamp
+ * it carries and queue it, to be sent with the rest of its slot by issuePacedSlot()
+ */
+static void
+queueSyncSingle(Integer32 dst, UInteger16 *sequenceId, const RunTimeOpts *rtOpts,PtpClock *ptpClock)
+{
+	Timestamp originTimestamp;
+	TimeInternal internalTime;
+
+	getTime(&internalTime);
+
+	if (respectUtcOffset(rtOpts, ptpClock) == TRUE) {
+		internalTime.seconds += ptpClock->timePropertiesDS.currentUtcOffset;
 	}
+
+	/* see LEAPNOTE01# */
+	if(ptpClock->leapSecondInProgress) {
+		DBG("Leap second in progress - will not send SYNC\n");
+		return;
+	}
+
+	fromInternalTime(&internalTime,&originTimestamp);
+
+	msgPackSync(ptpClock->msgObuf,*sequenceId,&originTimestamp,ptpClock);
+
+	netQueueEvent(ptpClock->msgObuf, SYNC_LENGTH, ptpClock->netPath, dst);
+
+	DBGV("Sync MSG queued ! \n");
+
+	ptpClock->lastSyncDst = dst;
+
+	/* index the Sync destination - needed when the Sync is looped back to us */
+	indexSync(&internalTime, *sequenceId, dst, &ptpClock->syncDestTable);
+
+	(*sequenceId)++;
 }
 
 /*Pack and send a single Sync message, return the embedded timestamp*/
@@ -2977,19 +3362,6 @@ issueSyncSingle(Integer32 dst, UInteger16 *sequenceId, const RunTimeOpts *rtOpts
 
 		DBGV("Sync MSG sent ! \n");
 
-#ifdef SO_TIMESTAMPING
-
-		if(netPathCheckTxTsValid(ptpClock->netPath)) {
-			if(internalTime.seconds && internalTime.nanoseconds) {
-
-			    if (respectUtcOffset(rtOpts, ptpClock) == TRUE) {
-				    internalTime.seconds += ptpClock->timePropertiesDS.currentUtcOffset;
-			    }
-			    processSyncFromSelf(&internalTime, rtOpts, ptpClock, dst, *sequenceId);
-			}
-		}
-#endif
-
 #if defined(__QNXNTO__) && defined(PTPD_EXPERIMENTAL)
 	if(internalTime.seconds && internalTime.nanoseconds) {
 	    if (respectUtcOffset(rtOpts, ptpClock) == TRUE) {
@@ -3006,8 +3378,8 @@ issueSyncSingle(Integer32 dst, UInteger16 *sequenceId, const RunTimeOpts *rtOpts
 		    internalTime = now;
 		}
 
-		/* index the Sync destination */
-		indexSync(&internalTime, *sequenceId, dst, ptpClock->syncDestIndex);
+		/* index the Sync destination under the origin timestamp it carries */
+		indexSync(&now, *sequenceId, dst, &ptpClock->syncDestTable);
 
 		(*sequenceId)++;
 		ptpClock->counters.syncMessagesSent++;
@@ -3068,6 +3440,13 @@ issueDelayReq(const RunTimeOpts *rtOpts,PtpClock *ptpClock)
 	}
 	fromInternalTime(&internalTime,&originTimestamp);
 
+	/*
+	 * forget the previous request: its response may have been lost, and
+	 * ours is only to be accepted once this request's own TX timestamp is in
+	 */
+	ptpClock->waitingForDelayResp = FALSE;
+	clearTime(&ptpClock->delay_req_send_time);
+
 	// uses current sentDelayReqSequenceId
 	msgPackDelayReq(ptpClock->msgObuf,&originTimestamp,ptpClock);
 
@@ -3088,17 +3467,6 @@ issueDelayReq(const RunTimeOpts *rtOpts,PtpClock *ptpClock)
 	} else {
 		DBGV("DelayReq MSG sent ! \n");
 
-#ifdef SO_TIMESTAMPING
-
-		if(netPathCheckTxTsValid(ptpClock->netPath)) {
-			if (respectUtcOffset(rtOpts, ptpClock) == TRUE) {
-				internalTime.seconds += ptpClock->timePropertiesDS.currentUtcOffset;
-			}
-
-			processDelayReqFromSelf(&internalTime, rtOpts, ptpClock);
-		}
-#endif
-
 #if defined(__QNXNTO__) && defined(PTPD_EXPERIMENTAL)
 			if (respectUtcOffset(rtOpts, ptpClock) == TRUE) {
 				internalTime.seconds += ptpClock->timePropertiesDS.currentUtcOffset;
@@ -3161,16 +3529,6 @@ issuePdelayReq(const RunTimeOpts *rtOpts,PtpClock *ptpClock)
 	} else {
 		DBGV("PdelayReq MSG sent ! \n");
 
-#ifdef SO_TIMESTAMPING
-
-		if(netPathCheckTxTsValid(ptpClock->netPath)) {
-			if (respectUtcOffset(rtOpts, ptpClock) == TRUE) {
-				internalTime.seconds += ptpClock->timePropertiesDS.currentUtcOffset;
-			}
-			processPdelayReqFromSelf(&internalTime, rtOpts, ptpClock);
-		}
-#endif
-
 		ptpClock->sentPdelayReqSequenceId++;
 		ptpClock->counters.pdelayReqMessagesSent++;
 	}
@@ -3210,16 +3568,6 @@ issuePdelayResp(const TimeInternal *tint,MsgHeader *header, Integer32 sourceAddr
 	} else {
 		DBGV("PdelayResp MSG sent ! \n");
 
-#ifdef SO_TIMESTAMPING
-
-		if(netPathCheckTxTsValid(ptpClock->netPath)) {
-			if (respectUtcOffset(rtOpts, ptpClock) == TRUE) {
-				internalTime.seconds += ptpClock->timePropertiesDS.currentUtcOffset;
-			}
-			processPdelayRespFromSelf(&internalTime, rtOpts, ptpClock, dst, header->sequenceId);
-		}
-#endif
-
 		ptpClock->counters.pdelayRespMessagesSent++;
 		ptpClock->lastPdelayRespDst = dst;
 	}
@@ -3277,80 +3625,70 @@ issuePdelayRespFollowUp(const TimeInternal *tint, MsgHeader *header, Integer32 d
 	}
 }
 
+/*
+ * check if an Announce carries anything the BMC cares about that the last one from
+ * this foreign master did not: everything but the correction field, sequence ID
+ * and origin timestamp, which change with every message
+ */
+static Boolean
+announceChanged(const Octet *buf, const ForeignMasterRecord *record)
+{
+	return memcmp(buf, record->announceData, 8) ||
+	       memcmp(buf + 16, record->announceData + 16, 14) ||
+	       memcmp(buf + 32, record->announceData + 32, 2) ||
+	       memcmp(buf + 44, record->announceData + 44, ANNOUNCE_LENGTH - 44);
+}
+
 static void
-addForeign(Octet *buf,MsgHeader *header,PtpClock *ptpClock, UInteger8 localPreference, UInteger32 sourceAddr)
+addForeign(Octet *buf,MsgHeader *header,PtpClock *ptpClock, UInteger8 localPreference, UInteger32 sourceAddr, const RunTimeOpts *rtOpts)
 {
-	int i,j;
-	Boolean found = FALSE;
+	ForeignMasterRecord *record;
 
 	DBGV("addForeign localPref: %d\n", localPreference);
 
-	j = ptpClock->foreign_record_best;
+	ageForeignMasters(ptpClock, rtOpts);
 
 	/*Check if Foreign master is already known*/
-	for (i=0;i<ptpClock->number_foreign_records;i++) {
-		if (!memcmp(header->sourcePortIdentity.clockIdentity,
-			    ptpClock->foreign[j].foreignMasterPortIdentity.clockIdentity,
-			    CLOCK_IDENTITY_LENGTH) &&
-		    (header->sourcePortIdentity.portNumber ==
-		     ptpClock->foreign[j].foreignMasterPortIdentity.portNumber))
-		{
-			/*Foreign Master is already in Foreignmaster data set*/
-			ptpClock->foreign[j].foreignMasterAnnounceMessages++;
-			found = TRUE;
-			DBGV("addForeign : AnnounceMessage incremented \n");
-			msgUnpackHeader(buf,&ptpClock->foreign[j].header);
-			msgUnpackAnnounce(buf,&ptpClock->foreign[j].announce);
-			ptpClock->foreign[j].disqualified = FALSE;
-			ptpClock->foreign[j].localPreference = localPreference;
-			break;
-		}
-
-		j = (j+1)%ptpClock->number_foreign_records;
-	}
-
-	/*New Foreign Master*/
-	if (!found) {
-		if (ptpClock->number_foreign_records <
-		    ptpClock->max_foreign_records) {
-			ptpClock->number_foreign_records++;
+	if((record = findForeignMaster(ptpClock, &header->sourcePortIdentity)) != NULL) {
+		/*Foreign Master is already in Foreignmaster data set*/
+		record->foreignMasterAnnounceMessages++;
+		touchForeignMaster(ptpClock, record);
+		DBGV("addForeign : AnnounceMessage incremented \n");
+		/* nothing to unpack or compare if it still announces the same */
+		if(!record->disqualified && record->localPreference == localPreference &&
+		    !announceChanged(buf, record)) {
+			return;
 		}
-
-		/* Preserve best master record from overwriting (sf FR #22) - use next slot */
-		if (ptpClock->foreign_record_i == ptpClock->foreign_record_best) {
-			ptpClock->foreign_record_i++;
-			ptpClock->foreign_record_i %= ptpClock->number_foreign_records;
+	} else {
+		/*New Foreign Master*/
+		if((record = addForeignMaster(ptpClock, &header->sourcePortIdentity)) == NULL) {
+			DBG("addForeign: foreign master table full, Announce ignored\n");
+			return;
 		}
-
-		j = ptpClock->foreign_record_i;
-
-		/*Copy new foreign master data set from Announce message*/
-		copyClockIdentity(ptpClock->foreign[j].foreignMasterPortIdentity.clockIdentity,
-		       header->sourcePortIdentity.clockIdentity);
-		ptpClock->foreign[j].foreignMasterPortIdentity.portNumber =
-			header->sourcePortIdentity.portNumber;
-		ptpClock->foreign[j].foreignMasterAnnounceMessages = 0;
-		ptpClock->foreign[j].localPreference = localPreference;
-		ptpClock->foreign[j].sourceAddr = sourceAddr;
-		ptpClock->foreign[j].disqualified = FALSE;
-		/*
-		 * header and announce field of each Foreign Master are
-		 * usefull to run Best Master Clock Algorithm
-		 */
-		msgUnpackHeader(buf,&ptpClock->foreign[j].header);
-		msgUnpackAnnounce(buf,&ptpClock->foreign[j].announce);
+		record->sourceAddr = sourceAddr;
 		DBGV("New foreign Master added \n");
-
-		ptpClock->foreign_record_i =
-			(ptpClock->foreign_record_i+1) %
-			ptpClock->max_foreign_records;
 	}
+
+	record->localPreference = localPreference;
+	record->disqualified = FALSE;
+	/*
+	 * header and announce field of each Foreign Master are
+	 * usefull to run Best Master Clock Algorithm
+	 */
+	record->header = *header;
+	msgUnpackAnnounce(buf,&record->announce);
+	memcpy(record->announceData, buf, ANNOUNCE_LENGTH);
+	foreignMasterChanged(ptpClock, record, rtOpts);
 }
 
 /* Update dataset fields which are safe to change without going into INITIALIZING */
 void
 updateDatasets(PtpClock* ptpClock, const RunTimeOpts* rtOpts)
 {
+	msgInvalidateTemplates(ptpClock, MSG_TEMPLATE_ALL);
+	/* the BMC options may have changed */
+	invalidateForeignBest(ptpClock);
+
 	if(rtOpts->unicastNegotiation) {
 	    	updateUnicastGrantTable(ptpClock->unicastGrants,
 			    ptpClock->unicastDestinationCount, rtOpts);
@@ -3456,6 +3794,10 @@ clearCounters(PtpClock * ptpClock)
 	/* TODO: print port info */
 	DBG("Port counters cleared\n");
 	memset(&ptpClock->counters, 0, sizeof(ptpClock->counters));
+	/* not a counter: the number of records in the FMR */
+	ptpClock->counters.foreignCount = ptpClock->number_foreign_records;
+	ptpClock->syncPacer.maxBurst = 0;
+	ptpClock->announcePacer.maxBurst = 0;
 }
 
 Boolean
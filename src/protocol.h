@@ -7,6 +7,8 @@
 #include "datatypes_stub.h"
 
 void protocol(RunTimeOpts*, PtpClock*);
+void protocolStart(RunTimeOpts*, PtpClock*);
+void protocolStep(RunTimeOpts*, PtpClock*);
 void setPortState(PtpClock* ptpClock, Enumeration8 state);
 void toState(UInteger8, const RunTimeOpts*, PtpClock*);
 Boolean acceptPortIdentity(PortIdentity thisPort, PortIdentity targetPort);
@@ -1,6 +1,7 @@
 #ifndef PTP_DATATYPES_H_
 #define PTP_DATATYPES_H_
 
+#include "constants.h" // For ANNOUNCE_LENGTH
 #include "dep/constants_dep.h" // For CLOCK_IDENTITY_LENGTH
 #include "ptp_primitives.h"
 
@@ -511,6 +512,10 @@ typedef struct
 	UInteger8    localPreference; /* local preference - only used by telecom profile */
 	UInteger32   sourceAddr; /* source address */
 	Boolean	     disqualified; /* if true, this one always loses */
+	Octet        announceData[ANNOUNCE_LENGTH]; /* last Announce received, to recognise unchanged ones */
+	TimeInternal lastSeen; /* monotonic time of the last Announce received */
+	Integer16    lruNewer; /* LRU list: next more recently heard from record, -1 if none */
+	Integer16    lruOlder; /* LRU list: next less recently heard from record, -1 if none */
 } ForeignMasterRecord;
 
 typedef struct {
@@ -95,6 +95,45 @@ timerRunning(IntervalTimer * itimer)
 	return timer->isRunning(timer);
 }
 
+/*
+ * Seconds until the earliest running timer in the set expires,
+ * negative if none are running. A timer whose expiry is latched but
+ * not yet serviced reports 0 once, so the main loop does not sleep past it.
+ */
+double
+timerNextExpiry(IntervalTimer *itimers)
+{
+	int i;
+	double left, ret = -1.0;
+	EventTimer *timer;
+
+	if (itimers == NULL)
+		return ret;
+
+	for(i = 0; i < PTP_MAX_TIMER; i++) {
+		timer = (EventTimer *)(itimers[i].data);
+		if(timer == NULL) {
+			continue;
+		}
+		left = timer->timeLeft(timer);
+		if(left < 0) {
+			continue;
+		}
+		if(ret < 0 || left < ret) {
+			ret = left;
+		}
+	}
+
+	return ret;
+}
+
+/* descriptor the main loop can poll for timer expiry, -1 with signal driven timers */
+int
+timerGetFd(void)
+{
+	return getEventTimerFd();
+}
+
 Boolean
 timerSetup(IntervalTimer *itimers)
 {
@@ -125,7 +164,9 @@ timerSetup(IntervalTimer *itimers)
   "MASTER_NETREFRESH",
   "CALIBRATION_DELAY",
   "CLOCK_UPDATE",
-  "TIMINGDOMAIN_UPDATE"
+  "TIMINGDOMAIN_UPDATE",
+  "SYNC_PACING",
+  "ANNOUNCE_PACING"
     };
 
     int i = 0;
@@ -30,12 +30,15 @@
 
 #include "ptp_primitives.h"
 
-#ifdef PTPD_PTIMERS
+#if defined(PTPD_TIMERFD)
+/* no signals and no minimum interval: ~4096/sec */
+#  define LOG_MIN_INTERVAL -12
+#elif defined(PTPD_PTIMERS)
 #  define LOG_MIN_INTERVAL -7
 #else
 /* 62.5ms tick for interval timers = 16/sec max */
 #  define LOG_MIN_INTERVAL -4
-#endif /* PTPD_PTIMERS */
+#endif /* PTPD_TIMERFD / PTPD_PTIMERS */
 
 /* safeguard: a week */
 #define PTPTIMER_MAX_INTERVAL 604800
@@ -80,6 +83,8 @@ enum {
   CALIBRATION_DELAY_TIMER,
   CLOCK_UPDATE_TIMER,
   TIMINGDOMAIN_UPDATE_TIMER,
+  SYNC_PACING_TIMER,	   /* unicast Sync transmissions spread across the Sync interval */
+  ANNOUNCE_PACING_TIMER,   /* unicast Announce transmissions spread across the Announce interval */
   PTP_MAX_TIMER
 };
 
@@ -88,6 +93,8 @@ void timerStop(IntervalTimer *itimer);
 void timerStart(IntervalTimer * itimer, double interval);
 Boolean timerExpired(IntervalTimer * itimer);
 Boolean timerRunning(IntervalTimer * itimer);
+double timerNextExpiry(IntervalTimer *itimers);
+int timerGetFd(void);
 Boolean timerSetup(IntervalTimer *itimers);
 void timerShutdown(IntervalTimer *itimers);
 
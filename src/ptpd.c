@@ -73,6 +73,7 @@
 #  include "dep/ntpengine/ntpdcontrol.h"
 #endif
 #include "dep/sys.h"
+#include "dep/replay.h"
 #include "protocol.h"
 #include "ptpd_logging.h"
 
@@ -103,8 +104,18 @@ main(int argc, char **argv)
 
 
 	/* Initialize run time options with command line arguments */
-	if (!runTimeOptsInit(argc, argv, &ret, &rtOpts) ||
-	    !sysPrePtpClockInit(&rtOpts, &ret) ||
+	if (!runTimeOptsInit(argc, argv, &ret, &rtOpts)) {
+		if (ret != 0 && !rtOpts.checkConfigOnly)
+			ERROR(USER_DESCRIPTION" startup failed\n");
+		return ret;
+	}
+
+	/* Offline mode: run the servo over a recorded trace and exit */
+	if (strlen(rtOpts.replayFile) > 0) {
+		return replayServoTrace(&rtOpts);
+	}
+
+	if (!sysPrePtpClockInit(&rtOpts, &ret) ||
 	    !(ptpClock = ptpClockCreate(&rtOpts, &ret, NULL)) ||
 	    !sysPostPtpClockInit(&rtOpts, ptpClock,  &ret)
 	    ) {
@@ -132,6 +132,7 @@ typedef enum {
   LOGFILE_RECORD,
   LOGFILE_EVENT,
   LOGFILE_STATUS,
+  LOGFILE_TRACE,
   LOGFILE_MAX
 } LogFile_e;
 
@@ -0,0 +1,867 @@
+/*-
+ * Copyright (c) 2015 Wojciech Owczarek,
+ *
+ * All Rights Reserved
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHORS ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE AUTHORS OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+ * OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
+ * IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/**
+ * @file   ptpd_netsim.c
+ * @date   Sun Oct 18 21:02:17 2026
+ *
+ * @brief  The main() function for the PTP network simulator
+ *
+ * Runs a number of masters and slaves as PtpClock instances in one
+ * process, each with its own simulated oscillator, connected by the
+ * simulated network and driven by virtual time: the simulator jumps
+ * from one event (packet arrival or timer expiry) to the next, so hours
+ * of protocol time take seconds. Master 0 is the intended grandmaster -
+ * the other masters run with a worse priority1. At the end, the time
+ * each slave took to lock to the grandmaster, the offsets after lock,
+ * the time the BMC took to settle and the master's cost per packet are
+ * printed.
+ *
+ * The protocol engine is the daemon's own, built against the simulated
+ * NetPath (port_sim/net.c) and event timers (eventtimer_sim.c).
+ */
+
+#ifdef HAVE_CONFIG_H
+#  include <config.h>
+#endif /* HAVE_CONFIG_H */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <math.h>
+#include <time.h>
+#include <unistd.h>
+#include <arpa/inet.h>
+
+#include "constants.h"
+#include "dep/constants_dep.h"
+#include "ptp_primitives.h"
+#include "ptp_datatypes.h"
+#include "ptp_timers.h"
+#include "timingdomain.h"
+#include "datatypes.h"
+#include "display.h" // For portState_getName
+#include "protocol.h"
+#include "signaling.h" // For freeUnicastGrantTable
+#include "bmc.h" // For freeForeignMasterTable
+#include "dep/msg.h" // For freeManagementTLV
+#include "dep/net.h"
+#include "dep/configdefaults.h"
+#include "dep/daemonconfig.h"
+#include "dep/startup.h" // For ptpClockCreate
+#include "dep/iniparser/iniparser.h"
+#include "dep/clockbackend.h"
+#include "dep/clocksim.h"
+#include "dep/netsim.h"
+#include "ptpd_logging.h"
+
+/* the daemon's globals: logging, and whatever node is being run at the moment */
+RunTimeOpts rtOpts;
+Boolean startupInProgress;
+PtpClock *G_ptpClock = NULL;
+TimingDomain timingDomain;
+
+#define NETSIM_MAX_MASTERS	16
+#define NETSIM_MAX_NODES	65536
+/* protocolStep() calls per node per event, so a node can drain its inbox */
+#define NETSIM_MAX_PASSES	16
+/* how often slave offsets are sampled, s */
+#define NETSIM_SAMPLE_INTERVAL	0.125
+
+typedef struct {
+	int masters;
+	int slaves;
+	double duration;	/* s of virtual time */
+	double frequencySpread;	/* ppb, +/- around clock:sim_frequency_offset */
+	double offsetSpread;	/* s, +/- around clock:sim_initial_offset */
+	double lockThreshold;	/* s */
+	double holdTime;	/* s the offset has to stay within the threshold */
+	NetSimConfig net;
+	const char *configFile;
+} SimOptions;
+
+typedef struct {
+	RunTimeOpts rtOpts;
+	PtpClock *ptpClock;
+	ClockBackend *clock;
+	Boolean master;
+	int64_t wake;		/* virtual time the node's next timer is due */
+	int heapIndex;		/* position in wakeHeap */
+	int64_t cpuTime;	/* ns spent in the protocol engine */
+
+	/* slaves: offset to the grandmaster, sampled */
+	int64_t inRangeSince;	/* -1 when outside the lock threshold */
+	int64_t lockedAt;	/* -1 until locked */
+	int lockLosses;
+	uint64_t samples;
+	double offsetSum;
+	double offsetSquares;
+	double offsetMax;
+} SimNode;
+
+static SimNode *nodes = NULL;
+static int nodeCount = 0;
+/* every node, as a binary heap on the time it is next due */
+static int *wakeHeap = NULL;
+
+static int64_t
+cpuTimeNs(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts);
+	return ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+static int64_t
+wallTimeNs(void)
+{
+	struct timespec ts;
+
+	/* not getTimeMonotonic(): that is the node's clock here */
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+static int64_t
+realTimeNs(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_REALTIME, &ts);
+	return ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+static int64_t
+nodeTime(const SimNode *node)
+{
+	TimeInternal t;
+
+	node->clock->getTime(node->clock, &t);
+	return t.seconds * 1000000000LL + t.nanoseconds;
+}
+
+/* make the node the one logging, the clock and the protocol engine see */
+static void
+selectNode(SimNode *node)
+{
+	G_ptpClock = node->ptpClock;
+	clockBackendInstall(node->clock);
+}
+
+static void
+usage(const char *name)
+{
+	printf(
+		"\nUsage: %s [options] [--section:key=value...]\n\n"
+		"Runs masters and slaves against a simulated network, in virtual time.\n"
+		"Settings from the configuration file and --section:key=value options\n"
+		"apply to every node; clock:sim_* settings set the nominal oscillator.\n\n"
+		"-c FILE          load settings from FILE\n"
+		"-m NUMBER        number of masters, master 0 is the best (default 1)\n"
+		"-n NUMBER        number of slaves (default 4)\n"
+		"-t SECONDS       virtual time to simulate (default 900)\n"
+		"-d SECONDS       one-way network delay (default 0.00005)\n"
+		"-j SECONDS       delay jitter (default 0.000005)\n"
+		"-J DISTRIBUTION  jitter distribution: uniform, normal, exponential (default normal)\n"
+		"-a SECONDS       delay asymmetry, downstream minus upstream (default 0)\n"
+		"-l PROBABILITY   packet loss, 0..1 (default 0)\n"
+		"-b I:L:D         queueing bursts: every I seconds, L seconds long, peaking at D seconds\n"
+		"-F PPB           oscillator frequency spread, +/- (default 20000)\n"
+		"-O SECONDS       initial clock offset spread, +/- (default 0.001)\n"
+		"-L SECONDS       lock threshold (default 0.000005)\n"
+		"-H SECONDS       time within the lock threshold to count as locked (default 10)\n"
+		"-s NUMBER        random seed (default 1)\n"
+		"-h               show this help\n"
+		"\n", name);
+}
+
+static Boolean
+parseBurst(const char *text, NetSimConfig *net)
+{
+	return sscanf(text, "%lf:%lf:%lf", &net->burstInterval,
+		&net->burstLength, &net->burstDelay) == 3 &&
+		net->burstInterval > 0 && net->burstLength >= 0 &&
+		net->burstLength <= net->burstInterval && net->burstDelay >= 0;
+}
+
+static Boolean
+parseOptions(int argc, char **argv, SimOptions *opts)
+{
+	int c;
+
+	opts->masters = 1;
+	opts->slaves = 4;
+	opts->duration = 900;
+	opts->frequencySpread = 20000;
+	opts->offsetSpread = 0.001;
+	opts->lockThreshold = 0.000005;
+	opts->holdTime = 10;
+	opts->configFile = NULL;
+
+	memset(&opts->net, 0, sizeof(NetSimConfig));
+	opts->net.delay = 0.00005;
+	opts->net.jitter = 0.000005;
+	opts->net.jitterDistribution = NETSIM_JITTER_NORMAL;
+	opts->net.seed = 1;
+
+	while((c = getopt(argc, argv, "c:m:n:t:d:j:J:a:l:b:F:O:L:H:s:h")) != -1) {
+		switch(c) {
+		case 'c':
+			opts->configFile = optarg;
+			break;
+		case 'm':
+			opts->masters = atoi(optarg);
+			break;
+		case 'n':
+			opts->slaves = atoi(optarg);
+			break;
+		case 't':
+			opts->duration = atof(optarg);
+			break;
+		case 'd':
+			opts->net.delay = atof(optarg);
+			break;
+		case 'j':
+			opts->net.jitter = atof(optarg);
+			break;
+		case 'J':
+			if(!strcmp(optarg, "uniform")) {
+				opts->net.jitterDistribution = NETSIM_JITTER_UNIFORM;
+			} else if(!strcmp(optarg, "normal")) {
+				opts->net.jitterDistribution = NETSIM_JITTER_NORMAL;
+			} else if(!strcmp(optarg, "exponential")) {
+				opts->net.jitterDistribution = NETSIM_JITTER_EXPONENTIAL;
+			} else {
+				ERROR("Unknown jitter distribution: %s\n", optarg);
+				return FALSE;
+			}
+			break;
+		case 'a':
+			opts->net.asymmetry = atof(optarg);
+			break;
+		case 'l':
+			opts->net.loss = atof(optarg);
+			break;
+		case 'b':
+			if(!parseBurst(optarg, &opts->net)) {
+				ERROR("Invalid burst specification: %s\n", optarg);
+				return FALSE;
+			}
+			break;
+		case 'F':
+			opts->frequencySpread = fabs(atof(optarg));
+			break;
+		case 'O':
+			opts->offsetSpread = fabs(atof(optarg));
+			break;
+		case 'L':
+			opts->lockThreshold = fabs(atof(optarg));
+			break;
+		case 'H':
+			opts->holdTime = fabs(atof(optarg));
+			break;
+		case 's':
+			opts->net.seed = strtoul(optarg, NULL, 10);
+			break;
+		case 'h':
+		default:
+			usage(argv[0]);
+			return FALSE;
+		}
+	}
+
+	if(opts->masters < 1 || opts->masters > NETSIM_MAX_MASTERS) {
+		ERROR("Number of masters must be between 1 and %d\n", NETSIM_MAX_MASTERS);
+		return FALSE;
+	}
+
+	if(opts->slaves < 0 || opts->masters + opts->slaves > NETSIM_MAX_NODES) {
+		ERROR("Number of slaves must be between 0 and %d\n", NETSIM_MAX_NODES - opts->masters);
+		return FALSE;
+	}
+
+	if(opts->duration <= 0 || opts->net.delay < 0 || opts->net.jitter < 0 ||
+	    opts->net.loss < 0 || opts->net.loss > 1) {
+		ERROR("Invalid duration, delay, jitter or loss\n");
+		return FALSE;
+	}
+
+	return TRUE;
+}
+
+/* parse the settings for one node, the way the daemon does at startup */
+static Boolean
+parseNodeConfig(dictionary *base, const char *preset, int priority1, const char *destinations,
+		RunTimeOpts *opts)
+{
+	dictionary *dict = dictionary_new(0);
+	char value[16];
+
+	dictionary_merge(base, dict, 1, 0, NULL);
+	dictionary_set(dict, "ptpengine:preset", preset);
+
+	if(priority1 >= 0) {
+		snprintf(value, sizeof(value), "%d", priority1);
+		dictionary_set(dict, "ptpengine:priority1", value);
+	}
+
+	if(destinations != NULL) {
+		dictionary_set(dict, "ptpengine:unicast_destinations", destinations);
+	}
+
+	loadDefaultSettings(opts);
+	opts->currentConfig = parseConfig(CFGOP_PARSE_QUIET, NULL, dict, opts);
+	dictionary_del(&dict);
+
+	if(opts->currentConfig == NULL) {
+		return FALSE;
+	}
+
+	/* nothing here may leave the simulation */
+	opts->sysopts.nonDaemon = TRUE;
+	opts->logStatistics = FALSE;
+	opts->do_IGMP_refresh = FALSE;
+	if(opts->sysopts.drift_recovery_method == DRIFT_FILE) {
+		opts->sysopts.drift_recovery_method = DRIFT_KERNEL;
+	}
+
+	return TRUE;
+}
+
+static Boolean
+setupNodes(dictionary *base, const SimOptions *opts)
+{
+	char destinations[NETSIM_MAX_MASTERS * 16] = "";
+	const char *slaveDestinations = NULL;
+	unsigned short spread[3];
+	ClockSimConfig clockConfig;
+	struct in_addr addr;
+	Integer16 ret = 0;
+	SimNode *node;
+	int i;
+
+	nodeCount = opts->masters + opts->slaves;
+	if(!(nodes = calloc(nodeCount, sizeof(SimNode))) ||
+	    !(wakeHeap = calloc(nodeCount, sizeof(int)))) {
+		PERROR("Could not allocate simulator nodes");
+		return FALSE;
+	}
+
+	for(i = 0; i < nodeCount; i++) {
+		nodes[i].wake = INT64_MAX;
+		nodes[i].heapIndex = i;
+		wakeHeap[i] = i;
+	}
+
+	/* unicast slaves ask the masters for service, unless told otherwise */
+	if(rtOpts.ipMode == IPMODE_UNICAST && !strlen(rtOpts.sysopts.unicastDestinations)) {
+		for(i = 0; i < opts->masters; i++) {
+			addr.s_addr = netSimNodeAddress(i);
+			snprintf(destinations + strlen(destinations), sizeof(destinations) - strlen(destinations),
+				"%s%s", i ? "," : "", inet_ntoa(addr));
+		}
+		slaveDestinations = destinations;
+		if(!rtOpts.unicastNegotiation) {
+			dictionary_set(base, "ptpengine:unicast_negotiation", "y");
+		}
+	}
+
+	/* the slave settings are the same for every slave but the interface */
+	if(opts->slaves > 0 && !parseNodeConfig(base, "slaveonly", -1, slaveDestinations,
+						&nodes[opts->masters].rtOpts)) {
+		return FALSE;
+	}
+
+	for(i = 0; i < nodeCount; i++) {
+		node = &nodes[i];
+		node->master = i < opts->masters;
+		node->inRangeSince = -1;
+		node->lockedAt = -1;
+
+		if(node->master) {
+			if(!parseNodeConfig(base, "masteronly", 128 + i, NULL, &node->rtOpts)) {
+				return FALSE;
+			}
+		} else if(i > opts->masters) {
+			memcpy(&node->rtOpts, &nodes[opts->masters].rtOpts, sizeof(RunTimeOpts));
+			node->rtOpts.currentConfig = NULL;
+			node->rtOpts.cliConfig = NULL;
+		}
+
+		snprintf(node->rtOpts.sysopts.primaryIfaceName, IFACE_NAME_LENGTH,
+			NETSIM_IFACE_PREFIX"%d", i);
+
+		/* every node gets a different oscillator around the nominal one */
+		clockConfig = rtOpts.clockSimConfig;
+		spread[0] = 0x330E;
+		spread[1] = opts->net.seed & 0xFFFF;
+		spread[2] = i & 0xFFFF;
+		clockConfig.frequencyOffset += opts->frequencySpread * (2.0 * erand48(spread) - 1.0);
+		clockConfig.initialOffset += opts->offsetSpread * (2.0 * erand48(spread) - 1.0);
+		clockConfig.seed += i;
+
+		if(!(node->clock = clockSimCreate(&clockConfig, node->rtOpts.servoMaxPpb, netSimNow))) {
+			return FALSE;
+		}
+
+		selectNode(node);
+		if(!(node->ptpClock = ptpClockCreate(&node->rtOpts, &ret, NULL))) {
+			return FALSE;
+		}
+		G_ptpClock = node->ptpClock;
+
+		netSimSetDownstream(i, node->master);
+	}
+
+	return TRUE;
+}
+
+static void
+teardownNodes(void)
+{
+	SimNode *node;
+	PtpClock *ptpClock;
+	int i;
+
+	if(nodes == NULL) {
+		return;
+	}
+
+	for(i = 0; i < nodeCount; i++) {
+		node = &nodes[i];
+		ptpClock = node->ptpClock;
+
+		if(ptpClock != NULL) {
+			/* not ptpdShutdown(): that works on the daemon's globals, lock file included */
+			selectNode(node);
+			toState(PTP_DISABLED, &node->rtOpts, ptpClock);
+			netShutdown(ptpClock->netPath);
+			netPathFree(&ptpClock->netPath);
+			freeForeignMasterTable(ptpClock);
+			freeUnicastGrantTable(ptpClock);
+
+			if(ptpClock->msgTmpHeader.messageType == MANAGEMENT)
+				freeManagementTLV(&ptpClock->msgTmp.manage);
+			freeManagementTLV(&ptpClock->outgoingManageTmp);
+			if(ptpClock->msgTmpHeader.messageType == SIGNALING)
+				freeSignalingTLV(&ptpClock->msgTmp.signaling);
+			freeSignalingTLV(&ptpClock->outgoingSignalingTmp);
+
+#ifdef PTPD_STATISTICS
+			ptpClock->oFilterMS.shutdown(&ptpClock->oFilterMS);
+			ptpClock->oFilterSM.shutdown(&ptpClock->oFilterSM);
+			freeDoubleMovingStatFilter(&ptpClock->filterMS);
+			freeDoubleMovingStatFilter(&ptpClock->filterSM);
+#endif /* PTPD_STATISTICS */
+
+			timerShutdown(ptpClock->timers);
+			free(ptpClock);
+			G_ptpClock = NULL;
+		}
+
+		clockBackendInstall(NULL);
+		clockSimFree(&node->clock);
+
+		if(node->rtOpts.currentConfig != NULL)
+			dictionary_del(&node->rtOpts.currentConfig);
+	}
+
+	free(nodes);
+	free(wakeHeap);
+	nodes = NULL;
+	wakeHeap = NULL;
+	nodeCount = 0;
+}
+
+static void
+wakeSwap(int a, int b)
+{
+	int node = wakeHeap[a];
+
+	wakeHeap[a] = wakeHeap[b];
+	wakeHeap[b] = node;
+	nodes[wakeHeap[a]].heapIndex = a;
+	nodes[wakeHeap[b]].heapIndex = b;
+}
+
+/* put the node back in its place after its wake time changed */
+static void
+wakeUpdate(SimNode *node)
+{
+	int i = node->heapIndex;
+	int child;
+
+	while(i > 0 && nodes[wakeHeap[(i - 1) / 2]].wake > node->wake) {
+		wakeSwap(i, (i - 1) / 2);
+		i = (i - 1) / 2;
+	}
+
+	while((child = 2 * i + 1) < nodeCount) {
+		if(child + 1 < nodeCount && nodes[wakeHeap[child + 1]].wake < nodes[wakeHeap[child]].wake) {
+			child++;
+		}
+		if(nodes[wakeHeap[child]].wake >= node->wake) {
+			break;
+		}
+		wakeSwap(i, child);
+		i = child;
+	}
+}
+
+static Boolean
+nodePending(const SimNode *node)
+{
+	const NetPath *netPath = node->ptpClock->netPath;
+
+	return netPathEventPending(netPath) || netPathGeneralPending(netPath) ||
+		netPathTxTimestampsPending(netPath);
+}
+
+/* run the node until it has nothing left to do at this point in virtual time */
+static void
+runNode(SimNode *node)
+{
+	PtpClock *ptpClock = node->ptpClock;
+	int64_t cpuStart = 0;
+	double nextExpiry;
+	int pass;
+
+	selectNode(node);
+
+	if(node->master) {
+		cpuStart = cpuTimeNs();
+	}
+
+	for(pass = 0; pass < NETSIM_MAX_PASSES; pass++) {
+		protocolStep(&node->rtOpts, ptpClock);
+		/* what the timing domain does when PTP is the only time service */
+		ptpClock->clockControl.granted = ptpClock->clockControl.available;
+		if(!ptpClock->message_activity && !nodePending(node)) {
+			break;
+		}
+	}
+
+	if(node->master) {
+		node->cpuTime += cpuTimeNs() - cpuStart;
+	}
+
+	nextExpiry = timerNextExpiry(ptpClock->timers);
+	if(nodePending(node)) {
+		/* ran out of passes - carry on at the same point in time */
+		node->wake = netSimNow();
+	} else if(nextExpiry < 0) {
+		node->wake = INT64_MAX;
+	} else {
+		node->wake = netSimNow() + llround(nextExpiry * 1E9);
+	}
+	wakeUpdate(node);
+}
+
+/* offset of every slave from the grandmaster's clock, and whether it is locked */
+static void
+sampleOffsets(const SimOptions *opts)
+{
+	int64_t now = netSimNow();
+	int64_t reference = nodeTime(&nodes[0]);
+	int64_t threshold = llround(opts->lockThreshold * 1E9);
+	int64_t hold = llround(opts->holdTime * 1E9);
+	SimNode *node;
+	double offset;
+	int i;
+
+	for(i = opts->masters; i < nodeCount; i++) {
+		node = &nodes[i];
+		offset = nodeTime(node) - reference;
+
+		if(fabs(offset) > threshold) {
+			if(node->lockedAt >= 0) {
+				node->lockLosses++;
+				node->lockedAt = -1;
+			}
+			node->inRangeSince = -1;
+		} else if(node->inRangeSince < 0) {
+			node->inRangeSince = now;
+		} else if(node->lockedAt < 0 && now - node->inRangeSince >= hold) {
+			node->lockedAt = node->inRangeSince;
+		}
+
+		/* offset statistics only count once the slave is locked */
+		if(node->lockedAt >= 0) {
+			node->samples++;
+			node->offsetSum += offset;
+			node->offsetSquares += offset * offset;
+			if(fabs(offset) > node->offsetMax) {
+				node->offsetMax = fabs(offset);
+			}
+		}
+	}
+}
+
+/*
+ * master 0 is the grandmaster, other masters stand by, slaves follow master 0;
+ * unicast masters never hear each other, so they all stay masters
+ */
+static Boolean
+bmcConverged(void)
+{
+	const PtpClock *gm = nodes[0].ptpClock;
+	const PtpClock *ptpClock;
+	int i;
+
+	if(gm->portDS.portState != PTP_MASTER) {
+		return FALSE;
+	}
+
+	for(i = 1; i < nodeCount; i++) {
+		ptpClock = nodes[i].ptpClock;
+		if(nodes[i].master) {
+			if(rtOpts.ipMode != IPMODE_UNICAST &&
+			    ptpClock->portDS.portState != PTP_PASSIVE &&
+			    ptpClock->portDS.portState != PTP_SLAVE) {
+				return FALSE;
+			}
+		} else if(ptpClock->portDS.portState != PTP_SLAVE ||
+		    memcmp(ptpClock->parentDS.grandmasterIdentity,
+			   gm->defaultDS.clockIdentity, CLOCK_IDENTITY_LENGTH)) {
+			return FALSE;
+		}
+	}
+
+	return TRUE;
+}
+
+static uint32_t
+messagesSent(const PtpClock *ptpClock)
+{
+	const PtpdCounters *counters = &ptpClock->counters;
+
+	return counters->announceMessagesSent + counters->syncMessagesSent +
+		counters->followUpMessagesSent + counters->delayReqMessagesSent +
+		counters->delayRespMessagesSent + counters->pdelayReqMessagesSent +
+		counters->pdelayRespMessagesSent + counters->pdelayRespFollowUpMessagesSent +
+		counters->signalingMessagesSent + counters->managementMessagesSent;
+}
+
+static int
+report(const SimOptions *opts, int64_t start, int64_t bmcAt, int64_t wallTime)
+{
+	const NetSimCounters *counters = netSimGetCounters();
+	double elapsed = (netSimNow() - start) / 1E9;
+	double lockTime, lockMax = 0, lockSum = 0;
+	double mean, rms;
+	int locked = 0;
+	uint32_t sent;
+	SimNode *node;
+	int i;
+
+	printf("\nSimulated %.3f s with %d master(s) and %d slave(s) in %.3f s (%.0fx real time)\n",
+		elapsed, opts->masters, opts->slaves, wallTime / 1E9,
+		wallTime > 0 ? elapsed / (wallTime / 1E9) : 0.0);
+
+	printf("\n%-8s %-12s %12s %12s %12s %12s %6s\n", "node", "state",
+		"locked (s)", "mean (ns)", "rms (ns)", "max (ns)", "losses");
+
+	for(i = opts->masters; i < nodeCount; i++) {
+		node = &nodes[i];
+
+		if(node->lockedAt < 0) {
+			printf("%-8s %-12s %12s %12s %12s %12s %6d\n", node->rtOpts.sysopts.primaryIfaceName,
+				portState_getName(node->ptpClock->portDS.portState),
+				"-", "-", "-", "-", node->lockLosses);
+			continue;
+		}
+
+		lockTime = (node->lockedAt - start) / 1E9;
+		lockSum += lockTime;
+		if(lockTime > lockMax) {
+			lockMax = lockTime;
+		}
+		locked++;
+
+		mean = node->offsetSum / node->samples;
+		rms = sqrt(node->offsetSquares / node->samples);
+
+		printf("%-8s %-12s %12.3f %12.1f %12.1f %12.1f %6d\n", node->rtOpts.sysopts.primaryIfaceName,
+			portState_getName(node->ptpClock->portDS.portState),
+			lockTime, mean, rms, node->offsetMax, node->lockLosses);
+	}
+
+	printf("\nSlaves locked: %d of %d", locked, opts->slaves);
+	if(locked > 0) {
+		printf(", lock time mean %.3f s, max %.3f s", lockSum / locked, lockMax);
+	}
+	printf("\n");
+
+	if(bmcAt >= 0) {
+		printf("BMC converged after %.3f s\n", (bmcAt - start) / 1E9);
+	} else {
+		printf("BMC did not converge\n");
+	}
+
+	for(i = 0; i < opts->masters; i++) {
+		node = &nodes[i];
+		sent = messagesSent(node->ptpClock);
+		printf("%s: %s, sent %u messages, %.3f s CPU, %.0f ns per message sent\n",
+			node->rtOpts.sysopts.primaryIfaceName,
+			portState_getName(node->ptpClock->portDS.portState),
+			sent, node->cpuTime / 1E9, sent ? (double)node->cpuTime / sent : 0.0);
+	}
+
+	printf("Network: %llu sent, %llu delivered, %llu lost, %llu unreachable\n\n",
+		(unsigned long long)counters->sent, (unsigned long long)counters->delivered,
+		(unsigned long long)counters->lost, (unsigned long long)counters->unreachable);
+
+	return (locked == opts->slaves && bmcAt >= 0) ? 0 : 3;
+}
+
+static int
+simulate(const SimOptions *opts)
+{
+	int64_t start = netSimNow();
+	int64_t end = start + llround(opts->duration * 1E9);
+	int64_t sampleInterval = llround(NETSIM_SAMPLE_INTERVAL * 1E9);
+	int64_t nextSample = start + sampleInterval;
+	int64_t wallStart = wallTimeNs();
+	int64_t bmcAt = -1;
+	int64_t now, next;
+	int i;
+
+	for(i = 0; i < nodeCount; i++) {
+		selectNode(&nodes[i]);
+		protocolStart(&nodes[i].rtOpts, nodes[i].ptpClock);
+		runNode(&nodes[i]);
+	}
+
+	for(now = start; now < end; now = netSimNow()) {
+
+		next = netSimNextDelivery();
+		if(nodes[wakeHeap[0]].wake < next) {
+			next = nodes[wakeHeap[0]].wake;
+		}
+		if(nextSample < next) {
+			next = nextSample;
+		}
+		if(next > end) {
+			next = end;
+		}
+		/* also delivers anything sent with no delay at all */
+		netSimAdvance(next > now ? next : now);
+		now = netSimNow();
+
+		/* nodes that received something, then nodes whose timers are due */
+		while((i = netSimNextReady()) >= 0) {
+			runNode(&nodes[i]);
+		}
+		while(nodes[wakeHeap[0]].wake <= now) {
+			runNode(&nodes[wakeHeap[0]]);
+		}
+
+		if(now >= nextSample) {
+			sampleOffsets(opts);
+			if(bmcAt < 0 && bmcConverged()) {
+				bmcAt = now;
+			}
+			nextSample += sampleInterval;
+		}
+	}
+
+	return report(opts, start, bmcAt, wallTimeNs() - wallStart);
+}
+
+int
+main(int argc, char **argv)
+{
+	dictionary *base;
+	dictionary *file;
+	SimOptions opts;
+	int ret = 1;
+
+	startupInProgress = TRUE;
+
+	/* settings for every node: --section:key=value, then the file, then the defaults */
+	base = dictionary_new(0);
+	loadCommandLineKeys(base, argc, argv);
+
+	if(!parseOptions(argc, argv, &opts)) {
+		dictionary_del(&base);
+		return 1;
+	}
+
+	if(opts.configFile != NULL) {
+		if((file = iniparser_load(opts.configFile)) == NULL) {
+			ERROR("Could not load configuration file %s\n", opts.configFile);
+			dictionary_del(&base);
+			return 1;
+		}
+		dictionary_merge(file, base, 0, 0, NULL);
+		dictionary_del(&file);
+	}
+
+	if(dictionary_get(base, "ptpengine:interface", NULL) == NULL) {
+		dictionary_set(base, "ptpengine:interface", NETSIM_IFACE_PREFIX"0");
+	}
+
+	loadDefaultSettings(&rtOpts);
+	if((rtOpts.currentConfig = parseConfig(CFGOP_PARSE, NULL, base, &rtOpts)) == NULL) {
+		dictionary_del(&base);
+		return 1;
+	}
+	rtOpts.sysopts.nonDaemon = TRUE;
+	rtOpts.logStatistics = FALSE;
+
+	if(rtOpts.transport != UDP_IPV4) {
+		ERROR("Only the UDP/IPv4 transport can be simulated\n");
+		goto cleanup;
+	}
+
+	NOTICE(USER_DESCRIPTION" network simulator: %d master(s), %d slave(s), %.0f s\n",
+		opts.masters, opts.slaves, opts.duration);
+
+	if(!netSimInit(&opts.net, opts.masters + opts.slaves, realTimeNs())) {
+		goto cleanup;
+	}
+
+	if(setupNodes(base, &opts)) {
+		startupInProgress = FALSE;
+		ret = simulate(&opts);
+		startupInProgress = TRUE;
+	} else {
+		ERROR("Could not set up the simulated nodes\n");
+	}
+
+	teardownNodes();
+	netSimShutdown();
+
+cleanup:
+	dictionary_del(&base);
+	if(rtOpts.currentConfig != NULL)
+		dictionary_del(&rtOpts.currentConfig);
+
+	return ret;
+}
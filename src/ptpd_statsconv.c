@@ -0,0 +1,364 @@
+/*-
+ * Copyright (c) 2015 Wojciech Owczarek,
+ *
+ * All Rights Reserved
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHORS ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE AUTHORS OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+ * OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
+ * IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/**
+ * @file   ptpd_statsconv.c
+ * @date   Mon Oct 19 15:40:22 2026
+ *
+ * @brief  Converts binary statistics files to the csv statistics format
+ *
+ * The output is what ptpd2 writes to the statistics file with
+ * global:statistics_log_format=csv, so the scripts in tools/ work on
+ * either.
+ */
+
+#ifdef HAVE_CONFIG_H
+#  include <config.h>
+#endif /* HAVE_CONFIG_H */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#ifdef HAVE_NETINET_ETHER_H
+#  include <netinet/ether.h>
+#endif
+
+#ifdef HAVE_NET_ETHERNET_H
+#  include <net/ethernet.h>
+#endif
+
+#include "constants.h"
+#include "dep/constants_dep.h"
+#include "ptp_primitives.h"
+#include "ptp_datatypes.h"
+#include "dep/statsbin.h"
+
+#define CONV_BUFSZ	1024
+
+typedef struct {
+	int timestampFormat;	/* -1: as recorded in the file */
+	Boolean headers;	/* print the csv header line for every header */
+} ConvOptions;
+
+static void
+usage(const char *name)
+{
+	printf(
+		"\nUsage: %s [options] [FILE...]\n\n"
+		"Converts binary ptpd2 statistics files (global:statistics_log_format=binary)\n"
+		"to csv, as written with global:statistics_log_format=csv. Reads standard\n"
+		"input when no FILE is given, writes to standard output.\n\n"
+		"-t FORMAT        timestamp format: datetime, unix or both\n"
+		"                 (default: global:statistics_timestamp_format at the time)\n"
+		"-n               do not print csv header lines\n"
+		"-h               show this help\n"
+		"\n", name);
+}
+
+/* same as translatePortState() in the daemon */
+static const char *
+portStateTag(int state, UInteger32 resetCount)
+{
+	switch(state) {
+	    case PTP_INITIALIZING:  return "init";
+	    case PTP_FAULTY:        return "flt";
+	    case PTP_LISTENING:     return resetCount == 1 ? "lstn_init" : "lstn_reset";
+	    case PTP_PASSIVE:       return "pass";
+	    case PTP_UNCALIBRATED:  return "uncl";
+	    case PTP_SLAVE:         return "slv";
+	    case PTP_PRE_MASTER:    return "pmst";
+	    case PTP_MASTER:        return "mst";
+	    case PTP_DISABLED:      return "dsbl";
+	    default:                return "?";
+	}
+}
+
+static int
+printTime(char *s, int max_len, const TimeInternal *p)
+{
+	/* either a space or the leading "-", as the daemon keeps the columns aligned */
+	return snprintf(s, max_len, "%c%d.%09d",
+	    (p->seconds < 0 || p->nanoseconds < 0) ? '-' : ' ',
+	    abs(p->seconds), abs(p->nanoseconds));
+}
+
+static int
+printClockIdentity(char *s, int max_len, const ClockIdentity id)
+{
+	int len = 0;
+	int i;
+
+	for (i = 0; i < CLOCK_IDENTITY_LENGTH; i++) {
+		len += snprintf(&s[len], max_len - len, "%02x", (unsigned char) id[i]);
+	}
+
+	return len;
+}
+
+/* clock identity, the host name from /etc/ethers and port number */
+static int
+printPortIdentity(char *s, int max_len, const PortIdentity *id)
+{
+	static ClockIdentity cachedId;
+	static char hostname[CONV_BUFSZ];
+	static Boolean cached = FALSE;
+	struct ether_addr e;
+	unsigned char *octet = (unsigned char*)&e;
+	int len = 0;
+	int i, j;
+
+#ifdef PRINT_MAC_ADDRESSES
+	for (i = 0; i < CLOCK_IDENTITY_LENGTH; i++) {
+		/* skip bytes 3 and 4 */
+		if ((i == 3) || (i == 4)) {
+			continue;
+		}
+		len += snprintf(&s[len], max_len - len, "%s%02x",
+		    i == 0 ? "" : ":", (unsigned char) id->clockIdentity[i]);
+	}
+#else
+	len += printClockIdentity(&s[len], max_len - len, id->clockIdentity);
+#endif /* PRINT_MAC_ADDRESSES */
+
+	if (!cached || memcmp(cachedId, id->clockIdentity, CLOCK_IDENTITY_LENGTH)) {
+		for (i = 0, j = 0; i < CLOCK_IDENTITY_LENGTH; i++) {
+			if ((i != 3) && (i != 4)) {
+				octet[j++] = id->clockIdentity[i];
+			}
+		}
+		if (ether_ntohost(hostname, &e)) {
+			snprintf(hostname, sizeof(hostname), "%s", "unknown");
+		}
+		while (strchr(hostname, ',') != NULL) {
+			*(strchr(hostname, ',')) = '_';
+		}
+		memcpy(cachedId, id->clockIdentity, CLOCK_IDENTITY_LENGTH);
+		cached = TRUE;
+	}
+
+	len += snprintf(&s[len], max_len - len, "(%s)/%d", hostname, (unsigned) id->portNumber);
+	return len;
+}
+
+static void
+printHeaderLine(FILE *out, const StatsBinHeader *header, int timestampFormat)
+{
+	fprintf(out, "# %s, State, Clock ID, One Way Delay, "
+	       "Offset From Master, Slave to Master, "
+	       "Master to Slave, Observed Drift, Last packet Received, Sequence ID"
+	       "%s\n", (timestampFormat == TIMESTAMP_BOTH) ? "Timestamp, Unix timestamp" : "Timestamp",
+	       (header->flags & STATSBIN_FLAG_STATISTICS) ?
+	       ", One Way Delay Mean, One Way Delay Std Dev, Offset From Master Mean, Offset From Master Std Dev, Observed Drift Mean, Observed Drift Std Dev, raw delayMS, raw delaySM" : "");
+}
+
+/* one csv line, field for field what logStatistics() prints */
+static void
+printRecord(FILE *out, const StatsBinHeader *header, int timestampFormat, const StatsBinRecord *record)
+{
+	char sbuf[CONV_BUFSZ];
+	char time_str[MAXTIMESTR];
+	const char *state = portStateTag(record->portState, record->resetCount);
+	time_t time_s = record->time.seconds;
+	int len = 0;
+
+	if (timestampFormat == TIMESTAMP_DATETIME || timestampFormat == TIMESTAMP_BOTH) {
+		strftime(time_str, MAXTIMESTR, "%Y-%m-%d %X", localtime(&time_s));
+		len += snprintf(sbuf + len, sizeof(sbuf) - len, "%s.%06d, %s, ",
+		    time_str, (int)record->time.nanoseconds/1000, state);
+	}
+
+	if (timestampFormat == TIMESTAMP_UNIX || timestampFormat == TIMESTAMP_BOTH) {
+		len += snprintf(sbuf + len, sizeof(sbuf) - len, "%d.%06d, %s,",
+		    record->time.seconds, record->time.nanoseconds, state);
+	}
+
+	if (record->portState == PTP_SLAVE) {
+		len += printPortIdentity(sbuf + len, sizeof(sbuf) - len, &record->parentPortIdentity);
+		if (record->flags & STATSBIN_RECORD_GM_DIFFERS) {
+			len += printClockIdentity(sbuf + len, sizeof(sbuf) - len, record->grandmasterIdentity);
+		}
+		len += snprintf(sbuf + len, sizeof(sbuf) - len, ", ");
+		len += printTime(sbuf + len, sizeof(sbuf) - len, &record->meanPathDelay);
+		len += snprintf(sbuf + len, sizeof(sbuf) - len, ", ");
+		len += printTime(sbuf + len, sizeof(sbuf) - len, &record->offsetFromMaster);
+		len += snprintf(sbuf + len, sizeof(sbuf) - len, ", ");
+		len += printTime(sbuf + len, sizeof(sbuf) - len, &record->delaySM);
+		len += snprintf(sbuf + len, sizeof(sbuf) - len, ", ");
+		len += printTime(sbuf + len, sizeof(sbuf) - len, &record->delayMS);
+		len += snprintf(sbuf + len, sizeof(sbuf) - len, ", %.09f, %c, %05d",
+		    record->observedDrift, record->lastMessage, record->sequenceId);
+
+		if (header->flags & STATSBIN_FLAG_STATISTICS) {
+			len += snprintf(sbuf + len, sizeof(sbuf) - len, ", %.09f, %.00f, %.09f, %.00f",
+			    record->mpdMean, record->mpdStdDev * 1E9,
+			    record->ofmMean, record->ofmStdDev * 1E9);
+			len += snprintf(sbuf + len, sizeof(sbuf) - len, ", %.0f, %.0f, ",
+			    record->driftMean, record->driftStdDev);
+			len += printTime(sbuf + len, sizeof(sbuf) - len, &record->rawDelayMS);
+			len += snprintf(sbuf + len, sizeof(sbuf) - len, ", ");
+			len += printTime(sbuf + len, sizeof(sbuf) - len, &record->rawDelaySM);
+		}
+	} else {
+		if ((record->portState == PTP_MASTER) || (record->portState == PTP_PASSIVE)) {
+			len += printPortIdentity(sbuf + len, sizeof(sbuf) - len, &record->parentPortIdentity);
+		}
+		if (record->portState == PTP_LISTENING) {
+			len += snprintf(sbuf + len, sizeof(sbuf) - len, " %d ", record->resetCount);
+		}
+	}
+
+	fprintf(out, "%s\n", sbuf);
+}
+
+/* returns the number of records converted, -1 on a format error */
+static long
+convertFile(FILE *in, const char *name, FILE *out, const ConvOptions *options)
+{
+	unsigned char buf[CONV_BUFSZ];
+	StatsBinHeader header;
+	StatsBinRecord record;
+	Boolean haveHeader = FALSE;
+	int timestampFormat = TIMESTAMP_DATETIME;
+	long count = 0;
+	size_t got;
+
+	for (;;) {
+		/* a record is always longer than the magic - peek at it */
+		got = fread(buf, 1, STATSBIN_MAGIC_LEN, in);
+		if (got == 0) {
+			break;
+		}
+		if (got < STATSBIN_MAGIC_LEN) {
+			fprintf(stderr, "%s: truncated at the end, %zu bytes ignored\n", name, got);
+			break;
+		}
+
+		if (statsBinIsHeader(buf)) {
+			if (fread(buf + STATSBIN_MAGIC_LEN, 1, STATSBIN_HEADER_SIZE - STATSBIN_MAGIC_LEN, in) !=
+			    STATSBIN_HEADER_SIZE - STATSBIN_MAGIC_LEN ||
+			    !statsBinUnpackHeader(buf, &header)) {
+				fprintf(stderr, "%s: unsupported or damaged file header\n", name);
+				return -1;
+			}
+			/* newer headers may be longer - skip what we do not know */
+			if (header.headerSize > STATSBIN_HEADER_SIZE &&
+			    fseek(in, header.headerSize - STATSBIN_HEADER_SIZE, SEEK_CUR) != 0) {
+				fprintf(stderr, "%s: unsupported or damaged file header\n", name);
+				return -1;
+			}
+			if (header.recordSize > sizeof(buf)) {
+				fprintf(stderr, "%s: record size %d not supported\n", name, header.recordSize);
+				return -1;
+			}
+			haveHeader = TRUE;
+			timestampFormat = options->timestampFormat >= 0 ?
+			    options->timestampFormat : header.timestampFormat;
+			if (options->headers) {
+				printHeaderLine(out, &header, timestampFormat);
+			}
+			continue;
+		}
+
+		if (!haveHeader) {
+			fprintf(stderr, "%s: not a binary statistics file\n", name);
+			return -1;
+		}
+
+		got = fread(buf + STATSBIN_MAGIC_LEN, 1, header.recordSize - STATSBIN_MAGIC_LEN, in);
+		if (got < header.recordSize - STATSBIN_MAGIC_LEN) {
+			fprintf(stderr, "%s: truncated at the end, %zu bytes ignored\n",
+			    name, got + STATSBIN_MAGIC_LEN);
+			break;
+		}
+
+		statsBinUnpackRecord(buf, &record);
+		printRecord(out, &header, timestampFormat, &record);
+		count++;
+	}
+
+	return count;
+}
+
+int
+main(int argc, char **argv)
+{
+	ConvOptions options;
+	FILE *in;
+	int ret = 0;
+	int c;
+	int i;
+
+	options.timestampFormat = -1;
+	options.headers = TRUE;
+
+	while ((c = getopt(argc, argv, "t:nh")) != -1) {
+		switch (c) {
+		case 't':
+			if (!strcmp(optarg, "datetime")) {
+				options.timestampFormat = TIMESTAMP_DATETIME;
+			} else if (!strcmp(optarg, "unix")) {
+				options.timestampFormat = TIMESTAMP_UNIX;
+			} else if (!strcmp(optarg, "both")) {
+				options.timestampFormat = TIMESTAMP_BOTH;
+			} else {
+				fprintf(stderr, "Unknown timestamp format: %s\n", optarg);
+				return 1;
+			}
+			break;
+		case 'n':
+			options.headers = FALSE;
+			break;
+		case 'h':
+			usage(argv[0]);
+			return 0;
+		default:
+			usage(argv[0]);
+			return 1;
+		}
+	}
+
+	if (optind >= argc) {
+		return convertFile(stdin, "stdin", stdout, &options) < 0 ? 2 : 0;
+	}
+
+	for (i = optind; i < argc; i++) {
+		if ((in = fopen(argv[i], "r")) == NULL) {
+			perror(argv[i]);
+			ret = 2;
+			continue;
+		}
+		if (convertFile(in, argv[i], stdout, &options) < 0) {
+			ret = 2;
+		}
+		fclose(in);
+	}
+
+	return ret;
+}
@@ -0,0 +1,302 @@
+/*-
+ * Copyright (c) 2015 Wojciech Owczarek,
+ *
+ * All Rights Reserved
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHORS ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE AUTHORS OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+ * OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
+ * IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/**
+ * @file   ptpd_status.c
+ * @date   Tue Oct 20 10:03:48 2026
+ *
+ * @brief  Displays the status ptpd2 publishes in shared memory
+ *
+ * Reads the segment set with global:status_shm, as text for people or
+ * as key=value lines for monitoring scripts, once or repeatedly.
+ */
+
+#ifdef HAVE_CONFIG_H
+#  include <config.h>
+#endif /* HAVE_CONFIG_H */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <time.h>
+#include <unistd.h>
+#include <signal.h>
+
+#include "constants.h"
+#include "ptp_primitives.h"
+#include "dep/statusshm.h"
+
+#define STATUS_DEFAULT_NAME	"/ptpd2.status"
+#define STATUSPREFIX		"%-19s:"
+
+static const char *
+portStateName(int state)
+{
+	switch(state) {
+	    case PTP_INITIALIZING:  return "PTP_INITIALIZING";
+	    case PTP_FAULTY:        return "PTP_FAULTY";
+	    case PTP_DISABLED:      return "PTP_DISABLED";
+	    case PTP_LISTENING:     return "PTP_LISTENING";
+	    case PTP_PRE_MASTER:    return "PTP_PRE_MASTER";
+	    case PTP_MASTER:        return "PTP_MASTER";
+	    case PTP_PASSIVE:       return "PTP_PASSIVE";
+	    case PTP_UNCALIBRATED:  return "PTP_UNCALIBRATED";
+	    case PTP_SLAVE:         return "PTP_SLAVE";
+	    default:                return "UNKNOWN";
+	}
+}
+
+static const char *
+delayMechanismName(int mechanism)
+{
+	switch(mechanism) {
+	    case E2E:               return "E2E";
+	    case P2P:               return "P2P";
+	    case DELAY_DISABLED:    return "DELAY_DISABLED";
+	    default:                return "UNKNOWN";
+	}
+}
+
+static void
+sprintIdentity(char *s, const uint8_t *id, uint16_t port)
+{
+	sprintf(s, "%02x%02x%02x%02x%02x%02x%02x%02x/%d",
+	    id[0], id[1], id[2], id[3], id[4], id[5], id[6], id[7], port);
+}
+
+static void
+printText(const PtpdStatus *status)
+{
+	char buf[64];
+	time_t seconds = status->updated / 1000000000LL;
+
+	strftime(buf, sizeof(buf), "%a %b %d %X %Z %Y", localtime(&seconds));
+	printf(STATUSPREFIX"  %s, PID %d\n", "Updated", buf, status->pid);
+	printf(STATUSPREFIX"  %s\n", "Interface", status->interface);
+	printf(STATUSPREFIX"  %s\n", "Delay mechanism", delayMechanismName(status->delayMechanism));
+	printf(STATUSPREFIX"  %d\n", "PTP domain", status->domainNumber);
+	printf(STATUSPREFIX"  %s\n", "Port state", portStateName(status->portState));
+	if(strlen(status->alarms) > 0) {
+		printf(STATUSPREFIX"  %s\n", "Alarms", status->alarms);
+	}
+	sprintIdentity(buf, status->portIdentity, status->portNumber);
+	printf(STATUSPREFIX"  %s\n", "Local port ID", buf);
+
+	if(status->portState >= PTP_MASTER) {
+		sprintIdentity(buf, status->parentIdentity, status->parentPortNumber);
+		printf(STATUSPREFIX"  %s%s\n", "Best master ID", buf,
+		    status->portState == PTP_MASTER ? " (self)" : "");
+	}
+
+	if(status->portState == PTP_SLAVE) {
+		printf(STATUSPREFIX"  Priority1 %d, Priority2 %d, clockClass %d\n", "GM priority",
+		    status->grandmasterPriority1, status->grandmasterPriority2,
+		    status->grandmasterClockClass);
+		printf(STATUSPREFIX"  UTC valid: %s, UTC offset: %d%s\n", "UTC properties",
+		    (status->timeFlags & STATUSSHM_UTC_VALID) ? "Y" : "N", status->utcOffset,
+		    (status->timeFlags & STATUSSHM_LEAP61) ? ", LEAP61 pending" :
+		    (status->timeFlags & STATUSSHM_LEAP59) ? ", LEAP59 pending" : "");
+		printf(STATUSPREFIX" % .09f s", "Offset from Master", status->offsetFromMaster / 1E9);
+		if(status->statsValid) {
+			printf(", mean % .09f s, dev % .09f s", status->ofmMean, status->ofmStdDev);
+		}
+		printf("\n");
+		printf(STATUSPREFIX" % .09f s", "Mean Path Delay", status->meanPathDelay / 1E9);
+		if(status->statsValid) {
+			printf(", mean % .09f s, dev % .09f s", status->mpdMean, status->mpdStdDev);
+		}
+		printf("\n");
+		printf(STATUSPREFIX"  %s%s%s%s%s\n", "Clock status",
+		    (status->clockFlags & STATUSSHM_CLOCK_PANIC) ? "panic mode, " : "",
+		    (status->clockFlags & STATUSSHM_CLOCK_IN_CONTROL) ? "in control" : "no control",
+		    (status->clockFlags & STATUSSHM_CLOCK_READ_ONLY) ? ", read-only" : "",
+		    (status->clockFlags & STATUSSHM_CLOCK_CALIBRATED) ? ", calibrated" : "",
+		    (status->clockFlags & STATUSSHM_CLOCK_STABLE) ? ", stabilised" : "");
+		printf(STATUSPREFIX" % .03f ppm", "Clock correction", status->observedDrift / 1000.0);
+		if(status->clockFlags & STATUSSHM_CLOCK_MAX_RATE) {
+			printf(" (slewing at maximum rate)");
+		} else if(status->statsValid) {
+			printf(", mean % .03f ppm, dev % .03f ppm",
+			    status->driftMean / 1000.0, status->driftStdDev / 1000.0);
+		}
+		printf("\n");
+	}
+
+	printf(STATUSPREFIX"  Message RX %u/s, TX %u/s", "Performance",
+	    status->messageReceiveRate, status->messageSendRate);
+	if(status->portState == PTP_MASTER && status->slaveCount) {
+		printf(", slaves %u", status->slaveCount);
+	}
+	printf("\n");
+	printf(STATUSPREFIX"  %u\n", "Announce received", status->announceReceived);
+	printf(STATUSPREFIX"  %u\n", "Sync received", status->syncReceived);
+	printf(STATUSPREFIX"  %u\n", "Follow-up received", status->followUpReceived);
+	printf(STATUSPREFIX"  %u\n", "DelayReq sent", status->delayReqSent);
+	printf(STATUSPREFIX"  %u\n", "DelayResp received", status->delayRespReceived);
+	printf(STATUSPREFIX"  %u\n", "DelayReq received", status->delayReqReceived);
+	printf(STATUSPREFIX"  %u\n", "DelayResp sent", status->delayRespSent);
+	printf(STATUSPREFIX"  %u\n", "State transitions", status->stateTransitions);
+	printf(STATUSPREFIX"  %u\n", "Announce timeouts", status->announceTimeouts);
+	printf(STATUSPREFIX"  %u discarded, %u RX errors, %u TX errors\n", "Errors",
+	    status->discardedMessages, status->messageRecvErrors, status->messageSendErrors);
+}
+
+/* one key=value per line - stable names for scripts */
+static void
+printValues(const PtpdStatus *status)
+{
+	char buf[64];
+
+	printf("updated=%lld\n", (long long)status->updated);
+	printf("pid=%d\n", status->pid);
+	printf("interface=%s\n", status->interface);
+	printf("port_state=%s\n", portStateName(status->portState));
+	printf("delay_mechanism=%s\n", delayMechanismName(status->delayMechanism));
+	printf("domain=%d\n", status->domainNumber);
+	sprintIdentity(buf, status->portIdentity, status->portNumber);
+	printf("port_id=%s\n", buf);
+	sprintIdentity(buf, status->parentIdentity, status->parentPortNumber);
+	printf("parent_id=%s\n", buf);
+	sprintIdentity(buf, status->grandmasterIdentity, 0);
+	*strrchr(buf, '/') = '\0';
+	printf("gm_id=%s\n", buf);
+	printf("gm_priority1=%d\n", status->grandmasterPriority1);
+	printf("gm_priority2=%d\n", status->grandmasterPriority2);
+	printf("gm_clock_class=%d\n", status->grandmasterClockClass);
+	printf("utc_offset=%d\n", status->utcOffset);
+	printf("utc_valid=%d\n", (status->timeFlags & STATUSSHM_UTC_VALID) ? 1 : 0);
+	printf("offset_ns=%lld\n", (long long)status->offsetFromMaster);
+	printf("path_delay_ns=%lld\n", (long long)status->meanPathDelay);
+	printf("drift_ppb=%.3f\n", status->observedDrift);
+	if(status->statsValid) {
+		printf("offset_mean=%.09f\n", status->ofmMean);
+		printf("offset_stddev=%.09f\n", status->ofmStdDev);
+		printf("path_delay_mean=%.09f\n", status->mpdMean);
+		printf("path_delay_stddev=%.09f\n", status->mpdStdDev);
+		printf("drift_mean_ppb=%.3f\n", status->driftMean);
+		printf("drift_stddev_ppb=%.3f\n", status->driftStdDev);
+	}
+	printf("in_control=%d\n", (status->clockFlags & STATUSSHM_CLOCK_IN_CONTROL) ? 1 : 0);
+	printf("stable=%d\n", (status->clockFlags & STATUSSHM_CLOCK_STABLE) ? 1 : 0);
+	printf("alarms_set=0x%04x\n", status->alarmsSet);
+	printf("alarms_cleared=0x%04x\n", status->alarmsCleared);
+	printf("rx_rate=%u\n", status->messageReceiveRate);
+	printf("tx_rate=%u\n", status->messageSendRate);
+	printf("announce_received=%u\n", status->announceReceived);
+	printf("sync_received=%u\n", status->syncReceived);
+	printf("followup_received=%u\n", status->followUpReceived);
+	printf("delayreq_sent=%u\n", status->delayReqSent);
+	printf("delayreq_received=%u\n", status->delayReqReceived);
+	printf("delayresp_sent=%u\n", status->delayRespSent);
+	printf("delayresp_received=%u\n", status->delayRespReceived);
+	printf("state_transitions=%u\n", status->stateTransitions);
+	printf("bm_changes=%u\n", status->bestMasterChanges);
+	printf("announce_timeouts=%u\n", status->announceTimeouts);
+	printf("discarded=%u\n", status->discardedMessages);
+	printf("rx_errors=%u\n", status->messageRecvErrors);
+	printf("tx_errors=%u\n", status->messageSendErrors);
+	printf("slaves=%u\n", status->slaveCount);
+}
+
+static void
+usage(const char *name)
+{
+	printf(
+		"\nUsage: %s [options]\n\n"
+		"Displays the status ptpd2 publishes in shared memory (global:status_shm).\n\n"
+		"-s NAME          shared memory segment name (default "STATUS_DEFAULT_NAME")\n"
+		"-k               print key=value lines instead of text\n"
+		"-w SECONDS       keep printing every SECONDS (fractions allowed)\n"
+		"-h               show this help\n"
+		"\n", name);
+}
+
+int
+main(int argc, char **argv)
+{
+	const char *name = STATUS_DEFAULT_NAME;
+	const PtpdStatusShm *shm;
+	PtpdStatus status;
+	Boolean values = FALSE;
+	double interval = 0;
+	struct timespec pause;
+	int c;
+
+	while ((c = getopt(argc, argv, "s:kw:h")) != -1) {
+		switch (c) {
+		case 's':
+			name = optarg;
+			break;
+		case 'k':
+			values = TRUE;
+			break;
+		case 'w':
+			interval = atof(optarg);
+			break;
+		case 'h':
+			usage(argv[0]);
+			return 0;
+		default:
+			usage(argv[0]);
+			return 1;
+		}
+	}
+
+	if ((shm = statusShmAttach(name)) == NULL) {
+		fprintf(stderr, "Could not open status segment %s: %s\n", name, strerror(errno));
+		return 2;
+	}
+
+	pause.tv_sec = (time_t)interval;
+	pause.tv_nsec = (long)((interval - pause.tv_sec) * 1E9);
+
+	for (;;) {
+		if (!statusShmRead(shm, &status)) {
+			fprintf(stderr, "Status segment %s has an unsupported layout or is not being updated consistently\n", name);
+			statusShmDetach(shm);
+			return 3;
+		}
+
+		if (values) {
+			printValues(&status);
+		} else {
+			printText(&status);
+		}
+
+		if (interval <= 0) {
+			break;
+		}
+
+		printf("\n");
+		fflush(stdout);
+		nanosleep(&pause, NULL);
+	}
+
+	statusShmDetach(shm);
+	return 0;
+}
@@ -63,7 +63,10 @@
 /* maximum number of missed messages of given type before we re-request */
 #define GRANT_MAX_MISSED 10
 
-static void updateUnicastIndex(UnicastGrantTable *table, UnicastGrantIndex *index);
+static void indexUnicastGrants(UnicastGrantTable *table, UnicastGrantIndex *index);
+static void unindexUnicastGrants(UnicastGrantTable *table, UnicastGrantIndex *index);
+static void removeUnicastIndexKey(UnicastGrantTable *table, UnicastGrantIndex *index, int map);
+static void resetUnicastIndex(UnicastGrantIndex *index, UnicastGrantTable *table, int capacity);
 static UnicastGrantTable* lookupUnicastIndex(PortIdentity *portIdentity, Integer32 transportAddress, UnicastGrantIndex *index);
 static int msgIndex(Enumeration8 messageType);
 static Enumeration8 msgXedni(int messageIndex);
@@ -117,52 +120,312 @@ msgXedni(int messageIndex)
     }
 }
 
-/* update index table */
+/* deletion marker: keeps probe sequences running through a slot whose entry was removed */
+static UnicastGrantTable grantIndexDeleted;
+#define GRANT_INDEX_DELETED (&grantIndexDeleted)
+
+/* only actual identities and addresses are indexed - not the empty or all-ones placeholders */
+static Boolean
+grantKeyValid(UnicastGrantTable *table, int map)
+{
+    if(map == GRANT_INDEX_BY_ADDRESS) {
+	return(table->transportAddress != 0);
+    }
+
+    return(!portIdentityEmpty(&table->portIdentity) && !portIdentityAllOnes(&table->portIdentity));
+}
+
+static Boolean
+grantKeyMatches(UnicastGrantTable *table, int map, const PortIdentity *portIdentity, Integer32 transportAddress)
+{
+    if(map == GRANT_INDEX_BY_ADDRESS) {
+	return(table->transportAddress == transportAddress);
+    }
+
+    return(!cmpPortIdentity(portIdentity, &table->portIdentity));
+}
+
+static uint32_t
+grantKeyHash(UnicastGrantIndex *index, int map, const PortIdentity *portIdentity, Integer32 transportAddress)
+{
+    if(map == GRANT_INDEX_BY_ADDRESS) {
+	return fnvHash(&transportAddress, sizeof(Integer32), index->size);
+    }
+
+    return fnvHash((void*)portIdentity, sizeof(PortIdentity), index->size);
+}
+
+/* return the slot holding the given key, or the empty slot terminating its probe sequence */
+static UnicastGrantTable**
+probeUnicastIndex(UnicastGrantIndex *index, int map, const PortIdentity *portIdentity, Integer32 transportAddress)
+{
+    uint32_t mask = index->size - 1;
+    uint32_t i = grantKeyHash(index, map, portIdentity, transportAddress);
+    UnicastGrantTable **slots = index->slots[map];
+
+    /* maps are never more than 3/4 full, so there always is an empty slot to stop at */
+    for(; slots[i] != NULL; i = (i + 1) & mask) {
+	if(slots[i] != GRANT_INDEX_DELETED &&
+	    grantKeyMatches(slots[i], map, portIdentity, transportAddress)) {
+		break;
+	}
+    }
+
+    return &slots[i];
+}
+
+/* clear both maps and re-populate them from the grant table, dropping the deletion markers */
 static void
-updateUnicastIndex(UnicastGrantTable *table, UnicastGrantIndex *index)
+rebuildUnicastIndex(UnicastGrantIndex *index)
 {
-    uint32_t hash = fnvHash(&table->portIdentity, sizeof(PortIdentity), UNICAST_MAX_DESTINATIONS);
+    int i;
+
+    for(i = 0; i < GRANT_INDEX_MAPS; i++) {
+	memset(index->slots[i], 0, index->size * sizeof(UnicastGrantTable*));
+	index->filled[i] = 0;
+    }
 
-    /* peer table normally has one entry: if we got here, we might pollute the main index */
-    if(!table->isPeer && index != NULL) {
-	index->data[hash] = table;
+    for(i = 0; i < index->used; i++) {
+	indexUnicastGrants(&index->table[i], index);
     }
+
+    DBG("rebuildUnicastIndex: re-indexed %d grant table entries\n", index->used);
 }
 
-/* return matching entry from index table */
+static void
+addUnicastIndexKey(UnicastGrantTable *table, UnicastGrantIndex *index, int map)
+{
+    UnicastGrantTable **slot;
+    UnicastGrantTable **firstDeleted = NULL;
+    uint32_t mask = index->size - 1;
+    uint32_t i;
+
+    if(!grantKeyValid(table, map)) {
+	return;
+    }
+
+    i = grantKeyHash(index, map, &table->portIdentity, table->transportAddress);
+
+    for(slot = &index->slots[map][i]; *slot != NULL; i = (i + 1) & mask, slot = &index->slots[map][i]) {
+	if(*slot == GRANT_INDEX_DELETED) {
+	    if(firstDeleted == NULL) {
+		firstDeleted = slot;
+	    }
+	/* key already held by an entry (this one, or one earlier in the table, as a linear search would find) */
+	} else if(grantKeyMatches(*slot, map, &table->portIdentity, table->transportAddress)) {
+	    return;
+	}
+    }
+
+    if(firstDeleted != NULL) {
+	*firstDeleted = table;
+	return;
+    }
+
+    *slot = table;
+    index->filled[map]++;
+
+    if(index->filled[map] > (index->size / 4) * 3) {
+	rebuildUnicastIndex(index);
+    }
+}
+
+static void
+removeUnicastIndexKey(UnicastGrantTable *table, UnicastGrantIndex *index, int map)
+{
+    UnicastGrantTable **slot;
+
+    if(index->slots[map] == NULL || !grantKeyValid(table, map)) {
+	return;
+    }
+
+    slot = probeUnicastIndex(index, map, &table->portIdentity, table->transportAddress);
+
+    /* only drop the key if it is this entry holding it */
+    if(*slot == table) {
+	*slot = GRANT_INDEX_DELETED;
+    }
+}
+
+/* index the entry under its current port identity and transport address */
+static void
+indexUnicastGrants(UnicastGrantTable *table, UnicastGrantIndex *index)
+{
+    /* peer table is not part of the main grant table: if we got here, we might pollute the main index */
+    if(index == NULL || index->table == NULL || table->isPeer ||
+	table < index->table || table >= index->table + index->capacity) {
+	    return;
+    }
+
+    addUnicastIndexKey(table, index, GRANT_INDEX_BY_PORT);
+    addUnicastIndexKey(table, index, GRANT_INDEX_BY_ADDRESS);
+}
+
+/* remove the entry from the index - before its port identity or transport address changes */
+static void
+unindexUnicastGrants(UnicastGrantTable *table, UnicastGrantIndex *index)
+{
+    if(index == NULL || index->table == NULL) {
+	return;
+    }
+
+    removeUnicastIndexKey(table, index, GRANT_INDEX_BY_PORT);
+    removeUnicastIndexKey(table, index, GRANT_INDEX_BY_ADDRESS);
+}
+
+/* return matching entry from index table: port identity match first, transport address match second */
 static UnicastGrantTable*
 lookupUnicastIndex(PortIdentity *portIdentity, Integer32 transportAddress, UnicastGrantIndex *index)
 {
-    uint32_t hash = fnvHash((void*)portIdentity, sizeof(PortIdentity), UNICAST_MAX_DESTINATIONS);
-
     UnicastGrantTable* table;
 
-    if(index == NULL) {
+    if(index == NULL || index->table == NULL) {
 	return NULL;
     }
 
-    table  = index->data[hash];
+    table = *probeUnicastIndex(index, GRANT_INDEX_BY_PORT, portIdentity, 0);
 
-    if(table == NULL) {
-	DBG("lookupUnicastIndex: empty hit\n");
-	return NULL;
+    if(table == NULL && transportAddress) {
+	table = *probeUnicastIndex(index, GRANT_INDEX_BY_ADDRESS, NULL, transportAddress);
     }
 
-    if(!cmpPortIdentity(portIdentity, &table->portIdentity)) {
-	DBG("lookupUnicastIndex: cache hit\n");
-	return table;
+    if(table == NULL) {
+	DBG("lookupUnicastIndex: no match\n");
     } else {
-	/* hash collision */
-	DBG("lookupUnicastIndex: hash collision\n");
-	return NULL;
+	DBG("lookupUnicastIndex: found entry %d\n", (int)(table - index->table));
+    }
+
+    return table;
+}
+
+/* (re)initialise the index for the given grant table */
+static void
+resetUnicastIndex(UnicastGrantIndex *index, UnicastGrantTable *table, int capacity)
+{
+    int i;
+
+    index->table = table;
+    index->capacity = capacity;
+    index->used = 0;
+
+    for(i = 0; i < GRANT_INDEX_MAPS; i++) {
+	if(index->slots[i] != NULL) {
+	    memset(index->slots[i], 0, index->size * sizeof(UnicastGrantTable*));
+	}
+	index->filled[i] = 0;
     }
 }
 
+/* allocate (or resize) the unicast grant table, destination table and their indexes, including the Sync index and pacers */
+Boolean
+allocUnicastGrantTable(PtpClock *ptpClock, int capacity)
+{
+    int i, j;
+    int size = 8;
+    UnicastGrantTable *grants;
+    UnicastDestination *destinations;
+    SyncDestEntry *syncIndex;
+    UnicastGrantTable **slots[GRANT_INDEX_MAPS];
+    int *pacing;
+
+    /* keep the maps at most half full with the whole table in use */
+    while(size < 2 * capacity) {
+	size <<= 1;
+    }
+
+    grants = (UnicastGrantTable*)calloc(capacity, sizeof(UnicastGrantTable));
+    destinations = (UnicastDestination*)calloc(capacity, sizeof(UnicastDestination));
+    syncIndex = (SyncDestEntry*)calloc(size, sizeof(SyncDestEntry));
+    /* Sync and Announce pacer: slot order and scratch space each */
+    pacing = (int*)calloc(4 * capacity, sizeof(int));
+    for(i = 0; i < GRANT_INDEX_MAPS; i++) {
+	slots[i] = (UnicastGrantTable**)calloc(size, sizeof(UnicastGrantTable*));
+    }
+
+    if(grants == NULL || destinations == NULL || syncIndex == NULL || pacing == NULL ||
+	slots[GRANT_INDEX_BY_PORT] == NULL || slots[GRANT_INDEX_BY_ADDRESS] == NULL) {
+	    PERROR("failed to allocate memory for %d unicast destinations", capacity);
+	    free(grants);
+	    free(destinations);
+	    free(syncIndex);
+	    free(pacing);
+	    for(i = 0; i < GRANT_INDEX_MAPS; i++) {
+		free(slots[i]);
+	    }
+	    return FALSE;
+    }
+
+    freeUnicastGrantTable(ptpClock);
+
+    ptpClock->unicastGrants = grants;
+    ptpClock->unicastDestinations = destinations;
+    ptpClock->syncDestTable.entry = syncIndex;
+    ptpClock->syncDestTable.size = size;
+    ptpClock->syncDestTable.filled = 0;
+    ptpClock->syncDestTable.generation = 1;
+    ptpClock->syncPacer.order = pacing;
+    ptpClock->syncPacer.due = pacing + capacity;
+    ptpClock->announcePacer.order = pacing + 2 * capacity;
+    ptpClock->announcePacer.due = pacing + 3 * capacity;
+    ptpClock->unicastCapacity = capacity;
+
+    for(i = 0; i < GRANT_INDEX_MAPS; i++) {
+	ptpClock->grantIndex.slots[i] = slots[i];
+    }
+    ptpClock->grantIndex.size = size;
+    resetUnicastIndex(&ptpClock->grantIndex, grants, capacity);
+
+    /* fixed unicast destinations never go through initUnicastGrantTable() - phase them here */
+    for(i = 0; i < capacity; i++) {
+	for(j = 0; j < PTP_MAX_MESSAGE_INDEXED; j++) {
+	    grants[i].grantData[j].phase = (UInteger16)(i * UNICAST_PACING_PHASE_STEP);
+	}
+    }
+
+    DBG("allocated %d bytes for %d unicast destinations\n",
+	(int)(capacity * (sizeof(UnicastGrantTable) + sizeof(UnicastDestination)) +
+	size * (GRANT_INDEX_MAPS * sizeof(UnicastGrantTable*) + sizeof(SyncDestEntry)) +
+	4 * capacity * sizeof(int)), capacity);
+
+    return TRUE;
+}
+
+void
+freeUnicastGrantTable(PtpClock *ptpClock)
+{
+    int i;
+
+    /* anything pointing into the old table is now invalid */
+    ptpClock->parentGrants = NULL;
+    ptpClock->previousGrants = NULL;
+    ptpClock->unicastDestinationCount = 0;
+    ptpClock->unicastCapacity = 0;
+
+    SAFE_FREE(ptpClock->unicastGrants);
+    SAFE_FREE(ptpClock->unicastDestinations);
+    SAFE_FREE(ptpClock->syncDestTable.entry);
+    ptpClock->syncDestTable.size = 0;
+
+    /* both pacers share one allocation, and a round in progress refers to the old table */
+    SAFE_FREE(ptpClock->syncPacer.order);
+    memset(&ptpClock->syncPacer, 0, sizeof(UnicastPacer));
+    memset(&ptpClock->announcePacer, 0, sizeof(UnicastPacer));
+
+    for(i = 0; i < GRANT_INDEX_MAPS; i++) {
+	SAFE_FREE(ptpClock->grantIndex.slots[i]);
+	ptpClock->grantIndex.filled[i] = 0;
+    }
+
+    ptpClock->grantIndex.table = NULL;
+    ptpClock->grantIndex.capacity = 0;
+    ptpClock->grantIndex.used = 0;
+    ptpClock->grantIndex.size = 0;
+}
 
 /* find which grant table entry the given port belongs to:
    - if not found, return first free entry, store portID and/or address
    - if found, find the entry it belongs to
-   - look up the index table, only iterate on miss
+   - the main grant table is fully indexed, other tables (peer) are searched
    - if update is FALSE, only a search is performed
 */
 UnicastGrantTable*
@@ -178,27 +441,53 @@ findUnicastGrants
 
 	PortIdentity tmpIdentity = *portIdentity;
 
-	/* look up the index table*/
+	Boolean indexed = (index != NULL && index->table != NULL && grantTable == index->table);
+
 	if(index != NULL) {
 	    tmpIdentity.portNumber |= index->portMask;
-	    found = lookupUnicastIndex(&tmpIdentity, transportAddress, index);
 	}
 
-	if(found != NULL) {
-	    DBG("findUnicastGrants: cache hit\n");
-		/* do not overwrite address if zero given
-		 * (used by slave to preserve configured master addresses)
-		 */
-		if(update && transportAddress) {
-		    found->transportAddress = transportAddress;
-		}
+	if(indexed) {
+
+	    found = lookupUnicastIndex(&tmpIdentity, transportAddress, index);
+
+	    if(found != NULL && (found - grantTable) >= nodeCount) {
+		found = NULL;
+	    }
+
+	    if(found != NULL) {
+		DBG("findUnicastGrants: index hit\n");
 		if(update) {
+		    unindexUnicastGrants(found, index);
+		    /* do not overwrite address if zero given
+		     * (used by slave to preserve configured master addresses)
+		     */
+		    if(transportAddress) {
+			found->transportAddress = transportAddress;
+		    }
 		    found->portIdentity = tmpIdentity;
+		    indexUnicastGrants(found, index);
 		}
+		return found;
+	    }
 
-		if(update) {
-		    updateUnicastIndex(found, index);
+	    if(!update) {
+		return NULL;
+	    }
+
+	    /* first free entry: re-use an expired one, otherwise take the next one never used */
+	    for(i = 0; i < index->used && i < nodeCount; i++) {
+		nodeTable = &grantTable[i];
+		if(portIdentityEmpty(&nodeTable->portIdentity) ||
+		    (nodeTable->timeLeft == 0)) {
+			firstFree = nodeTable;
+			break;
 		}
+	    }
+
+	    if(firstFree == NULL && index->used < nodeCount) {
+		firstFree = &grantTable[index->used++];
+	    }
 
 	} else for(i=0; i < nodeCount; i++) {
 
@@ -229,11 +518,7 @@ findUnicastGrants
 		    found->portIdentity = tmpIdentity;
 		}
 
-		DBG("findUnicastGrants: cache miss - %d iterations %d\n", i);
-
-		if(update) {
-		    updateUnicastIndex(found, index);
-		}
+		DBG("findUnicastGrants: found after %d iterations\n", i);
 
 		break;
 
@@ -246,7 +531,6 @@ findUnicastGrants
 		found = nodeTable;
 		if(update) {
 			found->portIdentity = tmpIdentity;
-			updateUnicastIndex(found, index);
 		}
 		break;
 	    }
@@ -259,9 +543,14 @@ findUnicastGrants
 
     /* will return NULL if there are no free slots, otherwise the first free slot */
     if(update && firstFree != NULL) {
+	if(indexed) {
+	    unindexUnicastGrants(firstFree, index);
+	}
 	firstFree->portIdentity = tmpIdentity;
 	firstFree->transportAddress = transportAddress;
-	updateUnicastIndex(firstFree, index);
+	if(indexed) {
+	    indexUnicastGrants(firstFree, index);
+	}
 	/* new set of grants - reset sequence numbers */
 	for(i=0; i < PTP_MAX_MESSAGE_INDEXED; i++) {
 	    firstFree->grantData[i].sentSeqId = 0;
@@ -339,10 +628,10 @@ handleSMRequestUnicastTransmission(MsgSignaling* incoming, MsgSignaling* outgoin
 			getMessageTypeName(messageType), portId, inet_ntoa(tmpAddr), requestData->durationField,
 			requestData->logInterMessagePeriod);
 
-	nodeTable = findUnicastGrants(&incoming->header.sourcePortIdentity, sourceAddress, ptpClock->unicastGrants, &ptpClock->grantIndex, UNICAST_MAX_DESTINATIONS, TRUE);
+	nodeTable = findUnicastGrants(&incoming->header.sourcePortIdentity, sourceAddress, ptpClock->unicastGrants, &ptpClock->grantIndex, ptpClock->unicastCapacity, TRUE);
 
 	if(nodeTable == NULL) {
-		if(ptpClock->slaveCount >= UNICAST_MAX_DESTINATIONS) {
+		if(ptpClock->slaveCount >= ptpClock->unicastCapacity) {
 			DBG("REQUEST_UNICAST_TRANSMISSION (%s): did not find node in slave table : %s (%s) - table full\n", getMessageTypeName(messageType),
 			inet_ntoa(tmpAddr),portId);
 		} else {
@@ -564,7 +853,7 @@ handleSMCancelUnicastTransmission(MsgSignaling* incoming, MsgSignaling* outgoing
 
 	ptpClock->counters.unicastGrantsCancelReceived++;
 
-	nodeTable = findUnicastGrants(&incoming->header.sourcePortIdentity, sourceAddress, ptpClock->unicastGrants, &ptpClock->grantIndex, UNICAST_MAX_DESTINATIONS, FALSE);
+	nodeTable = findUnicastGrants(&incoming->header.sourcePortIdentity, sourceAddress, ptpClock->unicastGrants, &ptpClock->grantIndex, ptpClock->unicastCapacity, FALSE);
 
 	if(nodeTable == NULL) {
 		DBG("CANCEL_UNICAST_TRANSMISSION: did not find node in slave table: %s\n", portId);
@@ -637,7 +926,7 @@ handleSMAcknowledgeCancelUnicastTransmission(MsgSignaling* incoming, Integer32 s
 	DBGV("Received ACKNOWLEDGE_CANCEL_UNICAST_TRANSMISSION message for message %s from %s(%s)\n",
 			getMessageTypeName(messageType), portId, inet_ntoa(tmpAddr));
 
-	nodeTable = findUnicastGrants(&incoming->header.sourcePortIdentity, sourceAddress, ptpClock->unicastGrants, &ptpClock->grantIndex, UNICAST_MAX_DESTINATIONS, FALSE);
+	nodeTable = findUnicastGrants(&incoming->header.sourcePortIdentity, sourceAddress, ptpClock->unicastGrants, &ptpClock->grantIndex, ptpClock->unicastCapacity, FALSE);
 
 	if(nodeTable == NULL) {
 		DBG("ACKNOWLEDGE_CANCEL_UNICAST_TRANSMISSION: did not find node in slave table: %s\n", portId);
@@ -766,10 +1055,11 @@ initUnicastGrantTable(UnicastGrantTable *grantTable, Enumeration8 delayMechanism
     UnicastGrantData *grantData;
     UnicastGrantTable *nodeTable;
 
-    /* initialise the index table */
-    for(i=0; i < UNICAST_MAX_DESTINATIONS; i++) {
-	ptpClock->grantIndex.data[i] = NULL;
-	ptpClock->syncDestIndex[i].transportAddress = 0;
+    Boolean indexed = (grantTable == ptpClock->unicastGrants);
+
+    /* initialise the index tables - the peer table is not indexed */
+    if(indexed) {
+	resetUnicastIndex(&ptpClock->grantIndex, ptpClock->unicastGrants, ptpClock->unicastCapacity);
     }
 
     ptpClock->grantIndex.portMask = rtOpts->unicastPortMask;
@@ -790,6 +1080,10 @@ initUnicastGrantTable(UnicastGrantTable *grantTable, Enumeration8 delayMechanism
 	    /* for masters: all-ones initially */
 	    nodeTable->portIdentity.portNumber = 0xFFFF;
 	    memset(&nodeTable->portIdentity.clockIdentity, 0xFF, CLOCK_IDENTITY_LENGTH);
+	    if(indexed) {
+		ptpClock->grantIndex.used = j + 1;
+		indexUnicastGrants(nodeTable, &ptpClock->grantIndex);
+	    }
 	}
 
 	for(i=0; i< PTP_MAX_MESSAGE_INDEXED; i++) {
@@ -800,6 +1094,7 @@ initUnicastGrantTable(UnicastGrantTable *grantTable, Enumeration8 delayMechanism
 
 	    grantData->parent = nodeTable;
 	    grantData->messageType = msgXedni(i);
+	    grantData->phase = (UInteger16)(j * UNICAST_PACING_PHASE_STEP);
 
 	    switch(grantData->messageType) {
 
@@ -845,6 +1140,11 @@ initUnicastGrantTable(UnicastGrantTable *grantTable, Enumeration8 delayMechanism
 	}
 
     }
+
+    /* the kernel filter accepts the destinations' domains - they may have just changed */
+    if(destinations != NULL) {
+	netUpdateFilter(ptpClock->netPath, rtOpts, ptpClock);
+    }
 }
 
 
@@ -1302,6 +1602,7 @@ refreshUnicastGrants(UnicastGrantTable *grantTable, int nodeCount, const RunTime
 	    /* Reggae version:     Matic in dem way, chopper in dem hand, hey, some a dem have M16 'pon dem shoulder */
 	    /* Factual version:    Make sure the node is re-usable: reset PortIdentity to all-ones again */
 	    if(nodeTable->timeLeft == 0) {
+		removeUnicastIndexKey(nodeTable, &ptpClock->grantIndex, GRANT_INDEX_BY_PORT);
 		nodeTable->portIdentity.portNumber = 0xFFFF;
 		memset(&nodeTable->portIdentity.clockIdentity, 0xFF, CLOCK_IDENTITY_LENGTH);
 		DBG("Unicast node %d now free and reusable\n", j);
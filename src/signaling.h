@@ -3,7 +3,6 @@
 #define SIGNALING_H_
 
 #include "constants.h" // For PTP_MAX_MESSAGE_INDEXED
-#include "dep/constants_dep.h" // For UNICAST_MAX_DESTINATION
 #include "ptp_primitives.h"
 #include "ptp_datatypes.h"
 #include "datatypes_stub.h"
@@ -21,6 +20,7 @@ typedef struct UnicastGrantData {
 	Integer8	logMaxInterval;		/* maximum interval we're going to request */
 	UInteger16	sentSeqId;		/* used by masters: last sent sequence id */
 	UInteger32	intervalCounter;	/* used as a modulo counter to allow different message rates for different slaves */
+	UInteger16	phase;			/* master: position within the interval this is paced at, in 1/65536 of the interval */
 	Boolean		expired;		/* TRUE -> grant has expired */
 	Boolean         granted;		/* master: we have granted this, slave: we have been granted this */
 	UInteger32      timeLeft;		/* countdown timer for aging out grants */
@@ -37,21 +37,32 @@ struct UnicastGrantTable {
 	UnicastGrantData	grantData[PTP_MAX_MESSAGE_INDEXED];/* master: grantee's grants, slave: grantor's grant status */
 	UInteger32		timeLeft;		/* time until expiry of last grant (max[grants.timeLeft]. when runs out and no renewal, entry can be re-used */
 	Boolean			isPeer;			/* this entry is peer only */
-	TimeInternal		lastSyncTimestamp;		/* last Sync message timestamp sent */
 };
 
-/* Unicast index holder: data + port mask */
+/* unicast index maps: grant table entries can be looked up by port identity or by transport address */
+#define GRANT_INDEX_BY_PORT	0
+#define GRANT_INDEX_BY_ADDRESS	1
+#define GRANT_INDEX_MAPS	2
+
+/*
+ * Unicast index holder: open addressing (linear probing) hash maps over the grant table,
+ * sized to at least twice the table capacity, so lookups never give up on a collision
+ */
 typedef struct UnicastGrantIndex {
-	UnicastGrantTable* data[UNICAST_MAX_DESTINATIONS];
-	UInteger16 portMask;
+	UnicastGrantTable*	table;				/* the grant table being indexed */
+	int			capacity;			/* number of entries in the grant table */
+	int			used;				/* high water mark: entries above this were never handed out */
+	int			size;				/* number of slots in each map, power of 2 */
+	UnicastGrantTable**	slots[GRANT_INDEX_MAPS];	/* NULL: empty slot */
+	int			filled[GRANT_INDEX_MAPS];	/* slots holding an entry or a deletion marker */
+	UInteger16		portMask;
 } UnicastGrantIndex;
 
-/* Unicast destination configuration: Address, domain, preference, last Sync timestamp sent */
+/* Unicast destination configuration: Address, domain, preference */
 typedef struct UnicastDestination {
 	Integer32		transportAddress;		/* destination address */
 	UInteger8		domainNumber;			/* domain number - for slaves with masters in multiple domains */
 	UInteger8		localPreference;		/* local preference to influence BMC */
-	TimeInternal		lastSyncTimestamp;		/* last Sync timestamp sent */
 } UnicastDestination;
 
 
@@ -75,6 +86,8 @@ void initUnicastGrantTable
  PtpClock* ptpClock
  );
 
+Boolean allocUnicastGrantTable(PtpClock* ptpClock, int capacity);
+void freeUnicastGrantTable(PtpClock* ptpClock);
 void updateUnicastGrantTable(UnicastGrantTable* grantTable, int nodeCount, const RunTimeOpts *rtOpts);
 void cancelUnicastTransmission(UnicastGrantData*, const RunTimeOpts*, PtpClock*);
 void cancelAllGrants(UnicastGrantTable* grantTable, int nodeCount, const RunTimeOpts* rtOpts, PtpClock* ptpClock);
@@ -24,6 +24,7 @@
 #endif
 #include "datatypes.h"
 #include "dep/sys.h" // Only for updateLeapInfo, getTime, updateXtmp
+#include "dep/clockbackend.h"
 #include "ptpd_logging.h"
 #include "ptpd_utils.h"
 
@@ -429,6 +430,12 @@ ptpServiceClockUpdate (TimingService* service)
 
 	DBG_LOCAL_ID(service, "clock status update\n");
 
+	/* kernel flags, RTC and utmp belong to the system clock, not a simulated one */
+	if(!clockBackendIsSystem()) {
+		ptpClock->clockStatus.update = FALSE;
+		return 1;
+	}
+
 #if defined(MOD_TAI) &&  NTP_API == 4
 	setKernelUtcOffset(clockStatus->utcOffset);
 